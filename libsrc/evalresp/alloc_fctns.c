@@ -15,14 +15,184 @@
 #include "evalresp/public_api.h"
 #include "evalresp_log/log.h"
 
+/* chunks start small, since channels read in parallel each have an arena
+   of their own, and double up to a limit; anything larger than the next
+   chunk gets a chunk to itself */
+#define ARENA_FIRST 4096
+#define ARENA_LIMIT 1048576
+#define ARENA_ALIGN 16
+
+typedef struct arena_chunk_s
+{
+  struct arena_chunk_s *next;
+  size_t size; /* bytes after the header */
+  size_t used;
+} arena_chunk;
+
+/* the header, rounded up so that the memory after it is aligned */
+#define CHUNK_HEADER ((sizeof (arena_chunk) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+struct evalresp_arena_s
+{
+  arena_chunk *chunks; /* the one in use first */
+  size_t next_size;
+};
+
+int
+new_arena (evalresp_logger *log, evalresp_arena **arena)
+{
+  int status = EVALRESP_OK;
+  if (!(*arena = calloc (1, sizeof (**arena))))
+  {
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate arena");
+    status = EVALRESP_MEM;
+  }
+  else
+  {
+    (*arena)->next_size = ARENA_FIRST;
+  }
+  return status;
+}
+
+/* chunks are calloc'ed and never reused, so the memory is zeroed */
+static void *
+arena_alloc (evalresp_arena *arena, size_t size)
+{
+  arena_chunk *chunk = arena->chunks;
+  char *ptr;
+
+  /* (a negative count, say) */
+  if (size > (size_t)-1 - CHUNK_HEADER - ARENA_ALIGN)
+  {
+    return NULL;
+  }
+  size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+  if (!chunk || chunk->size - chunk->used < size)
+  {
+    if (size >= arena->next_size)
+    {
+      if (!(chunk = calloc (1, CHUNK_HEADER + size)))
+      {
+        return NULL;
+      }
+      chunk->size = chunk->used = size;
+      /* keep filling the current chunk */
+      if (arena->chunks)
+      {
+        chunk->next = arena->chunks->next;
+        arena->chunks->next = chunk;
+      }
+      else
+      {
+        arena->chunks = chunk;
+      }
+      return (char *)chunk + CHUNK_HEADER;
+    }
+    if (!(chunk = calloc (1, CHUNK_HEADER + arena->next_size)))
+    {
+      return NULL;
+    }
+    chunk->size = arena->next_size;
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    if (arena->next_size < ARENA_LIMIT)
+    {
+      arena->next_size *= 2;
+    }
+  }
+  ptr = (char *)chunk + CHUNK_HEADER + chunk->used;
+  chunk->used += size;
+  return ptr;
+}
+
+void *
+arena_calloc (evalresp_logger *log, evalresp_arena *arena, const char *name, int n, size_t size)
+{
+  void *ptr = NULL;
+  if (n > 0)
+  {
+    if ((size_t)n > ((size_t)-1 - CHUNK_HEADER) / size || !(ptr = arena ? arena_alloc (arena, n * size) : calloc (n, size)))
+    {
+      evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate %s", name);
+    }
+  }
+  return ptr;
+}
+
+void *
+arena_realloc (evalresp_arena *arena, void *ptr, size_t old_size, size_t size)
+{
+  void *more;
+  if (!arena)
+  {
+    return realloc (ptr, size);
+  }
+  if (size <= old_size)
+  {
+    return ptr;
+  }
+  /* the old memory is released with the arena */
+  if ((more = arena_alloc (arena, size)) && old_size)
+  {
+    memcpy (more, ptr, old_size);
+  }
+  return more;
+}
+
+void
+join_arenas (evalresp_arena *arena, evalresp_arena **other)
+{
+  arena_chunk *last;
+  if (*other && (*other)->chunks)
+  {
+    for (last = (*other)->chunks; last->next; last = last->next)
+      ;
+    /* behind the chunk in use, which stays in use */
+    if (arena->chunks)
+    {
+      last->next = arena->chunks->next;
+      arena->chunks->next = (*other)->chunks;
+    }
+    else
+    {
+      arena->chunks = (*other)->chunks;
+    }
+  }
+  free (*other);
+  *other = NULL;
+}
+
+void
+free_arena (evalresp_arena **arena)
+{
+  arena_chunk *chunk, *next;
+  if (*arena)
+  {
+    for (chunk = (*arena)->chunks; chunk; chunk = next)
+    {
+      next = chunk->next;
+      free (chunk);
+    }
+    free (*arena);
+  }
+  *arena = NULL;
+}
+
+/* the zeroed memory of a new object, from the arena if there is one */
+static void *
+alloc_zeroed (evalresp_arena *arena, size_t size)
+{
+  return arena ? arena_alloc (arena, size) : calloc (1, size);
+}
+
 evalresp_complex *
-alloc_complex (int npts, evalresp_logger *log)
+alloc_complex (int npts, evalresp_arena *arena, evalresp_logger *log)
 {
   evalresp_complex *cptr;
 
   if (npts)
   {
-    if (!(cptr = malloc (npts * sizeof (*cptr))))
+    if (!(cptr = alloc_zeroed (arena, npts * sizeof (*cptr))))
     {
       evalresp_log (log, EV_ERROR, 0,
                     "alloc_complex; malloc() failed for (complex) vector");
@@ -112,6 +282,8 @@ alloc_scn (evalresp_logger *log)
   strncpy (scn_ptr->locid, "", LOCIDLEN);
   strncpy (scn_ptr->channel, "", CHALEN);
   scn_ptr->found = 0;
+  scn_ptr->station_glob = scn_ptr->network_glob = NULL;
+  scn_ptr->locid_glob = scn_ptr->channel_glob = NULL;
 
   return (scn_ptr);
 }
@@ -135,7 +307,7 @@ alloc_response (int npts, evalresp_logger *log)
     strncpy (rptr->locid, "", LOCIDLEN);
     strncpy (rptr->channel, "", NETLEN);
     strncpy (rptr->network, "", CHALEN);
-    rptr->rvec = alloc_complex (npts, log);
+    rptr->rvec = alloc_complex (npts, NULL, log);
     cvec = rptr->rvec;
     for (k = 0; k < npts; k++)
     {
@@ -226,13 +398,13 @@ alloc_matched_files (evalresp_logger *log)
 
 // TODO - replace with calloc_doubles below?
 double *
-alloc_double (int npts, evalresp_logger *log)
+alloc_double (int npts, evalresp_arena *arena, evalresp_logger *log)
 {
   double *dptr;
 
   if (npts)
   {
-    if (!(dptr = (double *)malloc (npts * sizeof (double))))
+    if (!(dptr = (double *)alloc_zeroed (arena, npts * sizeof (double))))
     {
       evalresp_log (log, EV_ERROR, 0,
                     "alloc_double; malloc() failed for (double) vector");
@@ -286,11 +458,11 @@ alloc_char_ptr (int len, evalresp_logger *log)
 }
 
 evalresp_blkt *
-alloc_pz (evalresp_logger *log)
+alloc_pz (evalresp_arena *arena, evalresp_logger *log)
 {
   evalresp_blkt *blkt_ptr;
 
-  if (!(blkt_ptr = (evalresp_blkt *)malloc (sizeof (evalresp_blkt))))
+  if (!(blkt_ptr = (evalresp_blkt *)alloc_zeroed (arena, sizeof (evalresp_blkt))))
   {
     evalresp_log (log, EV_ERROR, 0,
                   "alloc_pz; malloc() failed for (Poles & Zeros) blkt structure");
@@ -308,11 +480,11 @@ alloc_pz (evalresp_logger *log)
 }
 
 evalresp_blkt *
-alloc_coeff (evalresp_logger *log)
+alloc_coeff (evalresp_arena *arena, evalresp_logger *log)
 {
   evalresp_blkt *blkt_ptr;
 
-  if (!(blkt_ptr = (evalresp_blkt *)malloc (sizeof (*blkt_ptr))))
+  if (!(blkt_ptr = (evalresp_blkt *)alloc_zeroed (arena, sizeof (*blkt_ptr))))
   {
     evalresp_log (log, EV_ERROR, 0,
                   "alloc_coeff; malloc() failed for (FIR) blkt structure");
@@ -331,11 +503,11 @@ alloc_coeff (evalresp_logger *log)
 }
 
 evalresp_blkt *
-alloc_polynomial (evalresp_logger *log)
+alloc_polynomial (evalresp_arena *arena, evalresp_logger *log)
 {
   evalresp_blkt *blkt_ptr;
 
-  if (!(blkt_ptr = (evalresp_blkt *)calloc (1, sizeof (evalresp_blkt))))
+  if (!(blkt_ptr = (evalresp_blkt *)alloc_zeroed (arena, sizeof (evalresp_blkt))))
   {
     evalresp_log (log, EV_ERROR, 0,
                   "alloc_polynomial; calloc() failed for polynomial blkt structure");
@@ -346,11 +518,11 @@ alloc_polynomial (evalresp_logger *log)
 }
 
 evalresp_blkt *
-alloc_fir (evalresp_logger *log)
+alloc_fir (evalresp_arena *arena, evalresp_logger *log)
 {
   evalresp_blkt *blkt_ptr;
 
-  if (!(blkt_ptr = (evalresp_blkt *)malloc (sizeof (evalresp_blkt))))
+  if (!(blkt_ptr = (evalresp_blkt *)alloc_zeroed (arena, sizeof (evalresp_blkt))))
   {
     evalresp_log (log, EV_ERROR, 0,
                   "alloc_fir; malloc() failed for (FIR) blkt structure");
@@ -367,11 +539,11 @@ alloc_fir (evalresp_logger *log)
 }
 
 evalresp_blkt *
-alloc_ref (evalresp_logger *log)
+alloc_ref (evalresp_arena *arena, evalresp_logger *log)
 {
   evalresp_blkt *blkt_ptr;
 
-  if (!(blkt_ptr = (evalresp_blkt *)malloc (sizeof (evalresp_blkt))))
+  if (!(blkt_ptr = (evalresp_blkt *)alloc_zeroed (arena, sizeof (evalresp_blkt))))
   {
     evalresp_log (log, EV_ERROR, 0,
                   "alloc_ref; malloc() failed for (Resp. Ref.) blkt structure");
@@ -388,11 +560,11 @@ alloc_ref (evalresp_logger *log)
 }
 
 evalresp_blkt *
-alloc_gain (evalresp_logger *log)
+alloc_gain (evalresp_arena *arena, evalresp_logger *log)
 {
   evalresp_blkt *blkt_ptr;
 
-  if (!(blkt_ptr = (evalresp_blkt *)malloc (sizeof (evalresp_blkt))))
+  if (!(blkt_ptr = (evalresp_blkt *)alloc_zeroed (arena, sizeof (evalresp_blkt))))
   {
     evalresp_log (log, EV_ERROR, 0,
                   "alloc_gain; malloc() failed for (Gain) blkt structure");
@@ -408,11 +580,11 @@ alloc_gain (evalresp_logger *log)
 }
 
 evalresp_blkt *
-alloc_list (evalresp_logger *log)
+alloc_list (evalresp_arena *arena, evalresp_logger *log)
 {
   evalresp_blkt *blkt_ptr;
 
-  if (!(blkt_ptr = (evalresp_blkt *)malloc (sizeof (evalresp_blkt))))
+  if (!(blkt_ptr = (evalresp_blkt *)alloc_zeroed (arena, sizeof (evalresp_blkt))))
   {
     evalresp_log (log, EV_ERROR, 0,
                   "alloc_list; malloc() failed for (List) blkt structure");
@@ -430,11 +602,11 @@ alloc_list (evalresp_logger *log)
 }
 
 evalresp_blkt *
-alloc_generic (evalresp_logger *log)
+alloc_generic (evalresp_arena *arena, evalresp_logger *log)
 {
   evalresp_blkt *blkt_ptr;
 
-  if (!(blkt_ptr = (evalresp_blkt *)malloc (sizeof (evalresp_blkt))))
+  if (!(blkt_ptr = (evalresp_blkt *)alloc_zeroed (arena, sizeof (evalresp_blkt))))
   {
     evalresp_log (log, EV_ERROR, 0,
                   "alloc_generic; malloc() failed for (Generic) blkt structure");
@@ -451,11 +623,11 @@ alloc_generic (evalresp_logger *log)
 }
 
 evalresp_blkt *
-alloc_deci (evalresp_logger *log)
+alloc_deci (evalresp_arena *arena, evalresp_logger *log)
 {
   evalresp_blkt *blkt_ptr;
 
-  if (!(blkt_ptr = (evalresp_blkt *)malloc (sizeof (evalresp_blkt))))
+  if (!(blkt_ptr = (evalresp_blkt *)alloc_zeroed (arena, sizeof (evalresp_blkt))))
   {
     evalresp_log (log, EV_ERROR, 0,
                   "alloc_deci; malloc() failed for (Decimation) blkt structure");
@@ -474,11 +646,11 @@ alloc_deci (evalresp_logger *log)
 }
 
 evalresp_stage *
-alloc_stage (evalresp_logger *log)
+alloc_stage (evalresp_arena *arena, evalresp_logger *log)
 {
   evalresp_stage *stage_ptr;
 
-  if (!(stage_ptr = (evalresp_stage *)malloc (sizeof (evalresp_stage))))
+  if (!(stage_ptr = (evalresp_stage *)alloc_zeroed (arena, sizeof (evalresp_stage))))
   {
     evalresp_log (log, EV_ERROR, 0,
                   "alloc_stage; malloc() failed for stage structure");
@@ -526,6 +698,10 @@ free_scn (evalresp_sncl *ptr)
   free (ptr->network);
   free (ptr->locid);
   free (ptr->channel);
+  free_glob (&ptr->station_glob);
+  free_glob (&ptr->network_glob);
+  free_glob (&ptr->locid_glob);
+  free_glob (&ptr->channel_glob);
 }
 
 void
@@ -826,9 +1002,17 @@ evalresp_free_channels (evalresp_channels **channels)
   int i;
   if (*channels)
   {
-    for (i = 0; i < (*channels)->nchannels; ++i)
+    if ((*channels)->arena)
     {
-      evalresp_free_channel (&(*channels)->channels[i]);
+      /* the channels, with their stages and blockettes, are all here */
+      free_arena (&(*channels)->arena);
+    }
+    else
+    {
+      for (i = 0; i < (*channels)->nchannels; ++i)
+      {
+        evalresp_free_channel (&(*channels)->channels[i]);
+      }
     }
     free ((*channels)->channels);
     (*channels)->channels = NULL;
@@ -0,0 +1,766 @@
+/* binary_fctns.c */
+
+/*
+ A binary image of parsed channels, so that an inventory need only be
+ parsed (from RESP or StationXML) once and can then be reloaded quickly.
+
+ The format is versioned and little-endian whatever the host:
+
+   "EVRB" magic, then the version and the number of channels (int32)
+   for each channel:
+     the names, dates and units (each an int32 length, then the bytes)
+     the doubles and nstages of evalresp_channel, then the number of stages
+     for each stage:
+       sequence_no, input_units, output_units, the number of blockettes
+       for each blockette: the type, then the fields of its union member,
+       with arrays as an int32 count, padding to 8 bytes, then the values
+
+ Arrays are aligned in the image, so on little-endian hosts each is
+ loaded with a single memcpy (from a mapping of the file, when possible).
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./private.h"
+#include "evalresp/public_api.h"
+#include "evalresp_log/log.h"
+
+#define BINARY_MAGIC "EVRB"
+#define BINARY_VERSION 1
+/* 8 empty strings, 8 doubles, nstages and no stages */
+#define BINARY_MIN_CHANNEL 104
+
+typedef struct
+{
+  char *data;
+  size_t len, size;
+} binary_out;
+
+typedef struct
+{
+  const char *data;
+  size_t len, pos;
+  evalresp_arena *arena; /* of the channels loaded */
+} binary_in;
+
+static int
+little_endian (void)
+{
+  const int one = 1;
+  return *(const char *)&one;
+}
+
+static void
+swap_bytes (char *bytes, int n)
+{
+  char c;
+  int i;
+  for (i = 0; i < n / 2; i++)
+  {
+    c = bytes[i];
+    bytes[i] = bytes[n - 1 - i];
+    bytes[n - 1 - i] = c;
+  }
+}
+
+/*==================================================================
+ *    Writing
+ *=================================================================*/
+static int
+put_bytes (evalresp_logger *log, binary_out *out, const void *bytes, size_t n)
+{
+  char *more;
+  size_t size;
+
+  if (out->len + n > out->size)
+  {
+    for (size = out->size ? out->size : 65536; size < out->len + n; size *= 2)
+      ;
+    if (!(more = realloc (out->data, size)))
+    {
+      evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate binary image");
+      return EVALRESP_MEM;
+    }
+    out->data = more;
+    out->size = size;
+  }
+  if (bytes)
+  {
+    memcpy (out->data + out->len, bytes, n);
+  }
+  else
+  {
+    memset (out->data + out->len, 0, n);
+  }
+  out->len += n;
+  return EVALRESP_OK;
+}
+
+static int
+put_int (evalresp_logger *log, binary_out *out, int value)
+{
+  int32_t word = value;
+  if (!little_endian ())
+  {
+    swap_bytes ((char *)&word, sizeof (word));
+  }
+  return put_bytes (log, out, &word, sizeof (word));
+}
+
+static int
+put_double (evalresp_logger *log, binary_out *out, double value)
+{
+  if (!little_endian ())
+  {
+    swap_bytes ((char *)&value, sizeof (value));
+  }
+  return put_bytes (log, out, &value, sizeof (value));
+}
+
+static int
+put_string (evalresp_logger *log, binary_out *out, const char *string)
+{
+  int status, len = strlen (string);
+  if (!(status = put_int (log, out, len)))
+  {
+    status = put_bytes (log, out, string, len);
+  }
+  return status;
+}
+
+/* a count, then the values, aligned */
+static int
+put_doubles (evalresp_logger *log, binary_out *out, const double *values, int n)
+{
+  int status, i;
+  if (!(status = put_int (log, out, n)) && !(status = put_bytes (log, out, NULL, -out->len & 7)))
+  {
+    if (little_endian ())
+    {
+      status = put_bytes (log, out, values, n * sizeof (*values));
+    }
+    for (i = 0; !little_endian () && !status && i < n; i++)
+    {
+      status = put_double (log, out, values[i]);
+    }
+  }
+  return status;
+}
+
+static int
+put_blkt (evalresp_logger *log, binary_out *out, const evalresp_blkt *blkt)
+{
+  int status;
+
+  if ((status = put_int (log, out, blkt->type)))
+  {
+    return status;
+  }
+  switch (blkt->type)
+  {
+  case LAPLACE_PZ:
+  case ANALOG_PZ:
+  case IIR_PZ:
+    if (!(status = put_double (log, out, blkt->blkt_info.pole_zero.a0)) && !(status = put_double (log, out, blkt->blkt_info.pole_zero.a0_freq)) && !(status = put_doubles (log, out, (const double *)blkt->blkt_info.pole_zero.zeros, 2 * blkt->blkt_info.pole_zero.nzeros)))
+    {
+      status = put_doubles (log, out, (const double *)blkt->blkt_info.pole_zero.poles, 2 * blkt->blkt_info.pole_zero.npoles);
+    }
+    break;
+  case FIR_SYM_1:
+  case FIR_SYM_2:
+  case FIR_ASYM:
+    if (!(status = put_double (log, out, blkt->blkt_info.fir.h0)))
+    {
+      status = put_doubles (log, out, blkt->blkt_info.fir.coeffs, blkt->blkt_info.fir.ncoeffs);
+    }
+    break;
+  case FIR_COEFFS:
+  case IIR_COEFFS:
+    if (!(status = put_double (log, out, blkt->blkt_info.coeff.h0)) && !(status = put_doubles (log, out, blkt->blkt_info.coeff.numer, blkt->blkt_info.coeff.nnumer)))
+    {
+      status = put_doubles (log, out, blkt->blkt_info.coeff.denom, blkt->blkt_info.coeff.ndenom);
+    }
+    break;
+  case LIST:
+    if (!(status = put_doubles (log, out, blkt->blkt_info.list.freq, blkt->blkt_info.list.nresp)) && !(status = put_doubles (log, out, blkt->blkt_info.list.amp, blkt->blkt_info.list.nresp)))
+    {
+      status = put_doubles (log, out, blkt->blkt_info.list.phase, blkt->blkt_info.list.nresp);
+    }
+    break;
+  case GENERIC:
+    if (!(status = put_doubles (log, out, blkt->blkt_info.generic.corner_freq, blkt->blkt_info.generic.ncorners)))
+    {
+      status = put_doubles (log, out, blkt->blkt_info.generic.corner_slope, blkt->blkt_info.generic.ncorners);
+    }
+    break;
+  case DECIMATION:
+    if (!(status = put_double (log, out, blkt->blkt_info.decimation.sample_int)) && !(status = put_int (log, out, blkt->blkt_info.decimation.deci_fact)) && !(status = put_int (log, out, blkt->blkt_info.decimation.deci_offset)) && !(status = put_double (log, out, blkt->blkt_info.decimation.estim_delay)))
+    {
+      status = put_double (log, out, blkt->blkt_info.decimation.applied_corr);
+    }
+    break;
+  case GAIN:
+    if (!(status = put_double (log, out, blkt->blkt_info.gain.gain)))
+    {
+      status = put_double (log, out, blkt->blkt_info.gain.gain_freq);
+    }
+    break;
+  case REFERENCE:
+    if (!(status = put_int (log, out, blkt->blkt_info.reference.num_stages)) && !(status = put_int (log, out, blkt->blkt_info.reference.stage_num)))
+    {
+      status = put_int (log, out, blkt->blkt_info.reference.num_responses);
+    }
+    break;
+  case POLYNOMIAL:
+    if (!(status = put_int (log, out, blkt->blkt_info.polynomial.approximation_type)) && !(status = put_int (log, out, blkt->blkt_info.polynomial.frequency_units)) && !(status = put_double (log, out, blkt->blkt_info.polynomial.lower_freq_bound)) && !(status = put_double (log, out, blkt->blkt_info.polynomial.upper_freq_bound)) && !(status = put_double (log, out, blkt->blkt_info.polynomial.lower_approx_bound)) && !(status = put_double (log, out, blkt->blkt_info.polynomial.upper_approx_bound)) && !(status = put_double (log, out, blkt->blkt_info.polynomial.max_abs_error)) && !(status = put_doubles (log, out, blkt->blkt_info.polynomial.coeffs, blkt->blkt_info.polynomial.ncoeffs)))
+    {
+      status = put_doubles (log, out, blkt->blkt_info.polynomial.coeffs_err, blkt->blkt_info.polynomial.ncoeffs);
+    }
+    break;
+  default:
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot save blockette of type %d", blkt->type);
+    status = EVALRESP_ERR;
+    break;
+  }
+  return status;
+}
+
+static int
+put_stage (evalresp_logger *log, binary_out *out, const evalresp_stage *stage)
+{
+  const evalresp_blkt *blkt;
+  int status, n;
+
+  for (n = 0, blkt = stage->first_blkt; blkt; blkt = blkt->next_blkt)
+  {
+    n++;
+  }
+  if (!(status = put_int (log, out, stage->sequence_no)) && !(status = put_int (log, out, stage->input_units)) && !(status = put_int (log, out, stage->output_units)))
+  {
+    status = put_int (log, out, n);
+  }
+  for (blkt = stage->first_blkt; !status && blkt; blkt = blkt->next_blkt)
+  {
+    status = put_blkt (log, out, blkt);
+  }
+  return status;
+}
+
+static int
+put_channel (evalresp_logger *log, binary_out *out, const evalresp_channel *channel)
+{
+  const char *strings[8];
+  const double values[] = {channel->sensit, channel->sensfreq, channel->calc_sensit, channel->calc_delay,
+                           channel->estim_delay, channel->applied_corr, channel->unit_scale_fact, channel->sint};
+  const evalresp_stage *stage;
+  int status = EVALRESP_OK, i, n;
+
+  strings[0] = channel->staname;
+  strings[1] = channel->network;
+  strings[2] = channel->locid;
+  strings[3] = channel->chaname;
+  strings[4] = channel->beg_t;
+  strings[5] = channel->end_t;
+  strings[6] = channel->first_units;
+  strings[7] = channel->last_units;
+  for (i = 0; !status && i < 8; i++)
+  {
+    status = put_string (log, out, strings[i]);
+  }
+  for (i = 0; !status && i < 8; i++)
+  {
+    status = put_double (log, out, values[i]);
+  }
+  for (n = 0, stage = channel->first_stage; stage; stage = stage->next_stage)
+  {
+    n++;
+  }
+  if (!status && !(status = put_int (log, out, channel->nstages)))
+  {
+    status = put_int (log, out, n);
+  }
+  for (stage = channel->first_stage; !status && stage; stage = stage->next_stage)
+  {
+    status = put_stage (log, out, stage);
+  }
+  return status;
+}
+
+int
+evalresp_channels_save_binary (evalresp_logger *log, const evalresp_channels *channels, FILE *file)
+{
+  binary_out out = {NULL, 0, 0};
+  int status, i;
+
+  if (!(status = put_bytes (log, &out, BINARY_MAGIC, 4)) && !(status = put_int (log, &out, BINARY_VERSION)))
+  {
+    status = put_int (log, &out, channels->nchannels);
+  }
+  for (i = 0; !status && i < channels->nchannels; i++)
+  {
+    status = put_channel (log, &out, channels->channels[i]);
+  }
+  if (!status && (fwrite (out.data, 1, out.len, file) != out.len || fflush (file)))
+  {
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Error writing binary channels");
+    status = EVALRESP_IO;
+  }
+  free (out.data);
+  return status;
+}
+
+/*==================================================================
+ *    Reading
+ *=================================================================*/
+static int
+get_bytes (evalresp_logger *log, binary_in *in, void *bytes, size_t n)
+{
+  if (n > in->len - in->pos)
+  {
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Binary channels are truncated");
+    return EVALRESP_INP;
+  }
+  if (bytes)
+  {
+    memcpy (bytes, in->data + in->pos, n);
+  }
+  in->pos += n;
+  return EVALRESP_OK;
+}
+
+static int
+get_int (evalresp_logger *log, binary_in *in, int *value)
+{
+  int32_t word;
+  int status;
+  if (!(status = get_bytes (log, in, &word, sizeof (word))))
+  {
+    if (!little_endian ())
+    {
+      swap_bytes ((char *)&word, sizeof (word));
+    }
+    *value = word;
+  }
+  return status;
+}
+
+static int
+get_double (evalresp_logger *log, binary_in *in, double *value)
+{
+  int status;
+  if (!(status = get_bytes (log, in, value, sizeof (*value))) && !little_endian ())
+  {
+    swap_bytes ((char *)value, sizeof (*value));
+  }
+  return status;
+}
+
+static int
+get_string (evalresp_logger *log, binary_in *in, char *string, int size)
+{
+  int status, len;
+  if (!(status = get_int (log, in, &len)))
+  {
+    if (len < 0 || len >= size)
+    {
+      evalresp_log (log, EV_ERROR, EV_ERROR, "Bad string length (%d) in binary channels", len);
+      status = EVALRESP_INP;
+    }
+    else if (!(status = get_bytes (log, in, string, len)))
+    {
+      string[len] = '\0';
+    }
+  }
+  return status;
+}
+
+/* the values are allocated; the count is checked against the expected
+   count, if not negative */
+static int
+get_doubles (evalresp_logger *log, binary_in *in, double **values, int *n, int expected)
+{
+  int status, i;
+
+  *values = NULL;
+  if ((status = get_int (log, in, n)) || (status = get_bytes (log, in, NULL, -in->pos & 7)))
+  {
+    return status;
+  }
+  if (*n < 0 || (expected >= 0 && *n != expected) || (size_t)*n > (in->len - in->pos) / sizeof (**values))
+  {
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Bad array length (%d) in binary channels", *n);
+    return EVALRESP_INP;
+  }
+  if (*n)
+  {
+    if (!(*values = arena_calloc (log, in->arena, "array", *n, sizeof (**values))))
+    {
+      return EVALRESP_MEM;
+    }
+    if (little_endian ())
+    {
+      status = get_bytes (log, in, *values, *n * sizeof (**values));
+    }
+    for (i = 0; !little_endian () && !status && i < *n; i++)
+    {
+      status = get_double (log, in, &(*values)[i]);
+    }
+  }
+  return status;
+}
+
+/* complex values are stored as pairs of doubles */
+static int
+get_complex (evalresp_logger *log, binary_in *in, evalresp_complex **values, int *n)
+{
+  double *pairs;
+  int status, ndoubles;
+  if (!(status = get_doubles (log, in, &pairs, &ndoubles, -1)))
+  {
+    if (ndoubles % 2)
+    {
+      evalresp_log (log, EV_ERROR, EV_ERROR, "Bad complex array in binary channels");
+      status = EVALRESP_INP;
+    }
+    *n = ndoubles / 2;
+  }
+  *values = (evalresp_complex *)pairs;
+  return status;
+}
+
+static int
+get_char (evalresp_logger *log, binary_in *in, unsigned char *value)
+{
+  int status, word;
+  if (!(status = get_int (log, in, &word)))
+  {
+    *value = word;
+  }
+  return status;
+}
+
+/* the blockette is added to the stage before it is filled, so that it is
+   freed with the channel on error */
+static int
+get_blkt (evalresp_logger *log, binary_in *in, evalresp_blkt *blkt)
+{
+  int status, n;
+
+  if ((status = get_int (log, in, &blkt->type)))
+  {
+    return status;
+  }
+  switch (blkt->type)
+  {
+  case LAPLACE_PZ:
+  case ANALOG_PZ:
+  case IIR_PZ:
+    if (!(status = get_double (log, in, &blkt->blkt_info.pole_zero.a0)) && !(status = get_double (log, in, &blkt->blkt_info.pole_zero.a0_freq)) && !(status = get_complex (log, in, &blkt->blkt_info.pole_zero.zeros, &blkt->blkt_info.pole_zero.nzeros)))
+    {
+      status = get_complex (log, in, &blkt->blkt_info.pole_zero.poles, &blkt->blkt_info.pole_zero.npoles);
+    }
+    break;
+  case FIR_SYM_1:
+  case FIR_SYM_2:
+  case FIR_ASYM:
+    if (!(status = get_double (log, in, &blkt->blkt_info.fir.h0)))
+    {
+      status = get_doubles (log, in, &blkt->blkt_info.fir.coeffs, &blkt->blkt_info.fir.ncoeffs, -1);
+    }
+    break;
+  case FIR_COEFFS:
+  case IIR_COEFFS:
+    if (!(status = get_double (log, in, &blkt->blkt_info.coeff.h0)) && !(status = get_doubles (log, in, &blkt->blkt_info.coeff.numer, &blkt->blkt_info.coeff.nnumer, -1)))
+    {
+      status = get_doubles (log, in, &blkt->blkt_info.coeff.denom, &blkt->blkt_info.coeff.ndenom, -1);
+    }
+    break;
+  case LIST:
+    if (!(status = get_doubles (log, in, &blkt->blkt_info.list.freq, &blkt->blkt_info.list.nresp, -1)) && !(status = get_doubles (log, in, &blkt->blkt_info.list.amp, &n, blkt->blkt_info.list.nresp)))
+    {
+      status = get_doubles (log, in, &blkt->blkt_info.list.phase, &n, blkt->blkt_info.list.nresp);
+    }
+    break;
+  case GENERIC:
+    if (!(status = get_doubles (log, in, &blkt->blkt_info.generic.corner_freq, &blkt->blkt_info.generic.ncorners, -1)))
+    {
+      status = get_doubles (log, in, &blkt->blkt_info.generic.corner_slope, &n, blkt->blkt_info.generic.ncorners);
+    }
+    break;
+  case DECIMATION:
+    if (!(status = get_double (log, in, &blkt->blkt_info.decimation.sample_int)) && !(status = get_int (log, in, &blkt->blkt_info.decimation.deci_fact)) && !(status = get_int (log, in, &blkt->blkt_info.decimation.deci_offset)) && !(status = get_double (log, in, &blkt->blkt_info.decimation.estim_delay)))
+    {
+      status = get_double (log, in, &blkt->blkt_info.decimation.applied_corr);
+    }
+    break;
+  case GAIN:
+    if (!(status = get_double (log, in, &blkt->blkt_info.gain.gain)))
+    {
+      status = get_double (log, in, &blkt->blkt_info.gain.gain_freq);
+    }
+    break;
+  case REFERENCE:
+    if (!(status = get_int (log, in, &blkt->blkt_info.reference.num_stages)) && !(status = get_int (log, in, &blkt->blkt_info.reference.stage_num)))
+    {
+      status = get_int (log, in, &blkt->blkt_info.reference.num_responses);
+    }
+    break;
+  case POLYNOMIAL:
+    if (!(status = get_char (log, in, &blkt->blkt_info.polynomial.approximation_type)) && !(status = get_char (log, in, &blkt->blkt_info.polynomial.frequency_units)) && !(status = get_double (log, in, &blkt->blkt_info.polynomial.lower_freq_bound)) && !(status = get_double (log, in, &blkt->blkt_info.polynomial.upper_freq_bound)) && !(status = get_double (log, in, &blkt->blkt_info.polynomial.lower_approx_bound)) && !(status = get_double (log, in, &blkt->blkt_info.polynomial.upper_approx_bound)) && !(status = get_double (log, in, &blkt->blkt_info.polynomial.max_abs_error)) && !(status = get_doubles (log, in, &blkt->blkt_info.polynomial.coeffs, &blkt->blkt_info.polynomial.ncoeffs, -1)))
+    {
+      status = get_doubles (log, in, &blkt->blkt_info.polynomial.coeffs_err, &n, blkt->blkt_info.polynomial.ncoeffs);
+    }
+    break;
+  default:
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Bad blockette type (%d) in binary channels", blkt->type);
+    blkt->type = UNDEF_FILT;
+    status = EVALRESP_INP;
+    break;
+  }
+  return status;
+}
+
+static int
+get_stage (evalresp_logger *log, binary_in *in, evalresp_stage *stage)
+{
+  evalresp_blkt **blkt = &stage->first_blkt;
+  int status, i, n;
+
+  if (!(status = get_int (log, in, &stage->sequence_no)) && !(status = get_int (log, in, &stage->input_units)) && !(status = get_int (log, in, &stage->output_units)))
+  {
+    status = get_int (log, in, &n);
+  }
+  /* every stage has a blockette (normalize_response() relies on it) */
+  if (!status && n <= 0)
+  {
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Bad number of blockettes (%d) in binary channels", n);
+    status = EVALRESP_INP;
+  }
+  for (i = 0; !status && i < n; i++, blkt = &(*blkt)->next_blkt)
+  {
+    if (!(*blkt = arena_calloc (log, in->arena, "blockette", 1, sizeof (**blkt))))
+    {
+      status = EVALRESP_MEM;
+    }
+    else
+    {
+      status = get_blkt (log, in, *blkt);
+    }
+  }
+  return status;
+}
+
+static int
+get_channel (evalresp_logger *log, binary_in *in, evalresp_channel *channel)
+{
+  char *strings[8];
+  const int sizes[] = {STALEN, NETLEN, LOCIDLEN, CHALEN, DATIMLEN, DATIMLEN, MAXLINELEN, MAXLINELEN};
+  double *values[8];
+  evalresp_stage **stage = &channel->first_stage;
+  int status = EVALRESP_OK, i, n = 0;
+
+  strings[0] = channel->staname;
+  strings[1] = channel->network;
+  strings[2] = channel->locid;
+  strings[3] = channel->chaname;
+  strings[4] = channel->beg_t;
+  strings[5] = channel->end_t;
+  strings[6] = channel->first_units;
+  strings[7] = channel->last_units;
+  values[0] = &channel->sensit;
+  values[1] = &channel->sensfreq;
+  values[2] = &channel->calc_sensit;
+  values[3] = &channel->calc_delay;
+  values[4] = &channel->estim_delay;
+  values[5] = &channel->applied_corr;
+  values[6] = &channel->unit_scale_fact;
+  values[7] = &channel->sint;
+  for (i = 0; !status && i < 8; i++)
+  {
+    status = get_string (log, in, strings[i], sizes[i]);
+  }
+  for (i = 0; !status && i < 8; i++)
+  {
+    status = get_double (log, in, values[i]);
+  }
+  if (!status && !(status = get_int (log, in, &channel->nstages)))
+  {
+    status = get_int (log, in, &n);
+  }
+  /* evaluation walks nstages stages, so it must be the number read */
+  if (!status && n != channel->nstages)
+  {
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Bad number of stages (header says %d, found %d) in binary channels",
+                  channel->nstages, n);
+    status = EVALRESP_INP;
+  }
+  for (i = 0; !status && i < n; i++, stage = &(*stage)->next_stage)
+  {
+    if (!(*stage = arena_calloc (log, in->arena, "stage", 1, sizeof (**stage))))
+    {
+      status = EVALRESP_MEM;
+    }
+    else
+    {
+      status = get_stage (log, in, *stage);
+    }
+  }
+  return status;
+}
+
+/* the image may have been damaged or edited after it was saved, so the
+   layout that check_channel() leaves, and that evaluation relies on, is
+   checked again here without changing the channel: every digital filter
+   is followed by its decimation blockette, which carries the sample
+   interval */
+static int
+check_loaded_channel (evalresp_logger *log, const evalresp_channel *channel)
+{
+  const evalresp_stage *stage;
+  const evalresp_blkt *blkt;
+  int i;
+
+  for (stage = channel->first_stage, i = 1; stage; stage = stage->next_stage, i++)
+  {
+    if (stage->input_units < UNDEF_UNITS || stage->input_units > CENTIGRADE || stage->output_units < UNDEF_UNITS || stage->output_units > CENTIGRADE)
+    {
+      evalresp_log (log, EV_ERROR, EV_ERROR, "%s.%s.%s.%s: bad units at stage %d in binary channels",
+                    channel->network, channel->staname, channel->locid, channel->chaname, i);
+      return EVALRESP_INP;
+    }
+    for (blkt = stage->first_blkt; blkt; blkt = blkt->next_blkt)
+    {
+      switch (blkt->type)
+      {
+      case IIR_PZ:
+      case FIR_SYM_1:
+      case FIR_SYM_2:
+      case FIR_ASYM:
+      case IIR_COEFFS:
+        if (!blkt->next_blkt || blkt->next_blkt->type != DECIMATION)
+        {
+          evalresp_log (log, EV_ERROR, EV_ERROR, "%s.%s.%s.%s: no decimation after filter at stage %d in binary channels",
+                        channel->network, channel->staname, channel->locid, channel->chaname, i);
+          return EVALRESP_INP;
+        }
+        break;
+      default:
+        break;
+      }
+    }
+  }
+  return EVALRESP_OK;
+}
+
+int
+evalresp_binary_to_channels (evalresp_logger *log, const char *data, size_t len,
+                             evalresp_channels **channels)
+{
+  binary_in in;
+  evalresp_channel *channel;
+  char magic[4];
+  int status, version, n = 0, i;
+
+  in.data = data;
+  in.len = len;
+  in.pos = 0;
+  *channels = NULL;
+  if (!(status = get_bytes (log, &in, magic, 4)) && !(status = get_int (log, &in, &version)) && !(status = get_int (log, &in, &n)))
+  {
+    if (memcmp (magic, BINARY_MAGIC, 4))
+    {
+      evalresp_log (log, EV_ERROR, EV_ERROR, "Not binary channels");
+      status = EVALRESP_INP;
+    }
+    else if (version != BINARY_VERSION)
+    {
+      evalresp_log (log, EV_ERROR, EV_ERROR, "Unsupported binary channels version (%d)", version);
+      status = EVALRESP_INP;
+    }
+  }
+  /* everything loaded is allocated in the arena of the collection */
+  if (!status && !(status = evalresp_alloc_channels (log, channels)) && !(status = new_arena (log, &(*channels)->arena)))
+  {
+    in.arena = (*channels)->arena;
+    if (n < 0 || (size_t)n > (len - in.pos) / BINARY_MIN_CHANNEL)
+    {
+      evalresp_log (log, EV_ERROR, EV_ERROR, "Bad number of channels (%d) in binary channels", n);
+      status = EVALRESP_INP;
+    }
+    else if (!((*channels)->channels = calloc (n + 1, sizeof (*(*channels)->channels))))
+    {
+      evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate channels");
+      status = EVALRESP_MEM;
+    }
+    for (i = 0; !status && i < n; i++)
+    {
+      if (!(channel = arena_calloc (log, in.arena, "channel", 1, sizeof (*channel))))
+      {
+        status = EVALRESP_MEM;
+      }
+      else
+      {
+        (*channels)->channels[(*channels)->nchannels++] = channel;
+        if (!(status = get_channel (log, &in, channel)))
+        {
+          status = check_loaded_channel (log, channel);
+        }
+      }
+    }
+  }
+  if (status)
+  {
+    evalresp_free_channels (channels);
+  }
+  return status;
+}
+
+int
+evalresp_channels_load_binary (evalresp_logger *log, FILE *file, evalresp_channels **channels)
+{
+  void *map;
+  const char *mapped;
+  char *data = NULL, *more;
+  size_t map_len, len = 0, size = 0;
+  int status = EVALRESP_OK;
+
+  if (map_file (file, &map, &map_len, &mapped, &len))
+  {
+    status = evalresp_binary_to_channels (log, mapped, len, channels);
+    unmap_file (map, map_len);
+    return status;
+  }
+  /* a pipe, say */
+  while (!status && !feof (file))
+  {
+    if (len == size)
+    {
+      size = size ? 2 * size : 65536;
+      if (!(more = realloc (data, size)))
+      {
+        evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate buffer memory");
+        status = EVALRESP_MEM;
+        break;
+      }
+      data = more;
+    }
+    len += fread (data + len, 1, size - len, file);
+    if (ferror (file))
+    {
+      evalresp_log (log, EV_ERROR, EV_ERROR, "Error reading input");
+      status = EVALRESP_IO;
+    }
+  }
+  if (!status)
+  {
+    status = evalresp_binary_to_channels (log, data, len, channels);
+  }
+  free (data);
+  return status;
+}
@@ -0,0 +1,640 @@
+/* cache_fctns.c */
+
+/*
+ An in-process cache of evaluated responses.
+
+ Many channel epochs share exactly the same response (the same sensor and
+ digitizer, at many stations and over many years).  Responses are cached
+ under a key built from the content of the normalized, compiled channel
+ (see compile_plan()) and the options that affect the evaluation, so any
+ channel with the same filters hits the same entry whatever its name.
+ Entries are reference counted, so that they can be shared by several
+ callers, and the least recently used are dropped to stay within a memory
+ budget.
+
+ The stage cache works the same way at the level of single plan steps
+ (FIR, IIR coefficient and decimation stages), for the channels evaluated
+ in one batch: many channels with different sensors share the digitizer
+ and its decimation cascade.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "./private.h"
+#include "evalresp/public_api.h"
+#include "evalresp_log/log.h"
+
+#define CACHE_MIN_BUCKETS 64
+
+/* the stage cache is only kept for a batch, so it is not evicted, but
+   stops growing at this size */
+#define STAGE_CACHE_MAX_BYTES (256 * 1024 * 1024)
+#define STAGE_CACHE_BUCKETS 256
+
+typedef struct cache_entry_s
+{
+  unsigned int hash;
+  size_t nkey;
+  unsigned char *key;
+  evalresp_response *data;           /* frequencies and values (names unused) */
+  size_t nbytes;                     /* memory accounted to this entry */
+  int refs;                          /* responses handed out and not yet released */
+  evalresp_cache *cache;             /* NULL once dropped from the cache */
+  struct cache_entry_s *next_bucket; /* next entry in the same hash bucket */
+  struct cache_entry_s *newer;       /* neighbours in least recently used order */
+  struct cache_entry_s *older;
+} cache_entry;
+
+struct evalresp_cache_s
+{
+  size_t max_bytes;
+  size_t nbytes;
+  int nentries;
+  int nbuckets;
+  cache_entry **buckets;
+  cache_entry *newest;
+  cache_entry *oldest;
+  long hits;
+  long misses;
+  long evictions;
+};
+
+/* the response handed to the caller, which refers to the shared data */
+typedef struct
+{
+  evalresp_response response;
+  cache_entry *entry;
+} shared_response;
+
+typedef struct
+{
+  size_t n;
+  size_t size;
+  unsigned char *bytes;
+} cache_key;
+
+static int
+key_add (evalresp_logger *log, cache_key *key, const void *data, size_t n)
+{
+  unsigned char *bytes;
+  size_t size;
+  if (key->n + n > key->size)
+  {
+    for (size = key->size ? key->size : 256; size < key->n + n; size *= 2)
+      ;
+    if (!(bytes = realloc (key->bytes, size)))
+    {
+      evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate cache key");
+      return EVALRESP_MEM;
+    }
+    key->bytes = bytes;
+    key->size = size;
+  }
+  memcpy (key->bytes + key->n, data, n);
+  key->n += n;
+  return EVALRESP_OK;
+}
+
+#define KEY_VALUE(log, key, value) key_add (log, key, &(value), sizeof (value))
+#define KEY_ARRAY(log, key, array, n) key_add (log, key, (array), (n) * sizeof (*(array)))
+
+/*==================================================================
+ *    The content of a blockette used by a plan step
+ *=================================================================*/
+static int
+key_add_blkt (evalresp_logger *log, cache_key *key, const evalresp_plan_op *op)
+{
+  const evalresp_blkt *blkt = op->blkt;
+  int status = EVALRESP_OK;
+
+  switch (op->type)
+  {
+  case ANALOG_PZ:
+  case LAPLACE_PZ:
+  case IIR_PZ:
+    if (!(status = KEY_VALUE (log, key, blkt->blkt_info.pole_zero.nzeros)) && !(status = KEY_VALUE (log, key, blkt->blkt_info.pole_zero.npoles)) && !(status = KEY_VALUE (log, key, blkt->blkt_info.pole_zero.a0)) && !(status = KEY_ARRAY (log, key, blkt->blkt_info.pole_zero.zeros, blkt->blkt_info.pole_zero.nzeros)))
+    {
+      status = KEY_ARRAY (log, key, blkt->blkt_info.pole_zero.poles, blkt->blkt_info.pole_zero.npoles);
+    }
+    break;
+  case FIR_SYM_1:
+  case FIR_SYM_2:
+  case FIR_ASYM:
+    if (!(status = KEY_VALUE (log, key, blkt->blkt_info.fir.ncoeffs)) && !(status = KEY_VALUE (log, key, blkt->blkt_info.fir.h0)))
+    {
+      status = KEY_ARRAY (log, key, blkt->blkt_info.fir.coeffs, blkt->blkt_info.fir.ncoeffs);
+    }
+    break;
+  case IIR_COEFFS:
+    if (!(status = KEY_VALUE (log, key, blkt->blkt_info.coeff.nnumer)) && !(status = KEY_VALUE (log, key, blkt->blkt_info.coeff.ndenom)) && !(status = KEY_VALUE (log, key, blkt->blkt_info.coeff.h0)) && !(status = KEY_ARRAY (log, key, blkt->blkt_info.coeff.numer, blkt->blkt_info.coeff.nnumer)))
+    {
+      status = KEY_ARRAY (log, key, blkt->blkt_info.coeff.denom, blkt->blkt_info.coeff.ndenom);
+    }
+    break;
+  case LIST:
+    if (!(status = KEY_VALUE (log, key, blkt->blkt_info.list.nresp)) && !(status = KEY_ARRAY (log, key, blkt->blkt_info.list.freq, blkt->blkt_info.list.nresp)) && !(status = KEY_ARRAY (log, key, blkt->blkt_info.list.amp, blkt->blkt_info.list.nresp)))
+    {
+      status = KEY_ARRAY (log, key, blkt->blkt_info.list.phase, blkt->blkt_info.list.nresp);
+    }
+    break;
+  default:
+    /* decimation and polynomial steps are described by the plan itself */
+    break;
+  }
+  return status;
+}
+
+/*==================================================================
+ *    Key for a compiled channel evaluated with the given options
+ *=================================================================*/
+static int
+make_key (evalresp_logger *log, evalresp_options const *const options,
+          const evalresp_plan *plan, cache_key *key)
+{
+  const evalresp_plan_op *op;
+  int status = EVALRESP_OK, i;
+
+  /* options that change the frequencies or the values (the stage range,
+     delay flags and blockette 62 value are already part of the plan) */
+  if (!(status = KEY_VALUE (log, key, options->min_freq)) && !(status = KEY_VALUE (log, key, options->max_freq)) && !(status = KEY_VALUE (log, key, options->nfreq)) && !(status = KEY_VALUE (log, key, options->lin_freq)) && !(status = KEY_VALUE (log, key, options->unit)) && !(status = KEY_VALUE (log, key, options->b55_interpolate)) && !(status = KEY_VALUE (log, key, options->use_trig_recurrence)) && !(status = KEY_VALUE (log, key, options->fir_fft_threshold)))
+  {
+    if (!(status = KEY_VALUE (log, key, plan->nops)) && !(status = KEY_VALUE (log, key, plan->input_units)) && !(status = KEY_VALUE (log, key, plan->sensit)))
+    {
+      status = KEY_VALUE (log, key, plan->unit_scale_fact);
+    }
+  }
+  for (i = 0; !status && i < plan->nops; i++)
+  {
+    op = &plan->ops[i];
+    if (!(status = KEY_VALUE (log, key, op->type)) && !(status = KEY_VALUE (log, key, op->sint)) && !(status = KEY_VALUE (log, key, op->delay)) && !(status = KEY_VALUE (log, key, op->value)))
+    {
+      status = key_add_blkt (log, key, op);
+    }
+  }
+  return status;
+}
+
+/* FNV-1a */
+static unsigned int
+hash_key (const unsigned char *bytes, size_t n)
+{
+  unsigned int hash = 2166136261u;
+  size_t i;
+  for (i = 0; i < n; i++)
+  {
+    hash ^= bytes[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static void
+free_entry (cache_entry *entry)
+{
+  evalresp_free_response (&entry->data);
+  free (entry->key);
+  free (entry);
+}
+
+static void
+unlink_lru (evalresp_cache *cache, cache_entry *entry)
+{
+  if (entry->newer)
+    entry->newer->older = entry->older;
+  else
+    cache->newest = entry->older;
+  if (entry->older)
+    entry->older->newer = entry->newer;
+  else
+    cache->oldest = entry->newer;
+  entry->newer = entry->older = NULL;
+}
+
+static void
+link_newest (evalresp_cache *cache, cache_entry *entry)
+{
+  entry->older = cache->newest;
+  entry->newer = NULL;
+  if (cache->newest)
+    cache->newest->newer = entry;
+  else
+    cache->oldest = entry;
+  cache->newest = entry;
+}
+
+/* remove an entry from the cache; it is freed now, or when the last
+   response sharing it is released */
+static void
+drop_entry (evalresp_cache *cache, cache_entry *entry)
+{
+  cache_entry **ptr;
+  for (ptr = &cache->buckets[entry->hash & (cache->nbuckets - 1)]; *ptr != entry; ptr = &(*ptr)->next_bucket)
+    ;
+  *ptr = entry->next_bucket;
+  unlink_lru (cache, entry);
+  cache->nbytes -= entry->nbytes;
+  cache->nentries--;
+  entry->cache = NULL;
+  if (!entry->refs)
+  {
+    free_entry (entry);
+  }
+}
+
+static void
+grow_buckets (evalresp_cache *cache)
+{
+  cache_entry **buckets, *entry, *next;
+  int nbuckets = 2 * cache->nbuckets, i;
+
+  /* if this fails the chains just get longer */
+  if ((buckets = calloc (nbuckets, sizeof (*buckets))))
+  {
+    for (i = 0; i < cache->nbuckets; i++)
+    {
+      for (entry = cache->buckets[i]; entry; entry = next)
+      {
+        next = entry->next_bucket;
+        entry->next_bucket = buckets[entry->hash & (nbuckets - 1)];
+        buckets[entry->hash & (nbuckets - 1)] = entry;
+      }
+    }
+    free (cache->buckets);
+    cache->buckets = buckets;
+    cache->nbuckets = nbuckets;
+  }
+}
+
+static int
+share_entry (evalresp_logger *log, cache_entry *entry, const evalresp_channel *channel,
+             const evalresp_response **response)
+{
+  shared_response *shared;
+  if (!(shared = calloc (1, sizeof (*shared))))
+  {
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate response");
+    return EVALRESP_MEM;
+  }
+  shared->entry = entry;
+  shared->response.freqs = entry->data->freqs;
+  shared->response.rvec = entry->data->rvec;
+  shared->response.nfreqs = entry->data->nfreqs;
+  strncpy (shared->response.network, channel->network, NETLEN);
+  strncpy (shared->response.station, channel->staname, STALEN);
+  strncpy (shared->response.locid, channel->locid, LOCIDLEN);
+  strncpy (shared->response.channel, channel->chaname, CHALEN);
+  entry->refs++;
+  *response = &shared->response;
+  return EVALRESP_OK;
+}
+
+int
+evalresp_new_cache (evalresp_logger *log, size_t max_bytes, evalresp_cache **cache)
+{
+  int status = EVALRESP_OK;
+  if (!(*cache = calloc (1, sizeof (**cache))) || !((*cache)->buckets = calloc (CACHE_MIN_BUCKETS, sizeof (*(*cache)->buckets))))
+  {
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate response cache");
+    free (*cache);
+    *cache = NULL;
+    status = EVALRESP_MEM;
+  }
+  else
+  {
+    (*cache)->nbuckets = CACHE_MIN_BUCKETS;
+    (*cache)->max_bytes = max_bytes;
+  }
+  return status;
+}
+
+void
+evalresp_free_cache (evalresp_cache **cache)
+{
+  if (*cache)
+  {
+    while ((*cache)->oldest)
+    {
+      drop_entry (*cache, (*cache)->oldest);
+    }
+    free ((*cache)->buckets);
+    free (*cache);
+    *cache = NULL;
+  }
+}
+
+int
+evalresp_cached_channel_to_response (evalresp_logger *log, evalresp_cache *cache,
+                                     evalresp_channel *channel, evalresp_options *options,
+                                     const evalresp_response **response)
+{
+  int status = EVALRESP_OK, free_options = 0;
+  evalresp_prepared_channel *prepared = NULL;
+  evalresp_response *data = NULL;
+  cache_entry *entry = NULL;
+  cache_key key = {0, 0, NULL};
+  unsigned int hash;
+
+  *response = NULL;
+  /* allow NULL options */
+  if (!options)
+  {
+    status = evalresp_new_options (log, &options);
+    free_options = 1;
+  }
+
+  /* the channel is normalized and compiled before building the key, so
+     that it covers exactly what would be evaluated */
+  if (!status && !(status = evalresp_prepare_channel (log, channel, options, &prepared)) && !(status = make_key (log, options, prepared->plan, &key)))
+  {
+    hash = hash_key (key.bytes, key.n);
+    for (entry = cache->buckets[hash & (cache->nbuckets - 1)]; entry; entry = entry->next_bucket)
+    {
+      if (entry->hash == hash && entry->nkey == key.n && !memcmp (entry->key, key.bytes, key.n))
+        break;
+    }
+
+    if (entry)
+    {
+      cache->hits++;
+      unlink_lru (cache, entry);
+      link_newest (cache, entry);
+      if (!(status = share_entry (log, entry, channel, response)) && options->verbose)
+      {
+        evalresp_channel_to_log (log, options, channel);
+      }
+    }
+    else
+    {
+      cache->misses++;
+      if (!(status = evalresp_prepared_to_response (log, prepared, options, &data)))
+      {
+        if (!(entry = calloc (1, sizeof (*entry))))
+        {
+          evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate cache entry");
+          status = EVALRESP_MEM;
+          evalresp_free_response (&data);
+        }
+        else
+        {
+          entry->hash = hash;
+          entry->nkey = key.n;
+          entry->key = key.bytes;
+          key.bytes = NULL;
+          entry->data = data;
+          entry->nbytes = sizeof (*entry) + sizeof (*data) + entry->nkey + data->nfreqs * (sizeof (*data->freqs) + sizeof (*data->rvec));
+          entry->cache = cache;
+          entry->next_bucket = cache->buckets[hash & (cache->nbuckets - 1)];
+          cache->buckets[hash & (cache->nbuckets - 1)] = entry;
+          link_newest (cache, entry);
+          cache->nbytes += entry->nbytes;
+          if (++cache->nentries > cache->nbuckets)
+          {
+            grow_buckets (cache);
+          }
+          status = share_entry (log, entry, channel, response);
+          /* evict the least recently used (possibly even this one, if it
+             is larger than the whole budget, once it is released) */
+          while (cache->nbytes > cache->max_bytes)
+          {
+            cache->evictions++;
+            drop_entry (cache, cache->oldest);
+          }
+        }
+      }
+    }
+  }
+
+  free (key.bytes);
+  evalresp_free_prepared_channel (&prepared);
+  if (free_options)
+  {
+    evalresp_free_options (&options);
+  }
+  return status;
+}
+
+void
+evalresp_release_response (const evalresp_response **response)
+{
+  shared_response *shared;
+  if (*response)
+  {
+    shared = (shared_response *)*response;
+    if (!--shared->entry->refs && !shared->entry->cache)
+    {
+      free_entry (shared->entry);
+    }
+    free (shared);
+    *response = NULL;
+  }
+}
+
+void
+evalresp_get_cache_stats (const evalresp_cache *cache, evalresp_cache_stats *stats)
+{
+  stats->hits = cache->hits;
+  stats->misses = cache->misses;
+  stats->evictions = cache->evictions;
+  stats->nentries = cache->nentries;
+  stats->nbytes = cache->nbytes;
+}
+
+typedef struct stage_entry_s
+{
+  unsigned int hash;
+  size_t nkey;
+  unsigned char *key;
+  evalresp_complex *values;
+  struct stage_entry_s *next_bucket;
+} stage_entry;
+
+typedef struct
+{
+  unsigned int hash;
+  int nfreqs;
+  double *freqs;
+} stage_grid;
+
+struct stage_cache_s
+{
+  thread_lock *lock;
+  size_t nbytes;
+  int ngrids;
+  stage_grid *grids;
+  stage_entry *buckets[STAGE_CACHE_BUCKETS];
+};
+
+int
+new_stage_cache (evalresp_logger *log, stage_cache **stages)
+{
+  int status = EVALRESP_OK;
+  if (!(*stages = calloc (1, sizeof (**stages))))
+  {
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate stage cache");
+    status = EVALRESP_MEM;
+  }
+  else if ((status = new_lock (log, &(*stages)->lock)))
+  {
+    free (*stages);
+    *stages = NULL;
+  }
+  return status;
+}
+
+void
+free_stage_cache (stage_cache **stages)
+{
+  stage_entry *entry, *next;
+  int i;
+  if (*stages)
+  {
+    for (i = 0; i < STAGE_CACHE_BUCKETS; i++)
+    {
+      for (entry = (*stages)->buckets[i]; entry; entry = next)
+      {
+        next = entry->next_bucket;
+        free (entry->key);
+        free (entry->values);
+        free (entry);
+      }
+    }
+    for (i = 0; i < (*stages)->ngrids; i++)
+    {
+      free ((*stages)->grids[i].freqs);
+    }
+    free ((*stages)->grids);
+    free_lock (&(*stages)->lock);
+    free (*stages);
+    *stages = NULL;
+  }
+}
+
+int
+stage_cache_grid (stage_cache *stages, const double *freq, int nfreqs)
+{
+  stage_grid *grids;
+  unsigned int hash = hash_key ((const unsigned char *)freq, nfreqs * sizeof (*freq));
+  int i, grid = -1;
+
+  acquire_lock (stages->lock);
+  for (i = 0; i < stages->ngrids && grid < 0; i++)
+  {
+    if (stages->grids[i].hash == hash && stages->grids[i].nfreqs == nfreqs && !memcmp (stages->grids[i].freqs, freq, nfreqs * sizeof (*freq)))
+    {
+      grid = i;
+    }
+  }
+  if (grid < 0 && stages->nbytes + nfreqs * sizeof (*freq) <= STAGE_CACHE_MAX_BYTES && (grids = realloc (stages->grids, (stages->ngrids + 1) * sizeof (*grids))))
+  {
+    stages->grids = grids;
+    if ((grids[stages->ngrids].freqs = malloc (nfreqs * sizeof (*freq))))
+    {
+      memcpy (grids[stages->ngrids].freqs, freq, nfreqs * sizeof (*freq));
+      grids[stages->ngrids].hash = hash;
+      grids[stages->ngrids].nfreqs = nfreqs;
+      stages->nbytes += nfreqs * sizeof (*freq);
+      grid = stages->ngrids++;
+    }
+  }
+  release_lock (stages->lock);
+  return grid;
+}
+
+int
+stage_cache_stores (const evalresp_plan_op *op)
+{
+  switch (op->type)
+  {
+  case FIR_SYM_1:
+  case FIR_SYM_2:
+  case FIR_ASYM:
+  case IIR_COEFFS:
+  case DECIMATION:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+/* the key for a step: the step and blockette content, the grid and the
+   options that choose the kernel */
+static int
+make_stage_key (evalresp_options const *const options, const evalresp_plan_op *op,
+                int grid, cache_key *key)
+{
+  int status = EVALRESP_OK;
+  if (!(status = KEY_VALUE (NULL, key, grid)) && !(status = KEY_VALUE (NULL, key, options->lin_freq)) && !(status = KEY_VALUE (NULL, key, options->use_trig_recurrence)) && !(status = KEY_VALUE (NULL, key, options->fir_fft_threshold)) && !(status = KEY_VALUE (NULL, key, op->type)) && !(status = KEY_VALUE (NULL, key, op->sint)) && !(status = KEY_VALUE (NULL, key, op->delay)))
+  {
+    status = key_add_blkt (NULL, key, op);
+  }
+  return status;
+}
+
+static stage_entry *
+find_stage (stage_cache *stages, unsigned int hash, const cache_key *key)
+{
+  stage_entry *entry;
+  for (entry = stages->buckets[hash % STAGE_CACHE_BUCKETS]; entry; entry = entry->next_bucket)
+  {
+    if (entry->hash == hash && entry->nkey == key->n && !memcmp (entry->key, key->bytes, key->n))
+      break;
+  }
+  return entry;
+}
+
+const evalresp_complex *
+stage_cache_find (stage_cache *stages, evalresp_options const *const options,
+                  const evalresp_plan_op *op, int grid)
+{
+  cache_key key = {0, 0, NULL};
+  stage_entry *entry = NULL;
+  unsigned int hash;
+
+  if (!make_stage_key (options, op, grid, &key))
+  {
+    hash = hash_key (key.bytes, key.n);
+    acquire_lock (stages->lock);
+    entry = find_stage (stages, hash, &key);
+    release_lock (stages->lock);
+  }
+  free (key.bytes);
+  return entry ? entry->values : NULL;
+}
+
+void
+stage_cache_add (stage_cache *stages, evalresp_options const *const options,
+                 const evalresp_plan_op *op, int grid, evalresp_complex *values)
+{
+  cache_key key = {0, 0, NULL};
+  stage_entry *entry = NULL;
+  unsigned int hash;
+  size_t nbytes;
+
+  if (!make_stage_key (options, op, grid, &key))
+  {
+    hash = hash_key (key.bytes, key.n);
+    acquire_lock (stages->lock);
+    nbytes = sizeof (*entry) + key.n + stages->grids[grid].nfreqs * sizeof (*values);
+    /* another thread may have added the same step meanwhile */
+    if (!find_stage (stages, hash, &key) && stages->nbytes + nbytes <= STAGE_CACHE_MAX_BYTES && (entry = calloc (1, sizeof (*entry))))
+    {
+      entry->hash = hash;
+      entry->nkey = key.n;
+      entry->key = key.bytes;
+      entry->values = values;
+      entry->next_bucket = stages->buckets[hash % STAGE_CACHE_BUCKETS];
+      stages->buckets[hash % STAGE_CACHE_BUCKETS] = entry;
+      stages->nbytes += nbytes;
+      key.bytes = NULL;
+      values = NULL;
+    }
+    release_lock (stages->lock);
+  }
+  free (key.bytes);
+  free (values);
+}
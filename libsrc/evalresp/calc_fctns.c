@@ -53,7 +53,7 @@
  *    Complex multiplication:  complex version of val1 *= val2;
  *=================================================================*/
 static void
-zmul (evalresp_complex *val1, evalresp_complex *val2)
+zmul (evalresp_complex *val1, const evalresp_complex *val2)
 {
   double r, i;
   r = val1->real * val2->real - val1->imag * val2->imag;
@@ -142,23 +142,17 @@ convert_to_units (int inp, const evalresp_unit units, evalresp_complex *data, do
  * Version 0.2 07/12/00
  *================================================================*/
 static void
-iir_trans (evalresp_blkt *blkt_ptr, double wint, evalresp_complex *out)
+iir_trans (const evalresp_blkt *blkt_ptr, double t, double wint, evalresp_complex *out)
 {
 
   double h0;
   double xre, xim, phase;
   double amp;
-  double t, w;
+  double w;
   double *cn, *cd; /* numerators and denominators */
   int nn, nd, in, id;
 
-  evalresp_blkt *next_ptr;
-
   h0 = blkt_ptr->blkt_info.coeff.h0; /* set a sensitivity */
-  next_ptr = blkt_ptr->next_blkt;
-
-  /* Sample interaval = 1/sample rate */
-  t = next_ptr->blkt_info.decimation.sample_int;
 
   /* Numerator coeffs number */
   nn = blkt_ptr->blkt_info.coeff.nnumer;
@@ -215,7 +209,7 @@ iir_trans (evalresp_blkt *blkt_ptr, double wint, evalresp_complex *out)
  * Ilya Dricker ISTI (.dricker@isti.com) 06/01/13
  *===============================================================*/
 static int
-calc_polynomial (evalresp_blkt *blkt_ptr, evalresp_complex *out,
+calc_polynomial (const evalresp_blkt *blkt_ptr, evalresp_complex *out,
                  double x_for_b62, evalresp_logger *log)
 {
   double amp = 0, phase = 0;
@@ -256,7 +250,7 @@ calc_polynomial (evalresp_blkt *blkt_ptr, evalresp_complex *out,
  * Ilya Dricker ISTI (.dricker@isti.com) 06/22/00
  *===============================================================*/
 static void
-calc_list (evalresp_blkt *blkt_ptr, int i, evalresp_complex *out)
+calc_list (const evalresp_blkt *blkt_ptr, int i, evalresp_complex *out)
 {
   double amp, phase;
   double halfcirc = 180;
@@ -272,7 +266,7 @@ calc_list (evalresp_blkt *blkt_ptr, int i, evalresp_complex *out)
  *                Response of analog filter
  *=================================================================*/
 static void
-analog_trans (evalresp_blkt *blkt_ptr, double freq, evalresp_complex *out)
+analog_trans (const evalresp_blkt *blkt_ptr, double freq, evalresp_complex *out)
 {
   int nz, np, i;
   evalresp_complex *ze, *po, denom, num, omega, temp;
@@ -321,19 +315,16 @@ analog_trans (evalresp_blkt *blkt_ptr, double freq, evalresp_complex *out)
  *                Response of symetrical FIR filters
  *=================================================================*/
 static void
-fir_sym_trans (evalresp_blkt *blkt_ptr, double w, evalresp_complex *out)
+fir_sym_trans (const evalresp_blkt *blkt_ptr, double sint, double w, evalresp_complex *out)
 {
   double *a, h0, wsint;
-  evalresp_blkt *next_ptr;
   int na;
   int k, fact;
-  double R = 0.0, sint;
+  double R = 0.0;
 
   a = blkt_ptr->blkt_info.fir.coeffs;
   na = blkt_ptr->blkt_info.fir.ncoeffs;
-  next_ptr = blkt_ptr->next_blkt;
   h0 = blkt_ptr->blkt_info.fir.h0;
-  sint = next_ptr->blkt_info.decimation.sample_int;
   wsint = w * sint;
 
   if (blkt_ptr->type == FIR_SYM_1)
@@ -362,10 +353,9 @@ fir_sym_trans (evalresp_blkt *blkt_ptr, double w, evalresp_complex *out)
  *                Response of asymetrical FIR filters
  *=================================================================*/
 static void
-fir_asym_trans (evalresp_blkt *blkt_ptr, double w, evalresp_complex *out)
+fir_asym_trans (const evalresp_blkt *blkt_ptr, double sint, double w, evalresp_complex *out)
 {
-  double *a, h0, sint;
-  evalresp_blkt *next_ptr;
+  double *a, h0;
   int na;
   int k;
   double R = 0.0, I = 0.0;
@@ -374,9 +364,7 @@ fir_asym_trans (evalresp_blkt *blkt_ptr, double w, evalresp_complex *out)
 
   a = blkt_ptr->blkt_info.fir.coeffs;
   na = blkt_ptr->blkt_info.fir.ncoeffs;
-  next_ptr = blkt_ptr->next_blkt;
   h0 = blkt_ptr->blkt_info.fir.h0;
-  sint = next_ptr->blkt_info.decimation.sample_int;
   wsint = w * sint;
 
   for (k = 1; k < na; k++)
@@ -410,15 +398,143 @@ fir_asym_trans (evalresp_blkt *blkt_ptr, double w, evalresp_complex *out)
   out->imag = I * h0;
 }
 
+/*==================================================================
+ *    C = sum_k a[k * stride] cos (k theta) and
+ *    S = sum_k a[k * stride] sin (k theta), k = 0..n-1,
+ *    by Clenshaw's recurrence with Reinsch's modification (stable
+ *    for theta near 0 and pi).  s2 and c2 are sin and cos (theta / 2),
+ *    the only trigonometric values needed.
+ *=================================================================*/
+static void
+trig_sums (const double *a, int n, int stride, double s2, double c2,
+           double *C, double *S)
+{
+  double lambda, b = 0.0, b1 = 0.0, d = 0.0;
+  int k;
+
+  if (c2 * c2 >= s2 * s2) /* cos (theta) >= 0 */
+  {
+    lambda = -4.0 * s2 * s2;
+    for (k = n - 1; k >= 0; k--)
+    {
+      d = a[k * stride] + lambda * b + d;
+      b1 = b;
+      b = d + b;
+    }
+  }
+  else
+  {
+    lambda = 4.0 * c2 * c2;
+    for (k = n - 1; k >= 0; k--)
+    {
+      d = a[k * stride] + lambda * b - d;
+      b1 = b;
+      b = d - b;
+    }
+  }
+  *C = d - lambda / 2.0 * b1;
+  *S = 2.0 * s2 * c2 * b1;
+}
+
+/*==================================================================
+ *    Response of FIR filters (symmetric or asymmetric) using
+ *    trig_sums() instead of a cos/sin call per coefficient
+ *=================================================================*/
+static void
+fir_trans_rec (const evalresp_blkt *blkt_ptr, double sint, double w, evalresp_complex *out)
+{
+  double *a, h0, wsint, s2, c2;
+  int na, k;
+  double R, I, C, S;
+  double mod, pha;
+
+  a = blkt_ptr->blkt_info.fir.coeffs;
+  na = blkt_ptr->blkt_info.fir.ncoeffs;
+  h0 = blkt_ptr->blkt_info.fir.h0;
+  wsint = w * sint;
+  s2 = sin (wsint / 2.);
+  c2 = cos (wsint / 2.);
+
+  if (blkt_ptr->type == FIR_SYM_1)
+  {
+    /* taps run from the centre, a[na - 1], outwards */
+    trig_sums (&a[na - 1], na, -1, s2, c2, &C, &S);
+    out->real = (2.0 * C - a[na - 1]) * h0;
+    out->imag = 0.;
+    return;
+  }
+  else if (blkt_ptr->type == FIR_SYM_2)
+  {
+    /* as FIR_SYM_1, but half a sample off the centre */
+    trig_sums (&a[na - 1], na, -1, s2, c2, &C, &S);
+    out->real = 2.0 * (c2 * C - s2 * S) * h0;
+    out->imag = 0.;
+    return;
+  }
+
+  for (k = 1; k < na; k++)
+  {
+    if (a[k] != a[0])
+      break;
+  }
+  if (k == na)
+  {
+    if (wsint == 0.0)
+      out->real = 1.;
+    else
+      out->real = (sin (wsint / 2. * na) / sin (wsint / 2.)) * a[0];
+    out->imag = 0;
+    return;
+  }
+
+  trig_sums (a, na, 1, s2, c2, &R, &I);
+  I = -I;
+
+  mod = sqrt (R * R + I * I);
+  pha = atan2 (I, R) + (w * (double)((na - 1) / 2.0) * sint);
+  R = mod * cos (pha);
+  I = mod * sin (pha);
+  out->real = R * h0;
+  out->imag = I * h0;
+}
+
+/*==================================================================
+ *    Response of a digital IIR filter (as iir_trans()) using
+ *    trig_sums() instead of a cos/sin call per coefficient
+ *=================================================================*/
+static void
+iir_trans_rec (const evalresp_blkt *blkt_ptr, double t, double wint, evalresp_complex *out)
+{
+  double h0, w, s2, c2;
+  double xre, xim, phase, amp;
+
+  h0 = blkt_ptr->blkt_info.coeff.h0;
+  w = wint * t;
+  s2 = sin (w / 2.);
+  c2 = cos (w / 2.);
+
+  trig_sums (blkt_ptr->blkt_info.coeff.numer, blkt_ptr->blkt_info.coeff.nnumer,
+             1, s2, c2, &xre, &xim);
+  amp = sqrt (xre * xre + xim * xim);
+  phase = atan2 (-xim, xre);
+
+  trig_sums (blkt_ptr->blkt_info.coeff.denom, blkt_ptr->blkt_info.coeff.ndenom,
+             1, s2, c2, &xre, &xim);
+  amp /= (sqrt (xre * xre + xim * xim));
+  phase = (phase - atan2 (-xim, xre));
+
+  out->real = amp * cos (phase) * h0;
+  out->imag = amp * sin (phase) * h0;
+}
+
 /*==================================================================
  *                Response of IIR filters
  *=================================================================*/
 static void
-iir_pz_trans (evalresp_blkt *blkt_ptr, double w, evalresp_complex *out)
+iir_pz_trans (const evalresp_blkt *blkt_ptr, double sint, double w, evalresp_complex *out)
 {
   evalresp_complex *ze, *po;
-  double h0, sint, wsint;
-  evalresp_blkt *next_ptr;
+  double h0, wsint;
   int nz, np;
   int i;
   double mod = 1.0, pha = 0.0;
@@ -430,8 +546,6 @@ iir_pz_trans (evalresp_blkt *blkt_ptr, double w, evalresp_complex *out)
   po = blkt_ptr->blkt_info.pole_zero.poles;
   np = blkt_ptr->blkt_info.pole_zero.npoles;
   h0 = blkt_ptr->blkt_info.pole_zero.a0;
-  next_ptr = blkt_ptr->next_blkt;
-  sint = next_ptr->blkt_info.decimation.sample_int;
   wsint = w * sint;
 
   c = cos (wsint);
@@ -460,6 +574,16 @@ iir_pz_trans (evalresp_blkt *blkt_ptr, double w, evalresp_complex *out)
   out->imag = mod * sin (pha) * h0;
 }
 
+/*==================================================================
+ *    Sample interval of a digital filter, which is carried by the
+ *    decimation blockette that follows it in the stage
+ *=================================================================*/
+static double
+next_sample_int (const evalresp_blkt *blkt_ptr)
+{
+  return blkt_ptr->next_blkt->blkt_info.decimation.sample_int;
+}
+
 /*==================================================================
  *      calculate the phase shift equivalent to the time shift
  *      delta at the frequence w (rads/sec)
@@ -530,7 +654,7 @@ normalize_response (evalresp_logger *log, evalresp_options const *const options,
       }
       else
       {
-        fil = alloc_gain (log);
+        fil = alloc_gain (NULL, log);
         fil->blkt_info.gain.gain = chan->sensit;
         fil->blkt_info.gain.gain_freq = chan->sensfreq;
         last_fil->next_blkt = fil;
@@ -680,30 +804,30 @@ normalize_response (evalresp_logger *log, evalresp_options const *const options,
             else if (main_type == IIR_PZ)
             {
               main_filt->blkt_info.pole_zero.a0 = 1.0;
-              iir_pz_trans (main_filt,
+              iir_pz_trans (main_filt, next_sample_int (main_filt),
                             2 * M_PI * fil->blkt_info.gain.gain_freq, &df);
-              iir_pz_trans (main_filt, w, &of);
+              iir_pz_trans (main_filt, next_sample_int (main_filt), w, &of);
             }
             else if ((main_type == FIR_SYM_1 || main_type == FIR_SYM_2) && main_filt->blkt_info.fir.ncoeffs)
             {
               main_filt->blkt_info.fir.h0 = 1.0;
-              fir_sym_trans (main_filt,
+              fir_sym_trans (main_filt, next_sample_int (main_filt),
                              2 * M_PI * fil->blkt_info.gain.gain_freq, &df);
-              fir_sym_trans (main_filt, w, &of);
+              fir_sym_trans (main_filt, next_sample_int (main_filt), w, &of);
             }
             else if (main_type == FIR_ASYM && main_filt->blkt_info.fir.ncoeffs)
             {
               main_filt->blkt_info.fir.h0 = 1.0;
-              fir_asym_trans (main_filt,
+              fir_asym_trans (main_filt, next_sample_int (main_filt),
                               2 * M_PI * fil->blkt_info.gain.gain_freq, &df);
-              fir_asym_trans (main_filt, w, &of);
+              fir_asym_trans (main_filt, next_sample_int (main_filt), w, &of);
             }
             else if (main_type == IIR_COEFFS)
             { /*IGD - new case for 3.2.17 */
               main_filt->blkt_info.coeff.h0 = 1.0;
-              iir_trans (main_filt,
+              iir_trans (main_filt, next_sample_int (main_filt),
                          2 * M_PI * fil->blkt_info.gain.gain_freq, &df);
-              iir_trans (main_filt, w, &of);
+              iir_trans (main_filt, next_sample_int (main_filt), w, &of);
             }
 
             else
@@ -817,188 +941,558 @@ wrap_phase (double phase, double range, double *added_value)
   return phase;
 }
 
+/*==================================================================
+ *    Append a step to a plan under construction
+ *=================================================================*/
+static evalresp_plan_op *
+add_plan_op (evalresp_plan *plan, int type, const evalresp_blkt *blkt_ptr)
+{
+  evalresp_plan_op *op = &plan->ops[plan->nops++];
+  op->type = type;
+  op->blkt = blkt_ptr;
+  return op;
+}
+
 int
-calculate_response (evalresp_logger *log, evalresp_options *options,
-                    evalresp_channel *chan, double *freq, int nfreqs,
-                    evalresp_complex *output)
+compile_plan (evalresp_logger *log, evalresp_options const *const options,
+              const evalresp_channel *chan, evalresp_plan **plan)
 {
-  evalresp_blkt *blkt_ptr;
-  evalresp_stage *stage_ptr;
-  int i, j, units_code, eval_flag = 0, nc = 0, sym_fir = 0;
-  double w;
+  const evalresp_blkt *blkt_ptr;
+  const evalresp_stage *stage_ptr;
+  evalresp_plan_op *op;
+  int j, nblkts = 0, nc = 0, sym_fir = 0;
   int matching_stages = 0, has_stage0 = 0;
-  evalresp_complex of, val;
-  double corr_applied, calc_delay, estim_delay, delay;
+  double corr_applied, calc_delay, estim_delay;
   int status = EVALRESP_OK;
 
-  /*  if(options->start_stage && options->start_stage > chan->nstages) {
-     error_return(NO_STAGE_MATCHED, "calc_resp: %s options->start_stage=%d, highest stage found=%d)",
-     "No Matching Stages Found (requested",start_stage, chan->nstages);
-     } */
-
-  /* for each frequency */
-
-  for (i = 0; i < nfreqs; i++)
+  /* size the plan for the worst case of one step per blockette */
+  stage_ptr = chan->first_stage;
+  for (j = 0; j < chan->nstages; j++)
   {
-    w = 2 * M_PI * freq[i];
-    val.real = 1.0;
-    val.imag = 0.0;
+    for (blkt_ptr = stage_ptr->first_blkt; blkt_ptr; blkt_ptr = blkt_ptr->next_blkt)
+      nblkts++;
+    stage_ptr = stage_ptr->next_stage;
+  }
 
-    /* loop through the stages and filters for each stage, calculating
-         the response for each frequency for all stages */
+  if (!(*plan = calloc (1, sizeof (**plan))))
+  {
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate evaluation plan");
+    return EVALRESP_MEM;
+  }
+  if (nblkts && !((*plan)->ops = calloc (nblkts, sizeof (*(*plan)->ops))))
+  {
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate evaluation plan");
+    free_plan (plan);
+    return EVALRESP_MEM;
+  }
 
-    stage_ptr = chan->first_stage;
-    units_code = stage_ptr->input_units;
-    for (j = 0; j < chan->nstages; j++)
-    {
-      nc = 0;
-      sym_fir = 0;
-      if (!stage_ptr->sequence_no)
-        has_stage0 = 1;
-      if (options->start_stage >= 0 && options->stop_stage && (stage_ptr->sequence_no < options->start_stage || stage_ptr->sequence_no > options->stop_stage))
-      {
-        stage_ptr = stage_ptr->next_stage;
-        continue;
-      }
-      else if (options->start_stage >= 0 && !options->stop_stage && stage_ptr->sequence_no != options->start_stage)
-      {
-        stage_ptr = stage_ptr->next_stage;
-        continue;
-      }
-      matching_stages++;
-      blkt_ptr = stage_ptr->first_blkt;
-      while (blkt_ptr)
+  stage_ptr = chan->first_stage;
+  (*plan)->input_units = stage_ptr->input_units;
+  for (j = 0; j < chan->nstages && !status; j++)
+  {
+    nc = 0;
+    sym_fir = 0;
+    if (!stage_ptr->sequence_no)
+      has_stage0 = 1;
+    if (options->start_stage >= 0 && options->stop_stage && (stage_ptr->sequence_no < options->start_stage || stage_ptr->sequence_no > options->stop_stage))
+    {
+      stage_ptr = stage_ptr->next_stage;
+      continue;
+    }
+    else if (options->start_stage >= 0 && !options->stop_stage && stage_ptr->sequence_no != options->start_stage)
+    {
+      stage_ptr = stage_ptr->next_stage;
+      continue;
+    }
+    matching_stages++;
+    for (blkt_ptr = stage_ptr->first_blkt; blkt_ptr && !status; blkt_ptr = blkt_ptr->next_blkt)
+    {
+      switch (blkt_ptr->type)
       {
-        eval_flag = 0;
-        switch (blkt_ptr->type)
+      case ANALOG_PZ:
+      case LAPLACE_PZ:
+        add_plan_op (*plan, blkt_ptr->type, blkt_ptr);
+        break;
+      case IIR_PZ:
+        if (blkt_ptr->blkt_info.pole_zero.nzeros || blkt_ptr->blkt_info.pole_zero.npoles)
         {
-        case ANALOG_PZ:
-        case LAPLACE_PZ:
-          analog_trans (blkt_ptr, freq[i], &of);
-          eval_flag = 1;
-          break;
-        case IIR_PZ:
-          if (blkt_ptr->blkt_info.pole_zero.nzeros || blkt_ptr->blkt_info.pole_zero.npoles)
-          {
-            iir_pz_trans (blkt_ptr, w, &of);
-            eval_flag = 1;
-          }
-          break;
-        case FIR_SYM_1:
-        case FIR_SYM_2:
-          if (blkt_ptr->type == FIR_SYM_1)
-            nc = (double)blkt_ptr->blkt_info.fir.ncoeffs * 2 - 1;
-          else if (blkt_ptr->type == FIR_SYM_2)
-            nc = (double)blkt_ptr->blkt_info.fir.ncoeffs * 2;
-          if (blkt_ptr->blkt_info.fir.ncoeffs)
-          {
-            fir_sym_trans (blkt_ptr, w, &of);
-            sym_fir = 1;
-            eval_flag = 1;
-          }
-          break;
-        case FIR_ASYM:
-          nc = (double)blkt_ptr->blkt_info.fir.ncoeffs;
-          if (blkt_ptr->blkt_info.fir.ncoeffs)
-          {
-            fir_asym_trans (blkt_ptr, w, &of);
-            sym_fir = -1;
-            eval_flag = 1;
-          }
-          break;
-        case DECIMATION: /* IGD 10/05/13 Logic updated to include calc_delay on demand */
-          if (blkt_ptr->type != IIR_PZ && nc != 0)
+          op = add_plan_op (*plan, IIR_PZ, blkt_ptr);
+          op->sint = next_sample_int (blkt_ptr);
+        }
+        break;
+      case FIR_SYM_1:
+      case FIR_SYM_2:
+        if (blkt_ptr->type == FIR_SYM_1)
+          nc = (double)blkt_ptr->blkt_info.fir.ncoeffs * 2 - 1;
+        else if (blkt_ptr->type == FIR_SYM_2)
+          nc = (double)blkt_ptr->blkt_info.fir.ncoeffs * 2;
+        if (blkt_ptr->blkt_info.fir.ncoeffs)
+        {
+          op = add_plan_op (*plan, blkt_ptr->type, blkt_ptr);
+          op->sint = next_sample_int (blkt_ptr);
+          sym_fir = 1;
+        }
+        break;
+      case FIR_ASYM:
+        nc = (double)blkt_ptr->blkt_info.fir.ncoeffs;
+        if (blkt_ptr->blkt_info.fir.ncoeffs)
+        {
+          op = add_plan_op (*plan, FIR_ASYM, blkt_ptr);
+          op->sint = next_sample_int (blkt_ptr);
+          sym_fir = -1;
+        }
+        break;
+      case DECIMATION: /* IGD 10/05/13 Logic updated to include calc_delay on demand */
+        if (nc != 0)
+        {
+          op = add_plan_op (*plan, DECIMATION, blkt_ptr);
+          /* IGD 08/27/08 Use estimated delay instead of calculated */
+          estim_delay =
+              (double)blkt_ptr->blkt_info.decimation.estim_delay;
+          corr_applied =
+              blkt_ptr->blkt_info.decimation.applied_corr;
+          calc_delay = ((nc - 1) / 2.0) * blkt_ptr->blkt_info.decimation.sample_int;
+          /* Asymmetric FIR coefficients require a delay correction */
+          if (sym_fir == -1)
           {
-            /* IGD 08/27/08 Use estimated delay instead of calculated */
-            estim_delay =
-                (double)blkt_ptr->blkt_info.decimation.estim_delay;
-            corr_applied =
-                blkt_ptr->blkt_info.decimation.applied_corr;
-            calc_delay = ((nc - 1) / 2.0) * blkt_ptr->blkt_info.decimation.sample_int;
-            /* Asymmetric FIR coefficients require a delay correction */
-            if (sym_fir == -1)
+            if (options->use_estimated_delay)
             {
-              if (options->use_estimated_delay)
-              {
-                delay = estim_delay;
-              }
-              else
-              {
-                delay = corr_applied - calc_delay;
-              }
+              op->delay = estim_delay;
             }
-            /* Otherwise delay has already been handled in fir_sym_trans() */
             else
             {
-              delay = 0;
+              op->delay = corr_applied - calc_delay;
             }
-            calc_time_shift (delay, w, &of);
-            eval_flag = 1;
           }
-          break;
-        case LIST:                      /* This option is added in version 2.3.17 I.Dricker*/
-          calc_list (blkt_ptr, i, &of); /*compute real and imag parts for the i-th ampl and phase */
-          eval_flag = 1;
-          break;
-        case POLYNOMIAL: /* IGD 06/01/2013*/
-          if ((status = calc_polynomial (blkt_ptr, &of, options->b62_x, log)))
+          /* Otherwise delay has already been handled in fir_sym_trans() */
+          else
           {
-            return status;
+            op->delay = 0;
           }
-          eval_flag = 1;
-          break;
-        case IIR_COEFFS: /* This option is added in version 2.3.17 I.Dricker*/
-          iir_trans (blkt_ptr, w, &of);
-          eval_flag = 1;
-          break;
-        default:
-          break;
         }
-        if (eval_flag)
-          zmul (&val, &of);
-        blkt_ptr = blkt_ptr->next_blkt;
+        break;
+      case LIST: /* This option is added in version 2.3.17 I.Dricker*/
+        add_plan_op (*plan, LIST, blkt_ptr);
+        break;
+      case POLYNOMIAL: /* IGD 06/01/2013*/
+        /* the B62 response does not depend on frequency */
+        op = add_plan_op (*plan, POLYNOMIAL, blkt_ptr);
+        status = calc_polynomial (blkt_ptr, &op->value, options->b62_x, log);
+        break;
+      case IIR_COEFFS: /* This option is added in version 2.3.17 I.Dricker*/
+        op = add_plan_op (*plan, IIR_COEFFS, blkt_ptr);
+        op->sint = next_sample_int (blkt_ptr);
+        break;
+      default:
+        break;
       }
-      stage_ptr = stage_ptr->next_stage;
     }
+    stage_ptr = stage_ptr->next_stage;
+  }
+
+  /* if no matching stages were found, then report the error */
+
+  if (!status && !matching_stages)
+  {
+    evalresp_log (log, EV_ERROR, 0,
+                  "calc_resp: %s start_stage=%d, highest stage found=%d)",
+                  "No Matching Stages Found (requested", options->start_stage,
+                  has_stage0 ? chan->nstages - 1 : chan->nstages);
+    status = EVALRESP_PAR;
+  }
+
+  /*  note: unit_scale_fact is set by the 'check_units' function that is used
+   * to convert to 'MKS' units when the the response was given as a
+   * displacement, velocity, or acceleration in units other than meters */
+  (*plan)->sensit = options->use_total_sensitivity ? chan->sensit : chan->calc_sensit;
+  (*plan)->unit_scale_fact = chan->unit_scale_fact;
+
+  if (status)
+  {
+    free_plan (plan);
+  }
+  return status;
+}
+
+/* shorter FIR filters are always cheaper to sum directly */
+#define FIR_FFT_MIN_COEFFS 32
+
+/*==================================================================
+ *    Should a FIR step be evaluated with the chirp-z transform?
+ *    Only when enabled, for long filters on a linear grid
+ *    (freq[i] = freq[0] + i * df), and not for the boxcar filters
+ *    that fir_asym_trans() handles in closed form.
+ *=================================================================*/
+static int
+use_fir_fft (evalresp_options const *const options, const evalresp_plan_op *op,
+             const double *freq, int nfreqs, double *df)
+{
+  const double *a = op->blkt->blkt_info.fir.coeffs;
+  int na = op->blkt->blkt_info.fir.ncoeffs;
+  int i;
+
+  if (options->fir_fft_threshold <= 0 || !options->lin_freq || nfreqs < 2 || na < FIR_FFT_MIN_COEFFS || (double)na * nfreqs < options->fir_fft_threshold)
+    return 0;
+
+  *df = (freq[nfreqs - 1] - freq[0]) / (nfreqs - 1);
+  for (i = 0; i < nfreqs; i++)
+  {
+    if (fabs (freq[i] - (freq[0] + i * *df)) > 1e-9 * (fabs (freq[i]) + fabs (*df)))
+      return 0;
+  }
+
+  if (op->type == FIR_ASYM)
+  {
+    for (i = 1; i < na && a[i] == a[0]; i++)
+      ;
+    if (i == na)
+      return 0;
+  }
+  return 1;
+}
+
+/*==================================================================
+ *    Multiply the output by the response of a FIR step evaluated
+ *    with the chirp-z transform
+ *=================================================================*/
+static int
+fir_fft_product (evalresp_logger *log, const evalresp_plan_op *op, double f0,
+                 double df, int nfreqs, evalresp_complex *output)
+{
+  double *re = NULL, *im = NULL;
+  evalresp_complex of;
+  int i, status;
+
+  if (!(status = calloc_doubles (log, "FIR response", nfreqs, &re)) && !(status = calloc_doubles (log, "FIR response", nfreqs, &im)) && !(status = fir_trans_fft (log, op->blkt, op->sint, f0, df, nfreqs, re, im)))
+  {
+    for (i = 0; i < nfreqs; i++)
+    {
+      of.real = re[i];
+      of.imag = im[i];
+      zmul (&output[i], &of);
+    }
+  }
+  free (re);
+  free (im);
+  return status;
+}
 
-    /* if no matching stages were found, then report the error */
+/*==================================================================
+ *    The response of a single FIR, IIR coefficient or decimation step
+ *    at freq[0..nfreqs-1], as the same kernel evaluate_chunk() would
+ *    use (so that it can be kept in a stage cache)
+ *=================================================================*/
+static int
+step_values (evalresp_logger *log, evalresp_options const *const options,
+             const evalresp_plan_op *op, const double *freq, int nfreqs,
+             evalresp_complex *values)
+{
+  double df, *re = NULL, *im = NULL;
+  int i, status = EVALRESP_OK;
 
-    if (!matching_stages && !has_stage0)
+  switch (op->type)
+  {
+  case FIR_SYM_1:
+  case FIR_SYM_2:
+  case FIR_ASYM:
+    if (use_fir_fft (options, op, freq, nfreqs, &df))
     {
-      evalresp_log (log, EV_ERROR, 0,
-                    "calc_resp: %s start_stage=%d, highest stage found=%d)",
-                    "No Matching Stages Found (requested", options->start_stage,
-                    chan->nstages);
-      return EVALRESP_PAR;
+      if (!(status = calloc_doubles (log, "FIR response", nfreqs, &re)) && !(status = calloc_doubles (log, "FIR response", nfreqs, &im)) && !(status = fir_trans_fft (log, op->blkt, op->sint, freq[0], df, nfreqs, re, im)))
+      {
+        for (i = 0; i < nfreqs; i++)
+        {
+          values[i].real = re[i];
+          values[i].imag = im[i];
+        }
+      }
+      free (re);
+      free (im);
     }
-    else if (!matching_stages)
+    else
     {
-      evalresp_log (log, EV_ERROR, 0,
-                    "calc_resp: %s start_stage=%d, highest stage found=%d)",
-                    "No Matching Stages Found (requested", options->start_stage,
-                    chan->nstages - 1);
-      return EVALRESP_PAR;
+      for (i = 0; i < nfreqs; i++)
+      {
+        if (options->use_trig_recurrence)
+          fir_trans_rec (op->blkt, op->sint, 2 * M_PI * freq[i], &values[i]);
+        else if (op->type == FIR_ASYM)
+          fir_asym_trans (op->blkt, op->sint, 2 * M_PI * freq[i], &values[i]);
+        else
+          fir_sym_trans (op->blkt, op->sint, 2 * M_PI * freq[i], &values[i]);
+      }
+    }
+    break;
+  case IIR_COEFFS:
+    for (i = 0; i < nfreqs; i++)
+    {
+      if (options->use_trig_recurrence)
+        iir_trans_rec (op->blkt, op->sint, 2 * M_PI * freq[i], &values[i]);
+      else
+        iir_trans (op->blkt, op->sint, 2 * M_PI * freq[i], &values[i]);
     }
+    break;
+  case DECIMATION:
+    for (i = 0; i < nfreqs; i++)
+    {
+      calc_time_shift (op->delay, 2 * M_PI * freq[i], &values[i]);
+    }
+    break;
+  default:
+    break;
+  }
+  return status;
+}
 
-    /*  Write output for freq[i] in output[i] (note: unit_scale_fact is set by the
-     * 'check_units' function that is used to convert to 'MKS' units when the
-     * the response was given as a displacement, velocity, or acceleration in units other
-     * than meters) */
-    if (0 == options->use_total_sensitivity)
+/*==================================================================
+ *    Evaluate a plan at freq[0..nfreqs-1], which are the frequencies
+ *    from index first in the full vector (blockette 55 responses and
+ *    cached steps are looked up by that index).  When step k has
+ *    cached values they are used from shared[k]; when fill[k] is set
+ *    the values are also stored there, for the cache.
+ *=================================================================*/
+static int
+evaluate_chunk (evalresp_logger *log, evalresp_options const *const options,
+                const evalresp_plan *plan, const evalresp_complex *const *shared,
+                evalresp_complex *const *fill, int first, const double *freq,
+                int nfreqs, evalresp_complex *output)
+{
+  const evalresp_plan_op *op;
+  int i, j, k, n, isa = simd_best_isa ();
+  double w, df, re[SIMD_BATCH], im[SIMD_BATCH];
+  evalresp_complex of;
+  int status = EVALRESP_OK;
+
+  for (i = 0; i < nfreqs; i++)
+  {
+    output[i].real = 1.0;
+    output[i].imag = 0.0;
+  }
+
+  /* apply each step to the whole frequency vector in turn; the product
+     for each frequency is accumulated in the same order as the stages */
+  for (k = 0; k < plan->nops && !status; k++)
+  {
+    op = &plan->ops[k];
+    if (fill && fill[k])
     {
-      output[i].real = val.real * chan->calc_sensit * chan->unit_scale_fact;
-      output[i].imag = val.imag * chan->calc_sensit * chan->unit_scale_fact;
+      if (!(status = step_values (log, options, op, freq, nfreqs, fill[k] + first)))
+      {
+        for (i = 0; i < nfreqs; i++)
+        {
+          zmul (&output[i], &fill[k][first + i]);
+        }
+      }
+      continue;
     }
-    else
+    if (shared && shared[k])
     {
-      output[i].real = val.real * chan->sensit * chan->unit_scale_fact;
-      output[i].imag = val.imag * chan->sensit * chan->unit_scale_fact;
+      for (i = 0; i < nfreqs; i++)
+      {
+        zmul (&output[i], &shared[k][first + i]);
+      }
+      continue;
     }
+    switch (op->type)
+    {
+    case ANALOG_PZ:
+    case LAPLACE_PZ:
+    case IIR_PZ:
+      for (i = 0; i < nfreqs; i += SIMD_BATCH)
+      {
+        n = nfreqs - i < SIMD_BATCH ? nfreqs - i : SIMD_BATCH;
+        if (op->type == IIR_PZ)
+          iir_pz_trans_batch (op->blkt, op->sint, freq + i, n, re, im);
+        else
+          analog_trans_batch (isa, op->blkt, freq + i, n, re, im);
+        for (j = 0; j < n; j++)
+        {
+          of.real = re[j];
+          of.imag = im[j];
+          zmul (&output[i + j], &of);
+        }
+      }
+      break;
+    case FIR_SYM_1:
+    case FIR_SYM_2:
+    case FIR_ASYM:
+      if (use_fir_fft (options, op, freq, nfreqs, &df))
+      {
+        status = fir_fft_product (log, op, freq[0], df, nfreqs, output);
+      }
+      else if (options->use_trig_recurrence)
+      {
+        for (i = 0; i < nfreqs; i++)
+        {
+          fir_trans_rec (op->blkt, op->sint, 2 * M_PI * freq[i], &of);
+          zmul (&output[i], &of);
+        }
+      }
+      else if (op->type == FIR_ASYM)
+      {
+        for (i = 0; i < nfreqs; i++)
+        {
+          fir_asym_trans (op->blkt, op->sint, 2 * M_PI * freq[i], &of);
+          zmul (&output[i], &of);
+        }
+      }
+      else
+      {
+        for (i = 0; i < nfreqs; i++)
+        {
+          fir_sym_trans (op->blkt, op->sint, 2 * M_PI * freq[i], &of);
+          zmul (&output[i], &of);
+        }
+      }
+      break;
+    case DECIMATION:
+      for (i = 0; i < nfreqs; i++)
+      {
+        calc_time_shift (op->delay, 2 * M_PI * freq[i], &of);
+        zmul (&output[i], &of);
+      }
+      break;
+    case LIST:
+      for (i = 0; i < nfreqs; i++)
+      {
+        calc_list (op->blkt, first + i, &of); /*compute real and imag parts for the i-th ampl and phase */
+        zmul (&output[i], &of);
+      }
+      break;
+    case POLYNOMIAL:
+      of = op->value;
+      for (i = 0; i < nfreqs; i++)
+      {
+        zmul (&output[i], &of);
+      }
+      break;
+    case IIR_COEFFS:
+      for (i = 0; i < nfreqs; i++)
+      {
+        if (options->use_trig_recurrence)
+          iir_trans_rec (op->blkt, op->sint, 2 * M_PI * freq[i], &of);
+        else
+          iir_trans (op->blkt, op->sint, 2 * M_PI * freq[i], &of);
+        zmul (&output[i], &of);
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  for (i = 0; i < nfreqs && !status; i++)
+  {
+    w = 2 * M_PI * freq[i];
+    output[i].real = output[i].real * plan->sensit * plan->unit_scale_fact;
+    output[i].imag = output[i].imag * plan->sensit * plan->unit_scale_fact;
+    status = convert_to_units (plan->input_units, options->unit, &output[i], w, log);
+  }
+  return status;
+}
 
-    if ((status = convert_to_units (units_code, options->unit, &output[i], w, log)))
+typedef struct
+{
+  evalresp_options const *options;
+  const evalresp_plan *plan;
+  const evalresp_complex *const *shared;
+  evalresp_complex *const *fill;
+  const double *freq;
+  int nfreqs;
+  evalresp_complex *output;
+} chunk_work;
+
+static int
+chunk_task (evalresp_logger *log, void *data, int i)
+{
+  chunk_work *work = data;
+  int first = i * FREQ_CHUNK;
+  int n = work->nfreqs - first < FREQ_CHUNK ? work->nfreqs - first : FREQ_CHUNK;
+  return evaluate_chunk (log, work->options, work->plan, work->shared, work->fill, first,
+                         work->freq + first, n, work->output + first);
+}
+
+int
+evaluate_plan (evalresp_logger *log, evalresp_options const *const options,
+               const evalresp_plan *plan, stage_cache *stages, const double *freq,
+               int nfreqs, evalresp_complex *output)
+{
+  chunk_work work;
+  const evalresp_complex **shared = NULL;
+  evalresp_complex **fill = NULL;
+  int ndone, k, grid = -1, status = EVALRESP_OK;
+
+  /* steps already evaluated for another channel on the same grid are
+     taken from the stage cache; the others are evaluated into new
+     arrays and added to it (if memory is short they are just not
+     cached) */
+  if (stages && nfreqs && (grid = stage_cache_grid (stages, freq, nfreqs)) >= 0 && (shared = calloc (plan->nops, sizeof (*shared))) && (fill = calloc (plan->nops, sizeof (*fill))))
+  {
+    for (k = 0; k < plan->nops; k++)
     {
-      return status;
+      if (stage_cache_stores (&plan->ops[k]) && !(shared[k] = stage_cache_find (stages, options, &plan->ops[k], grid)))
+      {
+        fill[k] = calloc (nfreqs, sizeof (*fill[k]));
+      }
     }
   }
-  return EVALRESP_OK;
+
+  if (nfreqs <= FREQ_CHUNK)
+  {
+    status = evaluate_chunk (log, options, plan, shared, fill, 0, freq, nfreqs, output);
+  }
+  else
+  {
+    /* each chunk is evaluated stage by stage while it is in cache, and
+       written straight into its part of the output */
+    work.options = options;
+    work.plan = plan;
+    work.shared = shared;
+    work.fill = fill;
+    work.freq = freq;
+    work.nfreqs = nfreqs;
+    work.output = output;
+    status = parallel_for (log, options->nthreads, (nfreqs + FREQ_CHUNK - 1) / FREQ_CHUNK,
+                           chunk_task, &work, &ndone);
+  }
+
+  for (k = 0; fill && k < plan->nops; k++)
+  {
+    if (fill[k] && !status)
+    {
+      stage_cache_add (stages, options, &plan->ops[k], grid, fill[k]);
+    }
+    else
+    {
+      free (fill[k]);
+    }
+  }
+  free (shared);
+  free (fill);
+  return status;
+}
+
+void
+free_plan (evalresp_plan **plan)
+{
+  if (*plan)
+  {
+    free ((*plan)->ops);
+    free (*plan);
+    *plan = NULL;
+  }
+}
+
+int
+calculate_response (evalresp_logger *log, evalresp_options *options,
+                    evalresp_channel *chan, double *freq, int nfreqs,
+                    evalresp_complex *output)
+{
+  evalresp_plan *plan = NULL;
+  int status;
+
+  if (!(status = compile_plan (log, options, chan, &plan)))
+  {
+    status = evaluate_plan (log, options, plan, NULL, freq, nfreqs, output);
+    free_plan (&plan);
+  }
+  return status;
 }
@@ -14,6 +14,17 @@
 
 // new code as a clean wrapper for calc_resp etc.
 
+static void
+init_options (evalresp_options *options)
+{
+  memset (options, 0, sizeof (*options));
+  options->start_stage = EVALRESP_ALL_STAGES;
+  options->min_freq = EVALRESP_NO_FREQ;
+  options->max_freq = EVALRESP_NO_FREQ;
+  options->nfreq = 1;
+  options->unit = evalresp_velocity_unit;
+}
+
 int
 evalresp_new_options (evalresp_logger *log, evalresp_options **options)
 {
@@ -25,11 +36,7 @@ evalresp_new_options (evalresp_logger *log, evalresp_options **options)
   }
   else
   {
-    (*options)->start_stage = EVALRESP_ALL_STAGES;
-    (*options)->min_freq = EVALRESP_NO_FREQ;
-    (*options)->max_freq = EVALRESP_NO_FREQ;
-    (*options)->nfreq = 1;
-    (*options)->unit = evalresp_velocity_unit;
+    init_options (*options);
   }
   return status;
 }
@@ -197,19 +204,21 @@ is_block_55 (const evalresp_channel *channel)
 }
 
 static int
-validate_freqs (evalresp_logger *log, evalresp_options *options)
+validate_freqs (evalresp_logger *log, evalresp_options const *const options,
+                double *min_freq, double *max_freq)
 {
   int status = EVALRESP_OK;
 
-  options->min_freq = options->min_freq < 0 ? 1.0 : options->min_freq;
-  options->max_freq = options->max_freq < 0 ? options->min_freq : options->max_freq;
-  if (options->max_freq < options->min_freq)
+  /* the options are only read, so that they can be shared between threads */
+  *min_freq = options->min_freq < 0 ? 1.0 : options->min_freq;
+  *max_freq = options->max_freq < 0 ? *min_freq : options->max_freq;
+  if (*max_freq < *min_freq)
   {
-    double tmp = options->max_freq;
-    options->max_freq = options->min_freq;
-    options->min_freq = tmp;
+    double tmp = *max_freq;
+    *max_freq = *min_freq;
+    *min_freq = tmp;
   }
-  if (!options->lin_freq && options->min_freq == 0)
+  if (!options->lin_freq && *min_freq == 0)
   {
     evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot have zero frequency with logarithmic spacing");
     status = EVALRESP_INP;
@@ -224,23 +233,18 @@ validate_freqs (evalresp_logger *log, evalresp_options *options)
 }
 
 static int
-calculate_default_freqs (evalresp_logger *log, evalresp_options *options,
+calculate_default_freqs (evalresp_logger *log, evalresp_options const *const options,
                          evalresp_response *response)
 {
   int status = EVALRESP_OK, i;
   double delta = 0, lo, hi;
 
-  if (!(status = validate_freqs (log, options)))
+  if (!(status = validate_freqs (log, options, &lo, &hi)))
   {
-    if (options->lin_freq)
-    {
-      lo = options->min_freq;
-      hi = options->max_freq;
-    }
-    else
+    if (!options->lin_freq)
     {
-      lo = log10 (options->min_freq);
-      hi = log10 (options->max_freq);
+      lo = log10 (lo);
+      hi = log10 (hi);
     }
     delta = options->nfreq == 1 ? 0 : (hi - lo) / (options->nfreq - 1);
     if (!(status = calloc_doubles (log, "frequencies", options->nfreq, &response->freqs)))
@@ -283,38 +287,6 @@ save_doubles (evalresp_logger *log, const char *name, int n, double **dest, doub
   return status;
 }
 
-static int
-save_b55 (evalresp_logger *log, evalresp_channel *channel,
-          evalresp_blkt **b55_save)
-{
-  int status = EVALRESP_OK;
-  evalresp_blkt *b55 = channel->first_stage->first_blkt;
-  evalresp_list *list = &b55->blkt_info.list;
-  if (!(*b55_save = calloc (1, sizeof (**b55_save))))
-  {
-    evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate blockette 55");
-    status = EVALRESP_MEM;
-  }
-  else
-  {
-    memcpy (*b55_save, b55, sizeof (*b55));
-    /* interpolation will free the freq, phase and amp arrays, so we must
-     * allocate further copies
-     */
-    if (!(status = save_doubles (log, "b55 frequencies", list->nresp,
-                                 &(*b55_save)->blkt_info.list.freq, list->freq)))
-    {
-      if (!(status = save_doubles (log, "b55 amplitudes", list->nresp,
-                                   &(*b55_save)->blkt_info.list.amp, list->amp)))
-      {
-        status = save_doubles (log, "b55 phases", list->nresp,
-                               &(*b55_save)->blkt_info.list.phase, list->phase);
-      }
-    }
-  }
-  return status;
-}
-
 static int
 restrict_frequency_range (evalresp_logger *log, double lo, double hi, int *nfreqs, double *freqs)
 {
@@ -354,32 +326,49 @@ restrict_frequency_range (evalresp_logger *log, double lo, double hi, int *nfreq
   return status;
 }
 
+/* interpolate blockette 55 to the given frequencies (which must be within
+ * its range) in a private copy (the channel itself is left unchanged).
+ */
 static int
-interpolate_b55 (evalresp_logger *log, evalresp_channel *channel,
-                 evalresp_response *response, evalresp_blkt **b55_save)
+interpolate_b55 (evalresp_logger *log, const evalresp_blkt *b55,
+                 const double *freqs, int nfreqs, evalresp_blkt *copy)
 {
   int status = EVALRESP_OK;
-  evalresp_blkt *b55 = channel->first_stage->first_blkt;
-  evalresp_list *list = &b55->blkt_info.list;
-  if (!(status = save_b55 (log, channel, b55_save)))
-  {
-    if (!(status = restrict_frequency_range (log, list->freq[0], list->freq[list->nresp - 1],
-                                             &response->nfreqs, response->freqs)))
+  const evalresp_list *list = &b55->blkt_info.list;
+  evalresp_list *list_copy = &copy->blkt_info.list;
+  memset (copy, 0, sizeof (*copy));
+  copy->type = b55->type;
+  list_copy->nresp = list->nresp;
+  /* interpolation will free the freq, phase and amp arrays, so we must
+   * interpolate from copies
+   */
+  if (!(status = save_doubles (log, "b55 frequencies", list->nresp, &list_copy->freq, list->freq)))
+  {
+    if (!(status = save_doubles (log, "b55 amplitudes", list->nresp, &list_copy->amp, list->amp)))
     {
-      status = interpolate_list_blockette (&list->freq, &list->amp, &list->phase, &list->nresp,
-                                           response->freqs, response->nfreqs, log);
+      status = save_doubles (log, "b55 phases", list->nresp, &list_copy->phase, list->phase);
     }
   }
+  if (!status)
+  {
+    /* the requested frequencies are only read */
+    status = interpolate_list_blockette (&list_copy->freq, &list_copy->amp, &list_copy->phase,
+                                         &list_copy->nresp, (double *)freqs, nfreqs, log);
+  }
+  if (!status && list_copy->nresp != nfreqs)
+  {
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot interpolate blockette 55 to the requested frequencies");
+    status = EVALRESP_INP;
+  }
   return status;
 }
 
 static int
-use_b55_freqs (evalresp_logger *log, evalresp_channel *channel,
+use_b55_freqs (evalresp_logger *log, const evalresp_blkt *b55,
                evalresp_response *response)
 {
   int status = EVALRESP_OK;
-  evalresp_blkt *b55 = channel->first_stage->first_blkt;
-  evalresp_list *list = &b55->blkt_info.list;
+  const evalresp_list *list = &b55->blkt_info.list;
   free (response->freqs);
   if (!(status = calloc_doubles (log, "frequency array", list->nresp, &response->freqs)))
   {
@@ -398,92 +387,280 @@ use_b55_freqs (evalresp_logger *log, evalresp_channel *channel,
   return status;
 }
 
-static void
-restore_b55 (evalresp_channel *channel, evalresp_blkt *b55_save)
+/* evaluate a plan with its blockette 55 step replaced by an interpolated copy */
+static int
+evaluate_b55_plan (evalresp_logger *log, evalresp_options const *const options,
+                   const evalresp_plan *plan, stage_cache *stages, const evalresp_blkt *b55,
+                   const double *freqs, int nfreqs, evalresp_complex *output)
 {
-  evalresp_blkt *b55 = channel->first_stage->first_blkt;
-  evalresp_list *list = &b55->blkt_info.list;
-  evalresp_list *list_save = &b55_save->blkt_info.list;
-  list->nresp = list_save->nresp;
-  free (list->freq);
-  list->freq = list_save->freq;
-  free (list->amp);
-  list->amp = list_save->amp;
-  free (list->phase);
-  list->phase = list_save->phase;
+  int status = EVALRESP_OK, i;
+  evalresp_plan copy = *plan;
+  evalresp_plan_op *ops = NULL;
+  evalresp_blkt b55_copy;
+
+  if (!(status = interpolate_b55 (log, b55, freqs, nfreqs, &b55_copy)))
+  {
+    if (!(ops = calloc (plan->nops, sizeof (*ops))))
+    {
+      evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate evaluation plan");
+      status = EVALRESP_MEM;
+    }
+    else
+    {
+      for (i = 0; i < plan->nops; i++)
+      {
+        ops[i] = plan->ops[i];
+        if (ops[i].blkt == b55)
+        {
+          ops[i].blkt = &b55_copy;
+        }
+      }
+      copy.ops = ops;
+      status = evaluate_plan (log, options, &copy, stages, freqs, nfreqs, output);
+    }
+  }
+
+  free (ops);
+  free (b55_copy.blkt_info.list.freq);
+  free (b55_copy.blkt_info.list.amp);
+  free (b55_copy.blkt_info.list.phase);
+  return status;
 }
 
 int
-evalresp_channel_to_response (evalresp_logger *log, evalresp_channel *channel,
-                              evalresp_options *options, evalresp_response **response)
+evalresp_prepare_channel (evalresp_logger *log, evalresp_channel *channel,
+                          evalresp_options const *const options,
+                          evalresp_prepared_channel **prepared)
+{
+  int status = EVALRESP_OK;
+  evalresp_options *default_options = NULL;
+  evalresp_options const *opts = options;
+
+  /* allow NULL options */
+  if (!opts && !(status = evalresp_new_options (log, &default_options)))
+  {
+    opts = default_options;
+  }
+
+  if (!status)
+  {
+    if (!(*prepared = calloc (1, sizeof (**prepared))))
+    {
+      evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate prepared channel");
+      status = EVALRESP_MEM;
+    }
+    else if (!(status = normalize_response (log, opts, channel)))
+    {
+      (*prepared)->channel = channel;
+      status = compile_plan (log, opts, channel, &(*prepared)->plan);
+    }
+  }
+
+  if (status)
+  {
+    evalresp_free_prepared_channel (prepared);
+  }
+  evalresp_free_options (&default_options);
+  return status;
+}
+
+/* evaluate a prepared channel, sharing stages with other channels if a
+   stage cache is given */
+static int
+prepared_response (evalresp_logger *log, const evalresp_prepared_channel *prepared,
+                   evalresp_options const *const options, stage_cache *stages,
+                   evalresp_response **response)
 {
-  int status = EVALRESP_OK, free_options = 0;
-  evalresp_blkt *b55_save = NULL;
+  int status = EVALRESP_OK;
+  evalresp_options *default_options = NULL;
+  evalresp_options const *opts = options;
+  const evalresp_channel *channel = prepared->channel;
+  const evalresp_blkt *b55 = NULL;
 
   /* allow NULL options */
-  if (!options)
+  if (!opts && !(status = evalresp_new_options (log, &default_options)))
   {
-    status = evalresp_new_options (log, &options);
-    free_options = 1;
+    opts = default_options;
   }
 
-  if (!(status = local_alloc_response (log, response)))
+  if (!status && !(status = local_alloc_response (log, response)))
   {
-    if (!(status = calculate_default_freqs (log, options, *response)))
+    if (!(status = calculate_default_freqs (log, opts, *response)))
     {
       if (is_block_55 (channel))
       {
-        /* if it's a b55 block then calc_resp is just going to copy its data
-         * to the response.  so we need to make sure that frequencies agree
-         * beforehand.  either by interpolating the blockette data (in which
-         * case we keep a backup and restore it below) or by changing the
-         * output frequencies to match.
+        /* if it's a b55 block then the plan is just going to copy its data
+         * to the response.  so we need to make sure that frequencies agree.
+         * either by interpolating the blockette data (into a copy, as the
+         * prepared channel is shared) or by changing the output frequencies
+         * to match.
          */
-        if (options->b55_interpolate)
+        b55 = channel->first_stage->first_blkt;
+        if (opts->b55_interpolate)
         {
-          status = interpolate_b55 (log, channel, *response, &b55_save);
+          if (!(status = restrict_frequency_range (log, b55->blkt_info.list.freq[0],
+                                                   b55->blkt_info.list.freq[b55->blkt_info.list.nresp - 1],
+                                                   &(*response)->nfreqs, (*response)->freqs)))
+          {
+            status = evaluate_b55_plan (log, opts, prepared->plan, stages, b55, (*response)->freqs,
+                                        (*response)->nfreqs, (*response)->rvec);
+          }
         }
-        else
+        else if (!(status = use_b55_freqs (log, b55, *response)))
         {
-          status = use_b55_freqs (log, channel, *response);
+          status = evaluate_plan (log, opts, prepared->plan, stages, (*response)->freqs, (*response)->nfreqs, (*response)->rvec);
         }
       }
+      else
+      {
+        status = evaluate_plan (log, opts, prepared->plan, stages, (*response)->freqs, (*response)->nfreqs, (*response)->rvec);
+      }
     }
   }
 
   if (!status)
   {
-    if (!(status = normalize_response (log, options, channel)))
+    strncpy ((*response)->network, channel->network, NETLEN);
+    strncpy ((*response)->station, channel->staname, STALEN);
+    strncpy ((*response)->locid, channel->locid, LOCIDLEN);
+    strncpy ((*response)->channel, channel->chaname, CHALEN);
+    if (opts->verbose)
+    {
+      evalresp_channel_to_log (log, opts, channel);
+    }
+  }
+
+  if (status && *response)
+  {
+    evalresp_free_response (response);
+  }
+  evalresp_free_options (&default_options);
+  return status;
+}
+
+int
+evalresp_prepared_to_response (evalresp_logger *log, const evalresp_prepared_channel *prepared,
+                               evalresp_options const *const options,
+                               evalresp_response **response)
+{
+  return prepared_response (log, prepared, options, NULL, response);
+}
+
+int
+evalresp_prepared_to_buffer (evalresp_logger *log, const evalresp_prepared_channel *prepared,
+                             evalresp_options const *const options,
+                             const double *freqs, int nfreqs, evalresp_complex *output)
+{
+  int status = EVALRESP_OK, i;
+  evalresp_options default_options;
+  evalresp_options const *opts = options;
+  const evalresp_list *list;
+  double lo, hi;
+
+  /* allow NULL options (without allocating) */
+  if (!opts)
+  {
+    init_options (&default_options);
+    opts = &default_options;
+  }
+
+  if (nfreqs < 0)
+  {
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot have a negative number of frequencies");
+    status = EVALRESP_INP;
+  }
+  else if (is_block_55 (prepared->channel))
+  {
+    /* the blockette 55 values are only known at its own frequencies, unless
+     * interpolated (which needs some workspace) */
+    list = &prepared->channel->first_stage->first_blkt->blkt_info.list;
+    if (opts->b55_interpolate)
     {
-      if (!(status = calculate_response (log, options, channel, (*response)->freqs, (*response)->nfreqs, (*response)->rvec)))
+      lo = list->freq[0] < list->freq[list->nresp - 1] ? list->freq[0] : list->freq[list->nresp - 1];
+      hi = list->freq[0] < list->freq[list->nresp - 1] ? list->freq[list->nresp - 1] : list->freq[0];
+      for (i = 0; !status && i < nfreqs; ++i)
       {
-        strncpy ((*response)->network, channel->network, NETLEN);
-        strncpy ((*response)->station, channel->staname, STALEN);
-        strncpy ((*response)->locid, channel->locid, LOCIDLEN);
-        strncpy ((*response)->channel, channel->chaname, CHALEN);
-        if (options->verbose)
+        if (freqs[i] < lo || freqs[i] > hi)
         {
-          evalresp_channel_to_log (log, options, channel);
+          evalresp_log (log, EV_ERROR, EV_ERROR, "Frequency %g is not included in blockette 55", freqs[i]);
+          status = EVALRESP_INP;
         }
       }
+      if (!status)
+      {
+        status = evaluate_b55_plan (log, opts, prepared->plan, NULL, prepared->channel->first_stage->first_blkt,
+                                    freqs, nfreqs, output);
+      }
+    }
+    else
+    {
+      for (i = 0; i < nfreqs && nfreqs == list->nresp && freqs[i] == list->freq[i]; ++i)
+        ;
+      if (i < nfreqs || nfreqs != list->nresp)
+      {
+        evalresp_log (log, EV_ERROR, EV_ERROR, "Frequencies must match blockette 55 unless it is interpolated");
+        status = EVALRESP_INP;
+      }
+      else
+      {
+        status = evaluate_plan (log, opts, prepared->plan, NULL, freqs, nfreqs, output);
+      }
     }
   }
-
-  if (b55_save)
+  else
   {
-    restore_b55 (channel, b55_save);
+    status = evaluate_plan (log, opts, prepared->plan, NULL, freqs, nfreqs, output);
   }
-  if (free_options)
+  return status;
+}
+
+void
+evalresp_free_prepared_channel (evalresp_prepared_channel **prepared)
+{
+  if (*prepared)
   {
-    evalresp_free_options (&options);
+    free_plan (&(*prepared)->plan);
+    free (*prepared);
+    *prepared = NULL;
   }
-  free (b55_save);
+}
 
-  if (status && *response)
+int
+evalresp_channel_to_response (evalresp_logger *log, evalresp_channel *channel,
+                              evalresp_options *options, evalresp_response **response)
+{
+  int status = EVALRESP_OK;
+  evalresp_prepared_channel *prepared = NULL;
+
+  if (!(status = evalresp_prepare_channel (log, channel, options, &prepared)))
   {
-    evalresp_free_response (response);
+    status = evalresp_prepared_to_response (log, prepared, options, response);
   }
+  evalresp_free_prepared_channel (&prepared);
+
+  return status;
+}
+
+typedef struct
+{
+  evalresp_channels *channels;
+  evalresp_options *options;
+  evalresp_response **responses; /* one slot per channel */
+  stage_cache *stages;           /* shared between channels, or NULL */
+} channel_work;
+
+static int
+channel_task (evalresp_logger *log, void *data, int i)
+{
+  channel_work *work = data;
+  int status = EVALRESP_OK;
+  evalresp_prepared_channel *prepared = NULL;
 
+  if (!(status = evalresp_prepare_channel (log, work->channels->channels[i], work->options, &prepared)))
+  {
+    status = prepared_response (log, prepared, work->options, work->stages, &work->responses[i]);
+  }
+  evalresp_free_prepared_channel (&prepared);
   return status;
 }
 
@@ -491,30 +668,53 @@ int
 evalresp_channels_to_responses (evalresp_logger *log, evalresp_channels *channels,
                                 evalresp_options *options, evalresp_responses **responses)
 {
-  int status = EVALRESP_OK, i;
+  int status = EVALRESP_OK, i, ndone = 0;
+  evalresp_response **array;
+  evalresp_options channel_options;
+  channel_work work;
   if (!*responses && !(*responses = calloc (1, sizeof (**responses))))
   {
     evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate responses");
     status = EVALRESP_MEM;
   }
-  else
+  else if (channels->nchannels)
   {
-    for (i = 0; !status && i < channels->nchannels; ++i)
+    if (!(array = realloc ((*responses)->responses, ((*responses)->nresponses + channels->nchannels) * sizeof (*array))))
     {
-      evalresp_response *response = NULL;
-      if (!(status = evalresp_channel_to_response (log, channels->channels[i], options, &response)))
+      evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate array for new response");
+      status = EVALRESP_MEM;
+    }
+    else
+    {
+      (*responses)->responses = array;
+      work.channels = channels;
+      work.options = options;
+      work.responses = array + (*responses)->nresponses;
+      work.stages = NULL;
+      memset (work.responses, 0, channels->nchannels * sizeof (*array));
+      /* channels are independent, so can be evaluated in parallel; as
+         when run in sequence, only the responses before the first
+         failure are kept */
+      if (options && options->nthreads > 1 && channels->nchannels > 1)
       {
-        (*responses)->nresponses++;
-        if (!((*responses)->responses = realloc ((*responses)->responses, (*responses)->nresponses * sizeof (*(*responses)->responses))))
-        {
-          evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate array for new response");
-          status = EVALRESP_MEM;
-        }
-        else
-        {
-          (*responses)->responses[(*responses)->nresponses - 1] = response;
-        }
+        /* the threads are used for channels, not frequencies */
+        channel_options = *options;
+        channel_options.nthreads = 1;
+        work.options = &channel_options;
+      }
+      /* identical stages in different channels (the same digitizer,
+         say) need only be evaluated once */
+      if (!(options && options->cache_stages) || !(status = new_stage_cache (log, &work.stages)))
+      {
+        status = parallel_for (log, options ? options->nthreads : 1, channels->nchannels,
+                               channel_task, &work, &ndone);
+      }
+      free_stage_cache (&work.stages);
+      for (i = ndone; i < channels->nchannels; i++)
+      {
+        evalresp_free_response (&work.responses[i]);
       }
+      (*responses)->nresponses += ndone;
     }
   }
   return status;
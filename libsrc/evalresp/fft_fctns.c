@@ -0,0 +1,226 @@
+/* fft_fctns.c */
+
+/*
+ FFT based evaluation of long FIR filters on linear frequency grids.
+
+ The response of an N tap FIR filter at M equally spaced frequencies is
+ evaluated with the chirp-z transform (Bluestein's algorithm), which turns
+ the sums into a convolution of length N + M - 1 computed with a zero
+ padded FFT.  Unlike sampling a plain FFT and interpolating, this gives the
+ response at exactly the requested frequencies, so the only difference
+ from direct summation is rounding.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+/* NEEDED for M_PI on windows */
+#define _USE_MATH_DEFINES
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "./private.h"
+
+/*==================================================================
+ *    In-place iterative radix-2 FFT of length n (a power of two).
+ *    c[k] and s[k] hold cos and sin (2 pi k / n) for k < n / 2; the
+ *    sign of s selects the forward (-) or unscaled inverse (+)
+ *    transform.  Twiddle factors are tabulated directly, not by
+ *    recurrence, to keep the rounding error at O(eps log n).
+ *=================================================================*/
+static void
+fft (double *re, double *im, int n, const double *c, const double *s, int sign)
+{
+  double tr, ti, t, wr, wi;
+  int i, j, k, len, half, step;
+
+  /* bit reversal */
+  for (i = 1, j = 0; i < n; i++)
+  {
+    for (k = n >> 1; j & k; k >>= 1)
+      j ^= k;
+    j |= k;
+    if (i < j)
+    {
+      t = re[i];
+      re[i] = re[j];
+      re[j] = t;
+      t = im[i];
+      im[i] = im[j];
+      im[j] = t;
+    }
+  }
+
+  for (len = 2; len <= n; len <<= 1)
+  {
+    half = len >> 1;
+    step = n / len;
+    for (i = 0; i < n; i += len)
+    {
+      for (k = 0; k < half; k++)
+      {
+        wr = c[k * step];
+        wi = sign * s[k * step];
+        tr = re[i + k + half] * wr - im[i + k + half] * wi;
+        ti = re[i + k + half] * wi + im[i + k + half] * wr;
+        re[i + k + half] = re[i + k] - tr;
+        im[i + k + half] = im[i + k] - ti;
+        re[i + k] += tr;
+        im[i + k] += ti;
+      }
+    }
+  }
+}
+
+/*==================================================================
+ *    Chirp-z transform of a real sequence x[0..n-1]:
+ *      X[k] = sum_j x[j] exp(-i (phi0 + k delta) j),  k = 0..m-1
+ *=================================================================*/
+static int
+chirpz_transform (evalresp_logger *log, const double *x, int n, double phi0,
+                  double delta, int m, double *re, double *im)
+{
+  double *yr = NULL, *yi = NULL, *vr = NULL, *vi = NULL, *c = NULL, *s = NULL;
+  double a, tr, ti;
+  int j, len;
+  int status = EVALRESP_OK;
+
+  for (len = 2; len < n + m - 1; len <<= 1)
+    ;
+
+  if (!(yr = calloc (len, sizeof (*yr))) || !(yi = calloc (len, sizeof (*yi))) || !(vr = calloc (len, sizeof (*vr))) || !(vi = calloc (len, sizeof (*vi))) || !(c = calloc (len / 2, sizeof (*c))) || !(s = calloc (len / 2, sizeof (*s))))
+  {
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate chirp-z workspace");
+    status = EVALRESP_MEM;
+  }
+  else
+  {
+    for (j = 0; j < len / 2; j++)
+    {
+      c[j] = cos (2 * M_PI * j / len);
+      s[j] = sin (2 * M_PI * j / len);
+    }
+    /* y[j] = x[j] exp(-i (phi0 j + delta j^2 / 2)) */
+    for (j = 0; j < n; j++)
+    {
+      a = phi0 * j + 0.5 * delta * ((double)j * j);
+      yr[j] = x[j] * cos (a);
+      yi[j] = -x[j] * sin (a);
+    }
+    /* v[j] = exp(i delta j^2 / 2) for j = -(n-1)..m-1, wrapped; the
+       first m values are also kept in re, im for the final step */
+    for (j = 0; j < m || j < n; j++)
+    {
+      a = 0.5 * delta * ((double)j * j);
+      tr = cos (a);
+      ti = sin (a);
+      if (j < m)
+      {
+        vr[j] = re[j] = tr;
+        vi[j] = im[j] = ti;
+      }
+      if (j > 0 && j < n)
+      {
+        vr[len - j] = tr;
+        vi[len - j] = ti;
+      }
+    }
+    fft (yr, yi, len, c, s, -1);
+    fft (vr, vi, len, c, s, -1);
+    for (j = 0; j < len; j++)
+    {
+      tr = yr[j] * vr[j] - yi[j] * vi[j];
+      ti = yr[j] * vi[j] + yi[j] * vr[j];
+      yr[j] = tr;
+      yi[j] = ti;
+    }
+    fft (yr, yi, len, c, s, 1);
+    /* X[k] = exp(-i delta k^2 / 2) conv[k] / len */
+    for (j = 0; j < m; j++)
+    {
+      tr = yr[j] / len;
+      ti = yi[j] / len;
+      a = re[j];
+      re[j] = tr * a + ti * im[j];
+      im[j] = ti * a - tr * im[j];
+    }
+  }
+
+  free (yr);
+  free (yi);
+  free (vr);
+  free (vi);
+  free (c);
+  free (s);
+  return status;
+}
+
+int
+fir_trans_fft (evalresp_logger *log, const evalresp_blkt *blkt_ptr, double sint,
+               double f0, double df, int nfreqs, double *re, double *im)
+{
+  double *a, *x, h0, w, mod, pha, R, I;
+  int na, k, j;
+  int status = EVALRESP_OK;
+
+  a = blkt_ptr->blkt_info.fir.coeffs;
+  na = blkt_ptr->blkt_info.fir.ncoeffs;
+  h0 = blkt_ptr->blkt_info.fir.h0;
+
+  /* the symmetric filters are folded about their centre, so that
+     sum_k a[k] cos (wsint * (na - 1 - k)) = Re (sum_j x[j] exp(-i wsint j)) */
+  if (!(x = calloc (na, sizeof (*x))))
+  {
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate FIR coefficients");
+    return EVALRESP_MEM;
+  }
+  for (j = 0; j < na; j++)
+  {
+    switch (blkt_ptr->type)
+    {
+    case FIR_SYM_1:
+      x[j] = j ? 2.0 * a[na - 1 - j] : a[na - 1];
+      break;
+    case FIR_SYM_2:
+      x[j] = a[na - 1 - j];
+      break;
+    default:
+      x[j] = a[j];
+      break;
+    }
+  }
+
+  if (!(status = chirpz_transform (log, x, na, 2 * M_PI * f0 * sint,
+                                   2 * M_PI * df * sint, nfreqs, re, im)))
+  {
+    for (k = 0; k < nfreqs; k++)
+    {
+      w = 2 * M_PI * (f0 + k * df);
+      switch (blkt_ptr->type)
+      {
+      case FIR_SYM_1:
+        re[k] = re[k] * h0;
+        im[k] = 0.;
+        break;
+      case FIR_SYM_2:
+        /* the taps sit half a sample off the centre */
+        re[k] = 2.0 * (re[k] * cos (w * sint / 2) + im[k] * sin (w * sint / 2)) * h0;
+        im[k] = 0.;
+        break;
+      default:
+        R = re[k];
+        I = im[k];
+        mod = sqrt (R * R + I * I);
+        pha = atan2 (I, R) + (w * (double)((na - 1) / 2.0) * sint);
+        re[k] = mod * cos (pha) * h0;
+        im[k] = mod * sin (pha) * h0;
+        break;
+      }
+    }
+  }
+
+  free (x);
+  return status;
+}
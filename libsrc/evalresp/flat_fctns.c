@@ -0,0 +1,354 @@
+/* flat_fctns.c */
+
+/*
+ Channels in a flat layout (evalresp_flat_channel): one allocation holding
+ the channel, a table of its stages, a table of its blockettes and a single
+ pool of all their arrays, addressed by offsets:
+
+   evalresp_flat_channel
+   evalresp_flat_stage    [stages_len]
+   evalresp_flat_blkt     [blkts_len]   (the blockettes of each stage are
+                                         consecutive)
+   double                 [pool_len]
+
+ each part starting on a 16 byte boundary.  Walking a flat channel touches
+ contiguous memory rather than a list of small allocations, and it can be
+ copied as a block.  It is evaluated through a view: the linked structures
+ in a second single allocation, pointing into the pool.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "./private.h"
+#include "evalresp/public_api.h"
+#include "evalresp_log/log.h"
+
+#define FLAT_ALIGN 16
+
+static size_t
+flat_align (size_t n)
+{
+  return (n + FLAT_ALIGN - 1) & ~(size_t)(FLAT_ALIGN - 1);
+}
+
+static size_t
+flat_count (int n)
+{
+  return n > 0 ? n : 0;
+}
+
+/* the arrays of a blockette, in declaration order, with their lengths in
+   doubles; returns the number of arrays */
+static int
+get_arrays (const evalresp_blkt *blkt, const double *arrays[3], size_t lens[3])
+{
+  switch (blkt->type)
+  {
+  case LAPLACE_PZ:
+  case ANALOG_PZ:
+  case IIR_PZ:
+    arrays[0] = (const double *)blkt->blkt_info.pole_zero.zeros;
+    lens[0] = 2 * flat_count (blkt->blkt_info.pole_zero.nzeros);
+    arrays[1] = (const double *)blkt->blkt_info.pole_zero.poles;
+    lens[1] = 2 * flat_count (blkt->blkt_info.pole_zero.npoles);
+    return 2;
+  case FIR_SYM_1:
+  case FIR_SYM_2:
+  case FIR_ASYM:
+    arrays[0] = blkt->blkt_info.fir.coeffs;
+    lens[0] = flat_count (blkt->blkt_info.fir.ncoeffs);
+    return 1;
+  case FIR_COEFFS:
+  case IIR_COEFFS:
+    arrays[0] = blkt->blkt_info.coeff.numer;
+    lens[0] = flat_count (blkt->blkt_info.coeff.nnumer);
+    arrays[1] = blkt->blkt_info.coeff.denom;
+    lens[1] = flat_count (blkt->blkt_info.coeff.ndenom);
+    return 2;
+  case LIST:
+    arrays[0] = blkt->blkt_info.list.freq;
+    arrays[1] = blkt->blkt_info.list.amp;
+    arrays[2] = blkt->blkt_info.list.phase;
+    lens[0] = lens[1] = lens[2] = flat_count (blkt->blkt_info.list.nresp);
+    return 3;
+  case GENERIC:
+    arrays[0] = blkt->blkt_info.generic.corner_freq;
+    arrays[1] = blkt->blkt_info.generic.corner_slope;
+    lens[0] = lens[1] = flat_count (blkt->blkt_info.generic.ncorners);
+    return 2;
+  case POLYNOMIAL:
+    arrays[0] = blkt->blkt_info.polynomial.coeffs;
+    arrays[1] = blkt->blkt_info.polynomial.coeffs_err;
+    lens[0] = lens[1] = flat_count (blkt->blkt_info.polynomial.ncoeffs);
+    return 2;
+  default:
+    return 0;
+  }
+}
+
+/* the reverse of get_arrays() */
+static void
+set_arrays (evalresp_blkt *blkt, double *arrays[3])
+{
+  switch (blkt->type)
+  {
+  case LAPLACE_PZ:
+  case ANALOG_PZ:
+  case IIR_PZ:
+    blkt->blkt_info.pole_zero.zeros = (evalresp_complex *)arrays[0];
+    blkt->blkt_info.pole_zero.poles = (evalresp_complex *)arrays[1];
+    break;
+  case FIR_SYM_1:
+  case FIR_SYM_2:
+  case FIR_ASYM:
+    blkt->blkt_info.fir.coeffs = arrays[0];
+    break;
+  case FIR_COEFFS:
+  case IIR_COEFFS:
+    blkt->blkt_info.coeff.numer = arrays[0];
+    blkt->blkt_info.coeff.denom = arrays[1];
+    break;
+  case LIST:
+    blkt->blkt_info.list.freq = arrays[0];
+    blkt->blkt_info.list.amp = arrays[1];
+    blkt->blkt_info.list.phase = arrays[2];
+    break;
+  case GENERIC:
+    blkt->blkt_info.generic.corner_freq = arrays[0];
+    blkt->blkt_info.generic.corner_slope = arrays[1];
+    break;
+  case POLYNOMIAL:
+    blkt->blkt_info.polynomial.coeffs = arrays[0];
+    blkt->blkt_info.polynomial.coeffs_err = arrays[1];
+    break;
+  default:
+    break;
+  }
+}
+
+int
+evalresp_channel_to_flat (evalresp_logger *log, const evalresp_channel *channel,
+                          evalresp_flat_channel **flat)
+{
+  const evalresp_stage *stage;
+  const evalresp_blkt *blkt;
+  const double *arrays[3];
+  double *none[3] = {NULL, NULL, NULL};
+  size_t lens[3], npool = 0;
+  evalresp_flat_stage *stages;
+  evalresp_flat_blkt *blkts;
+  double *pool;
+  int nstages = 0, nblkts = 0, i, j, n;
+
+  *flat = NULL;
+  /* size everything first, so that it is allocated at once */
+  for (stage = channel->first_stage; stage; stage = stage->next_stage)
+  {
+    nstages++;
+    for (blkt = stage->first_blkt; blkt; blkt = blkt->next_blkt)
+    {
+      nblkts++;
+      n = get_arrays (blkt, arrays, lens);
+      for (j = 0; j < n; j++)
+      {
+        if (lens[j] && !arrays[j])
+        {
+          evalresp_log (log, EV_ERROR, EV_ERROR, "Missing array in blockette of type %d", blkt->type);
+          return EVALRESP_INP;
+        }
+        npool += lens[j];
+      }
+    }
+  }
+  if (!(*flat = calloc (1, flat_align (flat_align (flat_align (sizeof (**flat)) + nstages * sizeof (*stages)) + nblkts * sizeof (*blkts)) + npool * sizeof (*pool))))
+  {
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate flat channel");
+    return EVALRESP_MEM;
+  }
+  (*flat)->channel = *channel;
+  (*flat)->channel.first_stage = NULL;
+  (*flat)->stages_len = nstages;
+  (*flat)->blkts_len = nblkts;
+  (*flat)->pool_len = npool;
+  (*flat)->stages_offset = flat_align (sizeof (**flat));
+  (*flat)->blkts_offset = flat_align ((*flat)->stages_offset + nstages * sizeof (*stages));
+  (*flat)->pool_offset = flat_align ((*flat)->blkts_offset + nblkts * sizeof (*blkts));
+  (*flat)->size = (*flat)->pool_offset + npool * sizeof (*pool);
+
+  stages = EVALRESP_FLAT_STAGES (*flat);
+  blkts = EVALRESP_FLAT_BLKTS (*flat);
+  pool = EVALRESP_FLAT_POOL (*flat);
+  npool = 0;
+  nblkts = 0;
+  for (i = 0, stage = channel->first_stage; stage; i++, stage = stage->next_stage)
+  {
+    stages[i].sequence_no = stage->sequence_no;
+    stages[i].input_units = stage->input_units;
+    stages[i].output_units = stage->output_units;
+    stages[i].first_blkt = nblkts;
+    for (blkt = stage->first_blkt; blkt; nblkts++, blkt = blkt->next_blkt)
+    {
+      blkts[nblkts].blkt = *blkt;
+      blkts[nblkts].blkt.next_blkt = NULL;
+      set_arrays (&blkts[nblkts].blkt, none);
+      n = get_arrays (blkt, arrays, lens);
+      for (j = 0; j < n; j++)
+      {
+        blkts[nblkts].arrays[j] = npool;
+        if (lens[j])
+        {
+          memcpy (pool + npool, arrays[j], lens[j] * sizeof (*pool));
+        }
+        npool += lens[j];
+      }
+    }
+    stages[i].nblkts = nblkts - stages[i].first_blkt;
+  }
+  return EVALRESP_OK;
+}
+
+int
+evalresp_flat_to_channel (evalresp_logger *log, const evalresp_flat_channel *flat,
+                          evalresp_channel **channel)
+{
+  const evalresp_flat_stage *stages = EVALRESP_FLAT_STAGES (flat);
+  const evalresp_flat_blkt *blkts = EVALRESP_FLAT_BLKTS (flat);
+  const double *pool = EVALRESP_FLAT_POOL (flat);
+  const double *unused[3];
+  double *arrays[3] = {NULL, NULL, NULL};
+  size_t lens[3];
+  evalresp_stage **stage;
+  evalresp_blkt **blkt;
+  int status = EVALRESP_OK, i, j, k, n;
+
+  if (!(*channel = arena_calloc (log, NULL, "channel", 1, sizeof (**channel))))
+  {
+    return EVALRESP_MEM;
+  }
+  **channel = flat->channel;
+  (*channel)->first_stage = NULL;
+  /* each part is linked in as soon as it is allocated, so that it is freed
+     with the channel on error */
+  stage = &(*channel)->first_stage;
+  for (i = 0; !status && i < flat->stages_len; i++, stage = &(*stage)->next_stage)
+  {
+    if (!(*stage = alloc_stage (NULL, log)))
+    {
+      status = EVALRESP_MEM;
+      break;
+    }
+    (*stage)->sequence_no = stages[i].sequence_no;
+    (*stage)->input_units = stages[i].input_units;
+    (*stage)->output_units = stages[i].output_units;
+    blkt = &(*stage)->first_blkt;
+    for (j = stages[i].first_blkt; !status && j < stages[i].first_blkt + stages[i].nblkts; j++, blkt = &(*blkt)->next_blkt)
+    {
+      if (!(*blkt = arena_calloc (log, NULL, "blockette", 1, sizeof (**blkt))))
+      {
+        status = EVALRESP_MEM;
+        break;
+      }
+      **blkt = blkts[j].blkt;
+      n = get_arrays (&blkts[j].blkt, unused, lens);
+      for (k = 0; k < n; k++)
+      {
+        if (lens[k] && !(arrays[k] = arena_calloc (log, NULL, "array", lens[k], sizeof (*pool))))
+        {
+          status = EVALRESP_MEM;
+        }
+        else if (lens[k])
+        {
+          memcpy (arrays[k], pool + blkts[j].arrays[k], lens[k] * sizeof (*pool));
+        }
+      }
+      set_arrays (*blkt, arrays);
+      memset (arrays, 0, sizeof (arrays));
+    }
+  }
+  if (status)
+  {
+    evalresp_free_channel (channel);
+  }
+  return status;
+}
+
+void
+evalresp_free_flat_channel (evalresp_flat_channel **flat)
+{
+  free (*flat);
+  *flat = NULL;
+}
+
+/* the linked structures of a flat channel, in a single allocation, with
+   the arrays of the blockettes in the pool */
+static int
+flat_view (evalresp_logger *log, const evalresp_flat_channel *flat, evalresp_channel **view)
+{
+  const evalresp_flat_stage *flat_stages = EVALRESP_FLAT_STAGES (flat);
+  const evalresp_flat_blkt *flat_blkts = EVALRESP_FLAT_BLKTS (flat);
+  double *pool = EVALRESP_FLAT_POOL (flat);
+  const double *unused[3];
+  double *arrays[3] = {NULL, NULL, NULL};
+  size_t lens[3];
+  evalresp_stage *stages;
+  evalresp_blkt *blkts;
+  int i, j, k, n;
+
+  if (!(*view = calloc (1, sizeof (**view) + flat->stages_len * sizeof (*stages) + flat->blkts_len * sizeof (*blkts))))
+  {
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate flat channel view");
+    return EVALRESP_MEM;
+  }
+  stages = (evalresp_stage *)(*view + 1);
+  blkts = (evalresp_blkt *)(stages + flat->stages_len);
+  **view = flat->channel;
+  (*view)->first_stage = flat->stages_len ? stages : NULL;
+  for (i = 0; i < flat->stages_len; i++)
+  {
+    stages[i].sequence_no = flat_stages[i].sequence_no;
+    stages[i].input_units = flat_stages[i].input_units;
+    stages[i].output_units = flat_stages[i].output_units;
+    stages[i].first_blkt = flat_stages[i].nblkts ? &blkts[flat_stages[i].first_blkt] : NULL;
+    stages[i].next_stage = i + 1 < flat->stages_len ? &stages[i + 1] : NULL;
+    for (j = flat_stages[i].first_blkt; j < flat_stages[i].first_blkt + flat_stages[i].nblkts; j++)
+    {
+      blkts[j] = flat_blkts[j].blkt;
+      blkts[j].next_blkt = j + 1 < flat_stages[i].first_blkt + flat_stages[i].nblkts ? &blkts[j + 1] : NULL;
+      n = get_arrays (&blkts[j], unused, lens);
+      for (k = 0; k < n; k++)
+      {
+        arrays[k] = lens[k] ? pool + flat_blkts[j].arrays[k] : NULL;
+      }
+      set_arrays (&blkts[j], arrays);
+    }
+  }
+  return EVALRESP_OK;
+}
+
+int
+evalresp_flat_to_response (evalresp_logger *log, const evalresp_flat_channel *flat,
+                           evalresp_options *options, evalresp_response **response)
+{
+  evalresp_channel *view = NULL;
+  evalresp_blkt *last = NULL;
+  int status;
+
+  if (!(status = flat_view (log, flat, &view)))
+  {
+    for (last = view->first_stage ? view->first_stage->first_blkt : NULL; last && last->next_blkt; last = last->next_blkt)
+      ;
+    status = evalresp_channel_to_response (log, view, options, response);
+    /* normalize_response() may add a gain blockette to the first stage */
+    if (last && last->next_blkt)
+    {
+      free_gain (last->next_blkt);
+    }
+  }
+  free (view);
+  return status;
+}
@@ -96,21 +96,44 @@ responses_to_cwd (evalresp_logger *log, const evalresp_responses *responses,
   return status;
 }
 
+typedef struct
+{
+  evalresp_options *options;
+  evalresp_responses **responses;
+} stdio_work;
+
+// evaluate each channel as it is read from stdin
+static int
+stdio_channel (evalresp_logger *log, evalresp_channel *channel, void *data)
+{
+  stdio_work *work = data;
+  evalresp_channels channels;
+
+  channels.nchannels = 1;
+  channels.channels = &channel;
+  channels.arena = NULL;
+  return evalresp_channels_to_responses (log, &channels, work->options, work->responses);
+}
+
 int
 process_stdio (evalresp_logger *log, evalresp_options *options, evalresp_filter *filter, evalresp_responses **responses)
 {
   int status = EVALRESP_OK;
-  evalresp_channels *channels;
+  evalresp_channels none = {0, NULL, NULL};
+  stdio_work work;
 
   if (options->filename && strlen (options->filename))
   {
     evalresp_log (log, EV_WARN, EV_WARN, "Using stdio so ignoring file '%s'", options->filename);
   }
-  if (!(status = evalresp_file_to_channels (log, stdin, options, filter, &channels)))
+  work.options = options;
+  work.responses = responses;
+  // stdin may be a pipe of any size, so is streamed rather than read whole
+  if (!(status = evalresp_stream_to_channels (log, stdin, options, filter, stdio_channel, &work)))
   {
-    status = evalresp_channels_to_responses (log, channels, options, responses);
+    // allocate the responses even if there were no channels
+    status = evalresp_channels_to_responses (log, &none, options, responses);
   }
-  evalresp_free_channels (&channels);
 
   return status;
 }
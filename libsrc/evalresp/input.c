@@ -9,6 +9,7 @@
 #include "./regexp.h" // TODO - should all private imports be relative like this?
 #include "evalresp/constants.h"
 #include "evalresp/public_api.h"
+#include "evalresp/stationxml2resp/dom_to_channel.h"
 #include "evalresp/stationxml2resp/dom_to_seed.h"
 #include "evalresp/stationxml2resp/wrappers.h"
 #include "evalresp_log/log.h"
@@ -18,220 +19,203 @@
 #define timegm _mkgmtime
 #endif
 
+#if !defined(WIN32) && !defined(_WIN32)
+#define EVALRESP_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 // code from parse_fctns.c heavily refactored to (1) parse all lines and (2)
 // read from strings rather than files.
 
 static int
 read_int (evalresp_logger *log, char *in_line, int *value)
 {
-  if (!is_int (in_line, log))
+  if (!lex_int (in_line, value))
   {
     evalresp_log (log, EV_ERROR, EV_ERROR, "read_int; '%s' is not an integer",
                   in_line);
     return EVALRESP_PAR;
   }
-  else
-  {
-    *value = atoi (in_line);
-    return EVALRESP_OK;
-  }
+  return EVALRESP_OK;
 }
 
 static int
 read_double (evalresp_logger *log, char *in_line, double *value)
 {
-  if (!is_real (in_line, log))
+  if (!lex_double (in_line, value))
   {
     evalresp_log (log, EV_ERROR, EV_ERROR, "read_double; '%s' is not a real number",
                   in_line);
     return EVALRESP_PAR;
   }
-  else
-  {
-    *value = atof (in_line);
-    return EVALRESP_OK;
-  }
+  return EVALRESP_OK;
 }
 
-// non-static only for testing
-void
-slurp_line (const char **seed, char *line, int maxlen)
+/* RESP text is split into lines once, by tokenize_resp(), which drops
+   comments and blank lines and decodes the "BnnnFnn" prefix of each data
+   line.  the read_* functions below then work through the lines by index,
+   and only copy the value of the line they use. */
+
+#define IS_BLANK(c) ((c) == ' ' || (c) == '\t' || (c) == '\n' || (c) == '\v' || (c) == '\f' || (c) == '\r')
+
+/* the blockette and field numbers from a "BnnnFnn" prefix */
+static void
+read_pref (resp_line *line)
 {
-  int i = 0;
-  for (;;)
+  char blktstr[BLKTSTRLEN], fldstr[FLDSTRLEN];
+  int i;
+
+  line->blkt_no = line->fld_no = -1;
+  if (line->length >= 7 && *line->start == 'B')
   {
-    char c = **seed;
-    line[i++] = c;
-    if (!c)
+    for (i = 0; i < 3; i++)
     {
-      // don't move past end of input
-      // already appended NULL
-      return;
+      blktstr[i] = line->start[1 + i];
     }
-    else
+    blktstr[3] = '\0';
+    fldstr[0] = line->start[5];
+    fldstr[1] = line->start[6];
+    fldstr[2] = '\0';
+    if (!lex_int (blktstr, &line->blkt_no) || !lex_int (fldstr, &line->fld_no))
     {
-      (*seed)++;
-      if (c == '\n' || i == maxlen - 1)
-      {
-        line[i] = '\0';
-        return;
-      }
+      line->blkt_no = line->fld_no = -1;
     }
   }
 }
 
-static int
-end_of_string (const char **seed)
-{
-  return !**seed;
-}
-
-static int
-blank_line (char *line)
+// non-static only for testing
+int
+tokenize_resp (evalresp_logger *log, const char *seed, size_t seed_len, resp_lines *lines)
 {
-  int i;
-  for (i = 0; i < strlen (line); ++i)
-  {
-    if (!isspace (line[i]))
-      return 0;
-  }
-  return 1;
-}
+  const char *end, *p, *last = seed + seed_len;
+  resp_line *more;
+  int length, size = 0, line_no = 0;
 
-static void
-drop_comments_and_blank_lines (const char **seed)
-{
-  char line[MAXLINELEN];
-  const char *lookahead;
-  while (!end_of_string (seed))
+  /* the text need not be terminated (it may be a mapped file) */
+  memset (lines, 0, sizeof (*lines));
+  for (; seed < last; seed = end + 1)
   {
-    lookahead = *seed;
-    slurp_line (&lookahead, line, MAXLINELEN);
-    if (*line != '#' && !blank_line (line))
-      return;
-    *seed = lookahead;
+    line_no++;
+    if (!(end = memchr (seed, '\n', last - seed)))
+    {
+      end = last;
+    }
+    /* the end of line (but not the first character) is not part of it */
+    for (length = end - seed; length > 1 && (seed[length - 1] == '\n' || seed[length - 1] == '\r'); length--)
+      ;
+    for (p = seed; p < seed + length && IS_BLANK (*p); p++)
+      ;
+    if (*seed == '#' || p == seed + length)
+    {
+      continue;
+    }
+    if (lines->nlines == size)
+    {
+      size = size ? 2 * size : 256;
+      if (!(more = realloc (lines->lines, size * sizeof (*more))))
+      {
+        evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate RESP line index");
+        free_resp_lines (lines);
+        return EVALRESP_MEM;
+      }
+      lines->lines = more;
+    }
+    lines->lines[lines->nlines].start = seed;
+    lines->lines[lines->nlines].length = length;
+    lines->lines[lines->nlines].line_no = line_no;
+    read_pref (&lines->lines[lines->nlines++]);
   }
+  return EVALRESP_OK;
 }
 
-static void
-remove_tabs_and_crlf (char *line)
+// non-static only for testing
+void
+free_resp_lines (resp_lines *lines)
 {
-  int i;
-  for (i = 0; i < strlen (line); ++i)
-  {
-    if (line[i] == '\t')
-    {
-      line[i] = ' ';
-    }
-  }
-  for (--i; i && strspn (line + i, "\n\r"); --i)
-  {
-    line[i] = '\0';
-  }
+  free (lines->lines);
+  memset (lines, 0, sizeof (*lines));
 }
 
 static int
-read_pref (evalresp_logger *log, char *const line, int *blkt_no, int *fld_no)
+end_of_lines (resp_lines *lines)
 {
-  char fldstr[FLDSTRLEN], blktstr[BLKTSTRLEN];
-
-  strncpy (fldstr, "", FLDSTRLEN);
-  strncpy (blktstr, "", BLKTSTRLEN);
-  if (*line != 'B' || strlen (line) < 7)
-    return EVALRESP_PAR;
-
-  strncpy (blktstr, (line + 1), 3);
-  strncpy (fldstr, (line + 5), 2);
-  *(blktstr + 3) = '\0';
-  *(fldstr + 2) = '\0';
-
-  if (!is_int (blktstr, log))
-  {
-    evalresp_log (log, EV_ERROR, 0, "parse_pref; prefix '%s' cannot be %s",
-                  blktstr, "converted to a blockette number");
-    return EVALRESP_PAR;
-  }
-  *blkt_no = atoi (blktstr);
-  if (!is_int (fldstr, log))
-  {
-    evalresp_log (log, EV_ERROR, 0, "parse_pref; prefix '%s' cannot be %s",
-                  fldstr, "converted to a blockette number");
-    return EVALRESP_PAR;
-  }
-  *fld_no = atoi (fldstr);
-  return EVALRESP_OK;
+  return lines->next >= lines->nlines;
 }
 
 // this was "next_line"
 static int
-read_line (evalresp_logger *log, const char **seed, char *sep,
+read_line (evalresp_logger *log, resp_lines *lines, char *sep,
            int *blkt_no, int *fld_no, char *return_line)
 {
-  char *lcl_ptr, line[MAXLINELEN];
-  int status;
+  const resp_line *line;
+  const char *p, *end;
+  int i;
 
   return_line[0] = '\0';
 
-  drop_comments_and_blank_lines (seed);
-  if (end_of_string (seed))
+  if (end_of_lines (lines))
   {
     return EVALRESP_EOF;
   }
 
-  slurp_line (seed, line, MAXLINELEN);
-  remove_tabs_and_crlf (line);
-  if ((status = read_pref (log, line, blkt_no, fld_no)))
+  line = &lines->lines[lines->next++];
+  end = line->start + line->length;
+  if (line->blkt_no < 0)
   {
-    evalresp_log (log, EV_ERROR, EV_ERROR, "unrecognised prefix: '%s'", line);
-    return status;
+    evalresp_log (log, EV_ERROR, EV_ERROR, "unrecognised prefix: '%.*s' (line %d)", line->length, line->start, line->line_no);
+    return EVALRESP_PAR;
   }
+  *blkt_no = line->blkt_no;
+  *fld_no = line->fld_no;
 
-  if (!(lcl_ptr = strstr (line, sep)))
+  /* the separator is a single character (tabs count as spaces) */
+  for (p = line->start; p < end && *p != *sep && !(*sep == ' ' && *p == '\t'); p++)
+    ;
+  if (p == end)
   {
-    evalresp_log (log, EV_ERROR, EV_ERROR, "separator '%s' not found in '%s'", sep, line);
+    evalresp_log (log, EV_ERROR, EV_ERROR, "separator '%s' not found in '%.*s' (line %d)", sep, line->length, line->start, line->line_no);
     return EVALRESP_PAR;
   }
-  for (lcl_ptr++; *lcl_ptr && isspace (*lcl_ptr); lcl_ptr++)
+  for (p++; p < end && IS_BLANK (*p); p++)
     ;
-  if (!*lcl_ptr)
+  if (p == end)
   {
-    evalresp_log (log, EV_ERROR, EV_ERROR, "nothing to parse after '%s' in '%s'", sep, line);
+    evalresp_log (log, EV_ERROR, EV_ERROR, "nothing to parse after '%s' in '%.*s' (line %d)", sep, line->length, line->start, line->line_no);
     return EVALRESP_PAR;
   }
-  strncpy (return_line, lcl_ptr, MAXLINELEN);
+  if (end - p >= MAXLINELEN)
+  {
+    evalresp_log (log, EV_WARN, EV_WARN, "value truncated to %d characters in '%.*s' (line %d)", MAXLINELEN - 1, line->length, line->start, line->line_no);
+    end = p + MAXLINELEN - 1;
+  }
+  for (i = 0; p < end; p++)
+  {
+    return_line[i++] = *p == '\t' ? ' ' : *p;
+  }
+  return_line[i] = '\0';
   return EVALRESP_OK;
 }
 
 // non-static only for testing
 // this was "get_line"
 int
-find_line (evalresp_logger *log, const char **seed, char *sep, int blkt_no, int fld_no, char *return_line)
+find_line (evalresp_logger *log, resp_lines *lines, char *sep, int blkt_no, int fld_no, char *return_line)
 {
-  int lcl_blkt, lcl_fld, status;
-  char line[MAXLINELEN];
-  const char *lookahead;
+  const resp_line *line;
+  int lcl_blkt, lcl_fld;
 
-  while (!end_of_string (seed))
+  for (; !end_of_lines (lines); lines->next++)
   {
-    drop_comments_and_blank_lines (seed);
-    if (end_of_string (seed))
-      break;
-
-    lookahead = *seed;
-    slurp_line (&lookahead, line, MAXLINELEN);
-    remove_tabs_and_crlf (line);
-    if ((status = read_pref (log, line, &lcl_blkt, &lcl_fld)))
-    {
-      evalresp_log (log, EV_ERROR, EV_ERROR, "unrecognised prefix: '%s'", line);
-      return status;
-    }
-    else if (blkt_no == lcl_blkt && fld_no == lcl_fld)
+    line = &lines->lines[lines->next];
+    if (line->blkt_no < 0)
     {
-      return read_line (log, seed, sep, &lcl_blkt, &lcl_fld, return_line);
+      evalresp_log (log, EV_ERROR, EV_ERROR, "unrecognised prefix: '%.*s' (line %d)", line->length, line->start, line->line_no);
+      return EVALRESP_PAR;
     }
-    else
+    else if (blkt_no == line->blkt_no && fld_no == line->fld_no)
     {
-      *seed = lookahead;
+      return read_line (log, lines, sep, &lcl_blkt, &lcl_fld, return_line);
     }
   }
 
@@ -241,16 +225,19 @@ find_line (evalresp_logger *log, const char **seed, char *sep, int blkt_no, int
 static int
 number_of_fields (evalresp_logger *log, char *line, int *count)
 {
-  char *lcl_ptr, *new_ptr;
-  char lcl_field[50];
-  int nfields = 0, test;
+  char *p = line;
+  int nfields = 0;
 
-  lcl_ptr = line;
-  /* added test of 'strstr()' result -- 10/21/2005 -- [ET] */
-  while (*lcl_ptr && (test = sscanf (lcl_ptr, "%s", lcl_field)) != 0 && (new_ptr = strstr (lcl_ptr, lcl_field)) != NULL)
+  for (;;)
   {
-    lcl_ptr = new_ptr + strlen (lcl_field);
-    nfields++;
+    for (; IS_BLANK (*p); p++)
+      ;
+    if (!*p)
+    {
+      break;
+    }
+    for (nfields++; *p && !IS_BLANK (*p); p++)
+      ;
   }
   *count = nfields;
   return EVALRESP_OK;
@@ -260,12 +247,22 @@ number_of_fields (evalresp_logger *log, char *line, int *count)
 static int
 get_field_to_parse (evalresp_logger *log, char *line, int fld_no, char *return_field)
 {
-  char *lcl_ptr, *new_ptr;
-  char lcl_field[MAXFLDLEN];
-  int nfields, i;
+  char *p = line;
+  int nfields = 0, i;
 
-  number_of_fields (log, line, &nfields);
-  if (fld_no >= nfields)
+  /* fields are separated by white space, as for sscanf ("%s") */
+  for (;;)
+  {
+    for (; IS_BLANK (*p); p++)
+      ;
+    if (!*p || nfields == fld_no)
+    {
+      break;
+    }
+    for (nfields++; *p && !IS_BLANK (*p); p++)
+      ;
+  }
+  if (!*p)
   {
     if (nfields > 0)
     {
@@ -281,30 +278,24 @@ get_field_to_parse (evalresp_logger *log, char *line, int fld_no, char *return_f
     return EVALRESP_PAR;
   }
 
-  lcl_ptr = line;
-  /* added test of 'strstr()' result -- 10/21/2005 -- [ET] */
-  for (i = 0; i < fld_no; i++)
+  for (i = 0; *p && !IS_BLANK (*p) && i < MAXFLDLEN - 1; p++)
   {
-    sscanf (lcl_ptr, "%s", lcl_field);
-    if ((new_ptr = strstr (lcl_ptr, lcl_field)) == NULL)
-      break;
-    lcl_ptr = new_ptr + strlen (lcl_field);
+    return_field[i++] = *p;
   }
-
-  sscanf (lcl_ptr, "%s", return_field);
+  return_field[i] = '\0';
   return EVALRESP_OK;
 }
 
 // non-static only for testing
 int
-find_field (evalresp_logger *log, const char **seed, char *sep,
+find_field (evalresp_logger *log, resp_lines *lines, char *sep,
             int blkt_no, int fld_no, int fld_wanted, char *return_field)
 {
   int status = EVALRESP_OK;
   char line[MAXLINELEN];
 
   /* first get the next non-comment line */
-  if (!(status = find_line (log, seed, sep, blkt_no, fld_no, line)))
+  if (!(status = find_line (log, lines, sep, blkt_no, fld_no, line)))
   {
     /* then parse the field that the user wanted from the line find_line returned */
     status = get_field_to_parse (log, line, fld_wanted, return_field);
@@ -313,13 +304,13 @@ find_field (evalresp_logger *log, const char **seed, char *sep,
 }
 
 static int
-find_int_field (evalresp_logger *log, const char **seed, char *sep,
+find_int_field (evalresp_logger *log, resp_lines *lines, char *sep,
                 int blkt_no, int fld_no, int fld_wanted, int *value)
 {
   int status = EVALRESP_OK;
   char field[MAXFLDLEN];
 
-  if (!(status = find_field (log, seed, sep, blkt_no, fld_no, fld_wanted, field)))
+  if (!(status = find_field (log, lines, sep, blkt_no, fld_no, fld_wanted, field)))
   {
     status = read_int (log, field, value);
   }
@@ -327,13 +318,13 @@ find_int_field (evalresp_logger *log, const char **seed, char *sep,
 }
 
 static int
-find_double_field (evalresp_logger *log, const char **seed, char *sep,
+find_double_field (evalresp_logger *log, resp_lines *lines, char *sep,
                    int blkt_no, int fld_no, int fld_wanted, double *value)
 {
   int status = EVALRESP_OK;
   char field[MAXFLDLEN];
 
-  if (!(status = find_field (log, seed, sep, blkt_no, fld_no, fld_wanted, field)))
+  if (!(status = find_field (log, lines, sep, blkt_no, fld_no, fld_wanted, field)))
   {
     status = read_double (log, field, value);
   }
@@ -353,45 +344,51 @@ parse_int_field (evalresp_logger *log, char *line, int fld_wanted, int *value)
   return status;
 }
 
+/* copy a glob to the equivalent (unanchored) regular expression */
+static void
+glob_to_regexp (const char *glob, char *regexp_pattern)
+{
+  int i = 0;
+  while (*glob && i < (MAXLINELEN - 1))
+  {
+    if (*glob == '?')
+    {
+      regexp_pattern[i++] = '.';
+      glob++;
+    }
+    else if (*glob == '*')
+    {
+      regexp_pattern[i++] = '.';
+      regexp_pattern[i++] = '*';
+      glob++;
+    }
+    else
+      regexp_pattern[i++] = *(glob++);
+  }
+  regexp_pattern[i] = '\0';
+}
+
 static int
 reg_string_match (evalresp_logger *log, const char *string, char *expr, char *type_flag)
 {
   char lcl_string[MAXLINELEN], regexp_pattern[MAXLINELEN];
-  int i = 0, glob_type, test;
+  int test;
   register regexp *prog;
   register char *lcl_ptr;
 
   memset (lcl_string, 0, sizeof (lcl_string));
   memset (regexp_pattern, 0, sizeof (regexp_pattern));
   strncpy (lcl_string, string, strlen (string));
-  lcl_ptr = expr;
   if (!strcmp (type_flag, "-r"))
-    glob_type = 0;
+    strncpy (regexp_pattern, expr, MAXLINELEN - 1);
   else if (!strcmp (type_flag, "-g"))
-    glob_type = 1;
+    glob_to_regexp (expr, regexp_pattern);
   else
   {
     evalresp_log (log, EV_ERROR, 0, " string_match; improper pattern type (%s)\n",
                   type_flag);
     return 0; /*TODO error improper pattern type */
   }
-  while (*lcl_ptr && i < (MAXLINELEN - 1))
-  {
-    if (glob_type && *lcl_ptr == '?')
-    {
-      regexp_pattern[i++] = '.';
-      lcl_ptr++;
-    }
-    else if (glob_type && *lcl_ptr == '*')
-    {
-      regexp_pattern[i++] = '.';
-      regexp_pattern[i++] = '*';
-      lcl_ptr++;
-    }
-    else
-      regexp_pattern[i++] = *(lcl_ptr++);
-  }
-  regexp_pattern[i] = '\0';
 
   if ((prog = evr_regcomp (regexp_pattern, log)) == NULL)
   {
@@ -406,8 +403,122 @@ reg_string_match (evalresp_logger *log, const char *string, char *expr, char *ty
   return (test);
 }
 
-/* was check_units */
+/* SNCL patterns are globs, matched anywhere in the name (like the regular
+   expressions they used to be converted to for every channel).  they are
+   now compiled once, and those with no special characters other than '*'
+   and '?' (almost all) are matched directly. */
+struct glob_pattern_s
+{
+  char *glob;   /* a simple glob, or NULL */
+  regexp *prog; /* otherwise the regular expression, or NULL if invalid */
+};
+
+/* characters that are special in a regular expression, but not in a
+   simple glob */
+#define REGEXP_ONLY "^$.[()|+\\"
+
+int
+compile_glob (evalresp_logger *log, const char *glob, glob_pattern **pattern)
+{
+  char regexp_pattern[MAXLINELEN];
+
+  if (!(*pattern = calloc (1, sizeof (**pattern))))
+  {
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate pattern");
+    return EVALRESP_MEM;
+  }
+  if (!strpbrk (glob, REGEXP_ONLY))
+  {
+    if (!((*pattern)->glob = strdup (glob)))
+    {
+      evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate pattern");
+      free_glob (pattern);
+      return EVALRESP_MEM;
+    }
+  }
+  else
+  {
+    glob_to_regexp (glob, regexp_pattern);
+    if (!((*pattern)->prog = evr_regcomp (regexp_pattern, log)))
+    {
+      /* as before, an invalid pattern matches nothing */
+      evalresp_log (log, EV_ERROR, 0,
+                    "string_match; pattern '%s' didn't compile", regexp_pattern);
+    }
+  }
+  return EVALRESP_OK;
+}
+
+/* does a simple glob match anywhere in the string?  as if the glob were
+   surrounded by '*', it is matched in the usual way: on a mismatch, only
+   the last '*' seen takes one more character, so the time is at most the
+   product of the lengths, however many '*' there are */
+int
+match_glob (evalresp_logger *log, const glob_pattern *pattern, const char *string)
+{
+  const char *glob, *star, *mark;
+
+  if (!pattern->glob)
+  {
+    return pattern->prog && evr_regexec (pattern->prog, (char *)string, log);
+  }
+  for (glob = star = pattern->glob, mark = string; *glob;)
+  {
+    if (*glob == '*')
+    {
+      star = ++glob;
+      mark = string;
+    }
+    else if (*string && (*glob == '?' || *glob == *string))
+    {
+      glob++;
+      string++;
+    }
+    else if (*mark)
+    {
+      glob = star;
+      string = ++mark;
+    }
+    else
+    {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+void
+free_glob (glob_pattern **pattern)
+{
+  if (*pattern)
+  {
+    free ((*pattern)->glob);
+    free ((*pattern)->prog);
+    free (*pattern);
+    *pattern = NULL;
+  }
+}
+
+/* SNCLs added through the API are compiled, others (from the legacy code)
+   are converted as they are used */
+static int
+sncl_field_matches (evalresp_logger *log, const glob_pattern *pattern, char *glob, const char *name)
+{
+  return pattern ? match_glob (log, pattern, name) : reg_string_match (log, name, glob, "-g");
+}
+
+/* does the line start with the unit, optionally with a C, N or M prefix?
+   (as the regular expression ^[CNM]?unit, without the regexp globals, so
+   channels can be read in parallel) */
 static int
+unit_prefix (const char *line, const char *unit)
+{
+  size_t len = strlen (unit);
+  return !strncmp (line, unit, len) || (*line && strchr ("CNM", *line) && !strncmp (line + 1, unit, len));
+}
+
+/* was check_units */
+int
 parse_units (evalresp_logger *log, evalresp_options const *const options, char *line, evalresp_channel *channel, int *units)
 {
   int i, first_flag = 0, status = EVALRESP_OK;
@@ -452,7 +563,7 @@ parse_units (evalresp_logger *log, evalresp_options const *const options, char *
   {
     *units = CENTIGRADE;
   }
-  else if (reg_string_match (log, line, "^[CNM]?M/S\\*\\*2|^[CNM]?M/SEC\\*\\*2", "-r"))
+  else if (unit_prefix (line, "M/S**2") || unit_prefix (line, "M/SEC**2"))
   {
     if (first_flag && !strncmp ("NM", line, (size_t)2))
       channel->unit_scale_fact = 1.0e9;
@@ -462,7 +573,7 @@ parse_units (evalresp_logger *log, evalresp_options const *const options, char *
       channel->unit_scale_fact = 1.0e2;
     *units = ACC;
   }
-  else if (reg_string_match (log, line, "^[CNM]?M/S|^[CNM]?M/SEC", "-r"))
+  else if (unit_prefix (line, "M/S"))
   {
     if (first_flag && !strncmp (line, "NM", 2))
       channel->unit_scale_fact = 1.0e9;
@@ -472,7 +583,7 @@ parse_units (evalresp_logger *log, evalresp_options const *const options, char *
       channel->unit_scale_fact = 1.0e2;
     *units = VEL;
   }
-  else if (reg_string_match (log, line, "^[CNM]?M[^A-Z/]?", "-r"))
+  else if (unit_prefix (line, "M"))
   {
     if (first_flag && !strncmp (line, "NM", 2))
       channel->unit_scale_fact = 1.0e9;
@@ -482,11 +593,11 @@ parse_units (evalresp_logger *log, evalresp_options const *const options, char *
       channel->unit_scale_fact = 1.0e2;
     *units = DIS;
   }
-  else if (reg_string_match (log, line, "^COUNTS?[^A-Z]?", "-r") || reg_string_match (log, line, "^DIGITAL[^A-Z]?", "-r"))
+  else if (!strncmp (line, "COUNT", 5) || !strncmp (line, "DIGITAL", 7))
   {
     *units = COUNTS;
   }
-  else if (reg_string_match (log, line, "^V[^A-Z]?", "-r") || reg_string_match (log, line, "^VOLTS[^A-Z]?", "-r"))
+  else if (line[0] == 'V')
   {
     *units = VOLTS;
   }
@@ -501,7 +612,7 @@ parse_units (evalresp_logger *log, evalresp_options const *const options, char *
 }
 
 static int
-read_units_first_line_known (evalresp_logger *log, evalresp_options const *const options, const char **seed, int blkt_read, int *check_fld,
+read_units_first_line_known (evalresp_logger *log, evalresp_options const *const options, resp_lines *lines, int blkt_read, int *check_fld,
                              char *line, evalresp_channel *channel, int *input_units, int *output_units)
 {
   int status = EVALRESP_OK;
@@ -509,7 +620,7 @@ read_units_first_line_known (evalresp_logger *log, evalresp_options const *const
   //*input_units = check_units (channel, line, log);
   parse_units (log, options, line, channel, input_units);
 
-  if (!(status = find_line (log, seed, ":", blkt_read, (*check_fld)++, line)))
+  if (!(status = find_line (log, lines, ":", blkt_read, (*check_fld)++, line)))
   {
     //*output_units = check_units (channel, line, log);
     parse_units (log, options, line, channel, output_units);
@@ -519,15 +630,15 @@ read_units_first_line_known (evalresp_logger *log, evalresp_options const *const
 }
 
 static int
-read_units (evalresp_logger *log, evalresp_options const *const options, const char **seed, int blkt_read, int *check_fld,
+read_units (evalresp_logger *log, evalresp_options const *const options, resp_lines *lines, int blkt_read, int *check_fld,
             evalresp_channel *channel, int *input_units, int *output_units)
 {
   int status = EVALRESP_OK;
   char line[MAXLINELEN];
 
-  if (!(status = find_line (log, seed, ":", blkt_read, (*check_fld)++, line)))
+  if (!(status = find_line (log, lines, ":", blkt_read, (*check_fld)++, line)))
   {
-    status = read_units_first_line_known (log, options, seed, blkt_read, check_fld, line,
+    status = read_units_first_line_known (log, options, lines, blkt_read, check_fld, line,
                                           channel, input_units, output_units);
   }
 
@@ -536,7 +647,7 @@ read_units (evalresp_logger *log, evalresp_options const *const options, const c
 
 // this was "read_channel"
 static int
-read_channel_header (evalresp_logger *log, const char **seed, char *first_line,
+read_channel_header (evalresp_logger *log, resp_lines *lines, char *first_line,
                      evalresp_channel *chan)
 {
   int blkt_no, fld_no, status = EVALRESP_OK;
@@ -560,7 +671,7 @@ read_channel_header (evalresp_logger *log, const char **seed, char *first_line,
 
   if (!strlen (first_line))
   {
-    if ((status = find_field (log, seed, ":", 50, 3, 0, field)))
+    if ((status = find_field (log, lines, ":", 50, 3, 0, field)))
     {
       return status;
     }
@@ -577,7 +688,7 @@ read_channel_header (evalresp_logger *log, const char **seed, char *first_line,
 
   /* then (from the file) the Network ID */
 
-  if ((status = find_field (log, seed, ":", 50, 16, 0, field)))
+  if ((status = find_field (log, lines, ":", 50, 16, 0, field)))
   {
     return status;
   }
@@ -597,7 +708,7 @@ read_channel_header (evalresp_logger *log, const char **seed, char *first_line,
   /* Modified to use 'next_line()' and 'get_field_to_parse()' directly
      to handle case where file contains "B052F03 Location:" and
      nothing afterward -- 10/19/2005 -- [ET] */
-  if (!read_line (log, seed, ":", &blkt_no, &fld_no, line)) /* if data after "Location:" */
+  if (!read_line (log, lines, ":", &blkt_no, &fld_no, line)) /* if data after "Location:" */
   {
     if ((status = get_field_to_parse (log, line, 0, field))) /* parse location data */
     {
@@ -621,7 +732,7 @@ read_channel_header (evalresp_logger *log, const char **seed, char *first_line,
     {
       strncpy (chan->locid, field, LOCIDLEN);
     }
-    if ((status = find_field (log, seed, ":", 52, 4, 0, field)))
+    if ((status = find_field (log, lines, ":", 52, 4, 0, field)))
     {
       // TODO - log reason
       return status;
@@ -644,14 +755,14 @@ read_channel_header (evalresp_logger *log, const char **seed, char *first_line,
   }
 
   /* get the Start Date */
-  if ((status = find_line (log, seed, ":", 52, 22, line)))
+  if ((status = find_line (log, lines, ":", 52, 22, line)))
   {
     return status;
   }
   strncpy (chan->beg_t, line, DATIMLEN);
 
   /* get the End Date */
-  if ((status = find_line (log, seed, ":", 52, 23, line)))
+  if ((status = find_line (log, lines, ":", 52, 23, line)))
   {
     return status;
   }
@@ -662,7 +773,7 @@ read_channel_header (evalresp_logger *log, const char **seed, char *first_line,
 
 // this was parse_pz
 static int
-read_pz (evalresp_logger *log, evalresp_options const *const options, const char **seed, int first_field, char *first_line,
+read_pz (evalresp_logger *log, evalresp_options const *const options, resp_lines *lines, int first_field, char *first_line,
          evalresp_channel *channel, evalresp_blkt *blkt_ptr, evalresp_stage *stage_ptr)
 {
   int status = EVALRESP_OK, i, check_fld, blkt_read, npoles, nzeros;
@@ -720,14 +831,14 @@ read_pz (evalresp_logger *log, evalresp_options const *const options, const char
 
   if (check_fld == 4)
   {
-    if ((status = find_int_field (log, seed, ":", blkt_read, check_fld++, 0, &stage_ptr->sequence_no)))
+    if ((status = find_int_field (log, lines, ":", blkt_read, check_fld++, 0, &stage_ptr->sequence_no)))
     {
       return status;
     }
     //curr_seq_no = stage_ptr->sequence_no;
   }
 
-  if ((status = read_units (log, options, seed, blkt_read, &check_fld, channel,
+  if ((status = read_units (log, options, lines, blkt_read, &check_fld, channel,
                             &stage_ptr->input_units, &stage_ptr->output_units)))
   {
     return status;
@@ -735,7 +846,7 @@ read_pz (evalresp_logger *log, evalresp_options const *const options, const char
 
   /* then the A0 normalization factor */
 
-  if ((status = find_double_field (log, seed, ":", blkt_read, check_fld++, 0,
+  if ((status = find_double_field (log, lines, ":", blkt_read, check_fld++, 0,
                                    &blkt_ptr->blkt_info.pole_zero.a0)))
   {
     return status;
@@ -743,7 +854,7 @@ read_pz (evalresp_logger *log, evalresp_options const *const options, const char
 
   /* the A0 normalization frequency */
 
-  if ((status = find_double_field (log, seed, ":", blkt_read, check_fld++, 0,
+  if ((status = find_double_field (log, lines, ":", blkt_read, check_fld++, 0,
                                    &blkt_ptr->blkt_info.pole_zero.a0_freq)))
   {
     return status;
@@ -751,7 +862,7 @@ read_pz (evalresp_logger *log, evalresp_options const *const options, const char
 
   /* the number of zeros */
 
-  if ((status = find_int_field (log, seed, ":", blkt_read, check_fld, 0, &nzeros)))
+  if ((status = find_int_field (log, lines, ":", blkt_read, check_fld, 0, &nzeros)))
   {
     return status;
   }
@@ -759,7 +870,7 @@ read_pz (evalresp_logger *log, evalresp_options const *const options, const char
 
   /* remember to allocate enough space for the number of zeros to follow */
 
-  blkt_ptr->blkt_info.pole_zero.zeros = alloc_complex (nzeros, log);
+  blkt_ptr->blkt_info.pole_zero.zeros = alloc_complex (nzeros, lines->arena, log);
 
   /* set the expected field to the current value (9 or 10 for [53] or [43])
      to the current value + 5 (14 or 15 for [53] or [43] respectively) */
@@ -768,7 +879,7 @@ read_pz (evalresp_logger *log, evalresp_options const *const options, const char
 
   /* the number of poles */
 
-  if ((status = find_int_field (log, seed, ":", blkt_read, check_fld, 0, &npoles)))
+  if ((status = find_int_field (log, lines, ":", blkt_read, check_fld, 0, &npoles)))
   {
     return status;
   }
@@ -776,7 +887,7 @@ read_pz (evalresp_logger *log, evalresp_options const *const options, const char
 
   /* remember to allocate enough space for the number of poles to follow */
 
-  blkt_ptr->blkt_info.pole_zero.poles = alloc_complex (npoles, log);
+  blkt_ptr->blkt_info.pole_zero.poles = alloc_complex (npoles, lines->arena, log);
 
   /* set the expected field to the current value (14 or 15 for [53] or [43])
      to the current value - 4 (10 or 11 for [53] or [43] respectively) */
@@ -787,7 +898,7 @@ read_pz (evalresp_logger *log, evalresp_options const *const options, const char
 
   for (i = 0; i < nzeros; i++)
   {
-    if ((status = find_line (log, seed, " ", blkt_read, check_fld, line)))
+    if ((status = find_line (log, lines, " ", blkt_read, check_fld, line)))
     {
       return status;
     }
@@ -795,24 +906,22 @@ read_pz (evalresp_logger *log, evalresp_options const *const options, const char
     {
       return status;
     }
-    if (!is_real (field, log))
+    if (!lex_double (field, &blkt_ptr->blkt_info.pole_zero.zeros[i].real))
     {
       evalresp_log (log, EV_ERROR, EV_ERROR, "parse_pz: %s%s%s",
                     "zeros must be real numbers (found '", field, "')");
       return EVALRESP_PAR;
     }
-    blkt_ptr->blkt_info.pole_zero.zeros[i].real = atof (field);
     if ((status = get_field_to_parse (log, line, 2, field)))
     {
       return status;
     }
-    if (!is_real (field, log))
+    if (!lex_double (field, &blkt_ptr->blkt_info.pole_zero.zeros[i].imag))
     {
       evalresp_log (log, EV_ERROR, EV_ERROR, "parse_pz: %s%s%s",
                     "zeros must be real numbers (found '", field, "')");
       return EVALRESP_PAR;
     }
-    blkt_ptr->blkt_info.pole_zero.zeros[i].imag = atof (field);
   }
 
   /* set the expected field to the current value (10 or 11 for [53] or [43])
@@ -824,7 +933,7 @@ read_pz (evalresp_logger *log, evalresp_options const *const options, const char
 
   for (i = 0; i < npoles; i++)
   {
-    if ((status = find_line (log, seed, " ", blkt_read, check_fld, line)))
+    if ((status = find_line (log, lines, " ", blkt_read, check_fld, line)))
     {
       return status;
     }
@@ -832,24 +941,22 @@ read_pz (evalresp_logger *log, evalresp_options const *const options, const char
     {
       return status;
     }
-    if (!is_real (field, log))
+    if (!lex_double (field, &blkt_ptr->blkt_info.pole_zero.poles[i].real))
     {
       evalresp_log (log, EV_ERROR, EV_ERROR, "parse_pz: %s%s%s",
                     "poles must be real numbers (found '", field, "')");
       return EVALRESP_PAR;
     }
-    blkt_ptr->blkt_info.pole_zero.poles[i].real = atof (field);
     if ((status = get_field_to_parse (log, line, 2, field)))
     {
       return status;
     }
-    if (!is_real (field, log))
+    if (!lex_double (field, &blkt_ptr->blkt_info.pole_zero.poles[i].imag))
     {
       evalresp_log (log, EV_ERROR, EV_ERROR, "parse_pz: %s%s%s",
                     "poles must be real numbers (found '", field, "')");
       return EVALRESP_PAR;
     }
-    blkt_ptr->blkt_info.pole_zero.poles[i].imag = atof (field);
   }
 
   return status;
@@ -857,7 +964,7 @@ read_pz (evalresp_logger *log, evalresp_options const *const options, const char
 
 // was is_IIR_coeffs
 static int
-is_iir_coeffs (const char **seed)
+is_iir_coeffs (resp_lines *lines)
 {
   /* IGD Very narrow-specified function.                                    */
   /* It is used to check out if we are using a FIR or IIR coefficients      */
@@ -870,17 +977,23 @@ is_iir_coeffs (const char **seed)
   /* Tt returns 0  in case of the error, so use it with a caution!          */
   /* IGD I.Dricker ISTI i.dricker@isti.com 07/00 for evalresp 3.2.17        */
   /* IGD I.Dricker ISTI i.dricker@isti.com 07/17: Fully rewritten           */
-  char *substr = NULL;
-  char words[5][MAXLINELEN];
-  int denoms = 0;
+  const resp_line *line;
+  char copy[MAXLINELEN], words[5][MAXLINELEN];
+  int denoms = 0, i;
 
-  substr = strstr (*seed, "B054F10");
-  if (substr)
+  for (i = lines->next; i < lines->nlines; i++)
   {
-
-    /* Parsing (B054F10     Number of denominators:                0) */
-    sscanf (substr, "%s %s %s %s %s", words[0], words[1], words[2], words[3], words[4]);
-    denoms = atoi (words[4]);
+    line = &lines->lines[i];
+    if (line->blkt_no == 54 && line->fld_no == 10)
+    {
+      /* Parsing (B054F10     Number of denominators:                0) */
+      snprintf (copy, MAXLINELEN, "%.*s", line->length, line->start);
+      if (sscanf (copy, "%s %s %s %s %s", words[0], words[1], words[2], words[3], words[4]) == 5)
+      {
+        denoms = atoi (words[4]);
+      }
+      break;
+    }
   }
   if (0 == denoms)
     return 0;
@@ -889,7 +1002,7 @@ is_iir_coeffs (const char **seed)
 
 // this was parse_iir_coeff
 static int
-read_iir_coeff (evalresp_logger *log, evalresp_options const *const options, const char **seed, int first_field, char *first_line,
+read_iir_coeff (evalresp_logger *log, evalresp_options const *const options, resp_lines *lines, int first_field, char *first_line,
                 evalresp_channel *channel, evalresp_blkt *blkt_ptr, evalresp_stage *stage_ptr)
 {
   int status = EVALRESP_OK, i, check_fld, blkt_read, ncoeffs, ndenom;
@@ -932,14 +1045,14 @@ read_iir_coeff (evalresp_logger *log, evalresp_options const *const options, con
   /* then, if is a B054F04, get the stage sequence number (from the file) */
   if (check_fld == 4)
   {
-    if ((status = find_int_field (log, seed, ":", blkt_read, check_fld++, 0, &stage_ptr->sequence_no)))
+    if ((status = find_int_field (log, lines, ":", blkt_read, check_fld++, 0, &stage_ptr->sequence_no)))
     {
       return status;
     }
     //curr_seq_no = stage_ptr->sequence_no;
   }
 
-  if ((status = read_units (log, options, seed, blkt_read, &check_fld, channel,
+  if ((status = read_units (log, options, lines, blkt_read, &check_fld, channel,
                             &stage_ptr->input_units, &stage_ptr->output_units)))
   {
     return status;
@@ -947,21 +1060,21 @@ read_iir_coeff (evalresp_logger *log, evalresp_options const *const options, con
 
   /* the number of coefficients */
 
-  if ((status = find_int_field (log, seed, ":", blkt_read, check_fld++, 0, &ncoeffs)))
+  if ((status = find_int_field (log, lines, ":", blkt_read, check_fld++, 0, &ncoeffs)))
   {
     return status;
   }
   blkt_ptr->blkt_info.coeff.nnumer = ncoeffs;
 
   /* remember to allocate enough space for the number of coefficients to follow */
-  blkt_ptr->blkt_info.coeff.numer = alloc_double (ncoeffs, log);
+  blkt_ptr->blkt_info.coeff.numer = alloc_double (ncoeffs, lines->arena, log);
 
   /* set the expected field to the current value (8 or 9 for [54] or [44])
      to the current value + 2 (10 or 11 for [54] or [44] respectively) */
   check_fld += 2;
 
   /* the number of denominators */
-  if ((status = find_int_field (log, seed, ":", blkt_read, check_fld, 0, &ndenom)))
+  if ((status = find_int_field (log, lines, ":", blkt_read, check_fld, 0, &ndenom)))
   {
     return status;
   }
@@ -980,7 +1093,7 @@ read_iir_coeff (evalresp_logger *log, evalresp_options const *const options, con
 
   /* remember to allocate enough space for the number of coefficients to follow */
 
-  blkt_ptr->blkt_info.coeff.denom = alloc_double (ndenom, log);
+  blkt_ptr->blkt_info.coeff.denom = alloc_double (ndenom, lines->arena, log);
 
   /* set the expected field to the current value (10 or 11 for [54] or [44])
      to the current value - 2 (8 or 9 for [54] or [44] respectively) */
@@ -991,34 +1104,32 @@ read_iir_coeff (evalresp_logger *log, evalresp_options const *const options, con
 
   for (i = 0; i < ncoeffs; i++)
   {
-    if ((status = find_field (log, seed, " ", blkt_read, check_fld, 1, field)))
+    if ((status = find_field (log, lines, " ", blkt_read, check_fld, 1, field)))
     {
       return status;
     }
-    if (!is_real (field, log))
+    if (!lex_double (field, &blkt_ptr->blkt_info.coeff.numer[i]))
     {
       evalresp_log (log, EV_ERROR, EV_ERROR, "parse_coeff: %s%s%s",
                     "numerators must be real numbers (found '", field, "')");
       return EVALRESP_PAR;
     }
-    blkt_ptr->blkt_info.coeff.numer[i] = atof (field);
   }
 
   check_fld += 3;
 
   for (i = 0; i < ndenom; i++)
   {
-    if ((status = find_field (log, seed, " ", blkt_read, check_fld, 1, field)))
+    if ((status = find_field (log, lines, " ", blkt_read, check_fld, 1, field)))
     {
       return status;
     }
-    if (!is_real (field, log))
+    if (!lex_double (field, &blkt_ptr->blkt_info.coeff.denom[i]))
     {
       evalresp_log (log, EV_ERROR, EV_ERROR, "parse_coeff: %s%s%s",
                     "denominators must be real numbers (found '", field, "')");
       return EVALRESP_PAR;
     }
-    blkt_ptr->blkt_info.coeff.denom[i] = atof (field);
   }
 
   return status;
@@ -1026,7 +1137,7 @@ read_iir_coeff (evalresp_logger *log, evalresp_options const *const options, con
 
 // this was "parse_coeff"
 static int
-read_coeff (evalresp_logger *log, evalresp_options const *const options, const char **seed, int first_field, char *first_line,
+read_coeff (evalresp_logger *log, evalresp_options const *const options, resp_lines *lines, int first_field, char *first_line,
             evalresp_channel *channel, evalresp_blkt *blkt_ptr, evalresp_stage *stage_ptr)
 {
   int status = EVALRESP_OK, i, check_fld, blkt_read, ncoeffs, ndenom;
@@ -1069,14 +1180,14 @@ read_coeff (evalresp_logger *log, evalresp_options const *const options, const c
   /* then, if is a B054F04, get the stage sequence number (from the file) */
   if (check_fld == 4)
   {
-    if ((status = find_int_field (log, seed, ":", blkt_read, check_fld++, 0, &stage_ptr->sequence_no)))
+    if ((status = find_int_field (log, lines, ":", blkt_read, check_fld++, 0, &stage_ptr->sequence_no)))
     {
       return status;
     }
     //curr_seq_no = stage_ptr->sequence_no;
   }
 
-  if ((status = read_units (log, options, seed, blkt_read, &check_fld, channel,
+  if ((status = read_units (log, options, lines, blkt_read, &check_fld, channel,
                             &stage_ptr->input_units, &stage_ptr->output_units)))
   {
     return status;
@@ -1084,7 +1195,7 @@ read_coeff (evalresp_logger *log, evalresp_options const *const options, const c
 
   /* the number of coefficients */
 
-  if ((status = find_int_field (log, seed, ":", blkt_read, check_fld++, 0, &ncoeffs)))
+  if ((status = find_int_field (log, lines, ":", blkt_read, check_fld++, 0, &ncoeffs)))
   {
     return status;
   }
@@ -1092,7 +1203,7 @@ read_coeff (evalresp_logger *log, evalresp_options const *const options, const c
 
   /* remember to allocate enough space for the number of coefficients to follow */
 
-  blkt_ptr->blkt_info.fir.coeffs = alloc_double (ncoeffs, log);
+  blkt_ptr->blkt_info.fir.coeffs = alloc_double (ncoeffs, lines->arena, log);
 
   /* set the expected field to the current value (8 or 9 for [54] or [44])
      to the current value + 2 (10 or 11 for [54] or [44] respectively) */
@@ -1101,7 +1212,7 @@ read_coeff (evalresp_logger *log, evalresp_options const *const options, const c
 
   /* the number of denominators */
 
-  if ((status = find_int_field (log, seed, ":", blkt_read, check_fld, 0, &ndenom)))
+  if ((status = find_int_field (log, lines, ":", blkt_read, check_fld, 0, &ndenom)))
   {
     return status;
   }
@@ -1130,17 +1241,16 @@ read_coeff (evalresp_logger *log, evalresp_options const *const options, const c
 
   for (i = 0; i < ncoeffs; i++)
   {
-    if ((status = find_field (log, seed, " ", blkt_read, check_fld, 1, field)))
+    if ((status = find_field (log, lines, " ", blkt_read, check_fld, 1, field)))
     {
       return status;
     }
-    if (!is_real (field, log))
+    if (!lex_double (field, &blkt_ptr->blkt_info.fir.coeffs[i]))
     {
       evalresp_log (log, EV_ERROR, EV_ERROR, "parse_coeff: %s%s%s",
                     "coeffs must be real numbers (found '", field, "')");
       return EVALRESP_PAR;
     }
-    blkt_ptr->blkt_info.fir.coeffs[i] = atof (field);
   }
 
   return status;
@@ -1148,12 +1258,12 @@ read_coeff (evalresp_logger *log, evalresp_options const *const options, const c
 
 // this was "parse_list"
 static int
-read_list (evalresp_logger *log, evalresp_options const *const options, const char **seed, int first_field, char *first_line,
+read_list (evalresp_logger *log, evalresp_options const *const options, resp_lines *lines, int first_field, char *first_line,
            evalresp_channel *channel, evalresp_blkt *blkt_ptr, evalresp_stage *stage_ptr)
 {
   int status = EVALRESP_OK, i, blkt_read, check_fld, nresp, format;
   char field[MAXFLDLEN], line[MAXLINELEN];
-  const char *lookahead;
+  resp_lines lookahead;
 
   blkt_ptr->type = LIST;
 
@@ -1182,7 +1292,7 @@ read_list (evalresp_logger *log, evalresp_options const *const options, const ch
     }
     //curr_seq_no = stage_ptr->sequence_no;
     check_fld++;
-    if ((status = find_line (log, seed, ":", blkt_read, check_fld++, line)))
+    if ((status = find_line (log, lines, ":", blkt_read, check_fld++, line)))
     {
       return status;
     }
@@ -1193,7 +1303,7 @@ read_list (evalresp_logger *log, evalresp_options const *const options, const ch
     check_fld++;
   }
 
-  if ((status = read_units_first_line_known (log, options, seed, blkt_read, &check_fld,
+  if ((status = read_units_first_line_known (log, options, lines, blkt_read, &check_fld,
                                              line, channel,
                                              &stage_ptr->input_units, &stage_ptr->output_units)))
   {
@@ -1202,7 +1312,7 @@ read_list (evalresp_logger *log, evalresp_options const *const options, const ch
 
   /* the number of responses */
 
-  if ((status = find_int_field (log, seed, ":", blkt_read, check_fld++, 0, &nresp)))
+  if ((status = find_int_field (log, lines, ":", blkt_read, check_fld++, 0, &nresp)))
   {
     return status;
   }
@@ -1210,9 +1320,9 @@ read_list (evalresp_logger *log, evalresp_options const *const options, const ch
 
   /* remember to allocate enough space for the number frequency, amplitude, phase tuples
      that follow */
-  blkt_ptr->blkt_info.list.freq = alloc_double (nresp, log);
-  blkt_ptr->blkt_info.list.amp = alloc_double (nresp, log);
-  blkt_ptr->blkt_info.list.phase = alloc_double (nresp, log);
+  blkt_ptr->blkt_info.list.freq = alloc_double (nresp, lines->arena, log);
+  blkt_ptr->blkt_info.list.amp = alloc_double (nresp, lines->arena, log);
+  blkt_ptr->blkt_info.list.phase = alloc_double (nresp, lines->arena, log);
 
   /* then get the response information */
 
@@ -1220,7 +1330,7 @@ read_list (evalresp_logger *log, evalresp_options const *const options, const ch
   { /* This is blockette 55 */
 
     /*we now check if the B055F07-11 has a numbering field and set format accordingly */
-    lookahead = *seed;
+    lookahead = *lines;
     if ((status = find_line (log, &lookahead, " ", blkt_read, check_fld, line)))
     {
       return status;
@@ -1240,7 +1350,7 @@ read_list (evalresp_logger *log, evalresp_options const *const options, const ch
 
     for (i = 0; i < nresp; i++)
     {
-      if ((status = find_line (log, seed, " ", blkt_read, check_fld, line)))
+      if ((status = find_line (log, lines, " ", blkt_read, check_fld, line)))
       {
         return status;
       }
@@ -1248,43 +1358,40 @@ read_list (evalresp_logger *log, evalresp_options const *const options, const ch
       {
         return status;
       }
-      if (!is_real (field, log))
+      if (!lex_double (field, &blkt_ptr->blkt_info.list.freq[i]))
       {
         evalresp_log (log, EV_ERROR, EV_ERROR, "parse_list: %s%s%s",
                       "freq vals must be real numbers (found '", field, "')");
         return EVALRESP_PAR;
       }
-      blkt_ptr->blkt_info.list.freq[i] = atof (field);
       if ((status = get_field_to_parse (log, line, 1 + format, field))) /* the amplitude of the Fourier transform */
       {
         return status;
       }
-      if (!is_real (field, log))
+      if (!lex_double (field, &blkt_ptr->blkt_info.list.amp[i]))
       {
         evalresp_log (log, EV_ERROR, EV_ERROR, "parse_list: %s%s%s",
                       "amp vals must be real numbers (found '", field, "')");
         return EVALRESP_PAR;
       }
-      blkt_ptr->blkt_info.list.amp[i] = atof (field);
       if ((status = get_field_to_parse (log, line, 3 + format, field))) /* Phase of the transform */
       {
         return status;
       }
-      if (!is_real (field, log))
+      if (!lex_double (field, &blkt_ptr->blkt_info.list.phase[i]))
       {
         evalresp_log (log, EV_ERROR, EV_ERROR, "parse_list: %s%s%s",
                       "phase vals must be real numbers (found '", field,
                       "')");
         return EVALRESP_PAR;
       }
-      blkt_ptr->blkt_info.list.phase[i] = atof (field);
     }
   }
   else
   { /* This is blockette 45 - leave at as in McSweeny's version */
     for (i = 0; i < nresp; i++)
     {
-      if ((status = find_line (log, seed, " ", blkt_read, check_fld, line)))
+      if ((status = find_line (log, lines, " ", blkt_read, check_fld, line)))
       {
         return status;
       }
@@ -1292,36 +1399,33 @@ read_list (evalresp_logger *log, evalresp_options const *const options, const ch
       {
         return status;
       }
-      if (!is_real (field, log))
+      if (!lex_double (field, &blkt_ptr->blkt_info.list.freq[i]))
       {
         evalresp_log (log, EV_ERROR, EV_ERROR, "parse_list: %s%s%s",
                       "freq vals must be real numbers (found '", field, "')");
         return EVALRESP_PAR;
       }
-      blkt_ptr->blkt_info.list.freq[i] = atof (field);
       if ((status = get_field_to_parse (log, line, 1, field)))
       {
         return status;
       }
-      if (!is_real (field, log))
+      if (!lex_double (field, &blkt_ptr->blkt_info.list.amp[i]))
       {
         evalresp_log (log, EV_ERROR, EV_ERROR, "parse_list: %s%s%s",
                       "amp vals must be real numbers (found '", field, "')");
         return EVALRESP_PAR;
       }
-      blkt_ptr->blkt_info.list.amp[i] = atof (field);
       if ((status = get_field_to_parse (log, line, 3, field)))
       {
         return status;
       }
-      if (!is_real (field, log))
+      if (!lex_double (field, &blkt_ptr->blkt_info.list.phase[i]))
       {
         evalresp_log (log, EV_ERROR, EV_ERROR, "parse_list: %s%s%s",
                       "phase vals must be real numbers (found '", field,
                       "')");
         return EVALRESP_PAR;
       }
-      blkt_ptr->blkt_info.list.phase[i] = atof (field);
     }
   }
 
@@ -1330,7 +1434,7 @@ read_list (evalresp_logger *log, evalresp_options const *const options, const ch
 
 // this was "parse_generic"
 static int
-read_generic (evalresp_logger *log, evalresp_options const *const options, const char **seed, int first_field, char *first_line,
+read_generic (evalresp_logger *log, evalresp_options const *const options, resp_lines *lines, int first_field, char *first_line,
               evalresp_channel *channel, evalresp_blkt *blkt_ptr, evalresp_stage *stage_ptr)
 {
   int status = EVALRESP_OK, i, blkt_read, check_fld, ncorners;
@@ -1366,7 +1470,7 @@ read_generic (evalresp_logger *log, evalresp_options const *const options, const
     }
     //curr_seq_no = stage_ptr->sequence_no;
     check_fld++;
-    if ((status = find_line (log, seed, ":", blkt_read, check_fld++, line)))
+    if ((status = find_line (log, lines, ":", blkt_read, check_fld++, line)))
     {
       return status;
     }
@@ -1377,7 +1481,7 @@ read_generic (evalresp_logger *log, evalresp_options const *const options, const
     check_fld++;
   }
 
-  if ((status = read_units_first_line_known (log, options, seed, blkt_read, &check_fld,
+  if ((status = read_units_first_line_known (log, options, lines, blkt_read, &check_fld,
                                              line, channel,
                                              &stage_ptr->input_units, &stage_ptr->output_units)))
   {
@@ -1386,7 +1490,7 @@ read_generic (evalresp_logger *log, evalresp_options const *const options, const
 
   /* the number of responses */
 
-  if ((status = find_int_field (log, seed, ":", blkt_read, check_fld++, 0, &ncorners)))
+  if ((status = find_int_field (log, lines, ":", blkt_read, check_fld++, 0, &ncorners)))
   {
     return status;
   }
@@ -1395,14 +1499,14 @@ read_generic (evalresp_logger *log, evalresp_options const *const options, const
   /* remember to allocate enough space for the number corner_frequency, corner_slope pairs
      that follow */
 
-  blkt_ptr->blkt_info.generic.corner_freq = alloc_double (ncorners, log);
-  blkt_ptr->blkt_info.generic.corner_slope = alloc_double (ncorners, log);
+  blkt_ptr->blkt_info.generic.corner_freq = alloc_double (ncorners, lines->arena, log);
+  blkt_ptr->blkt_info.generic.corner_slope = alloc_double (ncorners, lines->arena, log);
 
   /* then get the response information */
 
   for (i = 0; i < ncorners; i++)
   {
-    if ((status = find_line (log, seed, " ", blkt_read, check_fld, line)))
+    if ((status = find_line (log, lines, " ", blkt_read, check_fld, line)))
     {
       return status;
     }
@@ -1410,24 +1514,22 @@ read_generic (evalresp_logger *log, evalresp_options const *const options, const
     {
       return status;
     }
-    if (!is_real (field, log))
+    if (!lex_double (field, &blkt_ptr->blkt_info.generic.corner_freq[i]))
     {
       evalresp_log (log, EV_ERROR, EV_ERROR, "parse_generic: %s%s%s",
                     "corner_freqs must be real numbers (found '", field, "')");
       return EVALRESP_PAR;
     }
-    blkt_ptr->blkt_info.generic.corner_freq[i] = atof (field);
     if ((status = get_field_to_parse (log, line, 2, field)))
     {
       return status;
     }
-    if (!is_real (field, log))
+    if (!lex_double (field, &blkt_ptr->blkt_info.generic.corner_slope[i]))
     {
       evalresp_log (log, EV_ERROR, EV_ERROR, "parse_generic: %s%s%s",
                     "corner_slopes must be real numbers (found '", field, "')");
       return EVALRESP_PAR;
     }
-    blkt_ptr->blkt_info.generic.corner_slope[i] = atof (field);
   }
 
   return status;
@@ -1435,7 +1537,7 @@ read_generic (evalresp_logger *log, evalresp_options const *const options, const
 
 // this was "parse_deci"
 static int
-read_deci (evalresp_logger *log, const char **seed, int first_field, char *first_line,
+read_deci (evalresp_logger *log, resp_lines *lines, int first_field, char *first_line,
            evalresp_blkt *blkt_ptr, int *sequence_no)
 {
   int status = EVALRESP_OK, blkt_read, check_fld;
@@ -1473,7 +1575,7 @@ read_deci (evalresp_logger *log, const char **seed, int first_field, char *first
       return status;
     }
     check_fld++;
-    if ((status = find_field (log, seed, ":", blkt_read, check_fld++, 0, field)))
+    if ((status = find_field (log, lines, ":", blkt_read, check_fld++, 0, field)))
     {
       return status;
     }
@@ -1498,12 +1600,12 @@ read_deci (evalresp_logger *log, const char **seed, int first_field, char *first
   }
 
   /* get the decimation factor and decimation offset */
-  if ((status = find_int_field (log, seed, ":", blkt_read, check_fld++, 0,
+  if ((status = find_int_field (log, lines, ":", blkt_read, check_fld++, 0,
                                 &blkt_ptr->blkt_info.decimation.deci_fact)))
   {
     return status;
   }
-  if ((status = find_int_field (log, seed, ":", blkt_read, check_fld++, 0,
+  if ((status = find_int_field (log, lines, ":", blkt_read, check_fld++, 0,
                                 &blkt_ptr->blkt_info.decimation.deci_offset)))
   {
     return status;
@@ -1511,7 +1613,7 @@ read_deci (evalresp_logger *log, const char **seed, int first_field, char *first
 
   /* the estimated delay */
 
-  if ((status = find_double_field (log, seed, ":", blkt_read, check_fld++, 0,
+  if ((status = find_double_field (log, lines, ":", blkt_read, check_fld++, 0,
                                    &blkt_ptr->blkt_info.decimation.estim_delay)))
   {
     return status;
@@ -1520,7 +1622,7 @@ read_deci (evalresp_logger *log, const char **seed, int first_field, char *first
   /* and, finally, the applied correction.  Note:  the calculated delay is left undefined
      by this routine, although space does exist in this filter type for this parameter */
 
-  if ((status = find_double_field (log, seed, ":", blkt_read, check_fld++, 0,
+  if ((status = find_double_field (log, lines, ":", blkt_read, check_fld++, 0,
                                    &blkt_ptr->blkt_info.decimation.applied_corr)))
   {
     return status;
@@ -1531,7 +1633,7 @@ read_deci (evalresp_logger *log, const char **seed, int first_field, char *first
 
 // this was "parse_gain"
 static int
-read_gain (evalresp_logger *log, const char **seed, int first_field, char *first_line,
+read_gain (evalresp_logger *log, resp_lines *lines, int first_field, char *first_line,
            evalresp_blkt *blkt_ptr, int *sequence_no)
 {
   int status = EVALRESP_OK, i, blkt_read, check_fld, nhist = 0;
@@ -1567,7 +1669,7 @@ read_gain (evalresp_logger *log, const char **seed, int first_field, char *first
       return status;
     }
     check_fld++;
-    if ((status = find_field (log, seed, ":", blkt_read, check_fld++, 0, field)))
+    if ((status = find_field (log, lines, ":", blkt_read, check_fld++, 0, field)))
     {
       return status;
     }
@@ -1589,7 +1691,7 @@ read_gain (evalresp_logger *log, const char **seed, int first_field, char *first
     return status;
   }
 
-  if ((status = find_double_field (log, seed, ":", blkt_read, check_fld++, 0,
+  if ((status = find_double_field (log, lines, ":", blkt_read, check_fld++, 0,
                                    &blkt_ptr->blkt_info.gain.gain_freq)))
   {
     return status;
@@ -1597,7 +1699,7 @@ read_gain (evalresp_logger *log, const char **seed, int first_field, char *first
 
   /* if there is a history, skip it. First determine number of lines to skip */
 
-  if ((status = find_int_field (log, seed, ":", blkt_read, check_fld++, 0, &nhist)))
+  if ((status = find_int_field (log, lines, ":", blkt_read, check_fld++, 0, &nhist)))
   {
     return status;
   }
@@ -1606,7 +1708,7 @@ read_gain (evalresp_logger *log, const char **seed, int first_field, char *first
 
   for (i = 0; i < nhist; i++)
   {
-    if ((status = find_line (log, seed, " ", blkt_read, check_fld, line)))
+    if ((status = find_line (log, lines, " ", blkt_read, check_fld, line)))
     {
       return status;
     }
@@ -1619,7 +1721,7 @@ read_gain (evalresp_logger *log, const char **seed, int first_field, char *first
 
 // this was "parse_fir"
 static int
-read_fir (evalresp_logger *log, evalresp_options const *const options, const char **seed, int first_field, char *first_line,
+read_fir (evalresp_logger *log, evalresp_options const *const options, resp_lines *lines, int first_field, char *first_line,
           evalresp_channel *channel, evalresp_blkt *blkt_ptr, evalresp_stage *stage_ptr)
 {
   int status = EVALRESP_OK, i, blkt_read, check_fld, ncoeffs;
@@ -1650,7 +1752,7 @@ read_fir (evalresp_logger *log, evalresp_options const *const options, const cha
     }
     //curr_seq_no = stage_ptr->sequence_no;
     check_fld += 2;
-    if ((status = find_field (log, seed, ":", blkt_read, check_fld++, 0, field)))
+    if ((status = find_field (log, lines, ":", blkt_read, check_fld++, 0, field)))
     {
       return status;
     }
@@ -1692,7 +1794,7 @@ read_fir (evalresp_logger *log, evalresp_options const *const options, const cha
     return EVALRESP_PAR;
   }
 
-  if ((status = read_units (log, options, seed, blkt_read, &check_fld, channel,
+  if ((status = read_units (log, options, lines, blkt_read, &check_fld, channel,
                             &stage_ptr->input_units, &stage_ptr->output_units)))
   {
     return status;
@@ -1700,7 +1802,7 @@ read_fir (evalresp_logger *log, evalresp_options const *const options, const cha
 
   /* the number of coefficients */
 
-  if ((status = find_int_field (log, seed, ":", blkt_read, check_fld++, 0, &ncoeffs)))
+  if ((status = find_int_field (log, lines, ":", blkt_read, check_fld++, 0, &ncoeffs)))
   {
     return status;
   }
@@ -1708,23 +1810,22 @@ read_fir (evalresp_logger *log, evalresp_options const *const options, const cha
 
   /* remember to allocate enough space for the number of coefficients to follow */
 
-  blkt_ptr->blkt_info.fir.coeffs = alloc_double (ncoeffs, log);
+  blkt_ptr->blkt_info.fir.coeffs = alloc_double (ncoeffs, lines->arena, log);
 
   /* the coefficients */
 
   for (i = 0; i < ncoeffs; i++)
   {
-    if ((status = find_field (log, seed, " ", blkt_read, check_fld, 1, field)))
+    if ((status = find_field (log, lines, " ", blkt_read, check_fld, 1, field)))
     {
       return status;
     }
-    if (!is_real (field, log))
+    if (!lex_double (field, &blkt_ptr->blkt_info.fir.coeffs[i]))
     {
       evalresp_log (log, EV_ERROR, EV_ERROR, "parse_fir: %s%s%s",
                     "coeffs must be real numbers (found '", field, "')");
       return EVALRESP_PAR;
     }
-    blkt_ptr->blkt_info.fir.coeffs[i] = atof (field);
   }
 
   return status;
@@ -1732,7 +1833,7 @@ read_fir (evalresp_logger *log, evalresp_options const *const options, const cha
 
 // this was "parse_ref"
 static int
-read_ref (evalresp_logger *log, evalresp_options const *const options, const char **seed, int first_field, char *first_line,
+read_ref (evalresp_logger *log, evalresp_options const *const options, resp_lines *lines, int first_field, char *first_line,
           evalresp_channel *channel, evalresp_blkt *blkt_ptr, evalresp_stage *stage_ptr)
 {
   int status = EVALRESP_OK, this_blkt_no = 60, blkt_no, fld_no, i, j, prev_blkt_no = 60;
@@ -1758,13 +1859,12 @@ read_ref (evalresp_logger *log, evalresp_options const *const options, const cha
   {
     return status;
   }
-  if (!is_int (field, log))
+  if (!lex_int (field, &nstages))
   {
     evalresp_log (log, EV_ERROR, EV_ERROR, "parse_ref; value '%s' %s", field,
                   " cannot be converted to the number of stages");
     return EVALRESP_PAR;
   }
-  nstages = atoi (field);
   blkt_ptr->blkt_info.reference.num_stages = nstages;
 
   /* then (from the file) read all of the stages in sequence */
@@ -1773,17 +1873,16 @@ read_ref (evalresp_logger *log, evalresp_options const *const options, const cha
   {
 
     /* determine the stage number in the sequence of stages */
-    if ((status = find_field (log, seed, ":", this_blkt_no, 4, 0, field)))
+    if ((status = find_field (log, lines, ":", this_blkt_no, 4, 0, field)))
     {
       return status;
     }
-    if (!is_int (field, log))
+    if (!lex_int (field, &stage_num))
     {
       evalresp_log (log, EV_ERROR, EV_ERROR, "parse_ref; value '%s' %s", field,
                     " cannot be converted to the stage sequence number");
       return EVALRESP_PAR;
     }
-    stage_num = atoi (field);
     blkt_ptr->blkt_info.reference.stage_num = stage_num;
 
     /* set the stage sequence number and the pointer to the first blockette */
@@ -1793,17 +1892,16 @@ read_ref (evalresp_logger *log, evalresp_options const *const options, const cha
 
     /* then the number of responses in this stage */
 
-    if ((status = find_field (log, seed, ":", this_blkt_no, 5, 0, field)))
+    if ((status = find_field (log, lines, ":", this_blkt_no, 5, 0, field)))
     {
       return status;
     }
-    if (!is_int (field, log))
+    if (!lex_int (field, &nresps))
     {
       evalresp_log (log, EV_ERROR, EV_ERROR, "parse_ref; value '%s' %s", field,
                     " cannot be converted to the number of responses");
       return EVALRESP_PAR;
     }
-    nresps = atoi (field);
     blkt_ptr->blkt_info.reference.num_responses = nresps;
 
     /* then, for each of the responses in this stage, get the first line of the next
@@ -1811,38 +1909,38 @@ read_ref (evalresp_logger *log, evalresp_options const *const options, const cha
 
     for (j = 0; j < nresps; j++)
     {
-      if (!(status = read_line (log, seed, ":", &blkt_no, &fld_no, first_line)))
+      if (!(status = read_line (log, lines, ":", &blkt_no, &fld_no, first_line)))
       {
         last_blkt = blkt_ptr;
         switch (blkt_no)
         {
         case 43:
-          blkt_ptr = alloc_pz (log);
-          status = read_pz (log, options, seed, fld_no, first_line, channel, blkt_ptr, this_stage);
+          blkt_ptr = alloc_pz (lines->arena, log);
+          status = read_pz (log, options, lines, fld_no, first_line, channel, blkt_ptr, this_stage);
           break;
         case 44:
-          blkt_ptr = alloc_fir (log);
-          status = read_coeff (log, options, seed, fld_no, first_line, channel, blkt_ptr, this_stage);
+          blkt_ptr = alloc_fir (lines->arena, log);
+          status = read_coeff (log, options, lines, fld_no, first_line, channel, blkt_ptr, this_stage);
           break;
         case 45:
-          blkt_ptr = alloc_list (log);
-          status = read_list (log, options, seed, fld_no, first_line, channel, blkt_ptr, this_stage);
+          blkt_ptr = alloc_list (lines->arena, log);
+          status = read_list (log, options, lines, fld_no, first_line, channel, blkt_ptr, this_stage);
           break;
         case 46:
-          blkt_ptr = alloc_generic (log);
-          status = read_generic (log, options, seed, fld_no, first_line, channel, blkt_ptr, this_stage);
+          blkt_ptr = alloc_generic (lines->arena, log);
+          status = read_generic (log, options, lines, fld_no, first_line, channel, blkt_ptr, this_stage);
           break;
         case 47:
-          blkt_ptr = alloc_deci (log);
-          status = read_deci (log, seed, fld_no, first_line, blkt_ptr, NULL);
+          blkt_ptr = alloc_deci (lines->arena, log);
+          status = read_deci (log, lines, fld_no, first_line, blkt_ptr, NULL);
           break;
         case 48:
-          blkt_ptr = alloc_gain (log);
-          status = read_gain (log, seed, fld_no, first_line, blkt_ptr, NULL);
+          blkt_ptr = alloc_gain (lines->arena, log);
+          status = read_gain (log, lines, fld_no, first_line, blkt_ptr, NULL);
           break;
         case 41:
-          blkt_ptr = alloc_fir (log);
-          status = read_fir (log, options, seed, fld_no, first_line, channel, blkt_ptr, this_stage);
+          blkt_ptr = alloc_fir (lines->arena, log);
+          status = read_fir (log, options, lines, fld_no, first_line, channel, blkt_ptr, this_stage);
           break;
         case 60:
           evalresp_log (log, EV_ERROR, EV_ERROR,
@@ -1876,8 +1974,8 @@ read_ref (evalresp_logger *log, evalresp_options const *const options, const cha
              for that stage to point to a new blockette [60] type filter */
 
       last_stage = this_stage;
-      this_stage = alloc_stage (log);
-      blkt_ptr = alloc_ref (log);
+      this_stage = alloc_stage (lines->arena, log);
+      blkt_ptr = alloc_ref (lines->arena, log);
       last_stage->next_stage = this_stage;
       this_stage->first_blkt = blkt_ptr;
 
@@ -1887,18 +1985,16 @@ read_ref (evalresp_logger *log, evalresp_options const *const options, const cha
 
       /* and set the number of stages again ... */
 
-      if ((status = find_field (log, seed, ":", this_blkt_no, 3, 0, field)))
+      if ((status = find_field (log, lines, ":", this_blkt_no, 3, 0, field)))
       {
         return status;
       }
-      if (!is_int (field, log))
+      if (!lex_int (field, &lcl_nstages))
       {
         evalresp_log (log, EV_ERROR, EV_ERROR, "parse_ref; value '%s' %s", field,
                       " cannot be converted to the new stage sequence number");
         return EVALRESP_PAR;
       }
-
-      lcl_nstages = atoi (field);
       if (lcl_nstages != nstages)
       {
         evalresp_log (log, EV_ERROR, EV_ERROR,
@@ -1916,7 +2012,7 @@ read_ref (evalresp_logger *log, evalresp_options const *const options, const cha
 
 // this was "parse_polynomial"
 static int
-read_polynomial (evalresp_logger *log, evalresp_options const *const options, const char **seed, int first_field, char *first_line,
+read_polynomial (evalresp_logger *log, evalresp_options const *const options, resp_lines *lines, int first_field, char *first_line,
                  evalresp_channel *channel, evalresp_blkt *blkt_ptr, evalresp_stage *stage_ptr)
 {
   int status = EVALRESP_OK, i, blkt_read, check_fld, ncoeffs;
@@ -1955,63 +2051,63 @@ read_polynomial (evalresp_logger *log, evalresp_options const *const options, co
 
   if (check_fld == 4)
   {
-    if ((status = find_int_field (log, seed, ":", blkt_read, check_fld++, 0, &stage_ptr->sequence_no)))
+    if ((status = find_int_field (log, lines, ":", blkt_read, check_fld++, 0, &stage_ptr->sequence_no)))
     {
       return status;
     }
     //curr_seq_no = stage_ptr->sequence_no;
   }
 
-  if ((status = read_units (log, options, seed, blkt_read, &check_fld, channel,
+  if ((status = read_units (log, options, lines, blkt_read, &check_fld, channel,
                             &stage_ptr->input_units, &stage_ptr->output_units)))
   {
     return status;
   }
 
   /* Polynomial Approximation Type */
-  if ((status = find_field (log, seed, ":", blkt_read, check_fld++, 0, field)))
+  if ((status = find_field (log, lines, ":", blkt_read, check_fld++, 0, field)))
   {
     return status;
   }
   blkt_ptr->blkt_info.polynomial.approximation_type = field[0];
 
   /* Valid Frequency Units */
-  if ((status = find_field (log, seed, ":", blkt_read, check_fld++, 0, field)))
+  if ((status = find_field (log, lines, ":", blkt_read, check_fld++, 0, field)))
   {
     return status;
   }
   blkt_ptr->blkt_info.polynomial.frequency_units = field[0];
 
   /* Lower Valid Frequency Bound */
-  if ((status = find_double_field (log, seed, ":", blkt_read, check_fld++, 0,
+  if ((status = find_double_field (log, lines, ":", blkt_read, check_fld++, 0,
                                    &blkt_ptr->blkt_info.polynomial.lower_freq_bound)))
   {
     return status;
   }
 
   /* Upper Valid Frequency Bound */
-  if ((status = find_double_field (log, seed, ":", blkt_read, check_fld++, 0,
+  if ((status = find_double_field (log, lines, ":", blkt_read, check_fld++, 0,
                                    &blkt_ptr->blkt_info.polynomial.upper_freq_bound)))
   {
     return status;
   }
 
   /* Lower Bound of Approximation */
-  if ((status = find_double_field (log, seed, ":", blkt_read, check_fld++, 0,
+  if ((status = find_double_field (log, lines, ":", blkt_read, check_fld++, 0,
                                    &blkt_ptr->blkt_info.polynomial.lower_approx_bound)))
   {
     return status;
   }
 
   /* Upper Bound of Approximation */
-  if ((status = find_double_field (log, seed, ":", blkt_read, check_fld++, 0,
+  if ((status = find_double_field (log, lines, ":", blkt_read, check_fld++, 0,
                                    &blkt_ptr->blkt_info.polynomial.upper_approx_bound)))
   {
     return status;
   }
 
   /* Maximum Absolute Error */
-  if ((status = find_double_field (log, seed, ":", blkt_read, check_fld++, 0,
+  if ((status = find_double_field (log, lines, ":", blkt_read, check_fld++, 0,
                                    &blkt_ptr->blkt_info.polynomial.max_abs_error)))
   {
     return status;
@@ -2019,7 +2115,7 @@ read_polynomial (evalresp_logger *log, evalresp_options const *const options, co
 
   /* the number of coefficients */
 
-  if ((status = find_int_field (log, seed, ":", blkt_read, check_fld, 0, &ncoeffs)))
+  if ((status = find_int_field (log, lines, ":", blkt_read, check_fld, 0, &ncoeffs)))
   {
     return status;
   }
@@ -2027,8 +2123,8 @@ read_polynomial (evalresp_logger *log, evalresp_options const *const options, co
 
   /* remember to allocate enough space for the number of coeffs */
 
-  blkt_ptr->blkt_info.polynomial.coeffs = calloc (ncoeffs, sizeof (double));
-  blkt_ptr->blkt_info.polynomial.coeffs_err = calloc (ncoeffs, sizeof (double));
+  blkt_ptr->blkt_info.polynomial.coeffs = alloc_double (ncoeffs, lines->arena, log);
+  blkt_ptr->blkt_info.polynomial.coeffs_err = alloc_double (ncoeffs, lines->arena, log);
 
   check_fld += 1;
 
@@ -2036,7 +2132,7 @@ read_polynomial (evalresp_logger *log, evalresp_options const *const options, co
 
   for (i = 0; i < ncoeffs; i++)
   {
-    if ((status = find_line (log, seed, " ", blkt_read, check_fld, line)))
+    if ((status = find_line (log, lines, " ", blkt_read, check_fld, line)))
     {
       return status;
     }
@@ -2044,24 +2140,22 @@ read_polynomial (evalresp_logger *log, evalresp_options const *const options, co
     {
       return status;
     }
-    if (!is_real (field, log))
+    if (!lex_double (field, &blkt_ptr->blkt_info.polynomial.coeffs[i]))
     {
       evalresp_log (log, EV_ERROR, EV_ERROR, "polynomial: %s%s%s",
                     "coeffs must be real numbers (found '", field, "')");
       return EVALRESP_PAR;
     }
-    blkt_ptr->blkt_info.polynomial.coeffs[i] = atof (field);
     if ((status = get_field_to_parse (log, line, 2, field)))
     {
       return status;
     }
-    if (!is_real (field, log))
+    if (!lex_double (field, &blkt_ptr->blkt_info.polynomial.coeffs_err[i]))
     {
       evalresp_log (log, EV_ERROR, EV_ERROR, "polynomial: %s%s%s",
                     "coeffs errors must be real numbers (found '", field, "')");
       return EVALRESP_PAR;
     }
-    blkt_ptr->blkt_info.polynomial.coeffs_err[i] = atof (field);
   }
 
   return status;
@@ -2069,7 +2163,7 @@ read_polynomial (evalresp_logger *log, evalresp_options const *const options, co
 
 // this was "parse_channel"
 static int
-read_channel_data (evalresp_logger *log, evalresp_options const *const options, const char **seed, char *first_line,
+read_channel_data (evalresp_logger *log, evalresp_options const *const options, resp_lines *lines, char *first_line,
                    evalresp_channel *channel)
 {
 
@@ -2083,70 +2177,70 @@ read_channel_data (evalresp_logger *log, evalresp_options const *const options,
 
   last_stage = (evalresp_stage *)NULL;
   curr_seq_no = last_seq_no = 0;
-  this_stage = alloc_stage (log);
+  this_stage = alloc_stage (lines->arena, log);
   channel->first_stage = this_stage;
   channel->nstages++;
-  tmp_stage = alloc_stage (log);
+  tmp_stage = alloc_stage (lines->arena, log);
 
   /* start processing the response information */
 
-  while (!(status = read_line (log, seed, ":", &blkt_no, &first_field, first_line)) && blkt_no != 50)
+  while (!(status = read_line (log, lines, ":", &blkt_no, &first_field, first_line)) && blkt_no != 50)
   {
     switch (blkt_no)
     {
     case 53:
-      blkt_ptr = alloc_pz (log);
-      status = read_pz (log, options, seed, first_field, first_line, channel, blkt_ptr, tmp_stage);
+      blkt_ptr = alloc_pz (lines->arena, log);
+      status = read_pz (log, options, lines, first_field, first_line, channel, blkt_ptr, tmp_stage);
       curr_seq_no = tmp_stage->sequence_no;
       break;
     case 54:
       /* IGD : as we add an IIR case to this blockette, we cannot simply assume that blockette 54 is FIR */
       /*The field 10 should be distinguish between the IIR and FIR */
-      if (is_iir_coeffs (seed))
+      if (is_iir_coeffs (lines))
       {
-        blkt_ptr = alloc_coeff (log);
-        status = read_iir_coeff (log, options, seed, first_field, first_line, channel, blkt_ptr, tmp_stage);
+        blkt_ptr = alloc_coeff (lines->arena, log);
+        status = read_iir_coeff (log, options, lines, first_field, first_line, channel, blkt_ptr, tmp_stage);
       }
       else
       {
-        blkt_ptr = alloc_fir (log);
-        status = read_coeff (log, options, seed, first_field, first_line, channel, blkt_ptr, tmp_stage);
+        blkt_ptr = alloc_fir (lines->arena, log);
+        status = read_coeff (log, options, lines, first_field, first_line, channel, blkt_ptr, tmp_stage);
       }
       curr_seq_no = tmp_stage->sequence_no;
       break;
     case 55:
-      blkt_ptr = alloc_list (log);
-      status = read_list (log, options, seed, first_field, first_line, channel, blkt_ptr, tmp_stage);
+      blkt_ptr = alloc_list (lines->arena, log);
+      status = read_list (log, options, lines, first_field, first_line, channel, blkt_ptr, tmp_stage);
       curr_seq_no = tmp_stage->sequence_no;
       break;
     case 56:
-      blkt_ptr = alloc_generic (log);
-      status = read_generic (log, options, seed, first_field, first_line, channel, blkt_ptr, tmp_stage);
+      blkt_ptr = alloc_generic (lines->arena, log);
+      status = read_generic (log, options, lines, first_field, first_line, channel, blkt_ptr, tmp_stage);
       curr_seq_no = tmp_stage->sequence_no;
       break;
     case 57:
-      blkt_ptr = alloc_deci (log);
-      status = read_deci (log, seed, first_field, first_line, blkt_ptr, &curr_seq_no);
+      blkt_ptr = alloc_deci (lines->arena, log);
+      status = read_deci (log, lines, first_field, first_line, blkt_ptr, &curr_seq_no);
       break;
     case 58:
-      blkt_ptr = alloc_gain (log);
-      status = read_gain (log, seed, first_field, first_line, blkt_ptr, &curr_seq_no);
+      blkt_ptr = alloc_gain (lines->arena, log);
+      status = read_gain (log, lines, first_field, first_line, blkt_ptr, &curr_seq_no);
       break;
     case 60: /* never see a blockette [41], [43]-[48] without a [60], parse_ref handles these */
-      blkt_ptr = alloc_ref (log);
-      tmp_stage2 = alloc_stage (log);
-      status = read_ref (log, options, seed, first_field, first_line, channel, blkt_ptr, tmp_stage2);
+      blkt_ptr = alloc_ref (lines->arena, log);
+      tmp_stage2 = alloc_stage (lines->arena, log);
+      status = read_ref (log, options, lines, first_field, first_line, channel, blkt_ptr, tmp_stage2);
       curr_seq_no = tmp_stage2->sequence_no;
       tmp_stage2->first_blkt = blkt_ptr;
       break;
     case 61:
-      blkt_ptr = alloc_fir (log);
-      status = read_fir (log, options, seed, first_field, first_line, channel, blkt_ptr, tmp_stage);
+      blkt_ptr = alloc_fir (lines->arena, log);
+      status = read_fir (log, options, lines, first_field, first_line, channel, blkt_ptr, tmp_stage);
       curr_seq_no = tmp_stage->sequence_no;
       break;
     case 62:
-      blkt_ptr = alloc_polynomial (log);
-      status = read_polynomial (log, options, seed, first_field, first_line, channel, blkt_ptr, tmp_stage);
+      blkt_ptr = alloc_polynomial (lines->arena, log);
+      status = read_polynomial (log, options, lines, first_field, first_line, channel, blkt_ptr, tmp_stage);
       curr_seq_no = tmp_stage->sequence_no;
       break;
     default:
@@ -2173,7 +2267,7 @@ read_channel_data (evalresp_logger *log, evalresp_options const *const options,
       {
         channel->nstages++;
         last_stage = this_stage;
-        this_stage = alloc_stage (log);
+        this_stage = alloc_stage (lines->arena, log);
         this_stage->sequence_no = curr_seq_no;
         last_stage->next_stage = this_stage;
         this_stage->first_blkt = blkt_ptr;
@@ -2200,7 +2294,11 @@ read_channel_data (evalresp_logger *log, evalresp_options const *const options,
       if (!read_blkt++)
       {
         this_stage = tmp_stage2;
-        free_stages (channel->first_stage);
+        /* stages in an arena are released with it */
+        if (!lines->arena)
+        {
+          free_stages (channel->first_stage);
+        }
         channel->first_stage = this_stage;
       }
       else if (last_seq_no != curr_seq_no)
@@ -2236,7 +2334,10 @@ read_channel_data (evalresp_logger *log, evalresp_options const *const options,
     }
   }
 
-  free_stages (tmp_stage);
+  if (!lines->arena)
+  {
+    free_stages (tmp_stage);
+  }
 
   return (status && status != EVALRESP_EOF) ? status : (first_field ? EVALRESP_OK : EVALRESP_PAR);
 }
@@ -2412,37 +2513,40 @@ timecmp (evalresp_datetime *dt1, evalresp_datetime *dt2)
 
 #define NO_ENDING_TIME "No Ending Time"
 
+/* the dates of a channel, parsed once for filter_channels() */
+typedef struct
+{
+  evalresp_datetime beg;
+  evalresp_datetime end;
+  int open;       /* no end time */
+  int open_epoch; /* no end time (as checked by in_epoch) */
+  int duration;
+  int next;       /* the next channel with the same SNCL, or -1 */
+} channel_epoch;
+
 static int
-earlier (evalresp_channel *a, evalresp_channel *b)
+earlier (channel_epoch *a, channel_epoch *b)
 {
-  int open_a, open_b;
-  evalresp_datetime a_time, b_time;
-  open_a = !strcmp (a->end_t, NO_ENDING_TIME);
-  open_b = !strcmp (b->end_t, NO_ENDING_TIME);
-  if (open_a || open_b)
+  if (a->open || b->open)
   {
-    if (!open_b)
+    if (!b->open)
     {
       return 0; // if a is open, but b is closed, a is later
     }
-    else if (!open_a)
+    else if (!a->open)
     {
       return 1; //  if b is open, but a is closed, a is earlier
     }
     else
     {
       // otherwise, both open so compare start times
-      parse_datetime (a->beg_t, &a_time);
-      parse_datetime (b->beg_t, &b_time);
-      return timecmp (&a_time, &b_time) <= 0;
+      return timecmp (&a->beg, &b->beg) <= 0;
     }
   }
   else
   {
     // both closed, so compare end times
-    parse_datetime (a->end_t, &a_time);
-    parse_datetime (b->end_t, &b_time);
-    return timecmp (&a_time, &b_time) <= 0;
+    return timecmp (&a->end, &b->end) <= 0;
   }
 }
 
@@ -2466,64 +2570,77 @@ to_epoch (evalresp_datetime *datetime)
 
 #define INDEFINITE INT_MAX
 
-static int
-duration (evalresp_channel *channel)
+static void
+parse_epoch (evalresp_channel *channel, channel_epoch *epoch)
 {
-  evalresp_datetime begin, end;
-  if (!strcmp (channel->end_t, NO_ENDING_TIME))
+  parse_datetime (channel->beg_t, &epoch->beg);
+  epoch->open = !strcmp (channel->end_t, NO_ENDING_TIME);
+  epoch->open_epoch = !strncmp (channel->end_t, NO_ENDING_TIME, 14);
+  if (epoch->open)
   {
-    return INDEFINITE;
+    epoch->duration = INDEFINITE;
   }
   else
   {
-    parse_datetime (channel->beg_t, &begin);
-    parse_datetime (channel->end_t, &end);
-    return (int)(to_epoch (&end) - to_epoch (&begin));
+    parse_datetime (channel->end_t, &epoch->end);
+    epoch->duration = (int)(to_epoch (&epoch->end) - to_epoch (&epoch->beg));
   }
 }
 
 static int
-in_epoch (evalresp_datetime *requirement, const char *beg_t, const char *end_t)
+in_epoch (evalresp_datetime *requirement, channel_epoch *epoch)
 {
-  evalresp_datetime start_time, end_time;
-
-  parse_datetime (beg_t, &start_time);
-  if (strncmp (end_t, NO_ENDING_TIME, 14))
+  if (!epoch->open_epoch)
   {
-    parse_datetime (end_t, &end_time);
-    return ((timecmp (&start_time, requirement) <= 0 && timecmp (&end_time, requirement) > 0));
+    return ((timecmp (&epoch->beg, requirement) <= 0 && timecmp (&epoch->end, requirement) > 0));
   }
   else
   {
-    return ((timecmp (&start_time, requirement) <= 0));
+    return ((timecmp (&epoch->beg, requirement) <= 0));
   }
 }
 
-static int
-channel_matches (evalresp_logger *log, const evalresp_filter *filter, evalresp_channel *channel)
+/* the first SNCL of the filter that matches the names, or NULL.  names
+   that are NULL (not yet known) match anything, so that everything in a
+   network or station can be skipped when nothing there could match */
+static evalresp_sncl *
+matching_sncl (evalresp_logger *log, const evalresp_filter *filter, const char *network,
+               const char *staname, const char *locid, const char *chaname)
 {
   int i;
+  for (i = 0; i < filter->sncls->nscn; ++i)
+  {
+    evalresp_sncl *sncl = filter->sncls->scn_vec[i];
+    if ((!staname || sncl_field_matches (log, sncl->station_glob, sncl->station, staname)) &&
+        (!network || (!strlen (sncl->network) && !strlen (network)) ||
+         sncl_field_matches (log, sncl->network_glob, sncl->network, network)) &&
+        (!locid || sncl_field_matches (log, sncl->locid_glob, sncl->locid, locid)) &&
+        (!chaname || sncl_field_matches (log, sncl->channel_glob, sncl->channel, chaname)))
+    {
+      return sncl;
+    }
+  }
+  return NULL;
+}
+
+static int
+channel_matches (evalresp_logger *log, const evalresp_filter *filter, evalresp_channel *channel,
+                 channel_epoch *epoch)
+{
+  evalresp_sncl *sncl;
   if (filter->datetime && filter->datetime->year)
   {
-    if (!in_epoch (filter->datetime, channel->beg_t, channel->end_t))
+    if (!in_epoch (filter->datetime, epoch))
     {
       return 0;
     }
   }
   if (filter->sncls->nscn)
   {
-    for (i = 0; i < filter->sncls->nscn; ++i)
+    if ((sncl = matching_sncl (log, filter, channel->network, channel->staname, channel->locid, channel->chaname)))
     {
-      evalresp_sncl *sncl = filter->sncls->scn_vec[i];
-      if (reg_string_match (log, channel->staname, sncl->station, "-g") &&
-          ((!strlen (sncl->network) && !strlen (channel->network)) ||
-           reg_string_match (log, channel->network, sncl->network, "-g")) &&
-          reg_string_match (log, channel->locid, sncl->locid, "-g") &&
-          reg_string_match (log, channel->chaname, sncl->channel, "-g"))
-      {
-        sncl->found++;
-        return 1;
-      }
+      sncl->found++;
+      return 1;
     }
     return 0;
   }
@@ -2533,21 +2650,22 @@ channel_matches (evalresp_logger *log, const evalresp_filter *filter, evalresp_c
   }
 }
 
-int
-collect_channels (evalresp_logger *log, const char *seed_or_xml,
-                  evalresp_options const *const options, evalresp_channels **channels)
+/* the first pass over RESP input: read only the channel headers (names
+   and dates), skipping the stages, and note where each channel's data
+   start so that only the channels selected can be read later */
+static int
+index_channels (evalresp_logger *log, resp_lines *lines,
+                evalresp_channels **channels, int **data_starts)
 {
-  const char *read_ptr = seed_or_xml;
   evalresp_channel *channel;
-  int status = EVALRESP_OK;
-  // TODO - first_line and first_field are lookaheads that can be eliminated since
-  // we are reading from char and can easily backstep
+  int status = EVALRESP_OK, blkt_no, fld_no, size = 0, *more;
   char first_line[MAXLINELEN] = "";
 
   *channels = NULL;
+  *data_starts = NULL;
   if (!(status = evalresp_alloc_channels (log, channels)))
   {
-    while (!status && !end_of_string (&read_ptr))
+    while (!status && !end_of_lines (lines))
     {
       if (!(channel = calloc (1, sizeof (*channel))))
       {
@@ -2556,15 +2674,36 @@ collect_channels (evalresp_logger *log, const char *seed_or_xml,
       }
       else
       {
-        if (!(status = read_channel_header (log, &read_ptr, first_line, channel)))
+        if (!(status = read_channel_header (log, lines, first_line, channel)))
         {
-          if (!(status = read_channel_data (log, options, &read_ptr, first_line, channel)))
+          if ((*channels)->nchannels == size)
+          {
+            size = size ? 2 * size : 64;
+            if (!(more = realloc (*data_starts, size * sizeof (*more))))
+            {
+              evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate channel index");
+              status = EVALRESP_MEM;
+            }
+            else
+            {
+              *data_starts = more;
+            }
+          }
+          if (!status)
           {
+            (*data_starts)[(*channels)->nchannels] = lines->next;
             if (!(status = add_channel (log, channel, *channels)))
             {
               channel = NULL; // don't free below because added above
             }
           }
+          /* the data end where the next channel starts (blockette 50) */
+          for (; !status && !end_of_lines (lines) && lines->lines[lines->next].blkt_no != 50; lines->next++)
+            ;
+          if (!status && !end_of_lines (lines))
+          {
+            status = read_line (log, lines, ":", &blkt_no, &fld_no, first_line);
+          }
         }
         evalresp_free_channel (&channel);
       }
@@ -2574,6 +2713,8 @@ collect_channels (evalresp_logger *log, const char *seed_or_xml,
   if (status)
   {
     evalresp_free_channels (channels);
+    free (*data_starts);
+    *data_starts = NULL;
   }
 
   return status;
@@ -2585,129 +2726,965 @@ same_channel (evalresp_channel *a, evalresp_channel *b)
   return !strcmp (a->network, b->network) && !strcmp (a->staname, b->staname) && !strcmp (a->locid, b->locid) && !strcmp (a->chaname, b->chaname);
 }
 
-/* WARNING - for efficiency this mutates channels_in (deleting channels) */
-int
-filter_channels (evalresp_logger *log, const evalresp_filter *filter,
-                 evalresp_channels *channels_in, evalresp_channels **channels_out)
+/* FNV-1a over the network, station, location and channel names */
+static unsigned int
+hash_sncl (const evalresp_channel *channel)
 {
-  int status = EVALRESP_OK, i, j, best_match, warn_user = 0;
-  evalresp_channel *candidate, *other;
+  const char *names[4];
+  const char *c;
+  unsigned int hash = 2166136261u;
+  int i;
 
-  if (!(status = evalresp_alloc_channels (log, channels_out)))
+  names[0] = channel->network;
+  names[1] = channel->staname;
+  names[2] = channel->locid;
+  names[3] = channel->chaname;
+  for (i = 0; i < 4; i++)
   {
-    for (i = 0; i < channels_in->nchannels && !status; ++i)
+    for (c = names[i];; c++)
     {
-      if ((candidate = channels_in->channels[i])) /* this may be null */
-      {
-        /* basic functionality: only ever consider candidates that match the filter */
-        if (!filter || channel_matches (log, filter, candidate))
-        {
-          /* run through remaining channels removing any that this "beats".
-             if it "loses" then stop, but delete this. */
-          best_match = 1;
-          for (j = i + 1; j < channels_in->nchannels && best_match; ++j)
-          {
-            if ((other = channels_in->channels[j])) /* this may be null */
-            {
-              /* other must match the filter too.  we do this in two parts.
-                first the channel must be the same */
-              if (same_channel (candidate, other))
-              {
-                /* second, either there's no date filter or that matches too */
-                if (!(filter && filter->datetime && filter->datetime->year))
-                {
-                  /* when no date filter is specified, we go with the latest data */
-                  if (earlier (candidate, other))
-                  {
-                    best_match = 0;
-                  }
-                }
-                else
-                {
-                  /* note that if other is not in_epoch then it's automatically a loser
-                     and can be deleted.  it's only kept if it matches AND is shorter */
-                  if (in_epoch (filter->datetime, other->beg_t, other->end_t) &&
-                      duration (candidate) >= duration (other))
-                  {
-                    warn_user = 1;
-                    best_match = 0;
-                  }
-                }
-                if (best_match)
-                {
-                  /* candidate beat this, so discard it */
-                  evalresp_free_channel (&channels_in->channels[j]);
-                }
-              }
-            }
-          }
-          if (best_match) /* candidate won */
-          {
-            /* only check channels that we will output */
-            if (!(status = check_channel (log, candidate)))
-            {
-              if (!(status = add_channel (log, candidate, *channels_out)))
-              {
-                channels_in->channels[i] = NULL; /* don't free with channels_in */
-              }
-            }
-          }
-          else /* candidate lost */
-          {
-            evalresp_free_channel (&channels_in->channels[i]);
-          }
-        }
-      }
+      hash ^= (unsigned char)*c;
+      hash *= 16777619u;
+      if (!*c)
+        break;
     }
   }
-
-  if (!status && warn_user)
-  {
-    evalresp_log (log, EV_WARN, EV_WARN,
-                  "Two or more entries match the same SNCL and date; the shortest was used");
-  }
-
-  return status;
+  return hash;
 }
 
-int
-evalresp_char_to_channels (evalresp_logger *log, const char *seed_or_xml,
-                           evalresp_options const *const options,
-                           const evalresp_filter *filter, evalresp_channels **channels)
+/* link the channels with the same SNCL, in order, through epochs[].next;
+   heads[i] is set for the first channel of each SNCL */
+static int
+group_channels (evalresp_logger *log, evalresp_channels *channels,
+                channel_epoch *epochs, int *heads)
 {
-  int status = EVALRESP_OK;
-  evalresp_channels *all_channels = NULL;
+  int *table, *tails = NULL, size, i, slot;
+  evalresp_channel *channel;
 
-  *channels = NULL;
-  if (!(status = collect_channels (log, seed_or_xml, options, &all_channels)))
+  for (size = 16; size < 2 * channels->nchannels; size *= 2)
+    ;
+  if (!(table = malloc (size * sizeof (*table))) || !(tails = malloc (channels->nchannels * sizeof (*tails))))
   {
-    status = filter_channels (log, filter, all_channels, channels);
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate channel index");
+    free (table);
+    free (tails);
+    return EVALRESP_MEM;
+  }
+  for (slot = 0; slot < size; slot++)
+  {
+    table[slot] = -1;
   }
+  for (i = 0; i < channels->nchannels; i++)
+  {
+    epochs[i].next = -1;
+    heads[i] = 0;
+    if ((channel = channels->channels[i]))
+    {
+      /* open addressing, the slots holding the first channel of a SNCL */
+      for (slot = hash_sncl (channel) & (size - 1);
+           table[slot] >= 0 && !same_channel (channels->channels[table[slot]], channel);
+           slot = (slot + 1) & (size - 1))
+        ;
+      if (table[slot] < 0)
+      {
+        table[slot] = tails[i] = i;
+        heads[i] = 1;
+      }
+      else
+      {
+        epochs[tails[table[slot]]].next = i;
+        tails[table[slot]] = i;
+      }
+    }
+  }
+  free (table);
+  free (tails);
+  return EVALRESP_OK;
+}
 
-  evalresp_free_channels (&all_channels);
+/* does a channel replace the best so far with the same SNCL (read before
+   it)?  when no date filter is specified, we go with the latest data.
+   otherwise, a channel that is not in_epoch is automatically a loser, and
+   one that is replaces the best only if it is shorter */
+static int
+replaces_best (const evalresp_filter *filter, channel_epoch *best, channel_epoch *epoch,
+               int *warn_user)
+{
+  if (filter && filter->datetime && filter->datetime->year)
+  {
+    if (in_epoch (filter->datetime, epoch) && best->duration >= epoch->duration)
+    {
+      *warn_user = 1;
+      return 1;
+    }
+    return 0;
+  }
+  return earlier (best, epoch);
+}
+
+/* WARNING - for efficiency this mutates channels (deleting channels): only
+   those to be returned are left (the others are freed and set to NULL).
+   only names and dates are used, so the channel data need not be read.
+
+   channels with the same SNCL compete, in the order they were read: each
+   in turn is the winner so far, until it loses to a later channel (which
+   then wins so far) and the channels it beats are discarded.  the names
+   are hashed and the dates parsed once, so this is linear in the number
+   of channels. */
+static int
+filter_channels (evalresp_logger *log, const evalresp_filter *filter,
+                 evalresp_channels *channels)
+{
+  int status = EVALRESP_OK, i, j, best, warn_user = 0, *heads = NULL;
+  channel_epoch *epochs = NULL;
+
+  if (!channels->nchannels)
+  {
+    return status;
+  }
+  if (!(epochs = calloc (channels->nchannels, sizeof (*epochs))) || !(heads = calloc (channels->nchannels, sizeof (*heads))))
+  {
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate channel index");
+    status = EVALRESP_MEM;
+  }
+  else if (!(status = group_channels (log, channels, epochs, heads)))
+  {
+    for (i = 0; i < channels->nchannels; ++i)
+    {
+      if (channels->channels[i])
+      {
+        parse_epoch (channels->channels[i], &epochs[i]);
+      }
+    }
+    for (i = 0; i < channels->nchannels; ++i)
+    {
+      if (!heads[i])
+      {
+        continue;
+      }
+      for (best = -1, j = i; j >= 0; j = epochs[j].next)
+      {
+        if (best < 0)
+        {
+          /* basic functionality: only ever consider candidates that match the filter */
+          if (!filter || channel_matches (log, filter, channels->channels[j], &epochs[j]))
+          {
+            best = j;
+          }
+          else
+          {
+            evalresp_free_channel (&channels->channels[j]);
+          }
+        }
+        else if (replaces_best (filter, &epochs[best], &epochs[j], &warn_user))
+        {
+          evalresp_free_channel (&channels->channels[best]);
+          /* the new best is checked against the filter, as a candidate */
+          best = -1;
+          if (!filter || channel_matches (log, filter, channels->channels[j], &epochs[j]))
+          {
+            best = j;
+          }
+          else
+          {
+            evalresp_free_channel (&channels->channels[j]);
+          }
+        }
+        else
+        {
+          evalresp_free_channel (&channels->channels[j]);
+        }
+      }
+    }
+  }
+  free (epochs);
+  free (heads);
+
+  if (!status && warn_user)
+  {
+    evalresp_log (log, EV_WARN, EV_WARN,
+                  "Two or more entries match the same SNCL and date; the shortest was used");
+  }
+  return status;
+}
+
+typedef struct
+{
+  evalresp_options const *options;
+  resp_lines *lines;             /* shared, read only */
+  int *data_starts;              /* the line after each header */
+  const x2r_channel **xml;       /* or the StationXML of each channel */
+  evalresp_channel **read;       /* the selected channels, in input order */
+  evalresp_arena **arenas;       /* where the stages of each are allocated */
+} read_work;
+
+/* read_channel_data(), saying which line of the input was read last on
+   error, since the messages of the parsers give values rather than lines */
+static int
+read_numbered_data (evalresp_logger *log, evalresp_options const *const options,
+                    resp_lines *lines, char *first_line, evalresp_channel *channel)
+{
+  int status;
+
+  if ((status = read_channel_data (log, options, lines, first_line, channel)) && lines->nlines)
+  {
+    evalresp_log (log, EV_ERROR, EV_ERROR, "%s.%s.%s.%s: error reading the channel near line %d",
+                  channel->network, channel->staname, channel->locid, channel->chaname,
+                  lines->lines[lines->next > 0 ? lines->next - 1 : 0].line_no);
+  }
+  return status;
+}
+
+/* read (and check) the data of a selected channel.  each task has its own
+   cursor into the shared lines (or converts its own part of the StationXML
+   model), and its own arena, so channels can be read in parallel */
+static int
+read_task (evalresp_logger *log, void *data, int i)
+{
+  read_work *work = data;
+  resp_lines lines;
+  char first_line[MAXLINELEN];
+  int status;
+
+  if (!(status = new_arena (log, &work->arenas[i])))
+  {
+    if (work->xml)
+    {
+      status = x2r_channel_data (log, work->options, work->arenas[i], work->xml[i], work->read[i]);
+    }
+    else
+    {
+      lines = *work->lines;
+      lines.next = work->data_starts[i];
+      lines.arena = work->arenas[i];
+      status = read_numbered_data (log, work->options, &lines, first_line, work->read[i]);
+    }
+    if (!status)
+    {
+      /* only check channels that we will output */
+      status = check_channel (log, work->arenas[i], work->read[i]);
+    }
+  }
+  return status;
+}
+
+/* select channels by name and date, then read the data of only those (moved
+   to the front, in order, with their data_starts or xml) into channels.
+   the data of all_channels are not freed with it */
+static int
+read_selected (evalresp_logger *log, evalresp_options const *const options,
+               const evalresp_filter *filter, evalresp_channels *all_channels,
+               read_work *work, evalresp_channels **channels)
+{
+  int status = EVALRESP_OK, i, n, ndone = 0;
+  evalresp_channel **selected, *copy;
+
+  work->options = options;
+  work->arenas = NULL;
+  if (!(status = evalresp_alloc_channels (log, channels)) && !(status = new_arena (log, &(*channels)->arena)) &&
+      !(status = filter_channels (log, filter, all_channels)))
+  {
+    selected = all_channels->channels;
+    for (i = n = 0; i < all_channels->nchannels; ++i)
+    {
+      if (selected[i])
+      {
+        if (work->data_starts)
+        {
+          work->data_starts[n] = work->data_starts[i];
+        }
+        if (work->xml)
+        {
+          work->xml[n] = work->xml[i];
+        }
+        selected[n] = selected[i];
+        if (n++ != i)
+        {
+          selected[i] = NULL;
+        }
+      }
+    }
+    /* the channels are independent, so can be read in parallel;
+       messages are logged, and the first failure returned, as if they
+       had been read in order */
+    work->read = selected;
+    if (!(work->arenas = calloc (n + 1, sizeof (*work->arenas))))
+    {
+      evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate arenas");
+      status = EVALRESP_MEM;
+    }
+    else
+    {
+      status = parallel_for (log, options ? options->nthreads : 1, n, read_task, work, &ndone);
+      /* the collection owns all the memory read, and a copy of each
+         channel, so is freed in one go */
+      for (i = 0; i < n; ++i)
+      {
+        join_arenas ((*channels)->arena, &work->arenas[i]);
+      }
+      for (i = 0; i < ndone && (copy = arena_calloc (log, (*channels)->arena, "channel", 1, sizeof (*copy))); ++i)
+      {
+        *copy = *selected[i];
+        if (add_channel (log, copy, *channels))
+        {
+          break;
+        }
+      }
+      if (!status && i < ndone)
+      {
+        status = EVALRESP_MEM;
+      }
+      for (i = 0; i < n; ++i)
+      {
+        selected[i]->first_stage = NULL; /* don't free with all_channels */
+      }
+    }
+  }
+
+  free (work->arenas);
   if (status)
   {
     evalresp_free_channels (channels);
   }
+  return status;
+}
+
+static int
+text_to_channels (evalresp_logger *log, const char *seed, size_t seed_len,
+                  evalresp_options const *const options,
+                  const evalresp_filter *filter, evalresp_channels **channels)
+{
+  int status = EVALRESP_OK, *data_starts = NULL;
+  evalresp_channels *all_channels = NULL;
+  resp_lines lines;
+  read_work work;
+
+  *channels = NULL;
+  if (!(status = tokenize_resp (log, seed, seed_len, &lines)))
+  {
+    if (!(status = index_channels (log, &lines, &all_channels, &data_starts)))
+    {
+      work.lines = &lines;
+      work.data_starts = data_starts;
+      work.xml = NULL;
+      status = read_selected (log, options, filter, all_channels, &work, channels);
+    }
+    free_resp_lines (&lines);
+  }
+
+  free (data_starts);
+  evalresp_free_channels (&all_channels);
+
+  return status;
+}
+
+/* the channels read from StationXML: the headers, and the model of each
+   (kept until the data of those selected are converted) */
+typedef struct
+{
+  const evalresp_filter *filter;
+  evalresp_channels *channels;
+  x2r_channel *xml;
+  int size;
+} xml_index;
+
+/* is a StationXML network, station or channel (given only names and
+   dates) possibly wanted?  those that cannot match the filter are skipped
+   as they are read.  this does not change the channels selected, because
+   a channel that does not match never displaces one that does (see
+   filter_channels) */
+static int
+select_xml_channel (evalresp_logger *log, const char *net, const char *stn, const x2r_channel *xml, void *data)
+{
+  const evalresp_filter *filter = ((xml_index *)data)->filter;
+  evalresp_channel channel;
+  channel_epoch epoch;
+
+  memset (&channel, 0, sizeof (channel));
+  if (x2r_channel_header (log, net, stn ? stn : "", xml, &channel))
+  {
+    return 1; /* the error is reported when the channel is read */
+  }
+  if (xml && filter->datetime && filter->datetime->year)
+  {
+    parse_epoch (&channel, &epoch);
+    if (!in_epoch (filter->datetime, &epoch))
+    {
+      return 0;
+    }
+  }
+  return !filter->sncls->nscn ||
+         matching_sncl (log, filter, channel.network, stn ? channel.staname : NULL,
+                        xml ? channel.locid : NULL, xml ? channel.chaname : NULL);
+}
+
+/* keep each channel as it is read from StationXML */
+static int
+index_xml_channel (evalresp_logger *log, const char *net, const char *stn, x2r_channel *xml, void *data)
+{
+  xml_index *index = data;
+  evalresp_channel *channel;
+  x2r_channel *more;
+  int status = EVALRESP_OK;
+
+  if (index->channels->nchannels == index->size)
+  {
+    index->size = index->size ? 2 * index->size : 64;
+    if (!(more = realloc (index->xml, index->size * sizeof (*more))))
+    {
+      evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate channel index");
+      return EVALRESP_MEM;
+    }
+    index->xml = more;
+  }
+  if (!(channel = calloc (1, sizeof (*channel))))
+  {
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate memory for channel");
+    status = EVALRESP_MEM;
+  }
+  else if ((status = x2r_channel_header (log, net, stn, xml, channel)) || (status = add_channel (log, channel, index->channels)))
+  {
+    evalresp_free_channel (&channel);
+  }
+  else
+  {
+    /* the model is kept, rather than freed by the reader */
+    index->xml[index->channels->nchannels - 1] = *xml;
+    memset (xml, 0, sizeof (*xml));
+  }
+  return status;
+}
+
+/* StationXML is read a channel at a time (never as a whole document),
+   skipping what the filter excludes, and the model of each is converted
+   directly to a channel (rather than printed as RESP and read back) */
+static int
+xml_to_channels (evalresp_logger *log, FILE *file, evalresp_options const *const options,
+                 const evalresp_filter *filter, evalresp_channels **channels)
+{
+  int status = EVALRESP_OK, i;
+  xml_index index;
+  read_work work;
+
+  *channels = NULL;
+  memset (&index, 0, sizeof (index));
+  index.filter = filter;
+  work.xml = NULL;
+  if (!(status = evalresp_alloc_channels (log, &index.channels)) &&
+      !(status = x2r_station_service_stream (log, file, filter ? select_xml_channel : NULL,
+                                             index_xml_channel, &index)))
+  {
+    if (!(work.xml = calloc (index.channels->nchannels + 1, sizeof (*work.xml))))
+    {
+      evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate channel index");
+      status = EVALRESP_MEM;
+    }
+    else
+    {
+      for (i = 0; i < index.channels->nchannels; ++i)
+      {
+        work.xml[i] = &index.xml[i];
+      }
+      work.lines = NULL;
+      work.data_starts = NULL;
+      status = read_selected (log, options, filter, index.channels, &work, channels);
+    }
+  }
 
+  for (i = 0; index.channels && i < index.channels->nchannels; ++i)
+  {
+    status = x2r_free_channel (&index.xml[i], status);
+  }
+  free (index.xml);
+  free (work.xml);
+  evalresp_free_channels (&index.channels);
   return status;
 }
 
+int
+evalresp_char_to_channels (evalresp_logger *log, const char *seed_or_xml,
+                           evalresp_options const *const options,
+                           const evalresp_filter *filter, evalresp_channels **channels)
+{
+  return text_to_channels (log, seed_or_xml, strlen (seed_or_xml), options, filter, channels);
+}
+
+/* map the rest of a regular file into memory, rather than copying it.
+   returns 0 (and maps nothing) when that is not possible (pipes,
+   terminals, empty files, Windows), so the caller can read instead. */
+int
+map_file (FILE *file, void **map, size_t *map_len, const char **seed, size_t *seed_len)
+{
+#ifdef EVALRESP_MMAP
+  struct stat info;
+  long offset;
+
+  /* the mapping sees the file, not data buffered in the stream */
+  fflush (file);
+  if (fstat (fileno (file), &info) || !S_ISREG (info.st_mode) || (offset = ftell (file)) < 0 || offset >= info.st_size)
+  {
+    return 0;
+  }
+  if ((*map = mmap (NULL, info.st_size, PROT_READ, MAP_PRIVATE, fileno (file), 0)) == MAP_FAILED)
+  {
+    return 0;
+  }
+  madvise (*map, info.st_size, MADV_SEQUENTIAL);
+  *map_len = info.st_size;
+  *seed = (const char *)*map + offset;
+  *seed_len = info.st_size - offset;
+  /* as if the file had been read */
+  fseek (file, 0L, SEEK_END);
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+void
+unmap_file (void *map, size_t map_len)
+{
+#ifdef EVALRESP_MMAP
+  munmap (map, map_len);
+#endif
+}
+
 int
 evalresp_file_to_channels (evalresp_logger *log, FILE *file,
                            evalresp_options const *const options,
                            const evalresp_filter *filter, evalresp_channels **channels)
 {
   char *seed = NULL;
+  const char *mapped;
+  void *map;
+  size_t map_len, seed_len;
   int status = EVALRESP_OK;
-  if (!(status = file_to_char (log, file, &seed)))
+
+  if (map_file (file, &map, &map_len, &mapped, &seed_len))
+  {
+    status = text_to_channels (log, mapped, seed_len, options, filter, channels);
+    unmap_file (map, map_len);
+  }
+  else if (!(status = file_to_char (log, file, &seed)))
   {
-    status = evalresp_char_to_channels (log, seed, options, filter, channels);
+    status = text_to_channels (log, seed, strlen (seed), options, filter, channels);
   }
   free (seed);
   return status;
 }
 
+/* the streaming reader: the input is read through a fixed window, one
+   channel (from its blockette 50 to the next) at a time.  a channel's
+   header is read as soon as it is complete, but since a later epoch may
+   replace it, the text of the best channel so far is kept until the input
+   moves on to another SNCL; then it is read and passed on.  so memory is
+   that of a single channel, whatever the size of the input.
+
+   this relies on the epochs of each SNCL being together, as in RESP
+   exports (rdseed, IRIS web services).  where an SNCL appears again after
+   another, each run of its epochs is selected separately (as if they were
+   separate inputs), with a warning, since the names of the SNCLs passed
+   on are kept.  otherwise the channels are those of
+   evalresp_file_to_channels, in the same order. */
+
+#define RESP_WINDOW 65536
+
+typedef struct
+{
+  evalresp_channel *header; /* names and dates (NULL before the first) */
+  channel_epoch epoch;
+  char *text;               /* the channel's lines (NULL once replaced by one not selected) */
+  size_t len;
+  int data_start;           /* the line after the header in text */
+  int line_no;              /* of the first line of text, in the input */
+} kept_channel;
+
+typedef struct
+{
+  unsigned int hash;        /* hash_sncl() of the channel */
+  char *name;               /* NET.STA.LOC.CHA (NULL if the slot is free) */
+} passed_sncl;
+
+typedef struct
+{
+  FILE *file;
+  char window[RESP_WINDOW]; /* unread input is window[next] to window[end] */
+  size_t next, end;
+  int eof;
+  int mid_line;             /* the last piece read did not end the line */
+  int line_no;              /* of the last piece read, from 1 */
+  char *text;               /* the lines of the current channel */
+  size_t len, size;
+  int text_line_no;         /* of the first line of text */
+  int header_seen;          /* text has a blockette 50 line */
+  int data_seen;            /* and other lines after it */
+  kept_channel best;        /* the best so far of the current SNCL */
+  passed_sncl *passed;      /* the SNCLs passed on, by open addressing */
+  int npassed, passed_size;
+  evalresp_options const *options;
+  evalresp_channel_func func;
+  void *data;
+  int warn_user;
+  int warned;
+} resp_stream;
+
+/* the next line from the window, refilled as necessary; a line longer
+   than the window is returned in pieces */
+static int
+next_piece (evalresp_logger *log, resp_stream *stream, const char **piece, size_t *len, int *status)
+{
+  const char *nl;
+  size_t n;
+
+  for (;;)
+  {
+    if (stream->next < stream->end && (nl = memchr (stream->window + stream->next, '\n', stream->end - stream->next)))
+    {
+      *piece = stream->window + stream->next;
+      *len = nl + 1 - *piece;
+      stream->next += *len;
+      return 1;
+    }
+    if (stream->eof || (!stream->next && stream->end == RESP_WINDOW))
+    {
+      if (stream->next == stream->end)
+      {
+        return 0;
+      }
+      *piece = stream->window + stream->next;
+      *len = stream->end - stream->next;
+      stream->next = stream->end;
+      return 1;
+    }
+    /* move the start of the line to the front and refill */
+    memmove (stream->window, stream->window + stream->next, stream->end - stream->next);
+    stream->end -= stream->next;
+    stream->next = 0;
+    n = fread (stream->window + stream->end, 1, RESP_WINDOW - stream->end, stream->file);
+    stream->end += n;
+    if (ferror (stream->file))
+    {
+      evalresp_log (log, EV_ERROR, EV_ERROR, "Error reading input");
+      *status = EVALRESP_IO;
+      return 0;
+    }
+    stream->eof = !n;
+  }
+}
+
+/* the blockette of a line, as seen by tokenize_resp (-2 if it is skipped) */
+static int
+piece_blkt_no (const char *piece, size_t len)
+{
+  resp_line line;
+  const char *p;
+
+  for (; len > 1 && (piece[len - 1] == '\n' || piece[len - 1] == '\r'); len--)
+    ;
+  for (p = piece; p < piece + len && IS_BLANK (*p); p++)
+    ;
+  if (*piece == '#' || p == piece + len)
+  {
+    return -2;
+  }
+  line.start = piece;
+  line.length = len;
+  read_pref (&line);
+  return line.blkt_no;
+}
+
+static void
+sncl_name (const evalresp_channel *channel, char *name)
+{
+  snprintf (name, NETLEN + STALEN + LOCIDLEN + CHALEN, "%s.%s.%s.%s",
+            channel->network, channel->staname, channel->locid, channel->chaname);
+}
+
+/* the slot of the SNCL of the channel, or the free slot where it goes */
+static int
+find_passed (resp_stream *stream, const evalresp_channel *channel)
+{
+  char name[NETLEN + STALEN + LOCIDLEN + CHALEN];
+  unsigned int hash = hash_sncl (channel);
+  int slot;
+
+  sncl_name (channel, name);
+  for (slot = hash & (stream->passed_size - 1);
+       stream->passed[slot].name && (stream->passed[slot].hash != hash || strcmp (stream->passed[slot].name, name));
+       slot = (slot + 1) & (stream->passed_size - 1))
+    ;
+  return slot;
+}
+
+static int
+was_passed (resp_stream *stream, const evalresp_channel *channel)
+{
+  return stream->npassed && stream->passed[find_passed (stream, channel)].name;
+}
+
+static int
+note_passed (evalresp_logger *log, resp_stream *stream, const evalresp_channel *channel)
+{
+  passed_sncl *table;
+  int size, i, slot;
+
+  if (2 * (stream->npassed + 1) > stream->passed_size)
+  {
+    size = stream->passed_size ? 2 * stream->passed_size : 16;
+    if (!(table = calloc (size, sizeof (*table))))
+    {
+      evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate channel index");
+      return EVALRESP_MEM;
+    }
+    for (i = 0; i < stream->passed_size; i++)
+    {
+      if (stream->passed[i].name)
+      {
+        for (slot = stream->passed[i].hash & (size - 1); table[slot].name; slot = (slot + 1) & (size - 1))
+          ;
+        table[slot] = stream->passed[i];
+      }
+    }
+    free (stream->passed);
+    stream->passed = table;
+    stream->passed_size = size;
+  }
+  slot = find_passed (stream, channel);
+  if (!stream->passed[slot].name)
+  {
+    if (!(stream->passed[slot].name = malloc (NETLEN + STALEN + LOCIDLEN + CHALEN)))
+    {
+      evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate channel index");
+      return EVALRESP_MEM;
+    }
+    sncl_name (channel, stream->passed[slot].name);
+    stream->passed[slot].hash = hash_sncl (channel);
+    stream->npassed++;
+  }
+  return EVALRESP_OK;
+}
+
+/* lines are numbered within the text of a channel; number them as in
+   the input, where the text starts at line first */
+static void
+number_lines (resp_lines *lines, int first)
+{
+  int i;
+  for (i = 0; i < lines->nlines; i++)
+  {
+    lines->lines[i].line_no += first - 1;
+  }
+}
+
+/* read the data of the best channel of the SNCL that ended and pass it on
+   (if it was selected) */
+static int
+pass_best (evalresp_logger *log, resp_stream *stream)
+{
+  kept_channel *best = &stream->best;
+  resp_lines lines;
+  char first_line[MAXLINELEN];
+  int status = EVALRESP_OK;
+
+  if (best->text)
+  {
+    if (stream->warn_user && !stream->warned)
+    {
+      evalresp_log (log, EV_WARN, EV_WARN,
+                    "Two or more entries match the same SNCL and date; the shortest was used");
+      stream->warned = 1;
+    }
+    if (!(status = tokenize_resp (log, best->text, best->len, &lines)))
+    {
+      number_lines (&lines, best->line_no);
+      lines.next = best->data_start;
+      if (!(status = read_numbered_data (log, stream->options, &lines, first_line, best->header)) &&
+          !(status = check_channel (log, NULL, best->header)) &&
+          !(status = note_passed (log, stream, best->header)))
+      {
+        status = stream->func (log, best->header, stream->data);
+      }
+      free_resp_lines (&lines);
+    }
+  }
+  free (best->text);
+  evalresp_free_channel (&best->header);
+  memset (best, 0, sizeof (*best));
+  return status;
+}
+
+/* compete a channel header (taken) against the best so far with the same
+   SNCL, as filter_channels() does, keeping the text if it wins.  a
+   different SNCL ends the last, so its best is passed on first */
+static int
+keep_channel (evalresp_logger *log, const evalresp_filter *filter, resp_stream *stream,
+              evalresp_channel **header, int data_start)
+{
+  kept_channel *kept = &stream->best;
+  channel_epoch epoch;
+  int status = EVALRESP_OK, matches;
+
+  parse_epoch (*header, &epoch);
+  if (kept->header && !same_channel (kept->header, *header) && (status = pass_best (log, stream)))
+  {
+    evalresp_free_channel (header);
+    return status;
+  }
+  if (kept->text && !replaces_best (filter, &kept->epoch, &epoch, &stream->warn_user))
+  {
+    evalresp_free_channel (header);
+    return status;
+  }
+  /* a new candidate, or it replaces the best so far */
+  matches = !filter || channel_matches (log, filter, *header, &epoch);
+  if (!kept->header && !matches)
+  {
+    evalresp_free_channel (header);
+    return status;
+  }
+  if (!kept->header && was_passed (stream, *header))
+  {
+    evalresp_log (log, EV_WARN, EV_WARN,
+                  "%s.%s.%s.%s appears again after other channels; its epochs there are selected separately",
+                  (*header)->network, (*header)->staname, (*header)->locid, (*header)->chaname);
+  }
+  free (kept->text);
+  kept->text = NULL;
+  evalresp_free_channel (&kept->header);
+  kept->header = *header;
+  *header = NULL;
+  kept->epoch = epoch;
+  kept->data_start = data_start;
+  kept->line_no = stream->text_line_no;
+  if (matches)
+  {
+    if (!(kept->text = malloc (stream->len)))
+    {
+      evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate channel text");
+      return EVALRESP_MEM;
+    }
+    memcpy (kept->text, stream->text, stream->len);
+    kept->len = stream->len;
+  }
+  return status;
+}
+
+/* read the header of the channel in the text */
+static int
+stream_channel (evalresp_logger *log, const evalresp_filter *filter, resp_stream *stream)
+{
+  evalresp_channels *headers = NULL;
+  int status, i, *data_starts = NULL;
+  resp_lines lines;
+
+  if (!(status = tokenize_resp (log, stream->text, stream->len, &lines)))
+  {
+    number_lines (&lines, stream->text_line_no);
+    if (!(status = index_channels (log, &lines, &headers, &data_starts)))
+    {
+      for (i = 0; i < headers->nchannels && !status; ++i)
+      {
+        status = keep_channel (log, filter, stream, &headers->channels[i], data_starts[i]);
+      }
+    }
+    free_resp_lines (&lines);
+  }
+  free (data_starts);
+  evalresp_free_channels (&headers);
+  stream->len = 0;
+  stream->header_seen = stream->data_seen = 0;
+  return status;
+}
+
+static int
+append_piece (evalresp_logger *log, resp_stream *stream, const char *piece, size_t len)
+{
+  char *more;
+  size_t size;
+
+  if (stream->len + len > stream->size)
+  {
+    for (size = stream->size ? stream->size : RESP_WINDOW; size < stream->len + len; size *= 2)
+      ;
+    if (!(more = realloc (stream->text, size)))
+    {
+      evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate channel text");
+      return EVALRESP_MEM;
+    }
+    stream->text = more;
+    stream->size = size;
+  }
+  memcpy (stream->text + stream->len, piece, len);
+  stream->len += len;
+  return EVALRESP_OK;
+}
+
+int
+evalresp_stream_to_channels (evalresp_logger *log, FILE *file,
+                             evalresp_options const *const options,
+                             const evalresp_filter *filter, evalresp_channel_func func, void *data)
+{
+  resp_stream *stream;
+  const char *piece;
+  size_t len;
+  int status = EVALRESP_OK, blkt_no, i;
+
+  if (!(stream = calloc (1, sizeof (*stream))))
+  {
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate stream");
+    return EVALRESP_MEM;
+  }
+  stream->file = file;
+  stream->options = options;
+  stream->func = func;
+  stream->data = data;
+  while (!status && next_piece (log, stream, &piece, &len, &status))
+  {
+    stream->line_no += !stream->mid_line;
+    if (!stream->mid_line && (blkt_no = piece_blkt_no (piece, len)) != -2)
+    {
+      /* a channel ends where the next starts (blockette 50) */
+      if (blkt_no == 50)
+      {
+        if (stream->data_seen)
+        {
+          status = stream_channel (log, filter, stream);
+        }
+        stream->header_seen = 1;
+      }
+      else
+      {
+        stream->data_seen = stream->header_seen;
+      }
+    }
+    stream->mid_line = piece[len - 1] != '\n';
+    if (!status)
+    {
+      stream->text_line_no = stream->len ? stream->text_line_no : stream->line_no;
+      status = append_piece (log, stream, piece, len);
+    }
+  }
+  if (!status && stream->len)
+  {
+    status = stream_channel (log, filter, stream);
+  }
+  if (!status)
+  {
+    status = pass_best (log, stream);
+  }
+
+  free (stream->best.text);
+  evalresp_free_channel (&stream->best.header);
+  for (i = 0; i < stream->passed_size; i++)
+  {
+    free (stream->passed[i].name);
+  }
+  free (stream->passed);
+  free (stream->text);
+  free (stream);
+  return status;
+}
+
 /* Detection FDSN StationXML by searching the first 255 bytes of the
  * file for "<FDSNStationXML".
  *
@@ -2746,8 +3723,6 @@ evalresp_filename_to_channels (evalresp_logger *log, const char *filename, evalr
 
   if (!(status = open_file (log, filename, &file)))
   {
-    FILE *temp_file = NULL;
-
     /* Attempt to detect StationXML if not forced */
     if (options != NULL && options->station_xml == 0)
     {
@@ -2759,17 +3734,9 @@ evalresp_filename_to_channels (evalresp_logger *log, const char *filename, evalr
 
     if (options != NULL && station_xml)
     {
-      if (EVALRESP_OK == (status = evalresp_xml_stream_to_resp_file (log, 1, file, NULL, &temp_file)))
-      {
-        if (temp_file != NULL)
-        {
-          fclose (file);
-          file = temp_file;
-          temp_file = NULL;
-        }
-      }
+      status = xml_to_channels (log, file, options, filter, channels);
     }
-    if (EVALRESP_OK == status)
+    else
     {
       status = evalresp_file_to_channels (log, file, options, filter, channels);
     }
@@ -2902,6 +3869,16 @@ evalresp_add_sncl_text (evalresp_logger *log, evalresp_filter *filter,
       {
         sncl->locid = strdup (locid ? locid : "*");
       }
+      if (!sncl->station || !sncl->network || !sncl->channel || !sncl->locid)
+      {
+        evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate sncl");
+        status = EVALRESP_MEM;
+      }
+      /* compiled once here, rather than for every channel read */
+      else if (!(status = compile_glob (log, sncl->station, &sncl->station_glob)) && !(status = compile_glob (log, sncl->network, &sncl->network_glob)) && !(status = compile_glob (log, sncl->locid, &sncl->locid_glob)))
+      {
+        status = compile_glob (log, sncl->channel, &sncl->channel_glob);
+      }
     }
   }
   return status;
@@ -3148,25 +4125,168 @@ parse_double (evalresp_logger *log, const char *name, const char *str, double *v
   return status;
 }
 
+/* numbers are lexed by hand rather than matched with a regular expression
+   (compiled for every field) and then converted again with atoi / atof.
+   the syntax accepted is that of the old patterns:
+     integer  ^[-+]?[0-9]+$
+     real     ^[-+]?([0-9]+\.?[0-9]*|[0-9]*\.[0-9]+)([Ee][-+]?[0-9]+)?$
+   and the conversion does not depend on the locale. */
+
+#define IS_DIGIT(c) ((c) >= '0' && (c) <= '9')
+
+/* powers of ten that are exact in a double */
+static const double exact_powers[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
 int
-is_int (const char *test, evalresp_logger *log)
+lex_int (const char *text, int *value)
 {
-  char ipattern[MAXLINELEN];
+  const char *p = text;
+  long result = 0;
+  int negative = 0;
 
-  /* first check to see if is an integer prefixed by a plus or minus.  If not
-     then check to see if is simply an integer */
+  if (*p == '-' || *p == '+')
+  {
+    negative = *p++ == '-';
+  }
+  if (!IS_DIGIT (*p))
+  {
+    return 0;
+  }
+  for (; IS_DIGIT (*p); p++)
+  {
+    /* saturate rather than overflow */
+    if (result <= (long)INT_MAX + 1)
+    {
+      result = 10 * result + (*p - '0');
+    }
+  }
+  if (*p)
+  {
+    return 0;
+  }
+  if (negative)
+  {
+    result = -result;
+  }
+  *value = result > INT_MAX ? INT_MAX : result < INT_MIN ? INT_MIN : (int)result;
+  return 1;
+}
+
+/* the digits (without the point) and the decimal exponent, for strtod;
+   there is no decimal point so the locale does not matter */
+static double
+slow_double (const char *text, size_t len, int exponent)
+{
+  char buffer[128], *copy = buffer, *q;
+  double result;
+
+  if (len + 16 > sizeof (buffer) && !(copy = malloc (len + 16)))
+  {
+    return atof (text);
+  }
+  for (q = copy; len--; text++)
+  {
+    if (*text != '.')
+    {
+      *q++ = *text;
+    }
+  }
+  sprintf (q, "e%d", exponent);
+  result = strtod (copy, NULL);
+  if (copy != buffer)
+  {
+    free (copy);
+  }
+  return result;
+}
+
+int
+lex_double (const char *text, double *value)
+{
+  const char *p = text, *end;
+  unsigned long long mantissa = 0;
+  int nsig = 0, ndigits = 0, point = 0, nfrac = 0, exponent = 0, negative = 0, exp_negative = 0;
+
+  if (*p == '-' || *p == '+')
+  {
+    negative = *p++ == '-';
+  }
+  for (; IS_DIGIT (*p) || (*p == '.' && !point); p++)
+  {
+    if (*p == '.')
+    {
+      point = 1;
+      continue;
+    }
+    ndigits++;
+    nfrac += point;
+    if (nsig || *p != '0')
+    {
+      if (++nsig <= 19)
+      {
+        mantissa = 10 * mantissa + (*p - '0');
+      }
+    }
+  }
+  end = p;
+  if (!ndigits)
+  {
+    return 0;
+  }
+  if (*p == 'E' || *p == 'e')
+  {
+    p++;
+    if (*p == '-' || *p == '+')
+    {
+      exp_negative = *p++ == '-';
+    }
+    if (!IS_DIGIT (*p))
+    {
+      return 0;
+    }
+    for (; IS_DIGIT (*p); p++)
+    {
+      if (exponent < 100000)
+      {
+        exponent = 10 * exponent + (*p - '0');
+      }
+    }
+  }
+  if (*p)
+  {
+    return 0;
+  }
+  exponent = (exp_negative ? -exponent : exponent) - nfrac;
+
+  /* a mantissa and power of ten that are both exact give a correctly
+     rounded result with a single operation (as strtod would) */
+  if (nsig <= 19 && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22)
+  {
+    *value = exponent < 0 ? (double)mantissa / exact_powers[-exponent] : (double)mantissa * exact_powers[exponent];
+    if (negative)
+    {
+      *value = -*value;
+    }
+  }
+  else
+  {
+    *value = slow_double (text, end - text, exponent);
+  }
+  return 1;
+}
 
-  strncpy (ipattern, "^[-+]?[0-9]+$", MAXLINELEN);
-  return (reg_string_match (log, test, ipattern, "-r"));
+int
+is_int (const char *test, evalresp_logger *log)
+{
+  int value;
+  return lex_int (test, &value);
 }
 
 int
 is_real (const char *test, evalresp_logger *log)
 {
-  char fpattern[MAXLINELEN];
-  strncpy (fpattern, "^[-+]?[0-9]+\\.?[0-9]*[Ee][-+]?[0-9]+$", MAXLINELEN);
-  strcat (fpattern, "|^[-+]?[0-9]*\\.[0-9]+[Ee][-+]?[0-9]+$");
-  strcat (fpattern, "|^[-+]?[0-9]+\\.?[0-9]*$");
-  strcat (fpattern, "|^[-+]?[0-9]*\\.[0-9]+$");
-  return (reg_string_match (log, test, fpattern, "-r"));
+  double value;
+  return lex_double (test, &value);
 }
@@ -7,17 +7,39 @@
 #include "evalresp_log/log.h"
 #include "public_api.h"
 
+/* a data line of RESP input (comments and blank lines are dropped) */
+typedef struct
+{
+  const char *start; /* first character, in the input text */
+  int length;        /* number of characters, without the end of line */
+  int blkt_no;       /* from the "BnnnFnn" prefix, -1 if not valid */
+  int fld_no;
+  int line_no;       /* in the input text, from 1 */
+} resp_line;
+
+/* the data lines of RESP input and the next to read */
+typedef struct
+{
+  resp_line *lines;
+  int nlines;
+  int next;
+  struct evalresp_arena_s *arena; /* where the stages read are allocated (NULL for the heap) */
+} resp_lines;
+
 // private functions exposed only for testing
 
+int
+tokenize_resp (evalresp_logger *log, const char *seed, size_t seed_len, resp_lines *lines);
+
 void
-slurp_line (const char **seed, char *line, int maxlen);
+free_resp_lines (resp_lines *lines);
 
 int
-find_line (evalresp_logger *log, const char **seed, char *sep,
+find_line (evalresp_logger *log, resp_lines *lines, char *sep,
            int blkt_no, int fld_no, char *return_line);
 
 int
-find_field (evalresp_logger *log, const char **seed, char *sep,
+find_field (evalresp_logger *log, resp_lines *lines, char *sep,
             int blkt_no, int fld_no, int fld_wanted, char *return_field);
 
 int
@@ -29,4 +51,9 @@ file_to_char (evalresp_logger *log, FILE *in, char **seed);
 time_t
 to_epoch (evalresp_datetime *datetime);
 
+// private functions shared with the StationXML conversion
+
+int
+parse_units (evalresp_logger *log, evalresp_options const *const options, char *line, evalresp_channel *channel, int *units);
+
 #endif
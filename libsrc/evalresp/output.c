@@ -223,7 +223,7 @@ evalresp_response_to_file (evalresp_logger *log, const evalresp_response *respon
 }
 
 int
-evalresp_channel_to_log (evalresp_logger *log, evalresp_options const *const options, evalresp_channel *const channel)
+evalresp_channel_to_log (evalresp_logger *log, evalresp_options const *const options, evalresp_channel const *const channel)
 {
   evalresp_stage *this_stage, *last_stage, *first_stage;
   evalresp_blkt *this_blkt;
@@ -188,6 +188,13 @@ enum stage_types
   POLYNOMIAL_TYPE  /**< Polynomial type stage. */
 };
 
+/**
+ * @private
+ * @ingroup evalresp_private
+ * @brief A compiled station, network, location or channel glob.
+ */
+typedef struct glob_pattern_s glob_pattern;
+
 /**
  * @private
  * @ingroup evalresp_private
@@ -195,13 +202,51 @@ enum stage_types
  */
 typedef struct
 {
-  char *station; /**< Station name. */
-  char *network; /**< Network name. */
-  char *locid;   /**< Location ID. */
-  char *channel; /**< Channel name. */
-  int found;     /**< Number of times found in the input RESP file. */
+  char *station;              /**< Station name. */
+  char *network;              /**< Network name. */
+  char *locid;                /**< Location ID. */
+  char *channel;              /**< Channel name. */
+  int found;                  /**< Number of times found in the input RESP file. */
+  glob_pattern *station_glob; /**< Compiled station name (NULL if not compiled). */
+  glob_pattern *network_glob; /**< Compiled network name (NULL if not compiled). */
+  glob_pattern *locid_glob;   /**< Compiled location ID (NULL if not compiled). */
+  glob_pattern *channel_glob; /**< Compiled channel name (NULL if not compiled). */
 } evalresp_sncl;
 
+/**
+ * @private
+ * @ingroup evalresp_private
+ * @brief Compile a SNCL glob ('*' and '?' are wildcards, and the name may
+ *        contain the match) once, for use with match_glob().
+ * @details Globs with no regular expression characters are matched
+ *          directly, others are compiled to a regular expression.
+ * @param[in] log Logging structure.
+ * @param[in] glob The pattern.
+ * @param[out] pattern The compiled pattern (an invalid regular expression
+ *             is logged, and matches nothing).
+ * @retval EVALRESP_OK on success
+ */
+int compile_glob (evalresp_logger *log, const char *glob, glob_pattern **pattern);
+
+/**
+ * @private
+ * @ingroup evalresp_private
+ * @brief Match a name against a compiled SNCL glob.
+ * @param[in] log Logging structure.
+ * @param[in] pattern The compiled pattern.
+ * @param[in] string The name.
+ * @returns 1 if the name matches, 0 otherwise.
+ */
+int match_glob (evalresp_logger *log, const glob_pattern *pattern, const char *string);
+
+/**
+ * @private
+ * @ingroup evalresp_private
+ * @brief Free a compiled SNCL glob.
+ * @param[in,out] pattern The pattern (set to NULL).
+ */
+void free_glob (glob_pattern **pattern);
+
 /**
  * @private
  * @ingroup evalresp_private
@@ -282,6 +327,32 @@ int is_int (const char *test, evalresp_logger *log);
 */
 int is_real (const char *test, evalresp_logger *log);
 
+/**
+ * @private
+ * @ingroup evalresp_private_string
+ * @brief Parse an integer (optional sign and digits, nothing else), without
+ *        regular expressions and independent of the locale.
+ * @param[in] text String to parse.
+ * @param[out] value The value, if valid (saturated at INT_MIN / INT_MAX).
+ * @returns 0 if the string is not an integer.
+ * @returns 1 if the string is an integer.
+ */
+int lex_int (const char *text, int *value);
+
+/**
+ * @private
+ * @ingroup evalresp_private_string
+ * @brief Parse a real number (optional sign, digits with an optional
+ *        decimal point and an optional exponent, nothing else), without
+ *        regular expressions and independent of the locale.
+ * @param[in] text String to parse.
+ * @param[out] value The value, if valid (the same as strtod() in the C
+ *                   locale).
+ * @returns 0 if the string is not a real number.
+ * @returns 1 if the string is a real number.
+ */
+int lex_double (const char *text, double *value);
+
 /* routines used to create a list of files matching the users request */
 
 /**
@@ -338,6 +409,19 @@ struct matched_files *find_files (char *file, evalresp_sncls *scn_lst,
  */
 int get_names (char *in_file, struct matched_files *file, evalresp_logger *log);
 
+/**
+ * @private
+ * @ingroup evalresp_private_alloc
+ * @brief Memory handed out in order from large chunks and released all at
+ *        once.
+ * @details Channels read by evalresp are allocated (with their stages,
+ *          blockettes and arrays) in an arena owned by the collection, so
+ *          freeing an inventory is a handful of calls to free() rather than
+ *          one per object.  Nothing in an arena may be passed to free() or
+ *          realloc().  Not safe to use from several threads.
+ */
+typedef struct evalresp_arena_s evalresp_arena;
+
 /* routines used to allocate vectors of the basic data types used in the
  filter stages */
 
@@ -346,12 +430,13 @@ int get_names (char *in_file, struct matched_files *file, evalresp_logger *log);
  * @ingroup evalresp_private_alloc
  * @brief Allocates space for an array of complex numbers.
  * @param[in] npts Number of complex numbers to allocate in array.
+ * @param[in] arena Arena to allocate from (or NULL for the heap).
  * @param[in] log Logging structure.
  * @returns Pointer to allocated array.
  * @returns @c NULL if @p npts is zero.
  * @warning Exits with error if allocation fails.
  */
-evalresp_complex *alloc_complex (int npts, evalresp_logger *log);
+evalresp_complex *alloc_complex (int npts, evalresp_arena *arena, evalresp_logger *log);
 
 /**
  * @private
@@ -428,12 +513,13 @@ struct matched_files *alloc_matched_files (evalresp_logger *log);
  * @ingroup evalresp_private_alloc
  * @brief Allocates space for an array of double precision numbers
  * @param[in] npts Number of double precision numbers to allocate in array.
+ * @param[in] arena Arena to allocate from (or NULL for the heap).
  * @param[in] log Logging structure.
  * @returns Pointer to allocated array.
  * @returns @c NULL if @p npts is zero.
  * @warning Exits with error if allocation fails.
  */
-double *alloc_double (int npts, evalresp_logger *log);
+double *alloc_double (int npts, evalresp_arena *arena, evalresp_logger *log);
 
 /**
  * @private
@@ -465,6 +551,7 @@ char **alloc_char_ptr (int len, evalresp_logger *log);
  * @private
  * @ingroup evalresp_private_alloc
  * @brief Allocates space for a pole-zero type filter structure.
+ * @param[in] arena Arena to allocate from (or NULL for the heap).
  * @param[in] log Logging structure.
  * @returns Pointer to allocated structure.
  * @note The space for the complex poles and zeros is not allocated here, the
@@ -473,12 +560,13 @@ char **alloc_char_ptr (int len, evalresp_logger *log);
  *       parsed.
  * @warning Exits with error if allocation fails.
  */
-evalresp_blkt *alloc_pz (evalresp_logger *log);
+evalresp_blkt *alloc_pz (evalresp_arena *arena, evalresp_logger *log);
 
 /**
  * @private
  * @ingroup evalresp_private_alloc
  * @brief Allocates space for a coefficients-type filter.
+ * @param[in] arena Arena to allocate from (or NULL for the heap).
  * @param[in] log Logging structure.
  * @returns Pointer to allocated structure.
  * @note See alloc_pz() for details (like alloc_pz(), this does not allocate
@@ -486,12 +574,13 @@ evalresp_blkt *alloc_pz (evalresp_logger *log);
  *       parse_fir()).
  * @warning Exits with error if allocation fails.
  */
-evalresp_blkt *alloc_coeff (evalresp_logger *log);
+evalresp_blkt *alloc_coeff (evalresp_arena *arena, evalresp_logger *log);
 
 /**
  * @private
  * @ingroup evalresp_private_alloc
  * @brief Allocates space for a fir-type filter.
+ * @param[in] arena Arena to allocate from (or NULL for the heap).
  * @param[in] log Logging structure.
  * @returns Pointer to allocated structure.
  * @note See alloc_pz() for details (like alloc_pz(), this does not allocate
@@ -499,22 +588,24 @@ evalresp_blkt *alloc_coeff (evalresp_logger *log);
  *       parse_fir()).
  * @warning Exits with error if allocation fails.
  */
-evalresp_blkt *alloc_fir (evalresp_logger *log);
+evalresp_blkt *alloc_fir (evalresp_arena *arena, evalresp_logger *log);
 
 /**
  * @private
  * @ingroup evalresp_private_alloc
  * @brief Allocates space for a response reference type filter structure.
+ * @param[in] arena Arena to allocate from (or NULL for the heap).
  * @param[in] log Logging structure.
  * @returns Pointer to allocated structure.
  * @warning Exits with error if allocation fails.
  */
-evalresp_blkt *alloc_ref (evalresp_logger *log);
+evalresp_blkt *alloc_ref (evalresp_arena *arena, evalresp_logger *log);
 
 /**
  * @private
  * @ingroup evalresp_private_alloc
  * @brief Allocates space for a gain type filter structure.
+ * @param[in] arena Arena to allocate from (or NULL for the heap).
  * @param[in] log Logging structure.
  * @returns Pointer to allocated structure.
  * @note The space for the calibration vectors is not allocated here, the
@@ -523,12 +614,13 @@ evalresp_blkt *alloc_ref (evalresp_logger *log);
  *       partially parsed.
  * @warning Exits with error if allocation fails.
  */
-evalresp_blkt *alloc_gain (evalresp_logger *log);
+evalresp_blkt *alloc_gain (evalresp_arena *arena, evalresp_logger *log);
 
 /**
  * @private
  * @ingroup evalresp_private_alloc
  * @brief Allocates space for a list type filter structure.
+ * @param[in] arena Arena to allocate from (or NULL for the heap).
  * @param[in] log Logging structure.
  * @returns Pointer to allocated structure.
  * @note The space for the amplitude, phase and frequency vectors is not
@@ -536,12 +628,13 @@ evalresp_blkt *alloc_gain (evalresp_logger *log);
  *       the number of frequencies is known.
  * @warning Exits with error if allocation fails.
  */
-evalresp_blkt *alloc_list (evalresp_logger *log);
+evalresp_blkt *alloc_list (evalresp_arena *arena, evalresp_logger *log);
 
 /**
  * @private
  * @ingroup evalresp_private_alloc
  * @brief Allocates space for a generic type filter structure.
+ * @param[in] arena Arena to allocate from (or NULL for the heap).
  * @param[in] log Logging structure.
  * @returns Pointer to allocated structure.
  * @note The space for the corner_freq, and corner_slope vectors is not
@@ -549,38 +642,41 @@ evalresp_blkt *alloc_list (evalresp_logger *log);
  *       the number of frequencies is known.
  * @warning Exits with error if allocation fails.
  */
-evalresp_blkt *alloc_generic (evalresp_logger *log);
+evalresp_blkt *alloc_generic (evalresp_arena *arena, evalresp_logger *log);
 
 /**
  * @private
  * @ingroup evalresp_private_alloc
  * @brief Allocates space for a decimation type filter structure.
+ * @param[in] arena Arena to allocate from (or NULL for the heap).
  * @param[in] log Logging structure.
  * @returns Pointer to allocated structure.
  * @warning Exits with error if allocation fails.
  */
-evalresp_blkt *alloc_deci (evalresp_logger *log);
+evalresp_blkt *alloc_deci (evalresp_arena *arena, evalresp_logger *log);
 
 /**
  * @private
  * @ingroup evalresp_private_alloc
  * @brief Allocates space for a polynomial Blockette 62.
+ * @param[in] arena Arena to allocate from (or NULL for the heap).
  * @param[in] log Logging structure.
  * @returns Pointer to allocated structure.
  * @warning Exits with error if allocation fails.
  * @author 05/31/2013: IGD.
  */
-evalresp_blkt *alloc_polynomial (evalresp_logger *log);
+evalresp_blkt *alloc_polynomial (evalresp_arena *arena, evalresp_logger *log);
 
 /**
  * @private
  * @ingroup evalresp_private_alloc
  * @brief Allocates space for a decimation type filter structure.
+ * @param[in] arena Arena to allocate from (or NULL for the heap).
  * @param[in] log Logging structure.
  * @returns Pointer to allocated structure.
  * @warning Exits with error if allocation fails.
  */
-evalresp_stage *alloc_stage (evalresp_logger *log);
+evalresp_stage *alloc_stage (evalresp_arena *arena, evalresp_logger *log);
 
 /* routines to free up space associated with dynamically allocated
  structure members */
@@ -710,6 +806,64 @@ f * @brief A routine that frees up the space associated with a channel's filter
  */
 void free_channel (evalresp_channel *chan_ptr);
 
+/**
+ * @private
+ * @ingroup evalresp_private_alloc
+ * @brief Create an empty arena.
+ * @param[in] log Logging structure.
+ * @param[out] arena Allocated arena, free with free_arena().
+ * @retval EVALRESP_OK on success
+ */
+int new_arena (evalresp_logger *log, evalresp_arena **arena);
+
+/**
+ * @private
+ * @ingroup evalresp_private_alloc
+ * @brief Allocate a zeroed array from an arena, or from the heap if there
+ *        is no arena.
+ * @param[in] log Logging structure.
+ * @param[in] arena Arena (or NULL for calloc()).
+ * @param[in] name Label to use if needing to log error.
+ * @param[in] n Number of elements.
+ * @param[in] size Size of each element.
+ * @returns Pointer to the array.
+ * @returns @c NULL if @p n is zero, or on failure (which is logged).
+ */
+void *arena_calloc (evalresp_logger *log, evalresp_arena *arena, const char *name, int n, size_t size);
+
+/**
+ * @private
+ * @ingroup evalresp_private_alloc
+ * @brief Grow memory from an arena (by copying), or from the heap if there
+ *        is no arena.
+ * @param[in] arena Arena (or NULL for realloc()).
+ * @param[in] ptr Memory to grow.
+ * @param[in] old_size Size of @p ptr.
+ * @param[in] size New size.
+ * @returns Pointer to the memory, or @c NULL on failure (when @p ptr is
+ *          unchanged).
+ */
+void *arena_realloc (evalresp_arena *arena, void *ptr, size_t old_size, size_t size);
+
+/**
+ * @private
+ * @ingroup evalresp_private_alloc
+ * @brief Move the memory of one arena into another.
+ * @details Lets channels read in parallel each use their own arena, which
+ *          are then collected by a single owner.
+ * @param[in,out] arena Arena taking the memory.
+ * @param[in,out] other Arena giving the memory, freed and set to NULL.
+ */
+void join_arenas (evalresp_arena *arena, evalresp_arena **other);
+
+/**
+ * @private
+ * @ingroup evalresp_private_alloc
+ * @brief Free an arena and all the memory allocated from it.
+ * @param[in,out] arena Arena, set to NULL.
+ */
+void free_arena (evalresp_arena **arena);
+
 /* simple error handling routines to standardize the output error values and
  allow for control to return to 'evresp' if a recoverable error occurs */
 
@@ -802,10 +956,12 @@ int add_null (char *s, int len, char where);
  *              filter sequence is calculated and stored in the filter
  *              structure.
  * @param[in] log Logging structure.
+ * @param[in] arena Arena the channel was allocated from (or NULL for the
+ *            heap), for blockettes that are added or merged.
  * @param[in] chan Channel structure.
  * @retval EVALRESP_OK on success
  */
-int check_channel (evalresp_logger *log, evalresp_channel *chan);
+int check_channel (evalresp_logger *log, evalresp_arena *arena, evalresp_channel *chan);
 
 /**
  * @private
@@ -820,6 +976,371 @@ int check_channel (evalresp_logger *log, evalresp_channel *chan);
 void check_sym (evalresp_blkt *f, evalresp_channel *chan, evalresp_logger *log);
 
 /* routines used to calculate the instrument responses */
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief A single step of an evaluation plan.
+ * @details Each step applies one filter kernel to the whole frequency
+ *          vector. Everything that does not depend on frequency (the
+ *          sample interval, the FIR delay correction, the value of a
+ *          polynomial stage) is resolved when the plan is compiled.
+ */
+typedef struct
+{
+  int type;                  /**< Filter type (from filt_types) selecting the kernel. */
+  const evalresp_blkt *blkt; /**< Blockette holding the filter coefficients. */
+  double sint;               /**< Sample interval for digital filters. */
+  double delay;              /**< Time shift for DECIMATION steps. */
+  evalresp_complex value;    /**< Frequency independent response for POLYNOMIAL steps. */
+} evalresp_plan_op;
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief Flat, stage-major evaluation plan for a normalized channel.
+ * @details The steps are stored in the order the blockettes appear in the
+ *          selected stages, so evaluating them in sequence multiplies the
+ *          per-frequency terms in exactly the same order as walking the
+ *          channel would. The plan refers to the channel's coefficient
+ *          arrays, so the channel must outlive it.
+ */
+typedef struct
+{
+  int nops;                /**< Number of steps. */
+  evalresp_plan_op *ops;   /**< Array of steps. */
+  int input_units;         /**< Input units of the first stage (for unit conversion). */
+  double sensit;           /**< Sensitivity applied to the product of the steps. */
+  double unit_scale_fact;  /**< Scale factor to MKS units. */
+} evalresp_plan;
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief A normalized channel and its compiled plan.
+ * @details Neither is modified by evaluation, so a prepared channel can be
+ *          shared between threads.
+ */
+struct evalresp_prepared_channel_s
+{
+  const evalresp_channel *channel; /**< Normalized channel (not owned). */
+  evalresp_plan *plan;             /**< Compiled plan. */
+};
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief Compile a normalized channel into an evaluation plan.
+ * @details Applies the stage selection in @p options and reports the same
+ *          errors as calculate_response() would.
+ * @param[in] log Logging structure.
+ * @param[in] options Options controlling stage selection, delays and B62.
+ * @param[in] chan Channel structure (already normalized).
+ * @param[out] plan Compiled plan, free with free_plan().
+ * @retval EVALRESP_OK on success
+ */
+int compile_plan (evalresp_logger *log, evalresp_options const *const options, const evalresp_channel *chan, evalresp_plan **plan);
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief Responses of individual FIR, IIR coefficient and decimation
+ *        steps, shared between the channels of a batch.
+ * @details Entries are keyed on the content of the blockette, the sample
+ *          interval (or delay), the kernel options and the frequency
+ *          grid, so a step common to many channels (the same digitizer)
+ *          is evaluated once per grid. Safe to use from several threads.
+ */
+typedef struct stage_cache_s stage_cache;
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief Evaluate a compiled plan at the given frequencies.
+ * @details Long frequency vectors are split into chunks of FREQ_CHUNK,
+ *          which are evaluated on options->nthreads threads. The result
+ *          does not depend on the number of threads, or on whether steps
+ *          come from a stage cache.
+ * @param[in] log Logging structure.
+ * @param[in] options Options (output unit, choice of kernels and threads).
+ * @param[in] plan Compiled plan.
+ * @param[in,out] stages Stage cache to use and fill (or NULL).
+ * @param[in] freq Frequency array.
+ * @param[in] nfreqs Number of frequencies in @p freq.
+ * @param[out] output Response at each frequency.
+ * @retval EVALRESP_OK on success
+ */
+int evaluate_plan (evalresp_logger *log, evalresp_options const *const options, const evalresp_plan *plan, stage_cache *stages, const double *freq, int nfreqs, evalresp_complex *output);
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief Create an empty stage cache.
+ * @param[in] log Logging structure.
+ * @param[out] stages Allocated stage cache, free with free_stage_cache().
+ * @retval EVALRESP_OK on success
+ */
+int new_stage_cache (evalresp_logger *log, stage_cache **stages);
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief Free a stage cache (and the values it holds).
+ * @param[in,out] stages Stage cache, set to NULL.
+ */
+void free_stage_cache (stage_cache **stages);
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief Identify a frequency grid in a stage cache, adding it if new.
+ * @param[in,out] stages Stage cache.
+ * @param[in] freq Frequency array.
+ * @param[in] nfreqs Number of frequencies in @p freq.
+ * @returns The grid id, or -1 if the grid cannot be cached.
+ */
+int stage_cache_grid (stage_cache *stages, const double *freq, int nfreqs);
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief Is a plan step of a type that the stage cache holds?
+ * @param[in] op Plan step.
+ */
+int stage_cache_stores (const evalresp_plan_op *op);
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief Find the values of a plan step on a grid in a stage cache.
+ * @param[in,out] stages Stage cache.
+ * @param[in] options Options (choice of kernels).
+ * @param[in] op Plan step.
+ * @param[in] grid Grid id from stage_cache_grid().
+ * @returns The response of the step at each frequency of the grid (valid
+ *          until the cache is freed), or NULL if not cached.
+ */
+const evalresp_complex *stage_cache_find (stage_cache *stages, evalresp_options const *const options, const evalresp_plan_op *op, int grid);
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief Add the values of a plan step on a grid to a stage cache.
+ * @details The cache takes ownership of @p values, which are freed at
+ *          once if the step is already cached or the cache is full.
+ * @param[in,out] stages Stage cache.
+ * @param[in] options Options (choice of kernels).
+ * @param[in] op Plan step.
+ * @param[in] grid Grid id from stage_cache_grid().
+ * @param[in] values Response of the step at each frequency of the grid.
+ */
+void stage_cache_add (stage_cache *stages, evalresp_options const *const options, const evalresp_plan_op *op, int grid, evalresp_complex *values);
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief Free an evaluation plan.
+ * @param[in,out] plan Plan to free (set to NULL).
+ */
+void free_plan (evalresp_plan **plan);
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief Number of frequencies evaluated per call of the batch kernels.
+ */
+#define SIMD_BATCH 256
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief Number of frequencies evaluated together by evaluate_plan(), so
+ *        that the frequencies and partial products (24 bytes each) stay
+ *        in a typical L2 cache while every stage is applied.
+ */
+#define FREQ_CHUNK 8192
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief Instruction sets available to the batch kernels.
+ */
+enum simd_isa
+{
+  SIMD_SCALAR, /**< Portable C. */
+  SIMD_SSE2,   /**< x86-64 SSE2 (2 doubles per vector). */
+  SIMD_AVX2,   /**< x86-64 AVX2 (4 doubles per vector). */
+  SIMD_AVX512  /**< x86-64 AVX-512F (8 doubles per vector). */
+};
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief Check whether the batch kernels can use an instruction set on this
+ *        build and CPU.
+ * @param[in] isa Instruction set (from simd_isa).
+ * @returns 1 if supported, otherwise 0.
+ */
+int simd_isa_supported (int isa);
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief The widest instruction set supported on this build and CPU.
+ */
+int simd_best_isa (void);
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief Response of an analog (ANALOG_PZ or LAPLACE_PZ) filter at a block
+ *        of frequencies.
+ * @details Results are identical (bit-for-bit) to evaluating each frequency
+ *          separately, for every instruction set.
+ * @param[in] isa Instruction set (from simd_isa) to use.
+ * @param[in] blkt_ptr Pole-zero blockette.
+ * @param[in] freq Frequencies (Hz).
+ * @param[in] nfreqs Number of frequencies.
+ * @param[out] re Real part of the response at each frequency.
+ * @param[out] im Imaginary part of the response at each frequency.
+ */
+void analog_trans_batch (int isa, const evalresp_blkt *blkt_ptr, const double *freq, int nfreqs, double *re, double *im);
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief Response of a digital (IIR_PZ) pole-zero filter at a block of
+ *        frequencies.
+ * @details Results are identical (bit-for-bit) to evaluating each frequency
+ *          separately.
+ * @param[in] blkt_ptr Pole-zero blockette.
+ * @param[in] sint Sample interval.
+ * @param[in] freq Frequencies (Hz).
+ * @param[in] nfreqs Number of frequencies.
+ * @param[out] re Real part of the response at each frequency.
+ * @param[out] im Imaginary part of the response at each frequency.
+ */
+void iir_pz_trans_batch (const evalresp_blkt *blkt_ptr, double sint, const double *freq, int nfreqs, double *re, double *im);
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief Response of a FIR filter (FIR_SYM_1, FIR_SYM_2 or FIR_ASYM) on a
+ *        linear frequency grid, using the chirp-z transform.
+ * @details Costs O((ncoeffs + nfreqs) log (ncoeffs + nfreqs)) instead of
+ *          O(ncoeffs * nfreqs). The response is evaluated at exactly the
+ *          requested frequencies, so it differs from direct summation only
+ *          by rounding. Boxcar FIR_ASYM filters are not handled (their
+ *          response has a closed form).
+ * @param[in] log Logging structure.
+ * @param[in] blkt_ptr FIR blockette.
+ * @param[in] sint Sample interval.
+ * @param[in] f0 First frequency (Hz).
+ * @param[in] df Frequency step (Hz).
+ * @param[in] nfreqs Number of frequencies.
+ * @param[out] re Real part of the response at each frequency.
+ * @param[out] im Imaginary part of the response at each frequency.
+ * @retval EVALRESP_OK on success
+ */
+int fir_trans_fft (evalresp_logger *log, const evalresp_blkt *blkt_ptr, double sint, double f0, double df, int nfreqs, double *re, double *im);
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief Task run by parallel_for() for a single index.
+ * @param[in] log Logging structure (private to the task).
+ * @param[in] data Data shared by all tasks.
+ * @param[in] i Index of the task.
+ * @retval EVALRESP_OK on success
+ */
+typedef int (*parallel_task) (evalresp_logger *log, void *data, int i);
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief Run a task for indices 0 to n-1 on up to nthreads threads.
+ * @details The result is the same as running the tasks in order and
+ *          stopping at the first failure: the status of the lowest
+ *          failing index is returned and the messages logged by the tasks
+ *          up to and including that one are passed to @p log in index
+ *          order. Tasks for later indices may or may not have run, so the
+ *          caller must clean up after them. Without pthreads, or when
+ *          nthreads is less than two, the tasks run in the calling thread.
+ * @param[in] log Logging structure.
+ * @param[in] nthreads Maximum number of threads (including the caller).
+ * @param[in] n Number of tasks.
+ * @param[in] task Task function.
+ * @param[in] data Data passed to each task.
+ * @param[out] ndone Number of leading tasks that succeeded (n on success).
+ * @retval EVALRESP_OK on success
+ */
+int parallel_for (evalresp_logger *log, int nthreads, int n, parallel_task task, void *data, int *ndone);
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief A mutex (which does nothing in builds without pthreads).
+ */
+typedef struct thread_lock_s thread_lock;
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief Create a mutex.
+ * @param[in] log Logging structure.
+ * @param[out] lock Allocated mutex, free with free_lock().
+ * @retval EVALRESP_OK on success
+ */
+int new_lock (evalresp_logger *log, thread_lock **lock);
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief Free a mutex.
+ * @param[in,out] lock Mutex, set to NULL.
+ */
+void free_lock (thread_lock **lock);
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief Lock a mutex.
+ * @param[in] lock Mutex.
+ */
+void acquire_lock (thread_lock *lock);
+
+/**
+ * @private
+ * @ingroup evalresp_private_calc
+ * @brief Unlock a mutex.
+ * @param[in] lock Mutex.
+ */
+void release_lock (thread_lock *lock);
+
+/**
+ * @private
+ * @ingroup evalresp_private_file
+ * @brief Map the rest of a regular file into memory, rather than reading it.
+ * @details The stream is left at the end of the file, as if it had been
+ *          read.  Nothing is mapped for pipes, terminals, empty files or on
+ *          Windows, so the caller can read the stream instead.
+ * @param[in] file Input stream.
+ * @param[out] map Mapping, to be passed to unmap_file().
+ * @param[out] map_len Length of the mapping.
+ * @param[out] data Unread contents of the file.
+ * @param[out] len Length of the contents.
+ * @retval 1 if the file was mapped, 0 otherwise
+ */
+int map_file (FILE *file, void **map, size_t *map_len, const char **data, size_t *len);
+
+/**
+ * @private
+ * @ingroup evalresp_private_file
+ * @brief Release a mapping made by map_file().
+ * @param[in] map Mapping.
+ * @param[in] map_len Length of the mapping.
+ */
+void unmap_file (void *map, size_t map_len);
+
 /**
  * @private
  * @ingroup evalresp_private_calc
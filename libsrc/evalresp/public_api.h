@@ -453,6 +453,10 @@ typedef struct
   evalresp_output_format format; /**< Output format (AMP and PHA by default). */
   evalresp_unit unit;            /**< Output unit (displacement by default). */
   int verbose;                   /**< Verbose output? */
+  int use_trig_recurrence;       /**< Evaluate FIR and IIR coefficient stages with a single sin/cos per frequency and a Clenshaw recurrence (call cos/sin for every coefficient by default)? */
+  double fir_fft_threshold;      /**< Evaluate long FIR stages on linear grids with an FFT (chirp-z transform) when ncoeffs * nfreq reaches this, eg 1e6 (sum directly, which is exact, by default). */
+  int nthreads;                  /**< Number of threads used to read the channels of a RESP file, and to evaluate channels or the frequencies of a single channel (one, the calling thread, by default). */
+  int cache_stages;              /**< Evaluate identical FIR, IIR coefficient and decimation stages once for all the channels in evalresp_channels_to_responses() (each channel separately by default)? */
 } evalresp_options;
 
 /**
@@ -615,6 +619,79 @@ int evalresp_file_to_channels (evalresp_logger *log, FILE *file,
                                evalresp_options const *const options,
                                const evalresp_filter *filter, evalresp_channels **channels);
 
+/**
+ * @public
+ * @ingroup evalresp_public_low_level_input
+ * @param[in] log logging structure
+ * @param[in] channel channel read (freed when the function returns)
+ * @param[in] data the data given to @ref evalresp_stream_to_channels
+ * @brief Receive a channel from @ref evalresp_stream_to_channels.
+ * @retval EVALRESP_OK on success (any other value stops the reading and is returned)
+ */
+typedef int (*evalresp_channel_func) (evalresp_logger *log, evalresp_channel *channel, void *data);
+
+/**
+ * @public
+ * @ingroup evalresp_public_low_level_input
+ * @param[in] log logging structure
+ * @param[in] file input stream (RESP only)
+ * @param[in] options unit options are used
+ * @param[in] filter filter to use when getting the channels
+ * @param[in] func called with each channel selected, in input order
+ * @param[in] data passed to func
+ * @brief Read channels (@ref evalresp_public_low_level_channel) from a RESP stream, as
+ * @ref evalresp_file_to_channels, without holding the whole stream in memory.
+ * @details The stream is read a channel at a time, keeping only the text of the best
+ * epoch so far of the current SNCL (a later epoch may replace an earlier one).  That
+ * is read and passed to func as soon as the input moves to another SNCL, so memory
+ * is bounded by a single channel rather than the input.  This assumes that the
+ * epochs of each SNCL are together, as in RESP exports; an SNCL that appears again
+ * after another has each run of its epochs selected separately, with a warning.
+ * @retval EVALRESP_OK on success
+ */
+int evalresp_stream_to_channels (evalresp_logger *log, FILE *file,
+                                 evalresp_options const *const options,
+                                 const evalresp_filter *filter, evalresp_channel_func func, void *data);
+
+/**
+ * @public
+ * @ingroup evalresp_public_low_level_input
+ * @param[in] log logging structure
+ * @param[in] channels channels to save
+ * @param[in] file output stream
+ * @brief Save channels (@ref evalresp_public_low_level_channel), as read from RESP or
+ * StationXML, in a binary format that is quick to load with
+ * @ref evalresp_channels_load_binary.
+ * @details The format is versioned and has the same (little-endian) layout on all hosts.
+ * @retval EVALRESP_OK on success
+ */
+int evalresp_channels_save_binary (evalresp_logger *log, const evalresp_channels *channels, FILE *file);
+
+/**
+ * @public
+ * @ingroup evalresp_public_low_level_input
+ * @param[in] log logging structure
+ * @param[in] file input stream (a regular file is mapped rather than read)
+ * @param[out] channels collection of channels that gets allocated and returned
+ * @brief Load channels saved by @ref evalresp_channels_save_binary.
+ * @retval EVALRESP_OK on success
+ */
+int evalresp_channels_load_binary (evalresp_logger *log, FILE *file, evalresp_channels **channels);
+
+/**
+ * @public
+ * @ingroup evalresp_public_low_level_input
+ * @param[in] log logging structure
+ * @param[in] data binary channels, as saved by @ref evalresp_channels_save_binary
+ *            (a file mapped by the caller, say)
+ * @param[in] len length of data
+ * @param[out] channels collection of channels that gets allocated and returned
+ * @brief Load channels saved by @ref evalresp_channels_save_binary from memory.
+ * @retval EVALRESP_OK on success
+ */
+int evalresp_binary_to_channels (evalresp_logger *log, const char *data, size_t len,
+                                 evalresp_channels **channels);
+
 /**
  * @public
  * @ingroup evalresp_public_low_level_input
@@ -647,6 +724,93 @@ int evalresp_filename_to_channels (evalresp_logger *log, const char *filename, e
 int evalresp_channel_to_response (evalresp_logger *log, evalresp_channel *channel,
                                   evalresp_options *options, evalresp_response **response);
 
+/**
+ * @public
+ * @ingroup evalresp_public_low_level_evaluation
+ * @param[in] log logging structure
+ * @param[in] flat flat channel (@ref evalresp_flat_channel) to be converted into a response
+ * @param[in] options options control how responses are evaluated
+ * @param[out] response an allocated response created from the channel
+ * @brief Evaluate a flat channel to a response, as evalresp_channel_to_response().
+ * @details The blockettes are evaluated where they are, with their arrays read from
+ * the pool of the flat channel, which is not changed.
+ * @retval EVALRESP_OK on success
+ */
+int evalresp_flat_to_response (evalresp_logger *log, const evalresp_flat_channel *flat,
+                               evalresp_options *options, evalresp_response **response);
+
+/**
+ * @public
+ * @ingroup evalresp_public_low_level_evaluation
+ * @brief A channel that has been normalized and compiled for evaluation
+ * (see evalresp_prepare_channel()).
+ */
+typedef struct evalresp_prepared_channel_s evalresp_prepared_channel;
+
+/**
+ * @public
+ * @ingroup evalresp_public_low_level_evaluation
+ * @param[in] log logging structure
+ * @param[in,out] channel channel object to be prepared (normalized in place)
+ * @param[in] options start and stop stages, estimated delay, total sensitivity and
+ * blockette 62 value are used (may be NULL)
+ * @param[out] prepared an allocated prepared channel, free with evalresp_free_prepared_channel()
+ * @brief Normalize a channel and compile it for evaluation, once.  The prepared channel
+ * refers to the channel, which must not be changed or freed while it is in use.
+ * @details evalresp_channel_to_response() does this on every call.  A prepared channel is
+ * never modified by evaluation, so it can be evaluated by several threads at once.
+ * @retval EVALRESP_OK on success
+ */
+int evalresp_prepare_channel (evalresp_logger *log, evalresp_channel *channel,
+                              evalresp_options const *const options,
+                              evalresp_prepared_channel **prepared);
+
+/**
+ * @public
+ * @ingroup evalresp_public_low_level_evaluation
+ * @param[in] log logging structure
+ * @param[in] prepared channel prepared by evalresp_prepare_channel()
+ * @param[in] options frequencies, output unit, blockette 55 interpolation and the choice of
+ * kernels are used (may be NULL)
+ * @param[out] response an allocated response created from the channel
+ * @brief Evaluate a prepared channel to a response.  This is re-entrant: neither the
+ * prepared channel nor the options are modified.
+ * @retval EVALRESP_OK on success
+ */
+int evalresp_prepared_to_response (evalresp_logger *log, const evalresp_prepared_channel *prepared,
+                                   evalresp_options const *const options,
+                                   evalresp_response **response);
+
+/**
+ * @public
+ * @ingroup evalresp_public_low_level_evaluation
+ * @param[in] log logging structure
+ * @param[in] prepared channel prepared by evalresp_prepare_channel()
+ * @param[in] options output unit, blockette 55 interpolation and the choice of kernels are
+ * used; the frequency grid options are ignored (may be NULL)
+ * @param[in] freqs frequencies (Hz) at which to evaluate the response, in any order
+ * @param[in] nfreqs number of values in @p freqs
+ * @param[out] output the response at each frequency (nfreqs values, allocated by the caller)
+ * @brief Evaluate a prepared channel at arbitrary frequencies into a caller supplied buffer.
+ * @details Nothing is allocated, except when nthreads or fir_fft_threshold are set in the
+ * options, or when a blockette 55 channel is interpolated (in which case the frequencies
+ * must be ascending and within the blockette's range).  Without interpolation, a blockette
+ * 55 channel can only be evaluated at its own frequencies.  Like
+ * evalresp_prepared_to_response() this is re-entrant.
+ * @retval EVALRESP_OK on success
+ */
+int evalresp_prepared_to_buffer (evalresp_logger *log, const evalresp_prepared_channel *prepared,
+                                 evalresp_options const *const options,
+                                 const double *freqs, int nfreqs, evalresp_complex *output);
+
+/**
+ * @public
+ * @ingroup evalresp_public_low_level_evaluation
+ * @param[in,out] prepared prepared channel to be freed (the channel itself is not)
+ * @brief Free a prepared channel and set the pointer to NULL.
+ */
+void evalresp_free_prepared_channel (evalresp_prepared_channel **prepared);
+
 /**
  * @public
  * @ingroup evalresp_public_low_level_evaluation
@@ -661,6 +825,85 @@ int evalresp_channel_to_response (evalresp_logger *log, evalresp_channel *channe
 int evalresp_channels_to_responses (evalresp_logger *log, evalresp_channels *channels,
                                     evalresp_options *options, evalresp_responses **responses);
 
+/**
+ * @public
+ * @ingroup evalresp_public_low_level_evaluation
+ * @brief A cache of evaluated responses, shared between channels with the same
+ * content (see evalresp_cached_channel_to_response()).
+ */
+typedef struct evalresp_cache_s evalresp_cache;
+
+/**
+ * @public
+ * @ingroup evalresp_public_low_level_evaluation
+ * @brief Counters describing the use of a response cache.
+ */
+typedef struct
+{
+  long hits;      /**< Responses found in the cache. */
+  long misses;    /**< Responses evaluated and added to the cache. */
+  long evictions; /**< Responses dropped to stay within the memory budget. */
+  int nentries;   /**< Responses currently in the cache. */
+  size_t nbytes;  /**< Memory used by the responses currently in the cache. */
+} evalresp_cache_stats;
+
+/**
+ * @public
+ * @ingroup evalresp_public_low_level_evaluation
+ * @param[in] log logging structure
+ * @param[in] max_bytes memory budget; least recently used responses are dropped beyond this
+ * @param[out] cache an allocated, empty cache
+ * @brief Create a response cache.  A cache must only be used by one thread at a time.
+ * @retval EVALRESP_OK on success
+ */
+int evalresp_new_cache (evalresp_logger *log, size_t max_bytes, evalresp_cache **cache);
+
+/**
+ * @public
+ * @ingroup evalresp_public_low_level_evaluation
+ * @param[in,out] cache cache to be freed (responses still in use remain valid until released)
+ * @brief Free a response cache and set the pointer to NULL.
+ */
+void evalresp_free_cache (evalresp_cache **cache);
+
+/**
+ * @public
+ * @ingroup evalresp_public_low_level_evaluation
+ * @param[in] log logging structure
+ * @param[in,out] cache response cache
+ * @param[in] channel channel object to be converted into a response (normalized in place)
+ * @param[in] options options control how responses are evaluated
+ * @param[out] response a shared response, release with evalresp_release_response() (never
+ * with evalresp_free_response())
+ * @brief Like evalresp_channel_to_response(), but returns a cached response when a channel
+ * with the same filters was already evaluated with the same options.
+ * @details The cache key covers the content of the normalized stages that are evaluated
+ * (after the stage range, delay and sensitivity options are applied) and the frequency grid,
+ * unit, blockette 55 and kernel options.  Channel names are not part of the key, but each
+ * response carries the names of the channel it was requested for.
+ * @retval EVALRESP_OK on success
+ */
+int evalresp_cached_channel_to_response (evalresp_logger *log, evalresp_cache *cache,
+                                         evalresp_channel *channel, evalresp_options *options,
+                                         const evalresp_response **response);
+
+/**
+ * @public
+ * @ingroup evalresp_public_low_level_evaluation
+ * @param[in,out] response shared response returned by evalresp_cached_channel_to_response()
+ * @brief Release a shared response and set the pointer to NULL.
+ */
+void evalresp_release_response (const evalresp_response **response);
+
+/**
+ * @public
+ * @ingroup evalresp_public_low_level_evaluation
+ * @param[in] cache response cache
+ * @param[out] stats hit, miss and eviction counters and the current size of the cache
+ * @brief Read the counters of a response cache.
+ */
+void evalresp_get_cache_stats (const evalresp_cache *cache, evalresp_cache_stats *stats);
+
 // --- low level output
 
 /**
@@ -728,7 +971,7 @@ int evalresp_response_to_file (evalresp_logger *log, const evalresp_response *re
  * @retval EVALRESP_OK on success
  */
 int evalresp_channel_to_log (evalresp_logger *log, evalresp_options const *const options,
-                             evalresp_channel *const channel);
+                             evalresp_channel const *const channel);
 
 // --- high level
 
@@ -2,6 +2,8 @@
 #ifndef evalresp_public_low_level_channelS_H
 #define evalresp_public_low_level_channelS_H
 
+#include <stddef.h>
+
 #include "evalresp/constants.h"
 #include "evalresp_log/log.h"
 
@@ -236,15 +238,81 @@ typedef struct evalresp_channel_s
                                    stage. */
 } evalresp_channel;
 
+/**
+ * @public
+ * @ingroup evalresp_public_low_level_channel
+ * @brief A stage of a flat channel (@ref evalresp_flat_channel).
+ */
+typedef struct evalresp_flat_stage_s
+{
+  int sequence_no;  /**< Sequence number. */
+  int input_units;  /**< Input units. */
+  int output_units; /**< Output units. */
+  int first_blkt;   /**< Index of the first blockette of the stage in the blockette table. */
+  int nblkts;       /**< Number of blockettes of the stage (consecutive in the table). */
+} evalresp_flat_stage;
+
+/**
+ * @public
+ * @ingroup evalresp_public_low_level_channel
+ * @brief A blockette of a flat channel (@ref evalresp_flat_channel).
+ * @details The arrays of the blockette are in the pool of the channel, in
+ *          the order they are declared in the union member for its type
+ *          (zeros then poles, numerator then denominator, and so on).
+ *          Complex values are stored as pairs of doubles.
+ */
+typedef struct evalresp_flat_blkt_s
+{
+  evalresp_blkt blkt; /**< Type and fields, with NULL arrays and next_blkt. */
+  size_t arrays[3];   /**< Offsets of the arrays in the pool (in doubles). */
+} evalresp_flat_blkt;
+
+/**
+ * @public
+ * @ingroup evalresp_public_low_level_channel
+ * @brief A channel held in a single allocation, as a stage table, a
+ *        blockette table and one pool of all the coefficients, poles,
+ *        zeros and other arrays of its blockettes.
+ * @details The tables and the pool follow this structure and are addressed
+ *          by offsets, not pointers, so a flat channel of @p size bytes can
+ *          be copied with memcpy() (or written and read back on the same
+ *          kind of host) and is still valid.  Use EVALRESP_FLAT_STAGES(),
+ *          EVALRESP_FLAT_BLKTS() and EVALRESP_FLAT_POOL() to reach them.
+ */
+typedef struct evalresp_flat_channel_s
+{
+  evalresp_channel channel; /**< Names, dates and values (first_stage is NULL). */
+  size_t size;              /**< Bytes in the allocation, including this structure. */
+  int stages_len;           /**< Number of entries in the stage table. */
+  int blkts_len;            /**< Number of entries in the blockette table. */
+  size_t pool_len;          /**< Number of doubles in the pool. */
+  size_t stages_offset;     /**< Offset of the stage table (in bytes, from this structure). */
+  size_t blkts_offset;      /**< Offset of the blockette table. */
+  size_t pool_offset;       /**< Offset of the pool. */
+} evalresp_flat_channel;
+
+/** Stage table of a flat channel. */
+#define EVALRESP_FLAT_STAGES(flat) ((evalresp_flat_stage *)((char *)(flat) + (flat)->stages_offset))
+/** Blockette table of a flat channel. */
+#define EVALRESP_FLAT_BLKTS(flat) ((evalresp_flat_blkt *)((char *)(flat) + (flat)->blkts_offset))
+/** Pool of a flat channel. */
+#define EVALRESP_FLAT_POOL(flat) ((double *)((char *)(flat) + (flat)->pool_offset))
+
 /**
  * @public
  * @ingroup evalresp_public_low_level_channel
  * @brief A collection of channel structures.
+ * @details Channels read by evalresp are allocated together, in memory
+ *          owned by the collection, and are released with it by
+ *          evalresp_free_channels() (not one by one).  A collection from
+ *          evalresp_alloc_channels() has no such memory, so channels built
+ *          by hand and added to it are freed individually.
 */
 typedef struct evalresp_channels_s
 {
   int nchannels;
   evalresp_channel **channels;
+  struct evalresp_arena_s *arena; /**< Memory of channels read by evalresp (or NULL). */
 } evalresp_channels;
 
 /**
@@ -275,4 +343,40 @@ TODO IGD: finish the description
 void
 evalresp_free_channel (evalresp_channel **channel);
 
+/**
+ * @public
+ * @ingroup evalresp_public_low_level_channel
+ * @param[in] log logging structure
+ * @param[in] channel channel to convert
+ * @param[out] flat an allocated flat copy of the channel, free with
+ *             evalresp_free_flat_channel()
+ * @brief Copy a channel into the flat layout (@ref evalresp_flat_channel).
+ * @retval EVALRESP_OK on success
+ */
+int
+evalresp_channel_to_flat (evalresp_logger *log, const evalresp_channel *channel,
+                          evalresp_flat_channel **flat);
+
+/**
+ * @public
+ * @ingroup evalresp_public_low_level_channel
+ * @param[in] log logging structure
+ * @param[in] flat flat channel to convert
+ * @param[out] channel an allocated channel, with its own stages, blockettes
+ *             and arrays, free with evalresp_free_channel()
+ * @brief Copy a flat channel back into the linked structures.
+ * @retval EVALRESP_OK on success
+ */
+int
+evalresp_flat_to_channel (evalresp_logger *log, const evalresp_flat_channel *flat,
+                          evalresp_channel **channel);
+
+/**
+ * @public
+ * @ingroup evalresp_public_low_level_channel
+ * @brief Free a flat channel.
+ */
+void
+evalresp_free_flat_channel (evalresp_flat_channel **flat);
+
 #endif
@@ -15,7 +15,7 @@
 #include "spline.h"
 
 static int
-merge_lists (evalresp_blkt *first_blkt, evalresp_blkt **second_blkt, evalresp_logger *log)
+merge_lists (evalresp_arena *arena, evalresp_blkt *first_blkt, evalresp_blkt **second_blkt, evalresp_logger *log)
 {
   int new_ncoeffs, ncoeffs1, ncoeffs2, i, j;
   double *amp1, *amp2, *phase1, *phase2, *freq1, *freq2;
@@ -55,21 +55,21 @@ merge_lists (evalresp_blkt *first_blkt, evalresp_blkt **second_blkt, evalresp_lo
 
   /* attempt to reallocate space for the new (combined) coefficients vector */
 
-  if ((amp1 = (double *)realloc (amp1, new_ncoeffs * sizeof (double))) == (double *)NULL)
+  if ((amp1 = (double *)arena_realloc (arena, amp1, ncoeffs1 * sizeof (double), new_ncoeffs * sizeof (double))) == (double *)NULL)
   {
     evalresp_log (log, EV_ERROR, 0,
                   "merge_lists; insufficient memory for combined amplitudes");
     return EVALRESP_MEM; /* OUT_OF_MEMORY */
   }
 
-  if ((phase1 = (double *)realloc (phase1, new_ncoeffs * sizeof (double))) == (double *)NULL)
+  if ((phase1 = (double *)arena_realloc (arena, phase1, ncoeffs1 * sizeof (double), new_ncoeffs * sizeof (double))) == (double *)NULL)
   {
     evalresp_log (log, EV_ERROR, 0,
                   "merge_lists; insufficient memory for combined phases");
     return EVALRESP_MEM; /* OUT_OF_MEMORY */
   }
 
-  if ((freq1 = (double *)realloc (freq1, new_ncoeffs * sizeof (double))) == (double *)NULL)
+  if ((freq1 = (double *)arena_realloc (arena, freq1, ncoeffs1 * sizeof (double), new_ncoeffs * sizeof (double))) == (double *)NULL)
   {
     evalresp_log (log, EV_ERROR, 0,
                   "merge_lists; insufficient memory for combined frequencies");
@@ -93,14 +93,17 @@ merge_lists (evalresp_blkt *first_blkt, evalresp_blkt **second_blkt, evalresp_lo
   first_blkt->blkt_info.list.freq = freq1;
   first_blkt->blkt_info.list.phase = phase1;
   first_blkt->next_blkt = tmp_blkt->next_blkt;
-  free_fir (tmp_blkt);
+  if (!arena)
+  {
+    free_fir (tmp_blkt);
+  }
   *second_blkt = first_blkt->next_blkt;
 
   return EVALRESP_OK;
 }
 
 static int
-merge_coeffs (evalresp_blkt *first_blkt, evalresp_blkt **second_blkt, evalresp_logger *log)
+merge_coeffs (evalresp_arena *arena, evalresp_blkt *first_blkt, evalresp_blkt **second_blkt, evalresp_logger *log)
 {
   int new_ncoeffs, ncoeffs1, ncoeffs2, i, j;
   double *coeffs1, *coeffs2;
@@ -137,7 +140,7 @@ merge_coeffs (evalresp_blkt *first_blkt, evalresp_blkt **second_blkt, evalresp_l
 
   /* attempt to reallocate space for the new (combined) coefficients vector */
 
-  if ((coeffs1 = (double *)realloc (coeffs1, new_ncoeffs * sizeof (double))) == (double *)NULL)
+  if ((coeffs1 = (double *)arena_realloc (arena, coeffs1, ncoeffs1 * sizeof (double), new_ncoeffs * sizeof (double))) == (double *)NULL)
   {
     evalresp_log (log, EV_ERROR, 0,
                   "merge_coeffs; insufficient memory for combined coeffs");
@@ -157,7 +160,10 @@ merge_coeffs (evalresp_blkt *first_blkt, evalresp_blkt **second_blkt, evalresp_l
   first_blkt->blkt_info.fir.ncoeffs = new_ncoeffs;
   first_blkt->blkt_info.fir.coeffs = coeffs1;
   first_blkt->next_blkt = tmp_blkt->next_blkt;
-  free_fir (tmp_blkt);
+  if (!arena)
+  {
+    free_fir (tmp_blkt);
+  }
   *second_blkt = first_blkt->next_blkt;
 
   return EVALRESP_OK;
@@ -216,7 +222,7 @@ check_symmetry (evalresp_blkt *f, evalresp_channel *chan, evalresp_logger *log)
 }
 
 int
-check_channel (evalresp_logger *log, evalresp_channel *chan)
+check_channel (evalresp_logger *log, evalresp_arena *arena, evalresp_channel *chan)
 {
   evalresp_stage *stage_ptr, *next_stage, *prev_stage;
   evalresp_blkt *blkt_ptr, *next_blkt;
@@ -320,7 +326,7 @@ check_channel (evalresp_logger *log, evalresp_channel *chan)
 
         while (next_blkt && next_blkt->type == blkt_ptr->type)
         {
-          int status = merge_lists (blkt_ptr, &next_blkt, log);
+          int status = merge_lists (arena, blkt_ptr, &next_blkt, log);
           if (status)
           {
             return status;
@@ -407,7 +413,7 @@ check_channel (evalresp_logger *log, evalresp_channel *chan)
            If so, merge them into one blockette */
         while (next_blkt && next_blkt->type == blkt_ptr->type)
         {
-          int status = merge_coeffs (blkt_ptr, &next_blkt, log);
+          int status = merge_coeffs (arena, blkt_ptr, &next_blkt, log);
           if (status)
           {
             return status;
@@ -555,7 +561,7 @@ check_channel (evalresp_logger *log, evalresp_channel *chan)
                       "%s.%s.%s.%s: Missing gain in stage %d - using unit gain at 1Hz",
                       chan->network, chan->staname, chan->locid, chan->chaname,
                       i_stage + 1);
-        gain_blkt = alloc_gain (log);
+        gain_blkt = alloc_gain (arena, log);
         gain_blkt->blkt_info.gain.gain = 1;
         gain_blkt->blkt_info.gain.gain_freq = 1;
       }
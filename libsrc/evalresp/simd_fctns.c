@@ -0,0 +1,339 @@
+/* simd_fctns.c */
+
+/*
+ Batch versions of the pole-zero kernels in calc_fctns.c.  They evaluate a
+ block of frequencies for one pole-zero set, keeping the real and imaginary
+ parts in separate arrays.
+
+ Every result is computed with the same sequence of IEEE operations as the
+ scalar kernels (no fused multiply-add, no reordering), so the batch and
+ scalar paths agree bit-for-bit whichever instruction set is used.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+/* NEEDED for M_PI on windows */
+#define _USE_MATH_DEFINES
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "./private.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define EVALRESP_X86_SIMD
+#include <immintrin.h>
+#endif
+
+/* Fused multiply-add (AVX-512F has it, as does -march=native) would change
+   the rounding of the vector code and the scalar tails differently, so
+   contraction is disabled for the whole file */
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+/*==================================================================
+ *    Analog response at a single (angular) frequency
+ *    (same arithmetic as analog_trans() in calc_fctns.c)
+ *=================================================================*/
+static void
+analog_point (const evalresp_complex *ze, int nz, const evalresp_complex *po,
+              int np, double h0, double omega, double *re, double *im)
+{
+  double nr = 1.0, ni = 1.0, dr = 1.0, di = 1.0;
+  double tr, ti, r, mod_squared;
+  int i;
+
+  for (i = 0; i < nz; i++)
+  {
+    tr = 0.0 - ze[i].real;
+    ti = omega - ze[i].imag;
+    r = nr * tr - ni * ti;
+    ni = ni * tr + nr * ti;
+    nr = r;
+  }
+  for (i = 0; i < np; i++)
+  {
+    tr = 0.0 - po[i].real;
+    ti = omega - po[i].imag;
+    r = dr * tr - di * ti;
+    di = di * tr + dr * ti;
+    dr = r;
+  }
+  tr = dr * nr - (-di) * ni;
+  ti = (-di) * nr + dr * ni;
+  mod_squared = dr * dr + di * di;
+  *re = h0 * (tr / mod_squared);
+  *im = h0 * (ti / mod_squared);
+}
+
+#ifdef EVALRESP_X86_SIMD
+
+__attribute__ ((target ("sse2"))) static int
+analog_batch_sse2 (const evalresp_complex *ze, int nz, const evalresp_complex *po,
+                   int np, double h0, int laplace, const double *freq, int n,
+                   double *re, double *im)
+{
+  const __m128d one = _mm_set1_pd (1.0), sign = _mm_set1_pd (-0.0);
+  __m128d om, nr, ni, dr, di, tr, ti, r, m2;
+  int i, k;
+
+  for (k = 0; k + 2 <= n; k += 2)
+  {
+    om = _mm_loadu_pd (freq + k);
+    if (laplace)
+      om = _mm_mul_pd (_mm_set1_pd (2 * M_PI), om);
+    nr = ni = dr = di = one;
+    for (i = 0; i < nz; i++)
+    {
+      tr = _mm_set1_pd (0.0 - ze[i].real);
+      ti = _mm_sub_pd (om, _mm_set1_pd (ze[i].imag));
+      r = _mm_sub_pd (_mm_mul_pd (nr, tr), _mm_mul_pd (ni, ti));
+      ni = _mm_add_pd (_mm_mul_pd (ni, tr), _mm_mul_pd (nr, ti));
+      nr = r;
+    }
+    for (i = 0; i < np; i++)
+    {
+      tr = _mm_set1_pd (0.0 - po[i].real);
+      ti = _mm_sub_pd (om, _mm_set1_pd (po[i].imag));
+      r = _mm_sub_pd (_mm_mul_pd (dr, tr), _mm_mul_pd (di, ti));
+      di = _mm_add_pd (_mm_mul_pd (di, tr), _mm_mul_pd (dr, ti));
+      dr = r;
+    }
+    ti = _mm_xor_pd (di, sign);
+    tr = _mm_sub_pd (_mm_mul_pd (dr, nr), _mm_mul_pd (ti, ni));
+    ti = _mm_add_pd (_mm_mul_pd (ti, nr), _mm_mul_pd (dr, ni));
+    m2 = _mm_add_pd (_mm_mul_pd (dr, dr), _mm_mul_pd (di, di));
+    _mm_storeu_pd (re + k, _mm_mul_pd (_mm_set1_pd (h0), _mm_div_pd (tr, m2)));
+    _mm_storeu_pd (im + k, _mm_mul_pd (_mm_set1_pd (h0), _mm_div_pd (ti, m2)));
+  }
+  return k;
+}
+
+__attribute__ ((target ("avx2"))) static int
+analog_batch_avx2 (const evalresp_complex *ze, int nz, const evalresp_complex *po,
+                   int np, double h0, int laplace, const double *freq, int n,
+                   double *re, double *im)
+{
+  const __m256d one = _mm256_set1_pd (1.0), sign = _mm256_set1_pd (-0.0);
+  __m256d om, nr, ni, dr, di, tr, ti, r, m2;
+  int i, k;
+
+  for (k = 0; k + 4 <= n; k += 4)
+  {
+    om = _mm256_loadu_pd (freq + k);
+    if (laplace)
+      om = _mm256_mul_pd (_mm256_set1_pd (2 * M_PI), om);
+    nr = ni = dr = di = one;
+    for (i = 0; i < nz; i++)
+    {
+      tr = _mm256_set1_pd (0.0 - ze[i].real);
+      ti = _mm256_sub_pd (om, _mm256_set1_pd (ze[i].imag));
+      r = _mm256_sub_pd (_mm256_mul_pd (nr, tr), _mm256_mul_pd (ni, ti));
+      ni = _mm256_add_pd (_mm256_mul_pd (ni, tr), _mm256_mul_pd (nr, ti));
+      nr = r;
+    }
+    for (i = 0; i < np; i++)
+    {
+      tr = _mm256_set1_pd (0.0 - po[i].real);
+      ti = _mm256_sub_pd (om, _mm256_set1_pd (po[i].imag));
+      r = _mm256_sub_pd (_mm256_mul_pd (dr, tr), _mm256_mul_pd (di, ti));
+      di = _mm256_add_pd (_mm256_mul_pd (di, tr), _mm256_mul_pd (dr, ti));
+      dr = r;
+    }
+    ti = _mm256_xor_pd (di, sign);
+    tr = _mm256_sub_pd (_mm256_mul_pd (dr, nr), _mm256_mul_pd (ti, ni));
+    ti = _mm256_add_pd (_mm256_mul_pd (ti, nr), _mm256_mul_pd (dr, ni));
+    m2 = _mm256_add_pd (_mm256_mul_pd (dr, dr), _mm256_mul_pd (di, di));
+    _mm256_storeu_pd (re + k, _mm256_mul_pd (_mm256_set1_pd (h0), _mm256_div_pd (tr, m2)));
+    _mm256_storeu_pd (im + k, _mm256_mul_pd (_mm256_set1_pd (h0), _mm256_div_pd (ti, m2)));
+  }
+  return k;
+}
+
+__attribute__ ((target ("avx512f"))) static int
+analog_batch_avx512 (const evalresp_complex *ze, int nz, const evalresp_complex *po,
+                     int np, double h0, int laplace, const double *freq, int n,
+                     double *re, double *im)
+{
+  const __m512d one = _mm512_set1_pd (1.0);
+  const __m512i sign = _mm512_castpd_si512 (_mm512_set1_pd (-0.0));
+  __m512d om, nr, ni, dr, di, tr, ti, r, m2;
+  int i, k;
+
+  for (k = 0; k + 8 <= n; k += 8)
+  {
+    om = _mm512_loadu_pd (freq + k);
+    if (laplace)
+      om = _mm512_mul_pd (_mm512_set1_pd (2 * M_PI), om);
+    nr = ni = dr = di = one;
+    for (i = 0; i < nz; i++)
+    {
+      tr = _mm512_set1_pd (0.0 - ze[i].real);
+      ti = _mm512_sub_pd (om, _mm512_set1_pd (ze[i].imag));
+      r = _mm512_sub_pd (_mm512_mul_pd (nr, tr), _mm512_mul_pd (ni, ti));
+      ni = _mm512_add_pd (_mm512_mul_pd (ni, tr), _mm512_mul_pd (nr, ti));
+      nr = r;
+    }
+    for (i = 0; i < np; i++)
+    {
+      tr = _mm512_set1_pd (0.0 - po[i].real);
+      ti = _mm512_sub_pd (om, _mm512_set1_pd (po[i].imag));
+      r = _mm512_sub_pd (_mm512_mul_pd (dr, tr), _mm512_mul_pd (di, ti));
+      di = _mm512_add_pd (_mm512_mul_pd (di, tr), _mm512_mul_pd (dr, ti));
+      dr = r;
+    }
+    ti = _mm512_castsi512_pd (_mm512_xor_si512 (_mm512_castpd_si512 (di), sign));
+    tr = _mm512_sub_pd (_mm512_mul_pd (dr, nr), _mm512_mul_pd (ti, ni));
+    ti = _mm512_add_pd (_mm512_mul_pd (ti, nr), _mm512_mul_pd (dr, ni));
+    m2 = _mm512_add_pd (_mm512_mul_pd (dr, dr), _mm512_mul_pd (di, di));
+    _mm512_storeu_pd (re + k, _mm512_mul_pd (_mm512_set1_pd (h0), _mm512_div_pd (tr, m2)));
+    _mm512_storeu_pd (im + k, _mm512_mul_pd (_mm512_set1_pd (h0), _mm512_div_pd (ti, m2)));
+  }
+  return k;
+}
+
+#endif /* EVALRESP_X86_SIMD */
+
+int
+simd_isa_supported (int isa)
+{
+  switch (isa)
+  {
+  case SIMD_SCALAR:
+    return 1;
+#ifdef EVALRESP_X86_SIMD
+  case SIMD_SSE2:
+    return 1;
+  case SIMD_AVX2:
+    __builtin_cpu_init ();
+    return __builtin_cpu_supports ("avx2");
+  case SIMD_AVX512:
+    __builtin_cpu_init ();
+    return __builtin_cpu_supports ("avx512f");
+#endif
+  default:
+    return 0;
+  }
+}
+
+int
+simd_best_isa (void)
+{
+  int isa;
+
+  for (isa = SIMD_AVX512; isa > SIMD_SCALAR; isa--)
+  {
+    if (simd_isa_supported (isa))
+      break;
+  }
+  return isa;
+}
+
+void
+analog_trans_batch (int isa, const evalresp_blkt *blkt_ptr, const double *freq,
+                    int nfreqs, double *re, double *im)
+{
+  const evalresp_complex *ze, *po;
+  int nz, np, k = 0, laplace;
+  double h0, omega;
+
+  ze = blkt_ptr->blkt_info.pole_zero.zeros;
+  nz = blkt_ptr->blkt_info.pole_zero.nzeros;
+  po = blkt_ptr->blkt_info.pole_zero.poles;
+  np = blkt_ptr->blkt_info.pole_zero.npoles;
+  h0 = blkt_ptr->blkt_info.pole_zero.a0;
+  laplace = (blkt_ptr->type == LAPLACE_PZ);
+
+#ifdef EVALRESP_X86_SIMD
+  switch (isa)
+  {
+  case SIMD_AVX512:
+    k = analog_batch_avx512 (ze, nz, po, np, h0, laplace, freq, nfreqs, re, im);
+    break;
+  case SIMD_AVX2:
+    k = analog_batch_avx2 (ze, nz, po, np, h0, laplace, freq, nfreqs, re, im);
+    break;
+  case SIMD_SSE2:
+    k = analog_batch_sse2 (ze, nz, po, np, h0, laplace, freq, nfreqs, re, im);
+    break;
+  default:
+    break;
+  }
+#endif
+
+  /* scalar fallback, and the tail that does not fill a whole vector */
+  for (; k < nfreqs; k++)
+  {
+    omega = laplace ? 2 * M_PI * freq[k] : freq[k];
+    analog_point (ze, nz, po, np, h0, omega, &re[k], &im[k]);
+  }
+}
+
+void
+iir_pz_trans_batch (const evalresp_blkt *blkt_ptr, double sint, const double *freq,
+                    int nfreqs, double *re, double *im)
+{
+  const evalresp_complex *ze, *po;
+  double h0, wsint, R, I;
+  double c[SIMD_BATCH], s[SIMD_BATCH], mod[SIMD_BATCH], pha[SIMD_BATCH];
+  int nz, np, i, k, n, k0;
+
+  ze = blkt_ptr->blkt_info.pole_zero.zeros;
+  nz = blkt_ptr->blkt_info.pole_zero.nzeros;
+  po = blkt_ptr->blkt_info.pole_zero.poles;
+  np = blkt_ptr->blkt_info.pole_zero.npoles;
+  h0 = blkt_ptr->blkt_info.pole_zero.a0;
+
+  /* There is no vector atan2() that reproduces libm exactly, so this kernel
+     only reorganises the loops: each pole or zero is applied to a block of
+     frequencies, which keeps the coefficients in registers and lets the
+     compiler vectorize the modulus updates. */
+  for (k0 = 0; k0 < nfreqs; k0 += SIMD_BATCH)
+  {
+    n = nfreqs - k0 < SIMD_BATCH ? nfreqs - k0 : SIMD_BATCH;
+    for (k = 0; k < n; k++)
+    {
+      wsint = 2 * M_PI * freq[k0 + k] * sint;
+      c[k] = cos (wsint);
+      s[k] = sin (wsint);
+      mod[k] = 1.0;
+      pha[k] = 0.0;
+    }
+    for (i = 0; i < nz; i++)
+    {
+      for (k = 0; k < n; k++)
+      {
+        R = c[k] - ze[i].real;
+        I = s[k] - ze[i].imag;
+        mod[k] *= sqrt (R * R + I * I);
+        if (R == 0.0 && I == 0.0)
+          pha[k] += 0.0;
+        else
+          pha[k] += atan2 (I, R);
+      }
+    }
+    for (i = 0; i < np; i++)
+    {
+      for (k = 0; k < n; k++)
+      {
+        R = c[k] - po[i].real;
+        I = s[k] - po[i].imag;
+        mod[k] /= sqrt (R * R + I * I);
+        if (R == 0.0 && I == 0.0)
+          pha[k] += 0.0;
+        else
+          pha[k] -= atan2 (I, R);
+      }
+    }
+    for (k = 0; k < n; k++)
+    {
+      re[k0 + k] = mod[k] * cos (pha[k]) * h0;
+      im[k0 + k] = mod[k] * sin (pha[k]) * h0;
+    }
+  }
+}
@@ -0,0 +1,495 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <evalresp/constants.h>
+#include <evalresp/input.h>
+#include <evalresp/private.h>
+#include <evalresp/public_api.h>
+#include <evalresp/stationxml2resp/xml_to_dom.h>
+#include <evalresp/stationxml2resp/dom_to_channel.h>
+#include <evalresp_log/log.h>
+
+
+// This file builds channels directly from the in-memory model of the
+// station.xml document (created in x2r_xml.c).  The result is what the RESP
+// reader would make of the output of x2r_resp_util_write() (dom_to_seed.c),
+// except that the values are not rounded by printing.
+
+
+#define OPEN "No Ending Time"
+
+
+/* The channel being built, and where the next blockette goes. */
+typedef struct {
+    evalresp_logger *log;
+    evalresp_options const *options;
+    evalresp_arena *arena;
+    evalresp_channel *chan;
+    evalresp_stage *stage;  /* the last stage */
+    evalresp_blkt *blkt;  /* the last blockette */
+    int nblkts;
+    int sequence_no;  /* of the last blockette */
+    int no_units;  /* the last stage has no units yet */
+} builder;
+
+
+/* Copy the first white space separated field, as the RESP reader sees it. */
+static void first_field(const char *value, char *field) {
+    int i = 0;
+    for (; value && isspace((unsigned char)*value); ++value);
+    for (; value && *value && !isspace((unsigned char)*value) && i < MAXFLDLEN - 1; ++value) {
+        field[i++] = *value;
+    }
+    field[i] = '\0';
+}
+
+
+/* Format epoch as julian days (as format_date_yjhms in dom_to_seed.c). */
+static int format_date(evalresp_logger *log, const time_t epoch, char *date) {
+
+    struct tm *tm;
+
+    if (!epoch) {
+        strncpy(date, OPEN, DATIMLEN);
+    } else if (!(tm = gmtime(&epoch))) {
+        evalresp_log(log, EV_ERROR, EV_ERROR, "Cannot convert epoch to time");
+        return EVALRESP_ERR;
+    } else if (!strftime(date, DATIMLEN, "%Y,%j,%H:%M:%S", tm)) {
+        evalresp_log(log, EV_ERROR, EV_ERROR, "Cannot format date in %d char", DATIMLEN);
+        return EVALRESP_ERR;
+    }
+    return EVALRESP_OK;
+}
+
+
+/* Convert transfer function type from station.xml (as convert_tft in dom_to_seed.c). */
+static char convert_tft(const char *transfer_function_type) {
+    if (!strcmp(transfer_function_type, "LAPLACE (RADIANS/SECOND)")) {
+        return 'A';
+    } else if (!strcmp(transfer_function_type, "LAPLACE (HERTZ)")) {
+        return 'B';
+    } else if (!strcmp(transfer_function_type, "DIGITAL (Z-TRANSFORM)")
+            || !strcmp(transfer_function_type, "DIGITAL")) {
+        return 'D';
+    } else {
+        return '\0';
+    }
+}
+
+
+/* Look up units from the "NAME - description" line the reader would see. */
+static void parse_x2r_units(builder *b, const x2r_units *units, int *code) {
+
+    char line[MAXLINELEN], *start;
+
+    snprintf(line, MAXLINELEN, "%s - %s", units->name, units->description);
+    for (start = line; *start == ' ' || *start == '\t'; ++start);
+    // like parse_units, the reader logs unsupported units but carries on
+    (void)parse_units(b->log, b->options, start, b->chan, code);
+}
+
+
+/*
+ * Add a blockette, starting a new stage when the sequence number changes
+ * (as read_channel_data does).  The units of a stage are those of its first
+ * filter (NULL units for decimation and gain).
+ */
+static int add_blkt(builder *b, int sequence_no, evalresp_blkt *blkt, const x2r_units *input,
+        const x2r_units *output) {
+
+    evalresp_stage *stage;
+    int input_units = 0, output_units = 0;
+
+    if (!blkt) {
+        return EVALRESP_MEM;
+    }
+    if (input) {
+        parse_x2r_units(b, input, &input_units);
+        parse_x2r_units(b, output, &output_units);
+    }
+
+    if (!b->nblkts++) {
+        b->stage->first_blkt = blkt;
+        b->stage->sequence_no = sequence_no;
+        b->no_units = 1;
+    } else if (b->sequence_no != sequence_no) {
+        if (!(stage = alloc_stage(b->arena, b->log))) {
+            return EVALRESP_MEM;
+        }
+        b->chan->nstages++;
+        stage->sequence_no = sequence_no;
+        stage->first_blkt = blkt;
+        b->stage->next_stage = stage;
+        b->stage = stage;
+        b->no_units = 1;
+    } else {
+        b->blkt->next_blkt = blkt;
+    }
+
+    if (b->no_units && input) {
+        b->stage->input_units = input_units;
+        b->stage->output_units = output_units;
+        b->no_units = 0;
+    }
+
+    b->blkt = blkt;
+    b->sequence_no = sequence_no;
+    return EVALRESP_OK;
+}
+
+
+/* Add x2r_poles_zeros (as read_pz). */
+static int add_poles_zeros(builder *b, int stage, const x2r_poles_zeros *poles_zeros) {
+
+    int status, i, type;
+    evalresp_blkt *blkt = NULL;
+    evalresp_pole_zero *pz;
+
+    switch (convert_tft(poles_zeros->pz_transfer_function_type)) {
+    case 'A':
+        type = LAPLACE_PZ;
+        break;
+    case 'B':
+        type = ANALOG_PZ;
+        break;
+    case 'D':
+        type = IIR_PZ;
+        break;
+    default:
+        evalresp_log(b->log, EV_ERROR, EV_ERROR,
+                "parse_pz; parsing (Poles & Zeros), illegal filter type ('Undefined')");
+        return EVALRESP_PAR;
+    }
+
+    if (!(status = add_blkt(b, stage, blkt = alloc_pz(b->arena, b->log),
+            &poles_zeros->input_units, &poles_zeros->output_units))) {
+        blkt->type = type;
+        pz = &blkt->blkt_info.pole_zero;
+        pz->a0 = poles_zeros->normalization_factor;
+        pz->a0_freq = poles_zeros->normalization_frequency;
+        pz->nzeros = poles_zeros->n_zeros;
+        pz->npoles = poles_zeros->n_poles;
+        if ((pz->nzeros && !(pz->zeros = alloc_complex(pz->nzeros, b->arena, b->log)))
+                || (pz->npoles && !(pz->poles = alloc_complex(pz->npoles, b->arena, b->log)))) {
+            return EVALRESP_MEM;
+        }
+        for (i = 0; i < pz->nzeros; ++i) {
+            pz->zeros[i].real = poles_zeros->zero[i].real.value;
+            pz->zeros[i].imag = poles_zeros->zero[i].imaginary.value;
+        }
+        for (i = 0; i < pz->npoles; ++i) {
+            pz->poles[i].real = poles_zeros->pole[i].real.value;
+            pz->poles[i].imag = poles_zeros->pole[i].imaginary.value;
+        }
+    }
+
+    return status;
+}
+
+
+/* Add x2r_coefficients (as read_iir_coeff, or read_coeff without denominators). */
+static int add_coefficients(builder *b, int stage, const x2r_coefficients *coefficients) {
+
+    int status, i;
+    char tft[2] = "";
+    evalresp_blkt *blkt = NULL;
+    evalresp_coeff *coeff;
+    evalresp_fir *fir;
+
+    if ((tft[0] = convert_tft(coefficients->cf_transfer_function_type)) != 'D') {
+        evalresp_log(b->log, EV_ERROR, EV_ERROR,
+                "parse_coeff; parsing (%s), unexpected filter type ('%s')",
+                coefficients->n_denominators ? "IIR_COEFFS" : "FIR_ASYM",
+                tft[0] ? tft : "Undefined");
+        return EVALRESP_PAR;
+    }
+
+    if (coefficients->n_denominators) {
+        if (!(status = add_blkt(b, stage, blkt = alloc_coeff(b->arena, b->log),
+                &coefficients->input_units, &coefficients->output_units))) {
+            blkt->type = IIR_COEFFS;
+            coeff = &blkt->blkt_info.coeff;
+            coeff->nnumer = coefficients->n_numerators;
+            coeff->ndenom = coefficients->n_denominators;
+            if ((coeff->nnumer && !(coeff->numer = alloc_double(coeff->nnumer, b->arena, b->log)))
+                    || !(coeff->denom = alloc_double(coeff->ndenom, b->arena, b->log))) {
+                return EVALRESP_MEM;
+            }
+            for (i = 0; i < coeff->nnumer; ++i) {
+                coeff->numer[i] = coefficients->numerator[i].value;
+            }
+            for (i = 0; i < coeff->ndenom; ++i) {
+                coeff->denom[i] = coefficients->denominator[i].value;
+            }
+        }
+    } else {
+        if (!(status = add_blkt(b, stage, blkt = alloc_fir(b->arena, b->log),
+                &coefficients->input_units, &coefficients->output_units))) {
+            blkt->type = FIR_ASYM;
+            fir = &blkt->blkt_info.fir;
+            fir->ncoeffs = coefficients->n_numerators;
+            if (fir->ncoeffs && !(fir->coeffs = alloc_double(fir->ncoeffs, b->arena, b->log))) {
+                return EVALRESP_MEM;
+            }
+            for (i = 0; i < fir->ncoeffs; ++i) {
+                fir->coeffs[i] = coefficients->numerator[i].value;
+            }
+        }
+    }
+
+    return status;
+}
+
+
+/* Add x2r_response_list (as read_list). */
+static int add_response_list(builder *b, int stage, const x2r_response_list *response_list) {
+
+    int status, i;
+    evalresp_blkt *blkt = NULL;
+    evalresp_list *list;
+
+    if (!(status = add_blkt(b, stage, blkt = alloc_list(b->arena, b->log),
+            &response_list->input_units, &response_list->output_units))) {
+        blkt->type = LIST;
+        list = &blkt->blkt_info.list;
+        list->nresp = response_list->n_response_list_elements;
+        if (list->nresp && (!(list->freq = alloc_double(list->nresp, b->arena, b->log))
+                || !(list->amp = alloc_double(list->nresp, b->arena, b->log))
+                || !(list->phase = alloc_double(list->nresp, b->arena, b->log)))) {
+            return EVALRESP_MEM;
+        }
+        for (i = 0; i < list->nresp; ++i) {
+            list->freq[i] = response_list->response_list_element[i].frequency;
+            list->amp[i] = response_list->response_list_element[i].amplitude.value;
+            list->phase[i] = response_list->response_list_element[i].phase.value;
+        }
+    }
+
+    return status;
+}
+
+
+/* Add x2r_fir (as read_fir). */
+static int add_fir(builder *b, int stage, const x2r_fir *x2r_fir) {
+
+    int status, i;
+    evalresp_blkt *blkt = NULL;
+    evalresp_fir *fir;
+
+    if (!(status = add_blkt(b, stage, blkt = alloc_fir(b->arena, b->log),
+            &x2r_fir->input_units, &x2r_fir->output_units))) {
+        // as convert_symmetry in dom_to_seed.c
+        if (!strcmp(x2r_fir->symmetry, "EVEN")) {
+            blkt->type = FIR_SYM_2;
+        } else if (!strcmp(x2r_fir->symmetry, "ODD")) {
+            blkt->type = FIR_SYM_1;
+        } else {
+            blkt->type = FIR_ASYM;
+        }
+        fir = &blkt->blkt_info.fir;
+        fir->ncoeffs = x2r_fir->n_numerator_coefficients;
+        if (fir->ncoeffs && !(fir->coeffs = alloc_double(fir->ncoeffs, b->arena, b->log))) {
+            return EVALRESP_MEM;
+        }
+        for (i = 0; i < fir->ncoeffs; ++i) {
+            fir->coeffs[i] = x2r_fir->numerator_coefficient[i].value;
+        }
+    }
+
+    return status;
+}
+
+
+/* Add x2r_polynomial (as read_polynomial). */
+static int add_polynomial(builder *b, int stage, const x2r_polynomial *polynomial) {
+
+    int status, i;
+    evalresp_blkt *blkt = NULL;
+    evalresp_polynomial *poly;
+
+    if (!(status = add_blkt(b, stage, blkt = alloc_polynomial(b->arena, b->log),
+            &polynomial->input_units, &polynomial->output_units))) {
+        blkt->type = POLYNOMIAL;
+        poly = &blkt->blkt_info.polynomial;
+        // these are fixed by print_polynomial in dom_to_seed.c
+        poly->approximation_type = 'M';
+        poly->frequency_units = 'B';
+        poly->lower_freq_bound = polynomial->frequency_lower_bound;
+        poly->upper_freq_bound = polynomial->frequency_upper_bound;
+        poly->lower_approx_bound = polynomial->approximation_lower_bound;
+        poly->upper_approx_bound = polynomial->approximation_upper_bound;
+        poly->max_abs_error = polynomial->maximum_error;
+        poly->ncoeffs = polynomial->n_coefficients;
+        if (poly->ncoeffs && (!(poly->coeffs = alloc_double(poly->ncoeffs, b->arena, b->log))
+                || !(poly->coeffs_err = alloc_double(poly->ncoeffs, b->arena, b->log)))) {
+            return EVALRESP_MEM;
+        }
+        for (i = 0; i < poly->ncoeffs; ++i) {
+            poly->coeffs[i] = polynomial->coefficient[i].value.value;
+            poly->coeffs_err[i] = polynomial->coefficient[i].value.minus_error;
+        }
+    }
+
+    return status;
+}
+
+
+/* Add x2r_decimation (as read_deci). */
+static int add_decimation(builder *b, int stage, const x2r_decimation *decimation) {
+
+    int status;
+    evalresp_blkt *blkt = NULL;
+    evalresp_decimation *deci;
+
+    if (!(status = add_blkt(b, stage, blkt = alloc_deci(b->arena, b->log), NULL, NULL))) {
+        blkt->type = DECIMATION;
+        deci = &blkt->blkt_info.decimation;
+        if (decimation->input_sample_rate) {
+            deci->sample_int = 1.0 / decimation->input_sample_rate;
+        }
+        deci->deci_fact = decimation->factor;
+        deci->deci_offset = decimation->offset;
+        deci->estim_delay = decimation->delay;
+        deci->applied_corr = decimation->correction;
+    }
+
+    return status;
+}
+
+
+/* Add x2r_gain (as read_gain). */
+static int add_gain(builder *b, int stage, const x2r_gain *gain) {
+
+    int status;
+    evalresp_blkt *blkt = NULL;
+
+    if (!(status = add_blkt(b, stage, blkt = alloc_gain(b->arena, b->log), NULL, NULL))) {
+        blkt->type = GAIN;
+        blkt->blkt_info.gain.gain = gain->value;
+        blkt->blkt_info.gain.gain_freq = gain->frequency;
+    }
+
+    return status;
+}
+
+
+/* Add x2r_stage (in the order of print_stage in dom_to_seed.c). */
+static int add_stage(builder *b, const x2r_stage *stage) {
+
+    int status = EVALRESP_OK;
+
+    switch (stage->type) {
+    case X2R_STAGE_POLES_ZEROS:
+        status = add_poles_zeros(b, stage->number, stage->u.poles_zeros);
+        break;
+    case X2R_STAGE_COEFFICIENTS:
+        status = add_coefficients(b, stage->number, stage->u.coefficients);
+        break;
+    case X2R_STAGE_RESPONSE_LIST:
+        status = add_response_list(b, stage->number, stage->u.response_list);
+        break;
+    case X2R_STAGE_FIR:
+        status = add_fir(b, stage->number, stage->u.fir);
+        break;
+    case X2R_STAGE_POLYNOMIAL:
+        status = add_polynomial(b, stage->number, stage->u.polynomial);
+        break;
+    default:
+        evalresp_log(b->log, EV_WARN, 0, "No content in stage (during conversion)");
+        break;
+    }
+
+    if (!status && stage->decimation) {
+        status = add_decimation(b, stage->number, stage->decimation);
+    }
+
+    if (!status && stage->stage_gain) {
+        status = add_gain(b, stage->number, stage->stage_gain);
+    }
+
+    return status;
+}
+
+
+/*
+ * Set the names and dates of a channel (as read_channel_header).
+ */
+int x2r_channel_header(evalresp_logger *log, const char *net, const char *stn,
+        const x2r_channel *channel, evalresp_channel *chan) {
+
+    int status;
+    char field[MAXFLDLEN];
+
+    chan->nstages = 0;
+    chan->sensfreq = 0.0;
+    chan->sensit = 0.0;
+    chan->calc_sensit = 0.0;
+    chan->calc_delay = 0.0;
+    chan->estim_delay = 0.0;
+    chan->applied_corr = 0.0;
+    chan->sint = 0.0;
+
+    first_field(stn, field);
+    strncpy(chan->staname, field, STALEN);
+
+    first_field(net, field);
+    strncpy(chan->network, strncmp(field, "??", 2) ? field : "", NETLEN);
+
+    if (!channel) {
+        return EVALRESP_OK;
+    }
+
+    // print_channel writes an empty location as "??"
+    first_field(channel->location_code, field);
+    strncpy(chan->locid, strncmp(field, "??", 2) ? field : "", LOCIDLEN);
+
+    first_field(channel->code, field);
+    strncpy(chan->chaname, field, CHALEN);
+
+    if (!(status = format_date(log, channel->start_date, chan->beg_t))) {
+        status = format_date(log, channel->end_date, chan->end_t);
+    }
+
+    return status;
+}
+
+
+/*
+ * Build the stages of a channel (as read_channel_data).
+ */
+int x2r_channel_data(evalresp_logger *log, evalresp_options const *const options,
+        evalresp_arena *arena, const x2r_channel *channel, evalresp_channel *chan) {
+
+    int status = EVALRESP_OK, i;
+    const x2r_response *response = &channel->response;
+    builder b;
+
+    memset(&b, 0, sizeof(b));
+    b.log = log;
+    b.options = options;
+    b.arena = arena;
+    b.chan = chan;
+
+    if (!(b.stage = alloc_stage(arena, log))) {
+        return EVALRESP_MEM;
+    }
+    chan->first_stage = b.stage;
+    chan->nstages++;
+
+    for (i = 0; !status && i < response->n_stages; ++i) {
+        status = add_stage(&b, &response->stage[i]);
+    }
+
+    // as print_response in dom_to_seed.c
+    if (!status && response->instrument_sensitivity && response->instrument_sensitivity->value != 0) {
+        status = add_gain(&b, 0, response->instrument_sensitivity);
+    }
+
+    if (!status && response->instrument_polynomial) {
+        status = add_polynomial(&b, 0, response->instrument_polynomial);
+    }
+
+    return status;
+}
@@ -0,0 +1,47 @@
+/**
+ * @file
+ * @brief This file contains declarations for converting the evalresp
+ *        XML-to-RSEED in-memory model straight to channels.
+ */
+
+#ifndef X2R_CHANNEL_H
+#define X2R_CHANNEL_H
+
+#include <evalresp/private.h>
+#include <evalresp/stationxml2resp/xml_to_dom.h>
+#include <evalresp_log/log.h>
+
+/**
+ * @private
+ * @ingroup evalresp_private_x2r_ws
+ * @param[in] log logging structure
+ * @param[in] net network code
+ * @param[in] stn station code
+ * @param[in] channel channel of the in-memory model (NULL to set only the
+ *            network and station names)
+ * @param[out] chan channel whose names and dates are set (no stages)
+ * @brief Set the names and dates of a channel, as read from the RESP header
+ *        that x2r_resp_util_write() would print for it.
+ * @retval EVALRESP_OK on success
+ */
+int x2r_channel_header (evalresp_logger *log, const char *net, const char *stn,
+                        const x2r_channel *channel, evalresp_channel *chan);
+
+/**
+ * @private
+ * @ingroup evalresp_private_x2r_ws
+ * @param[in] log logging structure
+ * @param[in] options unit options are used (may be NULL)
+ * @param[in] arena where the stages and blockettes are allocated (NULL for the heap)
+ * @param[in] channel channel of the in-memory model
+ * @param[in,out] chan channel with its header set, whose stages are added
+ * @brief Build the stages and blockettes of a channel from the in-memory model,
+ *        as they would be read from the RESP that x2r_resp_util_write() would
+ *        print, but without printing and parsing (or rounding) the values.
+ * @details The channel is not checked (see check_channel()).
+ * @retval EVALRESP_OK on success
+ */
+int x2r_channel_data (evalresp_logger *log, evalresp_options const *const options,
+                      evalresp_arena *arena, const x2r_channel *channel, evalresp_channel *chan);
+
+#endif
@@ -43,8 +43,12 @@ int x2r_resp_util_write(evalresp_logger *log, FILE *out, const x2r_fdsn_station_
  * @private
  * @ingroup evalresp_private_x2r_ws
  * @brief parse a mxml root node to datastructure
+ * @details With nthreads more than one, the channels are parsed in parallel
+ *          once the networks and stations are read, each into its place
+ *          in the model.
  */
-int x2r_parse_fdsn_station_xml(evalresp_logger *log, mxml_node_t *doc, x2r_fdsn_station_xml **root);
+int x2r_parse_fdsn_station_xml(evalresp_logger *log, mxml_node_t *doc, int nthreads,
+        x2r_fdsn_station_xml **root);
 
 /**
  * @private
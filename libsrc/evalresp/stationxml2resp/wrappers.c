@@ -63,6 +63,7 @@ save_mxml_service_to_char (evalresp_logger *log, x2r_fdsn_station_xml *root, cha
  * @private
  * @param[in] log logging structure where you want information to be sent
  * @param[in] xml_in char * containing xml to be translated
+ * @param[in] nthreads number of threads used to parse the channels
  * @param[out] root the root node of the xml converted to c stuructures
  * @retval EVALRESP_OK on success
  * @sa x2r_fdsn_station_xml
@@ -71,7 +72,7 @@ save_mxml_service_to_char (evalresp_logger *log, x2r_fdsn_station_xml *root, cha
  * @brief load the xml string into a mxml generated structure
  */
 static int
-load_mxml_service (evalresp_logger *log, char *xml_in, x2r_fdsn_station_xml **root)
+load_mxml_service (evalresp_logger *log, char *xml_in, int nthreads, x2r_fdsn_station_xml **root)
 {
   int status;
   mxml_node_t *doc = NULL;
@@ -92,7 +93,7 @@ load_mxml_service (evalresp_logger *log, char *xml_in, x2r_fdsn_station_xml **ro
   else
   {
     /* parse the mxml into data structure */
-    status = x2r_parse_fdsn_station_xml (log, doc, root);
+    status = x2r_parse_fdsn_station_xml (log, doc, nthreads, root);
   }
 
   /* clean up mxml */
@@ -104,6 +105,7 @@ load_mxml_service (evalresp_logger *log, char *xml_in, x2r_fdsn_station_xml **ro
  * @private
  * @param[in] log logging structure where you want information to be sent
  * @param[in] xml_in char * containing xml to be translated
+ * @param[in] nthreads number of threads used to parse the channels
  * @param[in,out] resp_out a pointer where to allocate and store the translated response file as char *
  * @retval EVALRESP_OK on success
  * @pre xml_in must not be NULL and *resp_out must be NULL
@@ -111,13 +113,13 @@ load_mxml_service (evalresp_logger *log, char *xml_in, x2r_fdsn_station_xml **ro
  * @brief house keeping function to initiate xml -> resp files but stored as char *
  */
 static int
-convert_xml_to_char (evalresp_logger *log, char *xml_in, char **resp_out)
+convert_xml_to_char (evalresp_logger *log, char *xml_in, int nthreads, char **resp_out)
 {
   int status;
   x2r_fdsn_station_xml *root = NULL;
 
   /* load xml string and parse */
-  if (EVALRESP_OK == (status = load_mxml_service (log, xml_in, &root)))
+  if (EVALRESP_OK == (status = load_mxml_service (log, xml_in, nthreads, &root)))
   {
     /* convert xml data structure to resp string */
     status = save_mxml_service_to_char (log, root, resp_out);
@@ -136,7 +138,15 @@ evalresp_xml_to_char (evalresp_logger *log, int xml_flag, char *xml_in, char **r
     return EVALRESP_OK;
   }
   /* call underlying functions */
-  return convert_xml_to_char(log, xml_in, resp_out);
+  return convert_xml_to_char(log, xml_in, 1, resp_out);
+}
+
+int
+evalresp_xml_options_to_char (evalresp_logger *log, evalresp_options const *const options,
+                              char *xml_in, char **resp_out)
+{
+  /* the channels are parsed on options->nthreads threads */
+  return convert_xml_to_char (log, xml_in, options ? options->nthreads : 1, resp_out);
 }
 
 int
@@ -1,6 +1,7 @@
 #ifndef __EVALRESP_X2R_WRAPPERS_H__
 #define __EVALRESP_X2R_WRAPPERS_H__
 
+#include <evalresp/public_api.h>
 #include <evalresp_log/log.h>
 #include <stdio.h>
 
@@ -16,6 +17,21 @@
  */
 int evalresp_xml_to_char (evalresp_logger *log, int xml_flag, char *xml_in, char **resp_out);
 
+/**
+ * @param[in] log logging structure where you want information to be sent
+ * @param[in] options nthreads is used (may be NULL)
+ * @param[in] xml_in char * containing xml to be translated
+ * @param[in,out] resp_out a pointer where to allocate and store the translated response file as char *
+ * @retval EVALRESP_OK on success
+ * @pre xml_in must not be NULL and *resp_out must be NULL
+ * @post *resp_out will be allocated using calloc that must be freed
+ * @brief do conversion of xml -> resp files but stored as char *, as
+ *        evalresp_xml_to_char(), parsing the channels on options->nthreads
+ *        threads (the result is the same)
+ */
+int evalresp_xml_options_to_char (evalresp_logger *log, evalresp_options const *const options,
+                                  char *xml_in, char **resp_out);
+
 /**
  * @param[in] log logging structure where you want information to be sent
  * @param[in] xml_flag if set to one then conversion happens otherwise nothing happens
@@ -3,6 +3,7 @@
 #include <mxml.h>
 #include <evalresp_log/log.h>
 
+#include <evalresp/private.h>
 #include <evalresp/stationxml2resp.h>
 #include <evalresp/stationxml2resp/xml_to_dom.h>
 
@@ -18,20 +19,6 @@
 #define timegm _mkgmtime
 #endif
 
-/* Read an XML file from the given stream and create an in-memory model. */
-static int stream2doc(evalresp_logger *log, FILE *in, mxml_node_t **doc) {
-
-    int status = X2R_OK;
-
-    if (!(*doc = mxmlLoadFile(NULL, in, MXML_OPAQUE_CALLBACK))) {
-        evalresp_log(log, EV_ERROR, 0, "Could not parse input");
-        status = X2R_ERR_XML;
-    }
-
-    return status;
-}
-
-
 /* A collection of nodes. */
 typedef struct {
     int n;
@@ -735,8 +722,8 @@ static int parse_fir(evalresp_logger *log, mxml_node_t *node, x2r_fir *fir) {
 }
 
 
-/* Free an x2r_fir value. */
-static int free_fir(x2r_fir *fir, int status) {
+/* Free an x2r_fir value (not free_fir(), which frees a blockette). */
+static int free_x2r_fir(x2r_fir *fir, int status) {
     if (fir) {
         free(fir->symmetry);
         free(fir->name);
@@ -1003,7 +990,7 @@ static int free_stage(x2r_stage *stage, int status) {
             status = free_response_list(stage->u.response_list, status);
             break;
         case X2R_STAGE_FIR:
-            status = free_fir(stage->u.fir, status);
+            status = free_x2r_fir(stage->u.fir, status);
             break;
         case X2R_STAGE_POLYNOMIAL:
             status = free_polynomial(stage->u.polynomial, status);
@@ -1090,13 +1077,10 @@ static int free_response(x2r_response *response, int status) {
 }
 
 
-/* Read an x2r_channel value from the current node. */
-static int parse_channel(evalresp_logger *log, mxml_node_t *node, x2r_channel *channel) {
+/* Read the names and dates of an x2r_channel value from the current node. */
+static int parse_channel_attributes(evalresp_logger *log, mxml_node_t *node, x2r_channel *channel) {
 
     int status = X2R_OK;
-    mxml_node_t *response;
-
-    //evalresp_log(log, EV_DEBUG, 0, "Parsing channel");
 
     if (!(status = char_attribute(log, node, "code", NULL, &channel->code))) {
         if (!(status = char_attribute(log, node, "locationCode", NULL, &channel->location_code))) {
@@ -1107,7 +1091,19 @@ static int parse_channel(evalresp_logger *log, mxml_node_t *node, x2r_channel *c
         }
     }
 
-    if (!status) {
+    return status;
+}
+
+
+/* Read an x2r_channel value from the current node. */
+static int parse_channel(evalresp_logger *log, mxml_node_t *node, x2r_channel *channel) {
+
+    int status = X2R_OK;
+    mxml_node_t *response;
+
+    //evalresp_log(log, EV_DEBUG, 0, "Parsing channel");
+
+    if (!(status = parse_channel_attributes(log, node, channel))) {
         if (!(status = find_child(log, &response, NULL, node, "Response"))) {
             status = parse_response(log, response, &channel->response);
         }
@@ -1118,7 +1114,7 @@ static int parse_channel(evalresp_logger *log, mxml_node_t *node, x2r_channel *c
 
 
 /* Free an x2r_channel value. */
-static int free_channel(x2r_channel *channel, int status) {
+int x2r_free_channel(x2r_channel *channel, int status) {
     if (channel) {
         status = free_response(&channel->response, status);
         free(channel->location_code);
@@ -1128,8 +1124,59 @@ static int free_channel(x2r_channel *channel, int status) {
 }
 
 
-/* Read an x2r_station value from the current node. */
-static int parse_station(evalresp_logger *log, mxml_node_t *node, x2r_station *station) {
+/*
+ * Channels whose parsing is deferred so that they can be parsed in parallel.
+ * parse_channel() reads only the subtree of its node and writes only its
+ * channel, so the channels of a document are independent.
+ */
+typedef struct {
+    int n;
+    mxml_node_t **node;
+    x2r_channel **channel;  /* where each is parsed, in document order */
+} deferred_channels;
+
+
+/* Queue a channel node to be parsed later into the given place. */
+static int defer_channel(evalresp_logger *log, deferred_channels *deferred,
+        mxml_node_t *node, x2r_channel *channel) {
+
+    int status = X2R_OK;
+    void *nodes, *channels;
+
+    if (!(deferred->n & (deferred->n - 1))) {  // zero or a power of two, so full
+        nodes = realloc(deferred->node, (deferred->n ? 2 * deferred->n : 1) * sizeof(*deferred->node));
+        if (nodes) {
+            deferred->node = nodes;
+        }
+        channels = realloc(deferred->channel,
+                (deferred->n ? 2 * deferred->n : 1) * sizeof(*deferred->channel));
+        if (channels) {
+            deferred->channel = channels;
+        }
+        if (!nodes || !channels) {
+            evalresp_log(log, EV_ERROR, 0, "Cannot alloc deferred channels");
+            status = X2R_ERR_MEMORY;
+        }
+    }
+    if (!status) {
+        deferred->node[deferred->n] = node;
+        deferred->channel[deferred->n++] = channel;
+    }
+
+    return status;
+}
+
+
+/* Parse a single deferred channel (a task for parallel_for()). */
+static int parse_deferred_channel(evalresp_logger *log, void *data, int i) {
+    deferred_channels *deferred = data;
+    return parse_channel(log, deferred->node[i], deferred->channel[i]);
+}
+
+
+/* Read an x2r_station value from the current node (deferring the channels if requested). */
+static int parse_station(evalresp_logger *log, mxml_node_t *node, x2r_station *station,
+        deferred_channels *deferred) {
 
     int status = X2R_OK, i;
     nodelist *stations = NULL;
@@ -1144,7 +1191,11 @@ static int parse_station(evalresp_logger *log, mxml_node_t *node, x2r_station *s
         } else {
             if (!(status = char_attribute(log, node, "code", NULL, &station->code))) {
                 for (i = 0; !status && i < station->n_channels; ++i) {
-                    status = parse_channel(log, stations->node[i], &station->channel[i]);
+                    if (deferred) {
+                        status = defer_channel(log, deferred, stations->node[i], &station->channel[i]);
+                    } else {
+                        status = parse_channel(log, stations->node[i], &station->channel[i]);
+                    }
                 }
             }
         }
@@ -1160,7 +1211,7 @@ static int free_station(x2r_station *station, int status) {
     int i;
     if (station) {
         for (i = 0; i < station->n_channels; ++i) {
-            status = free_channel(&station->channel[i], status);
+            status = x2r_free_channel(&station->channel[i], status);
         }
         free(station->code);
         free(station->channel);
@@ -1169,8 +1220,9 @@ static int free_station(x2r_station *station, int status) {
 }
 
 
-/* Read an x2r_network value from the current node. */
-static int parse_network(evalresp_logger *log, mxml_node_t *node, x2r_network *network) {
+/* Read an x2r_network value from the current node (deferring the channels if requested). */
+static int parse_network(evalresp_logger *log, mxml_node_t *node, x2r_network *network,
+        deferred_channels *deferred) {
 
     int status = X2R_OK, i;
     nodelist *stations = NULL;
@@ -1185,7 +1237,7 @@ static int parse_network(evalresp_logger *log, mxml_node_t *node, x2r_network *n
         } else {
             if (!(status = char_attribute(log, node, "code", NULL, &network->code))) {
                 for (i = 0; !status && i < network->n_stations; ++i) {
-                    status = parse_station(log, stations->node[i], &network->station[i]);
+                    status = parse_station(log, stations->node[i], &network->station[i], deferred);
                 }
             }
         }
@@ -1210,12 +1262,25 @@ static int free_network(x2r_network *network, int status) {
 }
 
 
-/* Read an x2r_fdsn_station_xml value from the current node. */
-int x2r_parse_fdsn_station_xml(evalresp_logger *log, mxml_node_t *doc, x2r_fdsn_station_xml **root) {
+/*
+ * Read an x2r_fdsn_station_xml value from the current node.
+ *
+ * With more than one thread the networks and stations are read first, and
+ * then the channels (most of the work) are parsed in parallel, each into its
+ * place in the model.
+ */
+int x2r_parse_fdsn_station_xml(evalresp_logger *log, mxml_node_t *doc, int nthreads,
+        x2r_fdsn_station_xml **root) {
 
-    int status = X2R_OK, i;
+    int status = X2R_OK, channel_status, ndone, i;
     mxml_node_t *fdsn = NULL;
     nodelist *networks = NULL;
+    deferred_channels channels, *deferred = NULL;
+
+    memset(&channels, 0, sizeof(channels));
+    if (nthreads > 1) {
+        deferred = &channels;
+    }
 
     //evalresp_log(log, EV_DEBUG, 0, "Parsing root");
 
@@ -1231,13 +1296,22 @@ int x2r_parse_fdsn_station_xml(evalresp_logger *log, mxml_node_t *doc, x2r_fdsn_
                     status = X2R_ERR_MEMORY;
                 } else {
                     for (i = 0; !status && i < (*root)->n_networks; ++i) {
-                        status = parse_network(log, networks->node[i], &(*root)->network[i]);
+                        status = parse_network(log, networks->node[i], &(*root)->network[i],
+                                deferred);
                     }
                 }
             }
         }
     }
 
+    // the channels queued precede any error above in the document, so theirs comes first
+    if (deferred && (channel_status = parallel_for(log, nthreads, deferred->n,
+            parse_deferred_channel, deferred, &ndone))) {
+        status = channel_status;
+    }
+
+    free(channels.node);
+    free(channels.channel);
     free_nodelist(&networks);
     return status;
 }
@@ -1258,20 +1332,259 @@ int x2r_free_fdsn_station_xml(x2r_fdsn_station_xml *root, int status) {
 
 
 /*
- * The equivalent of StationService.load() in IRIS-WS, constructing an in-memory
- * representation of the station.xml file read from the given stream.
+ * The state of an event-driven (SAX) read.  Only the subtree of the open
+ * Channel is kept by mxml (the rest is freed as it is read), so memory
+ * depends on the largest channel, not on the size of the document.
  */
-int x2r_station_service_load(evalresp_logger *log, FILE *in, x2r_fdsn_station_xml **root) {
+typedef struct {
+    evalresp_logger *log;
+    int status;
+    int started;  /* FDSNStationXML seen */
+    x2r_fdsn_station_xml *root;  /* the model being built, or NULL */
+    x2r_channel_handler handler;  /* or where each channel is handed */
+    x2r_channel_selector select;  /* which to read (NULL for all) */
+    void *data;
+    char *net;  /* code of the open Network */
+    char *stn;  /* code of the open Station */
+    mxml_node_t *channel;  /* the open Channel */
+    mxml_node_t *skip;  /* the open Network, Station or Channel not selected */
+} sax_state;
+
+
+/* Is the node an element with the given name? */
+static int is_element(mxml_node_t *node, const char *name) {
+    return node && mxmlGetType(node) == MXML_ELEMENT && !strcmp(mxmlGetElement(node), name);
+}
+
+
+/* Grow an array by one (zeroed) entry, doubling the allocation as needed. */
+static int grow(evalresp_logger *log, void *array, int n, size_t size, const char *name,
+        void **grown) {
 
     int status = X2R_OK;
-    mxml_node_t *doc = NULL;
 
-    if (!(status = stream2doc(log, in, &doc))) {
-        status = x2r_parse_fdsn_station_xml(log, doc, root);
+    *grown = array;
+    if (!(n & (n - 1))) {  // zero or a power of two, so full
+        if (!(*grown = realloc(array, (n ? 2 * n : 1) * size))) {
+            evalresp_log(log, EV_ERROR, 0, "Cannot alloc %s", name);
+            status = X2R_ERR_MEMORY;
+        }
+    }
+    if (!status) {
+        memset((char *)*grown + n * size, 0, size);
     }
 
-    mxmlDelete(doc);
     return status;
 }
 
 
+/* Start a Network, adding it to the model when building one. */
+static int start_network(sax_state *state, mxml_node_t *node) {
+
+    int status = X2R_OK;
+    void *grown;
+    x2r_network *network;
+
+    free(state->net);
+    state->net = NULL;
+    if (!(status = char_attribute(state->log, node, "code", NULL, &state->net))
+            && state->select && !state->select(state->log, state->net, NULL, NULL, state->data)) {
+        state->skip = node;
+    } else if (!status && state->root) {
+        if (!(status = grow(state->log, state->root->network, state->root->n_networks,
+                sizeof(*state->root->network), "networks", &grown))) {
+            state->root->network = grown;
+            network = &state->root->network[state->root->n_networks++];
+            if (!(network->code = strdup(state->net))) {
+                evalresp_log(state->log, EV_ERROR, 0, "Cannot alloc network code");
+                status = X2R_ERR_MEMORY;
+            }
+        }
+    }
+
+    return status;
+}
+
+
+/* Start a Station, adding it to the model when building one. */
+static int start_station(sax_state *state, mxml_node_t *node) {
+
+    int status = X2R_OK;
+    void *grown;
+    x2r_network *network;
+    x2r_station *station;
+
+    free(state->stn);
+    state->stn = NULL;
+    if (!(status = char_attribute(state->log, node, "code", NULL, &state->stn))
+            && state->select && !state->select(state->log, state->net, state->stn, NULL, state->data)) {
+        state->skip = node;
+    } else if (!status && state->root) {
+        network = &state->root->network[state->root->n_networks - 1];
+        if (!(status = grow(state->log, network->station, network->n_stations,
+                sizeof(*network->station), "stations", &grown))) {
+            network->station = grown;
+            station = &network->station[network->n_stations++];
+            if (!(station->code = strdup(state->stn))) {
+                evalresp_log(state->log, EV_ERROR, 0, "Cannot alloc station code");
+                status = X2R_ERR_MEMORY;
+            }
+        }
+    }
+
+    return status;
+}
+
+
+/* Start a Channel, unless its names and dates are not selected. */
+static int start_channel(sax_state *state, mxml_node_t *node) {
+
+    int status = X2R_OK;
+    x2r_channel channel;
+
+    if (state->select) {
+        memset(&channel, 0, sizeof(channel));
+        if (!(status = parse_channel_attributes(state->log, node, &channel))
+                && !state->select(state->log, state->net, state->stn, &channel, state->data)) {
+            state->skip = node;
+        }
+        status = x2r_free_channel(&channel, status);
+    }
+    if (!status && !state->skip) {
+        state->channel = node;
+    }
+
+    return status;
+}
+
+
+/* End a Channel: parse the subtree and either add it to the model or hand it off. */
+static int end_channel(sax_state *state, mxml_node_t *node) {
+
+    int status = X2R_OK;
+    void *grown;
+    x2r_network *network;
+    x2r_station *station;
+    x2r_channel channel;
+
+    if (state->root) {
+        network = &state->root->network[state->root->n_networks - 1];
+        station = &network->station[network->n_stations - 1];
+        if (!(status = grow(state->log, station->channel, station->n_channels,
+                sizeof(*station->channel), "channels", &grown))) {
+            station->channel = grown;
+            status = parse_channel(state->log, node, &station->channel[station->n_channels++]);
+        }
+    } else {
+        memset(&channel, 0, sizeof(channel));
+        if (!(status = parse_channel(state->log, node, &channel))) {
+            status = state->handler(state->log, state->net, state->stn, &channel, state->data);
+        }
+        status = x2r_free_channel(&channel, status);
+    }
+
+    return status;
+}
+
+
+/* The SAX callback, called by mxml as each node is read. */
+static void sax_event(mxml_node_t *node, mxml_sax_event_t event, void *data) {
+
+    sax_state *state = data;
+    mxml_node_t *parent = mxmlGetParent(node);
+
+    if (state->status) {
+        return;
+    }
+
+    if (state->skip) {
+        // nothing is kept (or parsed) until the subtree not selected closes
+        if (node == state->skip && event == MXML_SAX_ELEMENT_CLOSE) {
+            state->skip = NULL;
+        }
+    } else if (state->channel) {
+        if (node == state->channel && event == MXML_SAX_ELEMENT_CLOSE) {
+            state->status = end_channel(state, node);
+            state->channel = NULL;
+        } else if (event != MXML_SAX_ELEMENT_CLOSE) {
+            // keep the subtree until the channel closes (it is deleted with the channel)
+            mxmlRetain(node);
+        }
+    } else if (!parent && (event == MXML_SAX_DIRECTIVE || event == MXML_SAX_ELEMENT_OPEN)) {
+        // keep the top node, so that success is distinguished from failure
+        mxmlRetain(node);
+        state->started |= is_element(node, "FDSNStationXML");
+    } else if (event == MXML_SAX_ELEMENT_OPEN) {
+        if (is_element(node, "FDSNStationXML") && mxmlGetType(parent) == MXML_ELEMENT
+                && *mxmlGetElement(parent) == '?') {
+            state->started = 1;
+        } else if (is_element(node, "Network") && is_element(parent, "FDSNStationXML")) {
+            state->status = start_network(state, node);
+        } else if (is_element(node, "Station") && is_element(parent, "Network") && state->net) {
+            state->status = start_station(state, node);
+        } else if (is_element(node, "Channel") && is_element(parent, "Station") && state->stn) {
+            state->status = start_channel(state, node);
+        }
+    }
+}
+
+
+/* Read the document with the given state, freeing the nodes as they are used. */
+static int sax_load(evalresp_logger *log, FILE *in, sax_state *state) {
+
+    mxml_node_t *top;
+
+    state->log = log;
+    if (!(top = mxmlSAXLoadFile(NULL, in, MXML_OPAQUE_CALLBACK, sax_event, state))) {
+        if (!state->status) {
+            evalresp_log(log, EV_ERROR, 0, "Could not parse input");
+            state->status = X2R_ERR_XML;
+        }
+    } else if (!state->status && !state->started) {
+        evalresp_log(log, EV_ERROR, 0, "No child for FDSNStationXML");
+        state->status = X2R_ERR_XML;
+    }
+
+    mxmlDelete(top);
+    free(state->net);
+    free(state->stn);
+    return state->status;
+}
+
+
+/*
+ * The equivalent of StationService.load() in IRIS-WS, constructing an in-memory
+ * representation of the station.xml file read from the given stream.
+ *
+ * The document is read event by event, so the mxml tree is never built.
+ */
+int x2r_station_service_load(evalresp_logger *log, FILE *in, x2r_fdsn_station_xml **root) {
+
+    sax_state state;
+
+    memset(&state, 0, sizeof(state));
+    if (!(*root = calloc(1, sizeof(**root)))) {
+        evalresp_log(log, EV_ERROR, 0, "Cannot alloc fdsn_station_xml");
+        return X2R_ERR_MEMORY;
+    }
+    state.root = *root;
+    return sax_load(log, in, &state);
+}
+
+
+/*
+ * Read the station.xml file from the given stream, handing each channel to
+ * the handler (in document order) as soon as it is read.  Networks, stations
+ * and channels that are not selected are skipped without being parsed.
+ */
+int x2r_station_service_stream(evalresp_logger *log, FILE *in, x2r_channel_selector select,
+        x2r_channel_handler handler, void *data) {
+
+    sax_state state;
+
+    memset(&state, 0, sizeof(state));
+    state.select = select;
+    state.handler = handler;
+    state.data = data;
+    return sax_load(log, in, &state);
+}
@@ -321,4 +321,52 @@ int x2r_station_service_load(evalresp_logger *log, FILE *in, x2r_fdsn_station_xm
  */
 int x2r_free_fdsn_station_xml(x2r_fdsn_station_xml *root, int status);
 
+/**
+ * @private
+ * @ingroup evalresp_private_x2r_xml
+ * @brief A function called with each channel read by
+ *        x2r_station_service_stream(), and the codes of its network and
+ *        station.
+ * @details Whatever is left in the channel is freed when this returns, so
+ *          a handler that keeps the contents should zero it.  A non-zero
+ *          return stops the read (the status is returned).
+ */
+typedef int (*x2r_channel_handler)(evalresp_logger *log, const char *net, const char *stn,
+        x2r_channel *channel, void *data);
+
+/**
+ * @private
+ * @ingroup evalresp_private_x2r_xml
+ * @brief A function called by x2r_station_service_stream() to select what
+ *        is read: with stn and channel NULL for a network, with channel
+ *        NULL for a station, and with only the names and dates of a
+ *        channel set (no response).
+ * @details Returns non-zero if the network, station or channel (or anything
+ *          within it) may be wanted; otherwise it is skipped.
+ */
+typedef int (*x2r_channel_selector)(evalresp_logger *log, const char *net, const char *stn,
+        const x2r_channel *channel, void *data);
+
+/**
+ * @private
+ * @ingroup evalresp_private_x2r_xml
+ * @brief Read the station.xml file from the given stream a channel at a
+ *        time, handing each selected channel to the handler (in document
+ *        order) and then freeing it.
+ * @details The mxml tree is never built for the whole document, so memory
+ *          depends on the largest channel, not on the size of the input.
+ *          Networks, stations and channels not selected (when select is not
+ *          NULL) are skipped without being parsed or kept.  Channels read
+ *          before an error in the document are still handed off.
+ */
+int x2r_station_service_stream(evalresp_logger *log, FILE *in, x2r_channel_selector select,
+        x2r_channel_handler handler, void *data);
+
+/**
+ * @private
+ * @ingroup evalresp_private_x2r_xml
+ * @brief Free an x2r_channel value (but not the channel itself).
+ */
+int x2r_free_channel(x2r_channel *channel, int status);
+
 #endif
@@ -0,0 +1,242 @@
+/* thread_fctns.c */
+
+/*
+ A minimal worker pool for running independent tasks (one per channel,
+ say) on several threads.
+
+ Each task logs into a private buffer, and the buffers are passed on to
+ the caller's logger in task order once all threads have finished, so
+ the messages (and the status returned) are the same as if the tasks
+ had run one after another, stopping at the first failure.  Builds
+ without pthreads (Windows) simply run the tasks in sequence.
+
+ A mutex is also provided for data shared between tasks.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(WIN32) && !defined(_WIN32)
+#define EVALRESP_THREADS
+#include <pthread.h>
+#endif
+
+#include "./private.h"
+
+#ifdef EVALRESP_THREADS
+
+/* messages logged by a single task */
+typedef struct
+{
+  int nmsgs;
+  evalresp_log_msg *msgs;
+  int failed; /* ran out of memory saving a message */
+} task_log;
+
+typedef struct
+{
+  pthread_mutex_t lock;
+  int next;       /* next index to claim */
+  int first_fail; /* lowest index that failed (n if none) */
+  int fail_status;
+  int n;
+  parallel_task task;
+  void *data;
+  task_log *logs;
+} pool;
+
+static int
+save_msg (evalresp_log_msg *msg, void *data)
+{
+  task_log *tlog = data;
+  evalresp_log_msg *msgs;
+  if (!(msgs = realloc (tlog->msgs, (tlog->nmsgs + 1) * sizeof (*msgs))))
+  {
+    tlog->failed = 1;
+    return EXIT_FAILURE;
+  }
+  tlog->msgs = msgs;
+  tlog->msgs[tlog->nmsgs++] = *msg;
+  return EXIT_SUCCESS;
+}
+
+static void *
+worker (void *arg)
+{
+  pool *p = arg;
+  evalresp_logger tlog;
+  int i, status;
+
+  tlog.log_func = save_msg;
+  for (;;)
+  {
+    /* indices are claimed in order, so every index below a failure is
+       run to completion and the lowest failure is found exactly */
+    pthread_mutex_lock (&p->lock);
+    i = p->next < p->first_fail ? p->next++ : p->n;
+    pthread_mutex_unlock (&p->lock);
+    if (i >= p->n)
+    {
+      break;
+    }
+    tlog.func_data = &p->logs[i];
+    if ((status = p->task (&tlog, p->data, i)))
+    {
+      pthread_mutex_lock (&p->lock);
+      if (i < p->first_fail)
+      {
+        p->first_fail = i;
+        p->fail_status = status;
+      }
+      pthread_mutex_unlock (&p->lock);
+    }
+  }
+  return NULL;
+}
+
+static void
+replay_log (evalresp_logger *log, task_log *tlog)
+{
+  int j;
+  for (j = 0; j < tlog->nmsgs; j++)
+  {
+    if (log && log->log_func)
+    {
+      log->log_func (&tlog->msgs[j], log->func_data);
+    }
+    else
+    {
+      evalresp_log (log, tlog->msgs[j].log_level, tlog->msgs[j].verbosity_level,
+                    "%s", tlog->msgs[j].msg);
+    }
+  }
+  if (tlog->failed)
+  {
+    evalresp_log (log, EV_WARN, EV_WARN, "Cannot allocate log message (some were lost)");
+  }
+}
+
+#endif
+
+int
+parallel_for (evalresp_logger *log, int nthreads, int n, parallel_task task,
+              void *data, int *ndone)
+{
+  int i, status = EVALRESP_OK;
+#ifdef EVALRESP_THREADS
+  pool p;
+  pthread_t *threads = NULL;
+  int nstarted = 0;
+#endif
+
+  if (nthreads > n)
+  {
+    nthreads = n;
+  }
+
+#ifdef EVALRESP_THREADS
+  if (nthreads > 1)
+  {
+    memset (&p, 0, sizeof (p));
+    p.first_fail = p.n = n;
+    p.task = task;
+    p.data = data;
+    if (!(p.logs = calloc (n, sizeof (*p.logs))) || !(threads = calloc (nthreads - 1, sizeof (*threads))))
+    {
+      /* fall back to running in sequence below */
+      free (p.logs);
+      nthreads = 1;
+    }
+    else
+    {
+      pthread_mutex_init (&p.lock, NULL);
+      /* the calling thread is a worker too; if threads cannot be
+         created it does all the work */
+      while (nstarted < nthreads - 1 && !pthread_create (&threads[nstarted], NULL, worker, &p))
+      {
+        nstarted++;
+      }
+      worker (&p);
+      for (i = 0; i < nstarted; i++)
+      {
+        pthread_join (threads[i], NULL);
+      }
+      pthread_mutex_destroy (&p.lock);
+
+      for (i = 0; i < n; i++)
+      {
+        if (i <= p.first_fail)
+        {
+          replay_log (log, &p.logs[i]);
+        }
+        free (p.logs[i].msgs);
+      }
+      free (p.logs);
+      free (threads);
+      *ndone = p.first_fail;
+      return p.fail_status;
+    }
+  }
+#endif
+
+  for (i = 0; i < n && !(status = task (log, data, i)); i++)
+    ;
+  *ndone = i;
+  return status;
+}
+
+struct thread_lock_s
+{
+#ifdef EVALRESP_THREADS
+  pthread_mutex_t mutex;
+#else
+  int unused;
+#endif
+};
+
+int
+new_lock (evalresp_logger *log, thread_lock **lock)
+{
+  if (!(*lock = calloc (1, sizeof (**lock))))
+  {
+    evalresp_log (log, EV_ERROR, EV_ERROR, "Cannot allocate lock");
+    return EVALRESP_MEM;
+  }
+#ifdef EVALRESP_THREADS
+  pthread_mutex_init (&(*lock)->mutex, NULL);
+#endif
+  return EVALRESP_OK;
+}
+
+void
+free_lock (thread_lock **lock)
+{
+  if (*lock)
+  {
+#ifdef EVALRESP_THREADS
+    pthread_mutex_destroy (&(*lock)->mutex);
+#endif
+    free (*lock);
+    *lock = NULL;
+  }
+}
+
+void
+acquire_lock (thread_lock *lock)
+{
+#ifdef EVALRESP_THREADS
+  pthread_mutex_lock (&lock->mutex);
+#endif
+}
+
+void
+release_lock (thread_lock *lock)
+{
+#ifdef EVALRESP_THREADS
+  pthread_mutex_unlock (&lock->mutex);
+#endif
+}
@@ -1,8 +1,10 @@
 #include <check.h>
 #include <fcntl.h>
 #include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "evalresp/constants.h"
 #include "evalresp/public_api.h"
@@ -80,6 +82,302 @@ START_TEST (test_freqs)
 }
 END_TEST
 
+START_TEST (test_threads)
+{
+  evalresp_channels *channels = NULL;
+  evalresp_responses *seq = NULL, *par = NULL;
+  evalresp_options *options = NULL;
+  int i;
+
+  fail_if (evalresp_new_options (NULL, &options));
+  fail_if (evalresp_set_frequency (NULL, options, "0.001", "10", "200"));
+  options->station_xml = 1;
+  fail_if (evalresp_filename_to_channels (NULL, "./data/station-2.xml", options, NULL,
+                                          &channels));
+  fail_if (channels->nchannels < 2, "Unexpected number of channels: %d", channels->nchannels);
+  fail_if (evalresp_channels_to_responses (NULL, channels, options, &seq));
+  options->nthreads = 4;
+  fail_if (evalresp_channels_to_responses (NULL, channels, options, &par));
+  fail_if (par->nresponses != seq->nresponses, "Responses: %d", par->nresponses);
+  for (i = 0; i < seq->nresponses; ++i)
+  {
+    fail_if (strcmp (par->responses[i]->channel, seq->responses[i]->channel));
+    fail_if (par->responses[i]->nfreqs != seq->responses[i]->nfreqs);
+    fail_if (memcmp (par->responses[i]->rvec, seq->responses[i]->rvec,
+                     seq->responses[i]->nfreqs * sizeof (*seq->responses[i]->rvec)),
+             "Response %d differs", i);
+  }
+  evalresp_free_responses (&seq);
+  evalresp_free_responses (&par);
+  evalresp_free_channels (&channels);
+  evalresp_free_options (&options);
+}
+END_TEST
+
+START_TEST (test_stage_cache)
+{
+  evalresp_channels *channels = NULL;
+  evalresp_responses *seq = NULL, *shared = NULL, *par = NULL;
+  evalresp_options *options = NULL;
+  int i;
+
+  fail_if (evalresp_new_options (NULL, &options));
+  /* enough frequencies for several chunks */
+  fail_if (evalresp_set_frequency (NULL, options, "0.001", "10", "20000"));
+  options->station_xml = 1;
+  fail_if (evalresp_filename_to_channels (NULL, "./data/station-2.xml", options, NULL,
+                                          &channels));
+  fail_if (evalresp_channels_to_responses (NULL, channels, options, &seq));
+  options->cache_stages = 1;
+  fail_if (evalresp_channels_to_responses (NULL, channels, options, &shared));
+  options->nthreads = 4;
+  fail_if (evalresp_channels_to_responses (NULL, channels, options, &par));
+  fail_if (shared->nresponses != seq->nresponses, "Responses: %d", shared->nresponses);
+  fail_if (par->nresponses != seq->nresponses, "Responses: %d", par->nresponses);
+  for (i = 0; i < seq->nresponses; ++i)
+  {
+    fail_if (memcmp (shared->responses[i]->rvec, seq->responses[i]->rvec,
+                     seq->responses[i]->nfreqs * sizeof (*seq->responses[i]->rvec)),
+             "Response %d differs", i);
+    fail_if (memcmp (par->responses[i]->rvec, seq->responses[i]->rvec,
+                     seq->responses[i]->nfreqs * sizeof (*seq->responses[i]->rvec)),
+             "Response %d differs with threads", i);
+  }
+  evalresp_free_responses (&seq);
+  evalresp_free_responses (&shared);
+  evalresp_free_responses (&par);
+  evalresp_free_channels (&channels);
+  evalresp_free_options (&options);
+}
+END_TEST
+
+START_TEST (test_freq_threads)
+{
+  evalresp_channels *channels = NULL;
+  evalresp_response *seq = NULL, *par = NULL, *one = NULL;
+  evalresp_options *options = NULL;
+  int i;
+
+  fail_if (evalresp_new_options (NULL, &options));
+  fail_if (evalresp_set_frequency (NULL, options, "0.001", "20", "100000"));
+  fail_if (evalresp_filename_to_channels (NULL, "./data/RESP.IU.ANMO..BHZ", options, NULL,
+                                          &channels));
+  fail_if (evalresp_channel_to_response (NULL, channels->channels[0], options, &seq));
+  options->nthreads = 4;
+  fail_if (evalresp_channel_to_response (NULL, channels->channels[0], options, &par));
+  fail_if (par->nfreqs != seq->nfreqs);
+  fail_if (memcmp (par->rvec, seq->rvec, seq->nfreqs * sizeof (*seq->rvec)));
+  /* chunks give the same values as evaluating each frequency alone */
+  options->nthreads = 1;
+  options->lin_freq = 1;
+  options->nfreq = 1;
+  for (i = 0; i < seq->nfreqs; i += 9973)
+  {
+    options->min_freq = options->max_freq = seq->freqs[i];
+    fail_if (evalresp_channel_to_response (NULL, channels->channels[0], options, &one));
+    fail_if (memcmp (one->rvec, &seq->rvec[i], sizeof (*one->rvec)), "Frequency %d differs", i);
+    evalresp_free_response (&one);
+  }
+  evalresp_free_response (&seq);
+  evalresp_free_response (&par);
+  evalresp_free_channels (&channels);
+  evalresp_free_options (&options);
+}
+END_TEST
+
+typedef struct
+{
+  const evalresp_prepared_channel *prepared;
+  const evalresp_options *options;
+  evalresp_response *response;
+} prepared_job;
+
+static void *
+evaluate_prepared (void *arg)
+{
+  prepared_job *job = arg;
+  fail_if (evalresp_prepared_to_response (NULL, job->prepared, job->options, &job->response));
+  return NULL;
+}
+
+START_TEST (test_prepared)
+{
+  evalresp_channels *channels = NULL;
+  evalresp_response *response = NULL;
+  evalresp_prepared_channel *prepared = NULL;
+  evalresp_options *options = NULL;
+  prepared_job jobs[4];
+  pthread_t threads[4];
+  int i;
+
+  fail_if (evalresp_new_options (NULL, &options));
+  fail_if (evalresp_set_frequency (NULL, options, "0.001", "10", "500"));
+  fail_if (evalresp_filename_to_channels (NULL, "./data/RESP.IU.ANMO..BHZ", options, NULL,
+                                          &channels));
+  fail_if (evalresp_channel_to_response (NULL, channels->channels[0], options, &response));
+  fail_if (evalresp_prepare_channel (NULL, channels->channels[0], options, &prepared));
+  /* the same prepared channel, evaluated concurrently */
+  for (i = 0; i < 4; ++i)
+  {
+    jobs[i].prepared = prepared;
+    jobs[i].options = options;
+    jobs[i].response = NULL;
+    fail_if (pthread_create (&threads[i], NULL, evaluate_prepared, &jobs[i]));
+  }
+  for (i = 0; i < 4; ++i)
+  {
+    fail_if (pthread_join (threads[i], NULL));
+    fail_if (!jobs[i].response);
+    fail_if (jobs[i].response->nfreqs != response->nfreqs);
+    fail_if (memcmp (jobs[i].response->rvec, response->rvec,
+                     response->nfreqs * sizeof (*response->rvec)));
+    fail_if (strcmp (jobs[i].response->station, "ANMO"));
+    evalresp_free_response (&jobs[i].response);
+  }
+  evalresp_free_prepared_channel (&prepared);
+  fail_if (prepared != NULL);
+  evalresp_free_response (&response);
+  evalresp_free_channels (&channels);
+  evalresp_free_options (&options);
+}
+END_TEST
+
+START_TEST (test_buffer)
+{
+  evalresp_channels *channels = NULL;
+  evalresp_response *response = NULL;
+  evalresp_prepared_channel *prepared = NULL;
+  evalresp_options *options = NULL;
+  evalresp_complex output[3];
+  /* any frequencies, in any order */
+  double freqs[3] = {7.3, 0.013, 1.0};
+  int i;
+
+  fail_if (evalresp_new_options (NULL, &options));
+  fail_if (evalresp_filename_to_channels (NULL, "./data/RESP.IU.ANMO..BHZ", options, NULL,
+                                          &channels));
+  fail_if (evalresp_prepare_channel (NULL, channels->channels[0], NULL, &prepared));
+  fail_if (evalresp_prepared_to_buffer (NULL, prepared, NULL, freqs, 3, output));
+  fail_if (fabs (output[2].real - 918243620.549808) > 1e-3, "Real: %f", output[2].real);
+  fail_if (fabs (output[2].imag - -392298381.164822) > 1e-3, "Imag: %f", output[2].imag);
+  /* same as evaluating a single frequency grid */
+  for (i = 0; i < 3; ++i)
+  {
+    options->min_freq = options->max_freq = freqs[i];
+    fail_if (evalresp_prepared_to_response (NULL, prepared, options, &response));
+    fail_if (memcmp (response->rvec, &output[i], sizeof (output[i])), "Frequency %d differs", i);
+    evalresp_free_response (&response);
+  }
+  fail_if (evalresp_prepared_to_buffer (NULL, prepared, options, freqs, -1, output) != EVALRESP_INP);
+  evalresp_free_prepared_channel (&prepared);
+  evalresp_free_channels (&channels);
+  evalresp_free_options (&options);
+}
+END_TEST
+
+START_TEST (test_cache)
+{
+  evalresp_channels *channels = NULL;
+  evalresp_response *response = NULL;
+  const evalresp_response *first = NULL, *second = NULL, *other = NULL;
+  evalresp_options *options = NULL;
+  evalresp_cache *cache = NULL;
+  evalresp_cache_stats stats;
+
+  fail_if (evalresp_new_options (NULL, &options));
+  fail_if (evalresp_set_frequency (NULL, options, "0.01", "10", "100"));
+  fail_if (evalresp_filename_to_channels (NULL, "./data/RESP.IU.ANMO..BHZ", options, NULL,
+                                          &channels));
+  fail_if (evalresp_channel_to_response (NULL, channels->channels[0], options, &response));
+
+  fail_if (evalresp_new_cache (NULL, 1 << 20, &cache));
+  fail_if (evalresp_cached_channel_to_response (NULL, cache, channels->channels[0], options, &first));
+  fail_if (evalresp_cached_channel_to_response (NULL, cache, channels->channels[0], options, &second));
+  evalresp_get_cache_stats (cache, &stats);
+  fail_if (stats.hits != 1 || stats.misses != 1 || stats.nentries != 1, "Hits %ld misses %ld", stats.hits, stats.misses);
+  /* the values are shared, and the same as without the cache */
+  fail_if (first->rvec != second->rvec);
+  fail_if (first->nfreqs != response->nfreqs);
+  fail_if (memcmp (first->rvec, response->rvec, response->nfreqs * sizeof (*response->rvec)));
+  fail_if (strcmp (second->station, "ANMO"));
+  /* a different grid is a different entry */
+  options->nfreq = 50;
+  fail_if (evalresp_cached_channel_to_response (NULL, cache, channels->channels[0], options, &other));
+  evalresp_get_cache_stats (cache, &stats);
+  fail_if (stats.misses != 2 || stats.nentries != 2);
+  evalresp_release_response (&first);
+  evalresp_release_response (&second);
+  fail_if (second != NULL);
+  evalresp_free_cache (&cache);
+  /* still valid after the cache is gone */
+  fail_if (other->nfreqs != 50);
+  evalresp_release_response (&other);
+
+  /* nothing fits in a tiny budget */
+  fail_if (evalresp_new_cache (NULL, 1, &cache));
+  fail_if (evalresp_cached_channel_to_response (NULL, cache, channels->channels[0], options, &first));
+  evalresp_get_cache_stats (cache, &stats);
+  fail_if (stats.evictions != 1 || stats.nentries != 0 || stats.nbytes != 0);
+  fail_if (first->nfreqs != 50);
+  evalresp_release_response (&first);
+  evalresp_free_cache (&cache);
+
+  evalresp_free_response (&response);
+  evalresp_free_channels (&channels);
+  evalresp_free_options (&options);
+}
+END_TEST
+
+START_TEST (test_flat)
+{
+  /* flat channels, evaluated in place or converted back, respond as the
+     channels they came from, even when moved */
+  evalresp_channels *channels = NULL;
+  evalresp_flat_channel *flat = NULL, *moved = NULL, *again = NULL;
+  evalresp_channel *back = NULL;
+  evalresp_response *a = NULL, *b = NULL, *c = NULL;
+  evalresp_options *options = NULL;
+  int i;
+
+  fail_if (evalresp_new_options (NULL, &options));
+  fail_if (evalresp_set_frequency (NULL, options, "0.001", "10", "200"));
+  options->station_xml = 1;
+  fail_if (evalresp_filename_to_channels (NULL, "./data/station-2.xml", options, NULL,
+                                          &channels));
+  fail_if (!channels->nchannels);
+  for (i = 0; i < channels->nchannels; ++i)
+  {
+    fail_if (evalresp_channel_to_flat (NULL, channels->channels[i], &flat));
+    fail_if (flat->stages_len < 1 || flat->blkts_len < flat->stages_len || !flat->pool_len);
+    fail_if (!(moved = malloc (flat->size)));
+    memcpy (moved, flat, flat->size);
+    memset (flat, 0, flat->size);
+    evalresp_free_flat_channel (&flat);
+    fail_if (flat);
+    fail_if (evalresp_flat_to_channel (NULL, moved, &back));
+    fail_if (evalresp_channel_to_flat (NULL, back, &again));
+    fail_if (again->size != moved->size || again->blkts_len != moved->blkts_len);
+    fail_if (memcmp (EVALRESP_FLAT_POOL (again), EVALRESP_FLAT_POOL (moved),
+                     moved->pool_len * sizeof (double)));
+    fail_if (evalresp_channel_to_response (NULL, channels->channels[i], options, &a));
+    fail_if (evalresp_flat_to_response (NULL, moved, options, &b));
+    fail_if (evalresp_channel_to_response (NULL, back, options, &c));
+    fail_if (b->nfreqs != a->nfreqs || c->nfreqs != a->nfreqs);
+    fail_if (memcmp (b->rvec, a->rvec, a->nfreqs * sizeof (*a->rvec)), "Response %d differs", i);
+    fail_if (memcmp (c->rvec, a->rvec, a->nfreqs * sizeof (*a->rvec)), "Response %d differs", i);
+    fail_if (strcmp (b->station, a->station));
+    evalresp_free_response (&a);
+    evalresp_free_response (&b);
+    evalresp_free_response (&c);
+    evalresp_free_channel (&back);
+    evalresp_free_flat_channel (&again);
+    free (moved);
+  }
+  evalresp_free_channels (&channels);
+  evalresp_free_options (&options);
+}
+END_TEST
+
 int
 main (void)
 {
@@ -89,6 +387,13 @@ main (void)
   tcase_add_test (tc, test_no_options);
   tcase_add_test (tc, test_start);
   tcase_add_test (tc, test_freqs);
+  tcase_add_test (tc, test_threads);
+  tcase_add_test (tc, test_stage_cache);
+  tcase_add_test (tc, test_freq_threads);
+  tcase_add_test (tc, test_prepared);
+  tcase_add_test (tc, test_buffer);
+  tcase_add_test (tc, test_cache);
+  tcase_add_test (tc, test_flat);
   suite_add_tcase (s, tc);
   SRunner *sr = srunner_create (s);
   srunner_set_xml (sr, "check-evaluation.xml");
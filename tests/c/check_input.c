@@ -3,71 +3,70 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "evalresp/constants.h"
 #include "evalresp/input.h"
 #include "evalresp/private.h"
 #include "evalresp/public_api.h"
+#include "evalresp/regexp.h"
+#include "evalresp/stationxml2resp.h"
+#include "evalresp_log/log.h"
 
-START_TEST (test_slurp_line)
+START_TEST (test_tokenize_resp)
 {
-  const char *input = "line 1\nline 2\nline 3";
-  const char *start = input;
-  char line[MAXLINELEN];
-  slurp_line (&start, line, MAXLINELEN);
-  fail_if (strcmp (line, "line 1\n"), "Slurped [%s] (size %d)", line, strlen (line));
-  slurp_line (&start, line, MAXLINELEN);
-  fail_if (strcmp (line, "line 2\n"), "Slurped [%s] (size %d)", line, strlen (line));
-  slurp_line (&start, line, MAXLINELEN);
-  fail_if (strcmp (line, "line 3"), "Slurped [%s] (size %d)", line, strlen (line));
-  fail_if (*start, "Start is [%s]", start);
-  slurp_line (&start, line, MAXLINELEN);
-  fail_if (strcmp (line, ""), "Slurped [%s] (size %d)", line, strlen (line));
-  fail_if (*start, "Start is [%s]", start);
-}
-END_TEST
-
-START_TEST (test_slurp_line_buffer)
-{
-  const char *input = "\n1\n12\n123\n";
-  const char *start = input;
-  char line[3];
-  slurp_line (&start, line, 3);
-  fail_if (strcmp (line, "\n"), "Slurped [%s] (size %d)", line, strlen (line));
-  slurp_line (&start, line, 3);
-  fail_if (strcmp (line, "1\n"), "Slurped [%s] (size %d)", line, strlen (line));
-  slurp_line (&start, line, 3);
-  fail_if (strcmp (line, "12"), "Slurped [%s] (size %d)", line, strlen (line));
+  const char *input = "# comment\nB050F03 a: 1\r\n\n  \t\r\nB052F04\tb: 2\nbad\nB053F05 ";
+  char long_line[1000];
+  resp_lines lines;
+  fail_if (tokenize_resp (NULL, input, strlen (input), &lines));
+  fail_if (lines.nlines != 4, "Lines: %d", lines.nlines);
+  fail_if (lines.lines[0].blkt_no != 50 || lines.lines[0].fld_no != 3);
+  fail_if (lines.lines[0].length != 12, "Length: %d", lines.lines[0].length);
+  fail_if (lines.lines[1].blkt_no != 52 || lines.lines[1].fld_no != 4);
+  fail_if (lines.lines[2].blkt_no != -1);
+  fail_if (lines.lines[3].blkt_no != 53 || lines.lines[3].length != 8);
+  free_resp_lines (&lines);
+  /* lines are not split at MAXLINELEN */
+  memset (long_line, 'x', sizeof (long_line));
+  memcpy (long_line, "B050F03 a: ", 11);
+  long_line[sizeof (long_line) - 1] = '\0';
+  fail_if (tokenize_resp (NULL, long_line, strlen (long_line), &lines));
+  fail_if (lines.nlines != 1 || lines.lines[0].length != sizeof (long_line) - 1);
+  free_resp_lines (&lines);
 }
 END_TEST
 
 START_TEST (test_find_line)
 {
-  const char *input = "B999F99 name1: value1 \nB666F66 name2: value2", *start;
+  const char *input = "B999F99 name1: value1 \nB666F66 name2: value2";
   char line[MAXLINELEN];
-  start = input;
-  fail_if (find_line (NULL, &start, ":", 999, 99, line));
+  resp_lines lines;
+  fail_if (tokenize_resp (NULL, input, strlen (input), &lines));
+  fail_if (find_line (NULL, &lines, ":", 999, 99, line));
   fail_if (strcmp (line, "value1 "), "'%s'", line);
-  fail_if (find_line (NULL, &start, ":", 666, 66, line));
+  fail_if (find_line (NULL, &lines, ":", 666, 66, line));
   fail_if (strcmp (line, "value2"), "'%s'", line);
-  start = input;
-  fail_if (find_line (NULL, &start, ":", 666, 66, line));
+  lines.next = 0;
+  fail_if (find_line (NULL, &lines, ":", 666, 66, line));
   fail_if (strcmp (line, "value2"), "'%s'", line);
+  free_resp_lines (&lines);
 }
 END_TEST
 
 START_TEST (test_find_field)
 {
-  const char *input = "B999F99 name1: a b c \nB666F66 name2: value2", *start;
+  const char *input = "B999F99 name1: a b c \nB666F66 name2: value2";
   char field[MAXLINELEN];
-  start = input;
-  fail_if (find_field (NULL, &start, ":", 999, 99, 0, field));
+  resp_lines lines;
+  fail_if (tokenize_resp (NULL, input, strlen (input), &lines));
+  fail_if (find_field (NULL, &lines, ":", 999, 99, 0, field));
   fail_if (strcmp (field, "a"), "'%s'", field);
-  fail_if (find_field (NULL, &start, ":", 666, 66, 0, field));
+  fail_if (find_field (NULL, &lines, ":", 666, 66, 0, field));
   fail_if (strcmp (field, "value2"), "'%s'", field);
-  start = input;
-  fail_if (find_field (NULL, &start, ":", 999, 99, 2, field));
+  lines.next = 0;
+  fail_if (find_field (NULL, &lines, ":", 999, 99, 2, field));
   fail_if (strcmp (field, "c"), "'%s'", field);
+  free_resp_lines (&lines);
 }
 END_TEST
 
@@ -104,6 +103,712 @@ START_TEST (test_filename_to_channels)
 }
 END_TEST
 
+START_TEST (test_pipe_to_channels)
+{
+  evalresp_channels *mapped = NULL, *piped = NULL;
+  FILE *in;
+  int i;
+  /* a regular file is mapped, a pipe is read */
+  fail_if (!(in = fopen ("./data/RESP.IU.ANMO..BHZ", "r")));
+  fail_if (evalresp_file_to_channels (NULL, in, NULL, NULL, &mapped));
+  fclose (in);
+  fail_if (!(in = popen ("cat ./data/RESP.IU.ANMO..BHZ", "r")));
+  fail_if (evalresp_file_to_channels (NULL, in, NULL, NULL, &piped));
+  pclose (in);
+  fail_if (mapped->nchannels != 2, "Unexpected number of channels: %d", mapped->nchannels);
+  fail_if (piped->nchannels != mapped->nchannels, "Unexpected number of channels: %d", piped->nchannels);
+  for (i = 0; i < mapped->nchannels; ++i)
+  {
+    fail_if (strcmp (piped->channels[i]->beg_t, mapped->channels[i]->beg_t));
+    fail_if (piped->channels[i]->nstages != mapped->channels[i]->nstages);
+    fail_if (piped->channels[i]->sensit != mapped->channels[i]->sensit);
+  }
+  evalresp_free_channels (&mapped);
+  evalresp_free_channels (&piped);
+}
+END_TEST
+
+START_TEST (test_parallel_channels)
+{
+  /* channels read on several threads are the same, and in the same order,
+     as those read on one (and fail in the same way) */
+  evalresp_channels *serial = NULL, *parallel = NULL;
+  evalresp_options *options = NULL;
+  evalresp_filter *filter = NULL;
+  evalresp_stage *a, *b;
+  int i, status;
+  fail_if (evalresp_new_options (NULL, &options));
+  fail_if (!(status = evalresp_filename_to_channels (NULL, "./data/response-1", options, NULL, &serial)));
+  options->nthreads = 4;
+  fail_if (evalresp_filename_to_channels (NULL, "./data/response-1", options, NULL, &parallel) != status);
+  fail_if (serial || parallel);
+  /* skip the channels with undefined units */
+  fail_if (evalresp_new_filter (NULL, &filter));
+  fail_if (evalresp_add_sncl_text (NULL, filter, "IU", "ANMO", NULL, "?H?"));
+  fail_if (evalresp_filename_to_channels (NULL, "./data/response-1", options, filter, &parallel));
+  options->nthreads = 1;
+  fail_if (evalresp_filename_to_channels (NULL, "./data/response-1", options, filter, &serial));
+  fail_if (serial->nchannels != 21, "Unexpected number of channels: %d", serial->nchannels);
+  fail_if (parallel->nchannels != serial->nchannels, "Unexpected number of channels: %d", parallel->nchannels);
+  for (i = 0; i < serial->nchannels; ++i)
+  {
+    fail_if (strcmp (parallel->channels[i]->chaname, serial->channels[i]->chaname));
+    fail_if (strcmp (parallel->channels[i]->beg_t, serial->channels[i]->beg_t));
+    fail_if (parallel->channels[i]->nstages != serial->channels[i]->nstages);
+    fail_if (parallel->channels[i]->sensit != serial->channels[i]->sensit);
+    for (a = serial->channels[i]->first_stage, b = parallel->channels[i]->first_stage; a && b;
+         a = a->next_stage, b = b->next_stage)
+    {
+      fail_if (a->input_units != b->input_units || a->output_units != b->output_units);
+    }
+    fail_if (a || b);
+  }
+  evalresp_free_channels (&serial);
+  evalresp_free_channels (&parallel);
+  evalresp_free_filter (&filter);
+  evalresp_free_options (&options);
+}
+END_TEST
+
+static int
+collect_channel (evalresp_logger *log, evalresp_channel *channel, void *data)
+{
+  evalresp_channels *channels = data;
+  evalresp_channel *copy;
+  /* the channel is freed on return, so take the stages */
+  fail_if (!(copy = malloc (sizeof (*copy))));
+  *copy = *channel;
+  channel->first_stage = NULL;
+  channels->channels = realloc (channels->channels, (channels->nchannels + 1) * sizeof (copy));
+  channels->channels[channels->nchannels++] = copy;
+  return EVALRESP_OK;
+}
+
+/* count the warnings that a streamed SNCL appears again */
+static int
+count_again (evalresp_log_msg *msg, void *data)
+{
+  if (msg->log_level == EV_WARN && strstr (msg->msg, "appears again"))
+  {
+    ++*(int *)data;
+  }
+  return EXIT_SUCCESS;
+}
+
+START_TEST (test_stream_to_channels)
+{
+  /* streamed channels are the same as those read from the whole file,
+     except that the BHZ epochs of RESP.IU.ANMO..BHZ are split by a BHX
+     one, so (with no date) the latest of the first run is passed on too,
+     with a warning */
+  const char *files[] = {"./data/RESP.IU.ANMO..BHZ", "./data/RESP.IU.ANMO.10.BHZ", "./data/response-1"};
+  const char *years[] = {"1991", "1999", "2015"};
+  evalresp_channels *whole = NULL, *streamed = NULL;
+  evalresp_filter *filter = NULL;
+  evalresp_logger *log;
+  FILE *in;
+  int i, j, split, again = 0;
+  fail_if (!(log = evalresp_logger_alloc (count_again, &again)));
+  fail_if (evalresp_new_filter (NULL, &filter));
+  fail_if (evalresp_add_sncl_text (NULL, filter, "IU", "ANMO", NULL, "?H?"));
+  for (i = 0; i < 6; ++i)
+  {
+    /* then by date */
+    if (i >= 3)
+    {
+      fail_if (evalresp_set_year (NULL, filter, years[i % 3]));
+    }
+    fail_if (evalresp_filename_to_channels (NULL, files[i % 3], NULL, filter, &whole));
+    fail_if (evalresp_alloc_channels (NULL, &streamed));
+    fail_if (!(in = fopen (files[i % 3], "r")));
+    again = 0;
+    fail_if (evalresp_stream_to_channels (log, in, NULL, filter, collect_channel, streamed));
+    fclose (in);
+    fail_if (!whole->nchannels);
+    split = i == 0;
+    fail_if (again != split, "Unexpected warnings: %d", again);
+    fail_if (streamed->nchannels != whole->nchannels + split, "Unexpected number of channels: %d", streamed->nchannels);
+    fail_if (split && strcmp (streamed->channels[0]->beg_t, "1991,023,22:25"));
+    for (j = 0; j < whole->nchannels; ++j)
+    {
+      fail_if (strcmp (streamed->channels[j + split]->chaname, whole->channels[j]->chaname));
+      fail_if (strcmp (streamed->channels[j + split]->beg_t, whole->channels[j]->beg_t));
+      fail_if (streamed->channels[j + split]->nstages != whole->channels[j]->nstages);
+      fail_if (streamed->channels[j + split]->sensit != whole->channels[j]->sensit);
+    }
+    evalresp_free_channels (&whole);
+    evalresp_free_channels (&streamed);
+  }
+  evalresp_free_filter (&filter);
+  evalresp_logger_free (log);
+}
+END_TEST
+
+typedef struct
+{
+  FILE *in;
+  int nchannels;
+  int before_eof;
+} stream_progress;
+
+static int
+note_progress (evalresp_logger *log, evalresp_channel *channel, void *data)
+{
+  stream_progress *progress = data;
+  progress->nchannels++;
+  progress->before_eof += !feof (progress->in);
+  return EVALRESP_OK;
+}
+
+START_TEST (test_stream_before_eof)
+{
+  /* channels are passed on as the input moves to another SNCL, not once
+     it is exhausted (response-1 is several windows long) */
+  stream_progress progress;
+  evalresp_channels *whole = NULL;
+  evalresp_filter *filter = NULL;
+  fail_if (evalresp_new_filter (NULL, &filter));
+  fail_if (evalresp_add_sncl_text (NULL, filter, "IU", "ANMO", NULL, "?H?"));
+  fail_if (evalresp_filename_to_channels (NULL, "./data/response-1", NULL, filter, &whole));
+  memset (&progress, 0, sizeof (progress));
+  fail_if (!(progress.in = fopen ("./data/response-1", "r")));
+  fail_if (evalresp_stream_to_channels (NULL, progress.in, NULL, filter, note_progress, &progress));
+  fclose (progress.in);
+  fail_if (progress.nchannels != whole->nchannels, "Unexpected number of channels: %d", progress.nchannels);
+  /* all but those in the last window */
+  fail_if (progress.before_eof < whole->nchannels / 2, "Only %d channels before the end of the input",
+           progress.before_eof);
+  evalresp_free_channels (&whole);
+  evalresp_free_filter (&filter);
+}
+END_TEST
+
+/* look for the line expected in the error messages */
+typedef struct
+{
+  const char *expected;
+  int found;
+} line_search;
+
+static int
+find_line_no (evalresp_log_msg *msg, void *data)
+{
+  line_search *search = data;
+  if (msg->log_level == EV_ERROR && strstr (msg->msg, search->expected))
+  {
+    search->found = 1;
+  }
+  return EXIT_SUCCESS;
+}
+
+START_TEST (test_error_lines)
+{
+  /* an error in a channel read in parallel, or streamed, is reported
+     against its line in the input */
+  evalresp_channels *channels = NULL;
+  evalresp_options *options = NULL;
+  evalresp_logger *log;
+  line_search search;
+  char *text, *gain, expected[32];
+  FILE *in;
+  long len;
+  int line_no;
+  const char *p;
+  fail_if (!(in = fopen ("./data/RESP.IU.ANMO..BHZ", "r")));
+  fseek (in, 0, SEEK_END);
+  len = ftell (in);
+  rewind (in);
+  fail_if (!(text = calloc (len + 1, 1)) || fread (text, 1, len, in) != len);
+  fclose (in);
+  /* spoil the value of the last gain in the input */
+  for (gain = NULL, p = text; (p = strstr (p, "B058F04")); ++p)
+  {
+    gain = (char *)p;
+  }
+  fail_if (!gain || !(gain = strchr (gain, ':')));
+  for (++gain; *gain == ' '; ++gain)
+    ;
+  *gain = 'x';
+  for (line_no = 1, p = text; p < gain; ++p)
+  {
+    line_no += *p == '\n';
+  }
+  sprintf (expected, "line %d", line_no);
+  search.expected = expected;
+  fail_if (!(log = evalresp_logger_alloc (find_line_no, &search)));
+  fail_if (evalresp_new_options (NULL, &options));
+  options->nthreads = 2;
+  search.found = 0;
+  fail_if (evalresp_char_to_channels (log, text, options, NULL, &channels) == EVALRESP_OK);
+  fail_if (!search.found, "No error at %s", expected);
+  fail_if (!(in = tmpfile ()) || fwrite (text, 1, len, in) != len);
+  rewind (in);
+  fail_if (evalresp_alloc_channels (NULL, &channels));
+  search.found = 0;
+  fail_if (evalresp_stream_to_channels (log, in, NULL, NULL, collect_channel, channels) == EVALRESP_OK);
+  fail_if (!search.found, "No error at %s", expected);
+  fclose (in);
+  evalresp_free_channels (&channels);
+  evalresp_free_options (&options);
+  evalresp_logger_free (log);
+  free (text);
+}
+END_TEST
+
+static int
+close_to (double a, double b)
+{
+  return fabs (a - b) <= 1e-4 * fabs (b) + 1e-12;
+}
+
+static int
+close_arrays (const double *a, const double *b, int n)
+{
+  int i;
+  for (i = 0; i < n && close_to (a[i], b[i]); ++i)
+    ;
+  return i == n;
+}
+
+/* the values of the blockettes that evaluation reads */
+static int
+close_blkts (const evalresp_blkt *a, const evalresp_blkt *b)
+{
+  const evalresp_pole_zero *pz = &a->blkt_info.pole_zero, *other_pz = &b->blkt_info.pole_zero;
+  const evalresp_fir *fir = &a->blkt_info.fir, *other_fir = &b->blkt_info.fir;
+  const evalresp_coeff *coeff = &a->blkt_info.coeff, *other_coeff = &b->blkt_info.coeff;
+  const evalresp_decimation *deci = &a->blkt_info.decimation, *other_deci = &b->blkt_info.decimation;
+  const evalresp_list *list = &a->blkt_info.list, *other_list = &b->blkt_info.list;
+  const evalresp_polynomial *poly = &a->blkt_info.polynomial, *other_poly = &b->blkt_info.polynomial;
+
+  if (a->type != b->type)
+  {
+    return 0;
+  }
+  switch (a->type)
+  {
+  case LAPLACE_PZ:
+  case ANALOG_PZ:
+  case IIR_PZ:
+    return close_to (pz->a0, other_pz->a0) && close_to (pz->a0_freq, other_pz->a0_freq) && pz->nzeros == other_pz->nzeros && pz->npoles == other_pz->npoles && close_arrays ((const double *)pz->zeros, (const double *)other_pz->zeros, 2 * pz->nzeros) && close_arrays ((const double *)pz->poles, (const double *)other_pz->poles, 2 * pz->npoles);
+  case FIR_SYM_1:
+  case FIR_SYM_2:
+  case FIR_ASYM:
+    return fir->ncoeffs == other_fir->ncoeffs && close_arrays (fir->coeffs, other_fir->coeffs, fir->ncoeffs);
+  case IIR_COEFFS:
+    return coeff->nnumer == other_coeff->nnumer && coeff->ndenom == other_coeff->ndenom && close_arrays (coeff->numer, other_coeff->numer, coeff->nnumer) && close_arrays (coeff->denom, other_coeff->denom, coeff->ndenom);
+  case DECIMATION:
+    return close_to (deci->sample_int, other_deci->sample_int) && deci->deci_fact == other_deci->deci_fact && deci->deci_offset == other_deci->deci_offset && close_to (deci->estim_delay, other_deci->estim_delay) && close_to (deci->applied_corr, other_deci->applied_corr);
+  case GAIN:
+    return close_to (a->blkt_info.gain.gain, b->blkt_info.gain.gain) && close_to (a->blkt_info.gain.gain_freq, b->blkt_info.gain.gain_freq);
+  case LIST:
+    return list->nresp == other_list->nresp && close_arrays (list->freq, other_list->freq, list->nresp) && close_arrays (list->amp, other_list->amp, list->nresp) && close_arrays (list->phase, other_list->phase, list->nresp);
+  case POLYNOMIAL:
+    return poly->ncoeffs == other_poly->ncoeffs && close_arrays (poly->coeffs, other_poly->coeffs, poly->ncoeffs) && close_to (poly->lower_approx_bound, other_poly->lower_approx_bound) && close_to (poly->upper_approx_bound, other_poly->upper_approx_bound);
+  default:
+    return 1;
+  }
+}
+
+START_TEST (test_xml_channels)
+{
+  /* StationXML converted directly is read as from the printed RESP, apart
+     from the rounding of values in the text */
+  const char *files[] = {"./data/station-1.xml", "./data/station-2.xml", "./data/station-3.xml"};
+  evalresp_channels *direct = NULL, *printed = NULL;
+  evalresp_options *options = NULL;
+  evalresp_stage *stage, *other;
+  evalresp_blkt *blkt, *other_blkt;
+  evalresp_response *response = NULL, *other_response = NULL;
+  FILE *in, *resp = NULL;
+  double peak;
+  int i, j, k, status;
+  fail_if (evalresp_new_options (NULL, &options));
+  fail_if (evalresp_set_frequency (NULL, options, "0.001", "10", "200"));
+  options->station_xml = 1;
+  for (i = 0; i < 3; ++i)
+  {
+    status = evalresp_filename_to_channels (NULL, files[i], options, NULL, &direct);
+    fail_if (!(in = fopen (files[i], "r")));
+    fail_if (evalresp_xml_stream_to_resp_file (NULL, 1, in, NULL, &resp));
+    fclose (in);
+    fail_if (evalresp_file_to_channels (NULL, resp, options, NULL, &printed) != status);
+    fclose (resp);
+    if (status)
+    {
+      continue;
+    }
+    fail_if (!printed->nchannels);
+    fail_if (direct->nchannels != printed->nchannels, "Unexpected number of channels: %d", direct->nchannels);
+    for (j = 0; j < printed->nchannels; ++j)
+    {
+      fail_if (strcmp (direct->channels[j]->network, printed->channels[j]->network));
+      fail_if (strcmp (direct->channels[j]->staname, printed->channels[j]->staname));
+      fail_if (strcmp (direct->channels[j]->locid, printed->channels[j]->locid));
+      fail_if (strcmp (direct->channels[j]->chaname, printed->channels[j]->chaname));
+      fail_if (strcmp (direct->channels[j]->beg_t, printed->channels[j]->beg_t));
+      fail_if (strcmp (direct->channels[j]->end_t, printed->channels[j]->end_t));
+      fail_if (strcmp (direct->channels[j]->first_units, printed->channels[j]->first_units));
+      fail_if (strcmp (direct->channels[j]->last_units, printed->channels[j]->last_units));
+      fail_if (direct->channels[j]->nstages != printed->channels[j]->nstages);
+      fail_if (!close_to (direct->channels[j]->sensit, printed->channels[j]->sensit));
+      fail_if (!close_to (direct->channels[j]->calc_sensit, printed->channels[j]->calc_sensit));
+      for (stage = direct->channels[j]->first_stage, other = printed->channels[j]->first_stage;
+           stage && other; stage = stage->next_stage, other = other->next_stage)
+      {
+        fail_if (stage->sequence_no != other->sequence_no);
+        fail_if (stage->input_units != other->input_units || stage->output_units != other->output_units);
+        for (blkt = stage->first_blkt, other_blkt = other->first_blkt;
+             blkt && other_blkt; blkt = blkt->next_blkt, other_blkt = other_blkt->next_blkt)
+        {
+          fail_if (!close_blkts (blkt, other_blkt), "Blockettes differ: %d at stage %d", blkt->type, stage->sequence_no);
+        }
+        fail_if (blkt || other_blkt);
+      }
+      fail_if (stage || other);
+      /* and so is the response, to within the rounding, relative to its peak */
+      fail_if (evalresp_channel_to_response (NULL, direct->channels[j], options, &response));
+      fail_if (evalresp_channel_to_response (NULL, printed->channels[j], options, &other_response));
+      fail_if (response->nfreqs != other_response->nfreqs);
+      for (k = 0, peak = 0; k < response->nfreqs; ++k)
+      {
+        peak = fmax (peak, hypot (other_response->rvec[k].real, other_response->rvec[k].imag));
+      }
+      for (k = 0; k < response->nfreqs; ++k)
+      {
+        fail_if (hypot (response->rvec[k].real - other_response->rvec[k].real, response->rvec[k].imag - other_response->rvec[k].imag) > 1e-4 * peak,
+                 "Responses differ at %g Hz", response->freqs[k]);
+      }
+      evalresp_free_response (&response);
+      evalresp_free_response (&other_response);
+    }
+    evalresp_free_channels (&direct);
+    evalresp_free_channels (&printed);
+  }
+  evalresp_free_options (&options);
+}
+END_TEST
+
+START_TEST (test_xml_filter)
+{
+  /* StationXML filtered as it is read selects the same channels as the
+     filter applied to the printed RESP */
+  const char *stations[] = {"ANMO", "ANMO", "ANMO", "KONO"};
+  const char *channels[] = {"BH?", "BHZ", "?H?", "BHZ"};
+  const char *years[] = {NULL, "2015", "2000", NULL};
+  evalresp_channels *direct = NULL, *printed = NULL;
+  evalresp_options *options = NULL;
+  evalresp_filter *filter = NULL;
+  FILE *in, *resp = NULL;
+  int i, j;
+  fail_if (evalresp_new_options (NULL, &options));
+  options->station_xml = 1;
+  for (i = 0; i < 4; ++i)
+  {
+    fail_if (evalresp_new_filter (NULL, &filter));
+    fail_if (evalresp_add_sncl_text (NULL, filter, "IU", stations[i], NULL, channels[i]));
+    if (years[i])
+    {
+      fail_if (evalresp_set_year (NULL, filter, years[i]));
+    }
+    fail_if (evalresp_filename_to_channels (NULL, "./data/station-1.xml", options, filter, &direct));
+    fail_if (!(in = fopen ("./data/station-1.xml", "r")));
+    fail_if (evalresp_xml_stream_to_resp_file (NULL, 1, in, NULL, &resp));
+    fclose (in);
+    fail_if (evalresp_file_to_channels (NULL, resp, options, filter, &printed));
+    fclose (resp);
+    fail_if (direct->nchannels != printed->nchannels, "Unexpected number of channels: %d", direct->nchannels);
+    fail_if (i == 0 && !direct->nchannels);
+    fail_if (i == 3 && direct->nchannels);
+    for (j = 0; j < printed->nchannels; ++j)
+    {
+      fail_if (strcmp (direct->channels[j]->locid, printed->channels[j]->locid));
+      fail_if (strcmp (direct->channels[j]->chaname, printed->channels[j]->chaname));
+      fail_if (strcmp (direct->channels[j]->beg_t, printed->channels[j]->beg_t));
+    }
+    evalresp_free_channels (&direct);
+    evalresp_free_channels (&printed);
+    evalresp_free_filter (&filter);
+  }
+  evalresp_free_options (&options);
+}
+END_TEST
+
+START_TEST (test_binary_channels)
+{
+  /* channels saved and loaded save again to the same image, and a
+     truncated or tampered image is rejected */
+  const char *files[] = {"./data/RESP.IU.ANMO..BHZ", "./data/response-2"};
+  evalresp_channels *parsed = NULL, *loaded = NULL;
+  FILE *first, *second;
+  evalresp_channel *chan;
+  evalresp_stage *stage;
+  evalresp_blkt *filt = NULL, *deci;
+  const char *strings[8];
+  char *image;
+  long len, at;
+  int i, j;
+  for (i = 0; i < 2; ++i)
+  {
+    fail_if (evalresp_filename_to_channels (NULL, files[i], NULL, NULL, &parsed));
+    fail_if (!(first = tmpfile ()) || !(second = tmpfile ()));
+    fail_if (evalresp_channels_save_binary (NULL, parsed, first));
+    rewind (first);
+    fail_if (evalresp_channels_load_binary (NULL, first, &loaded));
+    fail_if (loaded->nchannels != parsed->nchannels, "Unexpected number of channels: %d", loaded->nchannels);
+    for (j = 0; j < parsed->nchannels; ++j)
+    {
+      fail_if (strcmp (loaded->channels[j]->chaname, parsed->channels[j]->chaname));
+      fail_if (strcmp (loaded->channels[j]->end_t, parsed->channels[j]->end_t));
+      fail_if (loaded->channels[j]->nstages != parsed->channels[j]->nstages);
+      fail_if (loaded->channels[j]->sensit != parsed->channels[j]->sensit);
+    }
+    fail_if (evalresp_channels_save_binary (NULL, loaded, second));
+    fail_if ((len = ftell (first)) != ftell (second));
+    fail_if (!(image = malloc (2 * len)));
+    rewind (first);
+    rewind (second);
+    fail_if (fread (image, 1, len, first) != len || fread (image + len, 1, len, second) != len);
+    fail_if (memcmp (image, image + len, len));
+    evalresp_free_channels (&loaded);
+    fail_if (evalresp_binary_to_channels (NULL, image, len - 1, &loaded) != EVALRESP_INP);
+    fail_if (loaded);
+    /* the (little-endian) nstages of the first channel follows the
+       header, 8 strings and 8 doubles; then the number of stages and the
+       sequence number, units and number of blockettes of its first stage */
+    chan = parsed->channels[0];
+    strings[0] = chan->staname;
+    strings[1] = chan->network;
+    strings[2] = chan->locid;
+    strings[3] = chan->chaname;
+    strings[4] = chan->beg_t;
+    strings[5] = chan->end_t;
+    strings[6] = chan->first_units;
+    strings[7] = chan->last_units;
+    for (at = 12, j = 0; j < 8; ++j)
+    {
+      at += 4 + strlen (strings[j]);
+    }
+    at += 8 * sizeof (double);
+    fail_if (image[at] != chan->nstages);
+    image[at] += 5;
+    fail_if (evalresp_binary_to_channels (NULL, image, len, &loaded) != EVALRESP_INP);
+    fail_if (loaded);
+    image[at] -= 5;
+    fail_if (image[at + 20] == 0);
+    image[at + 20] = 0;
+    fail_if (evalresp_binary_to_channels (NULL, image, len, &loaded) != EVALRESP_INP);
+    fail_if (loaded);
+    free (image);
+    fclose (first);
+    fclose (second);
+    /* an image whose digital filter has lost its decimation blockette
+       would crash evaluation, so it is rejected too */
+    for (stage = chan->first_stage; stage && !filt; stage = stage->next_stage)
+    {
+      for (filt = stage->first_blkt; filt && filt->type != FIR_SYM_1 && filt->type != FIR_SYM_2 && filt->type != FIR_ASYM && filt->type != IIR_PZ && filt->type != IIR_COEFFS; filt = filt->next_blkt)
+        ;
+    }
+    fail_if (!filt || !(deci = filt->next_blkt) || deci->type != DECIMATION);
+    filt->next_blkt = NULL;
+    fail_if (!(first = tmpfile ()));
+    fail_if (evalresp_channels_save_binary (NULL, parsed, first));
+    rewind (first);
+    fail_if (evalresp_channels_load_binary (NULL, first, &loaded) != EVALRESP_INP);
+    fail_if (loaded);
+    filt->next_blkt = deci;
+    filt = NULL;
+    fclose (first);
+    evalresp_free_channels (&parsed);
+  }
+}
+END_TEST
+
+START_TEST (test_arena_channels)
+{
+  /* channels read into the arena of their collection respond as those
+     streamed onto the heap, and channels built by hand are still freed
+     one by one */
+  evalresp_channels *arena = NULL, *heap = NULL, *hand = NULL;
+  evalresp_responses *a = NULL, *b = NULL;
+  evalresp_options *options = NULL;
+  evalresp_filter *filter = NULL;
+  evalresp_channel *channel;
+  FILE *in;
+  int i, j;
+  fail_if (evalresp_new_options (NULL, &options));
+  fail_if (evalresp_new_filter (NULL, &filter));
+  fail_if (evalresp_add_sncl_text (NULL, filter, "IU", "ANMO", NULL, "?H?"));
+  fail_if (evalresp_filename_to_channels (NULL, "./data/response-1", options, filter, &arena));
+  fail_if (!arena->arena);
+  fail_if (evalresp_alloc_channels (NULL, &heap));
+  fail_if (!(in = fopen ("./data/response-1", "r")));
+  fail_if (evalresp_stream_to_channels (NULL, in, options, filter, collect_channel, heap));
+  fclose (in);
+  fail_if (heap->arena);
+  fail_if (evalresp_channels_to_responses (NULL, arena, options, &a));
+  fail_if (evalresp_channels_to_responses (NULL, heap, options, &b));
+  fail_if (a->nresponses != arena->nchannels || b->nresponses != a->nresponses);
+  for (i = 0; i < a->nresponses; ++i)
+  {
+    fail_if (a->responses[i]->nfreqs != b->responses[i]->nfreqs);
+    for (j = 0; j < a->responses[i]->nfreqs; ++j)
+    {
+      fail_if (a->responses[i]->rvec[j].real != b->responses[i]->rvec[j].real);
+      fail_if (a->responses[i]->rvec[j].imag != b->responses[i]->rvec[j].imag);
+    }
+  }
+  evalresp_free_responses (&a);
+  evalresp_free_responses (&b);
+  evalresp_free_channels (&arena);
+  evalresp_free_channels (&heap);
+  fail_if (arena || heap);
+  fail_if (evalresp_alloc_channels (NULL, &hand));
+  fail_if (!(channel = calloc (1, sizeof (*channel))));
+  fail_if (!(channel->first_stage = alloc_stage (NULL, NULL)));
+  fail_if (!(channel->first_stage->first_blkt = alloc_gain (NULL, NULL)));
+  channel->nstages = 1;
+  fail_if (!(hand->channels = malloc (sizeof (channel))));
+  hand->channels[hand->nchannels++] = channel;
+  evalresp_free_channels (&hand);
+  evalresp_free_filter (&filter);
+  evalresp_free_options (&options);
+}
+END_TEST
+
+START_TEST (test_unselected_channels)
+{
+  /* channels that are not selected are not parsed, so errors in their
+     stages do not matter */
+  const char *input =
+      "B050F03     Station:     GOOD\n"
+      "B050F16     Network:     XX\n"
+      "B052F03     Location:    ??\n"
+      "B052F04     Channel:     BHZ\n"
+      "B052F22     Start date:  2000,001\n"
+      "B052F23     End date:    No Ending Time\n"
+      "B058F03     Stage sequence number:                 0\n"
+      "B058F04     Sensitivity:                           1.000000E+00\n"
+      "B058F05     Frequency of sensitivity:              1.000000E+00\n"
+      "B058F06     Number of calibrations:                0\n"
+      "B050F03     Station:     BAD\n"
+      "B050F16     Network:     XX\n"
+      "B052F03     Location:    ??\n"
+      "B052F04     Channel:     BHZ\n"
+      "B052F22     Start date:  2000,001\n"
+      "B052F23     End date:    No Ending Time\n"
+      "B058F03     Stage sequence number:                 x\n";
+  evalresp_channels *channels = NULL;
+  evalresp_filter *filter = NULL;
+
+  fail_if (!evalresp_char_to_channels (NULL, input, NULL, NULL, &channels));
+  fail_if (evalresp_new_filter (NULL, &filter));
+  fail_if (evalresp_add_sncl_text (NULL, filter, "XX", "GOOD", NULL, "BHZ"));
+  fail_if (evalresp_char_to_channels (NULL, input, NULL, filter, &channels));
+  fail_if (channels->nchannels != 1, "Unexpected number of channels: %d", channels->nchannels);
+  fail_if (strcmp (channels->channels[0]->staname, "GOOD"));
+  fail_if (channels->channels[0]->sensit != 1.0);
+  evalresp_free_channels (&channels);
+  evalresp_free_filter (&filter);
+}
+END_TEST
+
+START_TEST (test_channel_epochs)
+{
+  /* epochs of the same SNCL compete even when other channels come between;
+     the sensitivity identifies the epoch selected */
+#define EPOCH(sta, beg, end, sensit)                                    \
+  "B050F03     Station:     " sta "\n"                                  \
+  "B050F16     Network:     XX\n"                                       \
+  "B052F03     Location:    ??\n"                                       \
+  "B052F04     Channel:     BHZ\n"                                      \
+  "B052F22     Start date:  " beg "\n"                                  \
+  "B052F23     End date:    " end "\n"                                  \
+  "B058F03     Stage sequence number:                 0\n"              \
+  "B058F04     Sensitivity:                           " sensit "\n"     \
+  "B058F05     Frequency of sensitivity:              1.000000E+00\n"   \
+  "B058F06     Number of calibrations:                0\n"
+  const char *input =
+      EPOCH ("STA", "2000,001", "2005,001", "1.0")
+      EPOCH ("OTHER", "2000,001", "No Ending Time", "9.0")
+      EPOCH ("STA", "2005,001", "No Ending Time", "2.0")
+      EPOCH ("STA", "2001,001", "2002,001", "3.0");
+#undef EPOCH
+  evalresp_channels *channels = NULL;
+  evalresp_filter *filter = NULL;
+
+  /* without a date, the latest epoch of each SNCL, in input order */
+  fail_if (evalresp_char_to_channels (NULL, input, NULL, NULL, &channels));
+  fail_if (channels->nchannels != 2, "Unexpected number of channels: %d", channels->nchannels);
+  fail_if (strcmp (channels->channels[0]->staname, "OTHER"));
+  fail_if (channels->channels[1]->sensit != 2.0);
+  evalresp_free_channels (&channels);
+
+  /* with a date, the shortest epoch that contains it */
+  fail_if (evalresp_new_filter (NULL, &filter));
+  fail_if (evalresp_add_sncl_text (NULL, filter, "XX", "STA", NULL, "BHZ"));
+  fail_if (evalresp_set_year (NULL, filter, "2001"));
+  fail_if (evalresp_set_julian_day (NULL, filter, "100"));
+  fail_if (evalresp_char_to_channels (NULL, input, NULL, filter, &channels));
+  fail_if (channels->nchannels != 1, "Unexpected number of channels: %d", channels->nchannels);
+  fail_if (channels->channels[0]->sensit != 3.0);
+  evalresp_free_channels (&channels);
+
+  fail_if (evalresp_set_year (NULL, filter, "2006"));
+  fail_if (evalresp_char_to_channels (NULL, input, NULL, filter, &channels));
+  fail_if (channels->nchannels != 1, "Unexpected number of channels: %d", channels->nchannels);
+  fail_if (channels->channels[0]->sensit != 2.0);
+  evalresp_free_channels (&channels);
+  evalresp_free_filter (&filter);
+}
+END_TEST
+
+START_TEST (test_globs)
+{
+  /* compiled globs match as the regular expressions they convert to */
+  const char *globs[] = {"", "*", "?", "BHZ", "BH?", "B*Z", "*Z", "B*", "?H*", "**Z*", "ANMO",
+                         "AN?O*", "Z", "B*H*Z", "*B?Z*Z", "BH*HZ", "A*A*A*B",
+                         "B.Z", "B[HL]Z", "^BH", "HZ$", "B+", "(BH|LH)Z"};
+  const char *names[] = {"", "BHZ", "LHZ", "XBHZ", "BHZZ", "ANMO", "B.Z", "BBHZ", "Z",
+                         "BHHZ", "BHZBHZ", "AAAB", "AABAB"};
+  char regexp_pattern[MAXLINELEN], *r, many_a[64];
+  const char *g;
+  glob_pattern *pattern;
+  regexp *prog;
+  int i, j;
+
+  for (i = 0; i < sizeof (globs) / sizeof (*globs); ++i)
+  {
+    for (g = globs[i], r = regexp_pattern; *g; g++)
+    {
+      if (*g == '*')
+      {
+        *r++ = '.';
+      }
+      *r++ = *g == '?' ? '.' : *g;
+    }
+    *r = '\0';
+    fail_if (!(prog = evr_regcomp (regexp_pattern, NULL)));
+    fail_if (compile_glob (NULL, globs[i], &pattern));
+    for (j = 0; j < sizeof (names) / sizeof (*names); ++j)
+    {
+      fail_if (match_glob (NULL, pattern, names[j]) != !!evr_regexec (prog, (char *)names[j], NULL),
+               "'%s' and '%s'", globs[i], names[j]);
+    }
+    free_glob (&pattern);
+    free (prog);
+  }
+  /* many '*' take time in proportion to the lengths, not exponential */
+  memset (many_a, 'A', sizeof (many_a) - 1);
+  many_a[sizeof (many_a) - 1] = '\0';
+  fail_if (compile_glob (NULL, "*A*A*A*A*A*A*A*A*A*A*A*A*B", &pattern));
+  fail_if (match_glob (NULL, pattern, many_a));
+  many_a[40] = 'B';
+  fail_if (!match_glob (NULL, pattern, many_a));
+  free_glob (&pattern);
+}
+END_TEST
+
 int
 single_letter_prefix (char *string, int length)
 {
@@ -180,6 +885,48 @@ START_TEST (test_filter)
 }
 END_TEST
 
+START_TEST (test_lex_numbers)
+{
+  const char *ints[] = {"0", "-12", "+7", "0042"};
+  const char *not_ints[] = {"", "-", "1.0", "12a", " 1", "1 ", "0x10"};
+  const char *reals[] = {"0", "-0.0", "1.", ".5", "-.5E-3", "+2e+10", "1.23456789012345678901234E-05",
+                         "6.2831853071795864769", "9007199254740993", "1e-320", "1e400", "0.1", "3.00000E+02"};
+  const char *not_reals[] = {"", ".", "-", "e5", "1e", "1e+", "1.2.3", "1..", "1e5.0", "nan", "inf", "0x1p3", "1,5"};
+  double value, expected;
+  char text[64];
+  int i, n;
+
+  for (i = 0; i < sizeof (ints) / sizeof (*ints); ++i)
+  {
+    fail_if (!lex_int (ints[i], &n), "Rejected '%s'", ints[i]);
+    fail_if (n != atoi (ints[i]), "Parsed '%s' as %d", ints[i], n);
+  }
+  for (i = 0; i < sizeof (not_ints) / sizeof (*not_ints); ++i)
+  {
+    fail_if (lex_int (not_ints[i], &n), "Accepted '%s'", not_ints[i]);
+  }
+  for (i = 0; i < sizeof (reals) / sizeof (*reals); ++i)
+  {
+    fail_if (!lex_double (reals[i], &value), "Rejected '%s'", reals[i]);
+    expected = strtod (reals[i], NULL);
+    fail_if (memcmp (&value, &expected, sizeof (value)), "Parsed '%s' as %g", reals[i], value);
+  }
+  for (i = 0; i < sizeof (not_reals) / sizeof (*not_reals); ++i)
+  {
+    fail_if (lex_double (not_reals[i], &value), "Accepted '%s'", not_reals[i]);
+  }
+  /* values as they appear in RESP files convert exactly as before */
+  srand (42);
+  for (i = 0; i < 100000; ++i)
+  {
+    snprintf (text, sizeof (text), "%+.*E", rand () % 20, (rand () - RAND_MAX / 2) * pow (10, rand () % 60 - 30));
+    fail_if (!lex_double (text, &value), "Rejected '%s'", text);
+    expected = strtod (text, NULL);
+    fail_if (memcmp (&value, &expected, sizeof (value)), "Parsed '%s' as %.17g", text, value);
+  }
+}
+END_TEST
+
 START_TEST (test_julian_day)
 {
   evalresp_filter *filter = NULL;
@@ -200,14 +947,26 @@ main (void)
   int number_failed;
   Suite *s = suite_create ("suite");
   TCase *tc = tcase_create ("case");
-  tcase_add_test (tc, test_slurp_line);
-  tcase_add_test (tc, test_slurp_line_buffer);
+  tcase_add_test (tc, test_tokenize_resp);
   tcase_add_test (tc, test_find_line);
   tcase_add_test (tc, test_find_field);
   tcase_add_test (tc, test_file_to_char);
   tcase_add_test (tc, test_filename_to_channels);
+  tcase_add_test (tc, test_pipe_to_channels);
   tcase_add_test (tc, test_splits);
   tcase_add_test (tc, test_filter);
+  tcase_add_test (tc, test_parallel_channels);
+  tcase_add_test (tc, test_stream_to_channels);
+  tcase_add_test (tc, test_stream_before_eof);
+  tcase_add_test (tc, test_error_lines);
+  tcase_add_test (tc, test_xml_channels);
+  tcase_add_test (tc, test_xml_filter);
+  tcase_add_test (tc, test_binary_channels);
+  tcase_add_test (tc, test_arena_channels);
+  tcase_add_test (tc, test_unselected_channels);
+  tcase_add_test (tc, test_channel_epochs);
+  tcase_add_test (tc, test_globs);
+  tcase_add_test (tc, test_lex_numbers);
   tcase_add_test (tc, test_julian_day);
   suite_add_tcase (s, tc);
   SRunner *sr = srunner_create (s);
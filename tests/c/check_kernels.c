@@ -0,0 +1,238 @@
+#include <check.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "evalresp/private.h"
+#include "evalresp/public_api.h"
+
+static evalresp_blkt *
+find_blkt (evalresp_channel *channel, int type)
+{
+  evalresp_stage *stage;
+  evalresp_blkt *blkt;
+  for (stage = channel->first_stage; stage; stage = stage->next_stage)
+  {
+    for (blkt = stage->first_blkt; blkt; blkt = blkt->next_blkt)
+    {
+      if (blkt->type == type)
+      {
+        return blkt;
+      }
+    }
+  }
+  return NULL;
+}
+
+static double *
+log_freqs (int n, double lo, double hi)
+{
+  double *freqs = NULL;
+  int i;
+  fail_if (!(freqs = calloc (n, sizeof (*freqs))));
+  for (i = 0; i < n; ++i)
+  {
+    freqs[i] = pow (10.0, log10 (lo) + i * (log10 (hi) - log10 (lo)) / (n - 1));
+  }
+  return freqs;
+}
+
+START_TEST (test_analog_batch)
+{
+  evalresp_channels *channels = NULL;
+  evalresp_blkt *blkt;
+  int n = 1003, isa;
+  double *freqs, *re0, *im0, *re, *im;
+
+  fail_if (evalresp_filename_to_channels (NULL, "./data/RESP.IU.ANMO..BHZ", NULL, NULL, &channels));
+  fail_if (!(blkt = find_blkt (channels->channels[0], LAPLACE_PZ)));
+  freqs = log_freqs (n, 1e-4, 50);
+  fail_if (!(re0 = calloc (n, sizeof (*re0))) || !(im0 = calloc (n, sizeof (*im0))));
+  fail_if (!(re = calloc (n, sizeof (*re))) || !(im = calloc (n, sizeof (*im))));
+
+  analog_trans_batch (SIMD_SCALAR, blkt, freqs, n, re0, im0);
+  for (isa = SIMD_SSE2; isa <= SIMD_AVX512; isa++)
+  {
+    if (!simd_isa_supported (isa))
+    {
+      continue;
+    }
+    printf ("checking instruction set %d\n", isa);
+    memset (re, 0, n * sizeof (*re));
+    memset (im, 0, n * sizeof (*im));
+    analog_trans_batch (isa, blkt, freqs, n, re, im);
+    fail_if (memcmp (re, re0, n * sizeof (*re)), "Real part differs for isa %d", isa);
+    fail_if (memcmp (im, im0, n * sizeof (*im)), "Imaginary part differs for isa %d", isa);
+  }
+
+  free (freqs);
+  free (re0);
+  free (im0);
+  free (re);
+  free (im);
+  evalresp_free_channels (&channels);
+}
+END_TEST
+
+static void
+fir_fft_response (const char *file, double threshold, evalresp_response **response)
+{
+  evalresp_channels *channels = NULL;
+  evalresp_options *options = NULL;
+  fail_if (evalresp_new_options (NULL, &options));
+  fail_if (evalresp_set_frequency (NULL, options, "0.001", "20", "4001"));
+  options->lin_freq = 1;
+  options->fir_fft_threshold = threshold;
+  fail_if (evalresp_filename_to_channels (NULL, file, options, NULL, &channels));
+  fail_if (evalresp_channel_to_response (NULL, channels->channels[0], options, response));
+  evalresp_free_channels (&channels);
+  evalresp_free_options (&options);
+}
+
+START_TEST (test_fir_fft)
+{
+  const char *files[] = {"./data/RESP.IU.ANMO..BHZ", "./data/RESP.IU.ANMO.00.BHZ", "./data/RESP.HAW.CO.00.HHZ.counts"};
+  evalresp_response *direct = NULL, *fft = NULL;
+  double max, err;
+  int i, f;
+
+  for (f = 0; f < 3; f++)
+  {
+    fir_fft_response (files[f], 0, &direct);
+    fir_fft_response (files[f], 1, &fft);
+    fail_if (direct->nfreqs != fft->nfreqs);
+    max = 0;
+    for (i = 0; i < direct->nfreqs; i++)
+    {
+      max = fmax (max, hypot (direct->rvec[i].real, direct->rvec[i].imag));
+    }
+    err = 0;
+    for (i = 0; i < direct->nfreqs; i++)
+    {
+      err = fmax (err, hypot (direct->rvec[i].real - fft->rvec[i].real,
+                              direct->rvec[i].imag - fft->rvec[i].imag) /
+                           max);
+    }
+    printf ("%s: max error relative to peak %g\n", files[f], err);
+    fail_if (err > 1e-10, "FFT response differs for %s: %g", files[f], err);
+    evalresp_free_response (&direct);
+    evalresp_free_response (&fft);
+  }
+}
+END_TEST
+
+/* a single stage IIR filter given as coefficients */
+static const char *iir_resp =
+    "B050F03     Station:     TEST\n"
+    "B050F16     Network:     XX\n"
+    "B052F03     Location:    ??\n"
+    "B052F04     Channel:     BHZ\n"
+    "B052F22     Start date:  2000,001,00:00:00\n"
+    "B052F23     End date:    No Ending Time\n"
+    "B054F03     Transfer function type:                D\n"
+    "B054F04     Stage sequence number:                 1\n"
+    "B054F05     Response in units lookup:              V - Volts\n"
+    "B054F06     Response out units lookup:             COUNTS - Digital Counts\n"
+    "B054F07     Number of numerators:                  3\n"
+    "B054F10     Number of denominators:                3\n"
+    "B054F08-09    0  2.000000E-01  0.000000E+00\n"
+    "B054F08-09    1  4.000000E-01  0.000000E+00\n"
+    "B054F08-09    2  2.000000E-01  0.000000E+00\n"
+    "B054F11-12    0  1.000000E+00  0.000000E+00\n"
+    "B054F11-12    1 -6.000000E-01  0.000000E+00\n"
+    "B054F11-12    2  2.000000E-01  0.000000E+00\n"
+    "B057F03     Stage sequence number:                 1\n"
+    "B057F04     Input sample rate:                     1.000000E+02\n"
+    "B057F05     Decimation factor:                     1\n"
+    "B057F06     Decimation offset:                     0\n"
+    "B057F07     Estimated delay (seconds):             0.000000E+00\n"
+    "B057F08     Correction applied (seconds):          0.000000E+00\n"
+    "B058F03     Stage sequence number:                 1\n"
+    "B058F04     Gain:                                  1.000000E+06\n"
+    "B058F05     Frequency of gain:                     1.000000E+00 HZ\n"
+    "B058F06     Number of calibrations:                0\n"
+    "B058F03     Stage sequence number:                 0\n"
+    "B058F04     Sensitivity:                           1.000000E+06\n"
+    "B058F05     Frequency of sensitivity:              1.000000E+00 HZ\n"
+    "B058F06     Number of calibrations:                0\n";
+
+static double
+recurrence_error (evalresp_channels *channels, int c)
+{
+  evalresp_response *direct = NULL, *rec = NULL;
+  evalresp_options *options = NULL;
+  double max = 0, err = 0;
+  int i;
+
+  fail_if (evalresp_new_options (NULL, &options));
+  fail_if (evalresp_set_frequency (NULL, options, "0.0001", "100", "500"));
+  fail_if (evalresp_channel_to_response (NULL, channels->channels[c], options, &direct));
+  options->use_trig_recurrence = 1;
+  fail_if (evalresp_channel_to_response (NULL, channels->channels[c], options, &rec));
+  for (i = 0; i < direct->nfreqs; i++)
+  {
+    max = fmax (max, hypot (direct->rvec[i].real, direct->rvec[i].imag));
+  }
+  for (i = 0; i < direct->nfreqs; i++)
+  {
+    err = fmax (err, hypot (direct->rvec[i].real - rec->rvec[i].real,
+                            direct->rvec[i].imag - rec->rvec[i].imag) /
+                         max);
+  }
+  evalresp_free_response (&direct);
+  evalresp_free_response (&rec);
+  evalresp_free_options (&options);
+  return err;
+}
+
+START_TEST (test_trig_recurrence)
+{
+  const char *files[] = {"./data/RESP.IU.ANMO..BHZ", "./data/RESP.IU.ANMO.00.BHZ",
+                         "./data/RESP.IU.ANMO.10.BHZ", "./data/RESP.HAW.CO.00.HHZ.counts",
+                         "./data/station-2.xml", "./data/station-3.xml"};
+  evalresp_channels *channels = NULL;
+  evalresp_options *options = NULL;
+  double err;
+  int c, f;
+
+  fail_if (evalresp_new_options (NULL, &options));
+  for (f = 0; f < 6; f++)
+  {
+    fail_if (evalresp_filename_to_channels (NULL, files[f], options, NULL, &channels));
+    for (c = 0; c < channels->nchannels; c++)
+    {
+      err = recurrence_error (channels, c);
+      printf ("%s channel %d: max error relative to peak %g\n", files[f], c, err);
+      fail_if (err > 1e-10, "Recurrence differs for %s channel %d: %g", files[f], c, err);
+    }
+    evalresp_free_channels (&channels);
+  }
+  evalresp_free_options (&options);
+
+  fail_if (evalresp_char_to_channels (NULL, iir_resp, NULL, NULL, &channels));
+  fail_if (find_blkt (channels->channels[0], IIR_COEFFS) == NULL);
+  err = recurrence_error (channels, 0);
+  printf ("IIR coefficients: max error relative to peak %g\n", err);
+  fail_if (err > 1e-12, "Recurrence differs for IIR coefficients: %g", err);
+  evalresp_free_channels (&channels);
+}
+END_TEST
+
+int
+main (void)
+{
+  int number_failed;
+  Suite *s = suite_create ("suite");
+  TCase *tc = tcase_create ("case");
+  tcase_add_test (tc, test_analog_batch);
+  tcase_add_test (tc, test_fir_fft);
+  tcase_add_test (tc, test_trig_recurrence);
+  suite_add_tcase (s, tc);
+  SRunner *sr = srunner_create (s);
+  srunner_set_xml (sr, "check-kernels.xml");
+  srunner_run_all (sr, CK_NORMAL);
+  number_failed = srunner_ntests_failed (sr);
+  srunner_free (sr);
+  return number_failed;
+}
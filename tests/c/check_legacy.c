@@ -523,7 +523,7 @@ old_evresp_itp (char *stalst, char *chalst, char *net_code,
             }
 
             /* check the filter sequence that was just read */
-            check_channel (log, &this_channel);
+            check_channel (log, NULL, &this_channel);
 
             /* If we process blockette 55, we should recompute resp->rvec */
             /* because the number of output responses is generally different from */
@@ -545,7 +545,7 @@ old_evresp_itp (char *stalst, char *chalst, char *net_code,
               memcpy (freqs,
                       this_channel.first_stage->first_blkt->blkt_info.list.freq,
                       sizeof (double) * nfreqs); /*cp*/
-              resp->rvec = alloc_complex (nfreqs, log);
+              resp->rvec = alloc_complex (nfreqs, NULL, log);
               output = resp->rvec;
               resp->nfreqs = nfreqs;
               resp->freqs = (double *)malloc (
@@ -559,7 +559,7 @@ old_evresp_itp (char *stalst, char *chalst, char *net_code,
               nfreqs = nfreqs_orig;
               freqs = (double *)malloc (sizeof (double) * nfreqs);  /* malloc a new vector */
               memcpy (freqs, freqs_orig, sizeof (double) * nfreqs); /*cp*/
-              resp->rvec = alloc_complex (nfreqs, log);
+              resp->rvec = alloc_complex (nfreqs, NULL, log);
               output = resp->rvec;
               resp->nfreqs = nfreqs;
               resp->freqs = (double *)malloc (
@@ -808,7 +808,7 @@ old_evresp_itp (char *stalst, char *chalst, char *net_code,
                 }
 
                 /* check the filter sequence that was just read */
-                check_channel (log, &this_channel);
+                check_channel (log, NULL, &this_channel);
 
                 /* If we process blockette 55, we should recompute resp->rvec */
                 /* because the number of output responses is generally different from */
@@ -830,7 +830,7 @@ old_evresp_itp (char *stalst, char *chalst, char *net_code,
                   memcpy (freqs,
                           this_channel.first_stage->first_blkt->blkt_info.list.freq,
                           sizeof (double) * nfreqs); /*cp*/
-                  resp->rvec = alloc_complex (nfreqs, log);
+                  resp->rvec = alloc_complex (nfreqs, NULL, log);
                   output = resp->rvec;
                   resp->nfreqs = nfreqs;
                   resp->freqs = (double *)malloc (
@@ -846,7 +846,7 @@ old_evresp_itp (char *stalst, char *chalst, char *net_code,
                       sizeof (double) * nfreqs); /* malloc a new vector */
                   memcpy (freqs, freqs_orig,
                           sizeof (double) * nfreqs); /*cp*/
-                  resp->rvec = alloc_complex (nfreqs, log);
+                  resp->rvec = alloc_complex (nfreqs, NULL, log);
                   output = resp->rvec;
                   resp->nfreqs = nfreqs;
                   resp->freqs = (double *)malloc (
@@ -2,8 +2,11 @@
 #include <check.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "evalresp/stationxml2resp.h"
+#include "evalresp/stationxml2resp/dom_to_seed.h"
 #include "evalresp/stationxml2resp/xml_to_dom.h"
 #include "evalresp_log/log.h"
 
@@ -25,6 +28,79 @@ START_TEST (test_read_xml)
 }
 END_TEST
 
+static int
+count_channel (evalresp_logger *log, const char *net, const char *stn, x2r_channel *channel, void *data)
+{
+  x2r_station *station = data;
+  int *count = &station->n_channels;
+  if (strcmp (net, "IU") || strcmp (stn, station->code) || strcmp (channel->code, station->channel[*count].code) ||
+      channel->response.n_stages != station->channel[*count].response.n_stages)
+  {
+    return X2R_ERR_USER;
+  }
+  ++*count;
+  return X2R_OK;
+}
+
+START_TEST (test_stream_xml)
+{
+  /* channels streamed one at a time are those of the whole model, in order */
+  FILE *in;
+  evalresp_logger *log = NULL;
+  x2r_fdsn_station_xml *root = NULL;
+  x2r_station seen;
+  fail_if (!(in = fopen ("./data/station-1.xml", "r")));
+  fail_if (x2r_station_service_load (log, in, &root));
+  rewind (in);
+  seen = root->network[0].station[0];
+  seen.n_channels = 0;
+  fail_if (x2r_station_service_stream (log, in, NULL, count_channel, &seen));
+  fail_if (seen.n_channels != 47, "unexpected number of channels: %d", seen.n_channels);
+  fclose (in);
+  fail_if (x2r_free_fdsn_station_xml (root, X2R_OK));
+}
+END_TEST
+
+static char *
+print_resp (x2r_fdsn_station_xml *root)
+{
+  FILE *out;
+  long size;
+  char *text;
+  fail_if (!(out = tmpfile ()));
+  fail_if (x2r_resp_util_write (NULL, out, root));
+  size = ftell (out);
+  rewind (out);
+  fail_if (!(text = calloc (size + 1, 1)));
+  fail_if (fread (text, 1, size, out) != (size_t)size);
+  fclose (out);
+  return text;
+}
+
+START_TEST (test_parallel_parse)
+{
+  /* channels parsed in parallel give the same model as parsed in order */
+  FILE *in;
+  mxml_node_t *doc;
+  x2r_fdsn_station_xml *serial = NULL, *parallel = NULL;
+  char *expected, *actual;
+  fail_if (!(in = fopen ("./data/station-1.xml", "r")));
+  fail_if (!(doc = mxmlLoadFile (NULL, in, MXML_OPAQUE_CALLBACK)));
+  fclose (in);
+  fail_if (x2r_parse_fdsn_station_xml (NULL, doc, 1, &serial));
+  fail_if (x2r_parse_fdsn_station_xml (NULL, doc, 4, &parallel));
+  mxmlDelete (doc);
+  fail_if (parallel->network[0].station[0].n_channels != 47);
+  expected = print_resp (serial);
+  actual = print_resp (parallel);
+  fail_if (strcmp (expected, actual), "parallel parse differs");
+  free (expected);
+  free (actual);
+  fail_if (x2r_free_fdsn_station_xml (serial, X2R_OK));
+  fail_if (x2r_free_fdsn_station_xml (parallel, X2R_OK));
+}
+END_TEST
+
 int
 main (void)
 {
@@ -32,6 +108,8 @@ main (void)
   Suite *s = suite_create ("suite");
   TCase *tc = tcase_create ("case");
   tcase_add_test (tc, test_read_xml);
+  tcase_add_test (tc, test_stream_xml);
+  tcase_add_test (tc, test_parallel_parse);
   suite_add_tcase (s, tc);
   SRunner *sr = srunner_create (s);
   srunner_set_xml (sr, "check-read_xml.xml");
@@ -22,17 +22,28 @@ open_path (const char *dir, const char *file)
 }
 
 void
-run_xml_to_char_test (const char *xml_path, const char *resp_path)
+run_xml_to_char_test (const char *xml_path, const char *resp_path, int nthreads)
 {
   FILE *in_fd = NULL, *check_fd = NULL;
   char cwd[1000], *test_char = NULL, *test_xml = NULL, *check_char = NULL;
   evalresp_logger *log = NULL;
+  evalresp_options *options = NULL;
 
   ck_assert (NULL != getcwd (cwd, 1000));
   in_fd = open_path (cwd, xml_path);
   ck_assert (EVALRESP_OK == file_to_char (log, in_fd, &test_xml));
   fclose (in_fd);
-  ck_assert (EVALRESP_OK == evalresp_xml_to_char (log, 1, test_xml, &test_char));
+  if (nthreads > 1)
+  {
+    ck_assert (EVALRESP_OK == evalresp_new_options (log, &options));
+    options->nthreads = nthreads;
+    ck_assert (EVALRESP_OK == evalresp_xml_options_to_char (log, options, test_xml, &test_char));
+    evalresp_free_options (&options);
+  }
+  else
+  {
+    ck_assert (EVALRESP_OK == evalresp_xml_to_char (log, 1, test_xml, &test_char));
+  }
   free (test_xml);
   check_fd = open_path (cwd, resp_path);
   ck_assert (EVALRESP_OK == file_to_char (log, check_fd, &check_char));
@@ -44,19 +55,28 @@ run_xml_to_char_test (const char *xml_path, const char *resp_path)
 
 START_TEST (test_xml_to_char_1_flag_1)
 {
-  run_xml_to_char_test ("data/station-1.xml", "data/response-1");
+  run_xml_to_char_test ("data/station-1.xml", "data/response-1", 1);
 }
 END_TEST
 
 START_TEST (test_xml_to_char_1_flag_2)
 {
-  run_xml_to_char_test ("data/station-2.xml", "data/response-2");
+  run_xml_to_char_test ("data/station-2.xml", "data/response-2", 1);
 }
 END_TEST
 
 START_TEST (test_xml_to_char_1_flag_3)
 {
-  run_xml_to_char_test ("data/station-3.xml", "data/response-3");
+  run_xml_to_char_test ("data/station-3.xml", "data/response-3", 1);
+}
+END_TEST
+
+START_TEST (test_xml_to_char_threads)
+{
+  /* channels parsed in parallel give the same response file */
+  run_xml_to_char_test ("data/station-1.xml", "data/response-1", 4);
+  run_xml_to_char_test ("data/station-2.xml", "data/response-2", 4);
+  run_xml_to_char_test ("data/station-3.xml", "data/response-3", 4);
 }
 END_TEST
 
@@ -78,6 +98,7 @@ main (void)
   tcase_add_test (tc, test_xml_to_char_1_flag_1);
   tcase_add_test (tc, test_xml_to_char_1_flag_2);
   tcase_add_test (tc, test_xml_to_char_1_flag_3);
+  tcase_add_test (tc, test_xml_to_char_threads);
   suite_add_tcase (s, tc);
   SRunner *sr = srunner_create (s);
   srunner_set_xml (sr, "check-xml-to-char.xml");
@@ -185,7 +185,7 @@ parse_pz (FILE *fptr, evalresp_blkt *blkt_ptr, evalresp_stage *stage_ptr, evalre
 
   /* remember to allocate enough space for the number of zeros to follow */
 
-  blkt_ptr->blkt_info.pole_zero.zeros = alloc_complex (nzeros, log);
+  blkt_ptr->blkt_info.pole_zero.zeros = alloc_complex (nzeros, NULL, log);
 
   /* set the expected field to the current value (9 or 10 for [53] or [43])
      to the current value + 5 (14 or 15 for [53] or [43] respectively) */
@@ -203,7 +203,7 @@ parse_pz (FILE *fptr, evalresp_blkt *blkt_ptr, evalresp_stage *stage_ptr, evalre
 
   /* remember to allocate enough space for the number of poles to follow */
 
-  blkt_ptr->blkt_info.pole_zero.poles = alloc_complex (npoles, log);
+  blkt_ptr->blkt_info.pole_zero.poles = alloc_complex (npoles, NULL, log);
 
   /* set the expected field to the current value (14 or 15 for [53] or [43])
      to the current value - 4 (10 or 11 for [53] or [43] respectively) */
@@ -379,7 +379,7 @@ parse_iir_coeff (FILE *fptr, evalresp_blkt *blkt_ptr, evalresp_stage *stage_ptr,
 
   /* remember to allocate enough space for the number of coefficients to follow */
 
-  blkt_ptr->blkt_info.coeff.numer = alloc_double (ncoeffs, log);
+  blkt_ptr->blkt_info.coeff.numer = alloc_double (ncoeffs, NULL, log);
 
   /* set the expected field to the current value (8 or 9 for [54] or [44])
      to the current value + 2 (10 or 11 for [54] or [44] respectively) */
@@ -407,7 +407,7 @@ parse_iir_coeff (FILE *fptr, evalresp_blkt *blkt_ptr, evalresp_stage *stage_ptr,
 
   /* remember to allocate enough space for the number of coefficients to follow */
 
-  blkt_ptr->blkt_info.coeff.denom = alloc_double (ndenom, log);
+  blkt_ptr->blkt_info.coeff.denom = alloc_double (ndenom, NULL, log);
 
   /* set the expected field to the current value (10 or 11 for [54] or [44])
      to the current value - 2 (8 or 9 for [54] or [44] respectively) */
@@ -548,7 +548,7 @@ parse_coeff (FILE *fptr, evalresp_blkt *blkt_ptr, evalresp_stage *stage_ptr, eva
 
   /* remember to allocate enough space for the number of coefficients to follow */
 
-  blkt_ptr->blkt_info.fir.coeffs = alloc_double (ncoeffs, log);
+  blkt_ptr->blkt_info.fir.coeffs = alloc_double (ncoeffs, NULL, log);
 
   /* set the expected field to the current value (8 or 9 for [54] or [44])
      to the current value + 2 (10 or 11 for [54] or [44] respectively) */
@@ -685,9 +685,9 @@ parse_list (FILE *fptr, evalresp_blkt *blkt_ptr, evalresp_stage *stage_ptr, eval
   /* remember to allocate enough space for the number frequency, amplitude, phase tuples
      that follow */
 
-  blkt_ptr->blkt_info.list.freq = alloc_double (nresp, log);
-  blkt_ptr->blkt_info.list.amp = alloc_double (nresp, log);
-  blkt_ptr->blkt_info.list.phase = alloc_double (nresp, log);
+  blkt_ptr->blkt_info.list.freq = alloc_double (nresp, NULL, log);
+  blkt_ptr->blkt_info.list.amp = alloc_double (nresp, NULL, log);
+  blkt_ptr->blkt_info.list.phase = alloc_double (nresp, NULL, log);
 
   /* then get the response information */
 
@@ -882,8 +882,8 @@ parse_generic (FILE *fptr, evalresp_blkt *blkt_ptr, evalresp_stage *stage_ptr, e
   /* remember to allocate enough space for the number corner_frequency, corner_slope pairs
      that follow */
 
-  blkt_ptr->blkt_info.generic.corner_freq = alloc_double (ncorners, log);
-  blkt_ptr->blkt_info.generic.corner_slope = alloc_double (ncorners, log);
+  blkt_ptr->blkt_info.generic.corner_freq = alloc_double (ncorners, NULL, log);
+  blkt_ptr->blkt_info.generic.corner_slope = alloc_double (ncorners, NULL, log);
 
   /* then get the response information */
 
@@ -1420,7 +1420,7 @@ parse_fir (FILE *fptr, evalresp_blkt *blkt_ptr, evalresp_stage *stage_ptr, evalr
 
   /* remember to allocate enough space for the number of coefficients to follow */
 
-  blkt_ptr->blkt_info.fir.coeffs = alloc_double (ncoeffs, log);
+  blkt_ptr->blkt_info.fir.coeffs = alloc_double (ncoeffs, NULL, log);
 
   /* the coefficients */
 
@@ -1530,31 +1530,31 @@ parse_ref (FILE *fptr, evalresp_blkt *blkt_ptr, evalresp_stage *stage_ptr, evalr
       switch (blkt_no)
       {
       case 43:
-        blkt_ptr = alloc_pz (log);
+        blkt_ptr = alloc_pz (NULL, log);
         parse_pz (fptr, blkt_ptr, this_stage, log);
         break;
       case 44:
-        blkt_ptr = alloc_fir (log);
+        blkt_ptr = alloc_fir (NULL, log);
         parse_coeff (fptr, blkt_ptr, this_stage, log);
         break;
       case 45:
-        blkt_ptr = alloc_list (log);
+        blkt_ptr = alloc_list (NULL, log);
         parse_list (fptr, blkt_ptr, this_stage, log);
         break;
       case 46:
-        blkt_ptr = alloc_generic (log);
+        blkt_ptr = alloc_generic (NULL, log);
         parse_generic (fptr, blkt_ptr, this_stage, log);
         break;
       case 47:
-        blkt_ptr = alloc_deci (log);
+        blkt_ptr = alloc_deci (NULL, log);
         parse_deci (fptr, blkt_ptr, log);
         break;
       case 48:
-        blkt_ptr = alloc_gain (log);
+        blkt_ptr = alloc_gain (NULL, log);
         parse_gain (fptr, blkt_ptr, log);
         break;
       case 41:
-        blkt_ptr = alloc_fir (log);
+        blkt_ptr = alloc_fir (NULL, log);
         parse_fir (fptr, blkt_ptr, this_stage, log);
         break;
       case 60:
@@ -1584,8 +1584,8 @@ parse_ref (FILE *fptr, evalresp_blkt *blkt_ptr, evalresp_stage *stage_ptr, evalr
              for that stage to point to a new blockette [60] type filter */
 
       last_stage = this_stage;
-      this_stage = alloc_stage (log);
-      blkt_ptr = alloc_ref (log);
+      this_stage = alloc_stage (NULL, log);
+      blkt_ptr = alloc_ref (NULL, log);
       last_stage->next_stage = this_stage;
       this_stage->first_blkt = blkt_ptr;
 
@@ -1633,10 +1633,10 @@ parse_channel (FILE *fptr, evalresp_channel *chan, evalresp_logger *log)
 
   last_stage = (evalresp_stage *)NULL;
   curr_seq_no = last_seq_no = 0;
-  this_stage = alloc_stage (log);
+  this_stage = alloc_stage (NULL, log);
   chan->first_stage = this_stage;
   chan->nstages++;
-  tmp_stage = alloc_stage (log);
+  tmp_stage = alloc_stage (NULL, log);
 
   /* start processing the response information */
 
@@ -1645,7 +1645,7 @@ parse_channel (FILE *fptr, evalresp_channel *chan, evalresp_logger *log)
     switch (blkt_no)
     {
     case 53:
-      blkt_ptr = alloc_pz (log);
+      blkt_ptr = alloc_pz (NULL, log);
       parse_pz (fptr, blkt_ptr, tmp_stage, log);
       curr_seq_no = tmp_stage->sequence_no;
       break;
@@ -1654,48 +1654,48 @@ parse_channel (FILE *fptr, evalresp_channel *chan, evalresp_logger *log)
       /*The field 10 should be distinguish between the IIR and FIR */
       if (is_IIR_coeffs (fptr, ftell (fptr)))
       { /*IGD New IIR case */
-        blkt_ptr = alloc_coeff (log);
+        blkt_ptr = alloc_coeff (NULL, log);
         parse_iir_coeff (fptr, blkt_ptr, tmp_stage, log);
       }
       else
       { /*IGD this is the original case here */
-        blkt_ptr = alloc_fir (log);
+        blkt_ptr = alloc_fir (NULL, log);
         parse_coeff (fptr, blkt_ptr, tmp_stage, log);
       }
       curr_seq_no = tmp_stage->sequence_no;
       break;
     case 55:
-      blkt_ptr = alloc_list (log);
+      blkt_ptr = alloc_list (NULL, log);
       parse_list (fptr, blkt_ptr, tmp_stage, log);
       curr_seq_no = tmp_stage->sequence_no;
       break;
     case 56:
-      blkt_ptr = alloc_generic (log);
+      blkt_ptr = alloc_generic (NULL, log);
       parse_generic (fptr, blkt_ptr, tmp_stage, log);
       curr_seq_no = tmp_stage->sequence_no;
       break;
     case 57:
-      blkt_ptr = alloc_deci (log);
+      blkt_ptr = alloc_deci (NULL, log);
       curr_seq_no = parse_deci (fptr, blkt_ptr, log);
       break;
     case 58:
-      blkt_ptr = alloc_gain (log);
+      blkt_ptr = alloc_gain (NULL, log);
       curr_seq_no = parse_gain (fptr, blkt_ptr, log);
       break;
     case 60: /* never see a blockette [41], [43]-[48] without a [60], parse_ref handles these */
-      blkt_ptr = alloc_ref (log);
-      tmp_stage2 = alloc_stage (log);
+      blkt_ptr = alloc_ref (NULL, log);
+      tmp_stage2 = alloc_stage (NULL, log);
       parse_ref (fptr, blkt_ptr, tmp_stage2, log);
       curr_seq_no = tmp_stage2->sequence_no;
       tmp_stage2->first_blkt = blkt_ptr;
       break;
     case 61:
-      blkt_ptr = alloc_fir (log);
+      blkt_ptr = alloc_fir (NULL, log);
       parse_fir (fptr, blkt_ptr, tmp_stage, log);
       curr_seq_no = tmp_stage->sequence_no;
       break;
     case 62:
-      blkt_ptr = alloc_polynomial (log);
+      blkt_ptr = alloc_polynomial (NULL, log);
       parse_polynomial (fptr, blkt_ptr, tmp_stage, log);
       curr_seq_no = tmp_stage->sequence_no;
       break;
@@ -1722,7 +1722,7 @@ parse_channel (FILE *fptr, evalresp_channel *chan, evalresp_logger *log)
       {
         chan->nstages++;
         last_stage = this_stage;
-        this_stage = alloc_stage (log);
+        this_stage = alloc_stage (NULL, log);
         this_stage->sequence_no = curr_seq_no;
         last_stage->next_stage = this_stage;
         this_stage->first_blkt = blkt_ptr;
@@ -7,7 +7,7 @@ BIN_DIR=$INSTALL_DIR/bin
 LIB_DIR=$INSTALL_DIR/lib
 
 echo "compiling evtest"
-gfortran evtest.f -L $LIB_DIR -g -o evtest -levalresp -levalresp_log -lmxmlev -lspline
+gfortran evtest.f -L $LIB_DIR -g -o evtest -levalresp -levalresp_log -lmxmlev -lspline -lpthread
 
 echo "running evtest"
 LD_LIBRARY_PATH=$LIB_DIR ./evtest